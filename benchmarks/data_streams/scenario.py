@@ -0,0 +1,48 @@
+import threading
+from typing import Callable  # noqa:F401
+from typing import Generator  # noqa:F401
+
+import bm
+
+from ddtrace.internal.datastreams.processor import DataStreamsProcessor
+
+
+class DataStreams(bm.Scenario):
+    nthreads = bm.var(type=int)
+    ncheckpoints = bm.var(type=int)
+    npathways = bm.var(type=int)
+    flush = bm.var_bool()
+
+    def run(self):
+        # type: () -> Generator[Callable[[int], None], None, None]
+        processor = DataStreamsProcessor("http://localhost:8126")
+        # Flushes are driven by the scenario, and never sent
+        processor.stop()
+        processor._flush_stats_with_backoff = lambda payload: None
+
+        edge_tags = [["direction:out", "topic:topic-%d" % i, "type:kafka"] for i in range(self.npathways)]
+        # Each thread creates ncheckpoints checkpoints, so the total work grows with the number of threads
+        ncheckpoints = self.ncheckpoints
+        now = 1642544540.0
+
+        def create_checkpoints():
+            # type: () -> None
+            for i in range(ncheckpoints):
+                processor.on_checkpoint_creation(i % 7, 1, edge_tags[i % len(edge_tags)], now, 0.1, 1.0, 128)
+                processor.track_kafka_produce("topic", i % 4, i, now)
+
+        def _(loops):
+            # type: (int) -> None
+            for _ in range(loops):
+                threads = [threading.Thread(target=create_checkpoints) for _ in range(self.nthreads)]
+                for t in threads:
+                    t.start()
+                if self.flush:
+                    # Flush concurrently with the producers, as the periodic thread does
+                    while any(t.is_alive() for t in threads):
+                        processor.periodic()
+                for t in threads:
+                    t.join()
+                processor.periodic()
+
+        yield _
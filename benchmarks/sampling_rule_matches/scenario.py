@@ -5,6 +5,7 @@ import string
 import bm
 
 from ddtrace._trace.span import Span
+from ddtrace.sampler import DatadogSampler
 from ddtrace.sampling_rule import SamplingRule
 
 
@@ -29,6 +30,7 @@ class SamplingRules(bm.Scenario):
     num_operations = bm.var(type=int)
     num_resources = bm.var(type=int)
     num_tags = bm.var(type=int)
+    num_rules = bm.var(type=int)
 
     def run(self):
         # Generate random service and operation names for the counts we requested
@@ -55,6 +57,28 @@ class SamplingRules(bm.Scenario):
             sample_rate=1.0,
         )
 
+        if self.num_rules > 1:
+            # Rules with globs which never match, before a catch-all one, all evaluated through the sampler
+            rules = [
+                SamplingRule(
+                    sample_rate=0.5,
+                    service=rands() + "*",
+                    name="*" + rands(),
+                    resource=rands(3) + "?" + rands(3) + "*",
+                )
+                for _ in range(self.num_rules - 1)
+            ]
+            rules.append(SamplingRule(sample_rate=1.0, service="*", name="*", resource="*"))
+            sampler = DatadogSampler(rules=rules)
+
+            def _(loops):
+                for _ in range(loops):
+                    for span in iter_n(spans, n=self.num_iterations):
+                        sampler.sample(span)
+
+            yield _
+            return
+
         def _(loops):
             for _ in range(loops):
                 for span in iter_n(spans, n=self.num_iterations):
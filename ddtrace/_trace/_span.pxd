@@ -0,0 +1,52 @@
+from libc.stdint cimport int32_t
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint32_t
+from libc.stdint cimport uint64_t
+
+
+# Bits of the fields of SpanData in _set_fields and _raw_fields
+cdef enum:
+    SPAN_FIELD_NAME = 1 << 0
+    SPAN_FIELD_SERVICE = 1 << 1
+    SPAN_FIELD_RESOURCE = 1 << 2
+    SPAN_FIELD_SPAN_TYPE = 1 << 3
+    SPAN_FIELD_TRACE_ID = 1 << 4
+    SPAN_FIELD_SPAN_ID = 1 << 5
+    SPAN_FIELD_PARENT_ID = 1 << 6
+    SPAN_FIELD_START_NS = 1 << 7
+    SPAN_FIELD_DURATION_NS = 1 << 8
+    SPAN_FIELD_ERROR = 1 << 9
+    SPAN_FIELD_META = 1 << 10
+    SPAN_FIELD_METRICS = 1 << 11
+    SPAN_FIELD_META_STRUCT = 1 << 12
+    SPAN_FIELD_LINKS = 1 << 13
+
+
+cdef class SpanData:
+    # Fields which have been set: reading the others raises AttributeError
+    cdef uint32_t _set_fields
+    # Integer fields whose value does not fit the C field, and which are kept as is in _raw_values
+    cdef uint32_t _raw_fields
+    cdef dict _raw_values
+
+    cdef object _c_name
+    cdef object _c_service
+    cdef list _c_resource
+    cdef object _c_span_type
+    cdef object _c_trace_id
+    cdef uint64_t _c_trace_id_64bits
+    cdef uint64_t _c_span_id
+    cdef uint64_t _c_parent_id
+    cdef bint _has_parent_id
+    cdef int64_t _c_start_ns
+    cdef int64_t _c_duration_ns
+    cdef bint _finished
+    cdef int32_t _c_error
+    cdef dict _c_meta
+    cdef dict _c_metrics
+    cdef dict _c_meta_struct
+    cdef dict _c_links
+
+    cdef object _get(self, uint32_t field, str name)
+    cdef int _set_raw(self, uint32_t field, object value) except -1
+    cdef int _clear_raw(self, uint32_t field) except -1
@@ -0,0 +1,22 @@
+from typing import Any
+from typing import Dict
+from typing import List
+from typing import Optional
+
+class SpanData:
+    name: Any
+    service: Optional[str]
+    _resource: List[Any]
+    span_type: Optional[str]
+    trace_id: int
+    @property
+    def _trace_id_64bits(self) -> int: ...
+    span_id: int
+    parent_id: Optional[int]
+    start_ns: int
+    duration_ns: Optional[int]
+    error: int
+    _meta: Dict[Any, Any]
+    _metrics: Dict[Any, Any]
+    _meta_struct: Dict[str, Dict[str, Any]]
+    _links: Dict[int, Any]
@@ -0,0 +1,273 @@
+from libc.stdint cimport uint32_t
+from libc.stdint cimport uint64_t
+
+
+cdef inline object _unset_field(SpanData span, str name):
+    # Like an unset slot
+    raise AttributeError("'%s' object has no attribute '%s'" % (type(span).__name__, name))
+
+
+cdef class SpanData:
+    """The fields of a span that are read by the encoders and the trace processors.
+
+    The ids, timestamps and error flag are kept as C integers and the tags in exact dicts, so that the encoders can read
+    them without looking up attributes. The parent id and the duration are None until they are set. Integer values
+    that do not fit their C field, or values of other types, are kept as they are, and the encoders pack them as they
+    did before the fields were native.
+    """
+
+    cdef object _get(self, uint32_t field, str name):
+        if not self._set_fields & field:
+            return _unset_field(self, name)
+        return self._raw_values[field]
+
+    cdef int _set_raw(self, uint32_t field, object value) except -1:
+        if self._raw_values is None:
+            self._raw_values = {}
+        self._raw_values[field] = value
+        self._raw_fields |= field
+        self._set_fields |= field
+        return 0
+
+    cdef int _clear_raw(self, uint32_t field) except -1:
+        if self._raw_fields & field:
+            del self._raw_values[field]
+            self._raw_fields &= ~field
+        self._set_fields |= field
+        return 0
+
+    @property
+    def name(self):
+        if not self._set_fields & SPAN_FIELD_NAME:
+            return _unset_field(self, "name")
+        return self._c_name
+
+    @name.setter
+    def name(self, value):
+        self._c_name = value
+        self._set_fields |= SPAN_FIELD_NAME
+
+    @property
+    def service(self):
+        # type: () -> typing.Optional[str]
+        if not self._set_fields & SPAN_FIELD_SERVICE:
+            return _unset_field(self, "service")
+        return self._c_service
+
+    @service.setter
+    def service(self, value):
+        # type: (typing.Optional[str]) -> None
+        self._c_service = value
+        self._set_fields |= SPAN_FIELD_SERVICE
+
+    @property
+    def _resource(self):
+        # type: () -> typing.List[typing.Any]
+        if not self._set_fields & SPAN_FIELD_RESOURCE:
+            return _unset_field(self, "_resource")
+        return self._c_resource
+
+    @_resource.setter
+    def _resource(self, list value):
+        # type: (typing.List[typing.Any]) -> None
+        self._c_resource = value
+        self._set_fields |= SPAN_FIELD_RESOURCE
+
+    @property
+    def span_type(self):
+        # type: () -> typing.Optional[str]
+        if not self._set_fields & SPAN_FIELD_SPAN_TYPE:
+            return _unset_field(self, "span_type")
+        return self._c_span_type
+
+    @span_type.setter
+    def span_type(self, value):
+        # type: (typing.Optional[str]) -> None
+        self._c_span_type = value
+        self._set_fields |= SPAN_FIELD_SPAN_TYPE
+
+    @property
+    def trace_id(self):
+        # type: () -> int
+        if not self._set_fields & SPAN_FIELD_TRACE_ID:
+            return _unset_field(self, "trace_id")
+        return self._c_trace_id
+
+    @trace_id.setter
+    def trace_id(self, value):
+        # type: (int) -> None
+        try:
+            self._c_trace_id_64bits = <uint64_t>(value & 0xFFFFFFFFFFFFFFFF)
+        except (TypeError, OverflowError):
+            # The lower bits are computed when they are read, which raises like it did before
+            self._set_raw(SPAN_FIELD_TRACE_ID, value)
+        else:
+            self._clear_raw(SPAN_FIELD_TRACE_ID)
+        self._c_trace_id = value
+
+    @property
+    def _trace_id_64bits(self):
+        # type: () -> int
+        if not self._set_fields & SPAN_FIELD_TRACE_ID:
+            return _unset_field(self, "_trace_id_64bits")
+        if self._raw_fields & SPAN_FIELD_TRACE_ID:
+            return self._c_trace_id & 0xFFFFFFFFFFFFFFFF
+        return self._c_trace_id_64bits
+
+    @property
+    def span_id(self):
+        # type: () -> int
+        if self._raw_fields & SPAN_FIELD_SPAN_ID or not self._set_fields & SPAN_FIELD_SPAN_ID:
+            return self._get(SPAN_FIELD_SPAN_ID, "span_id")
+        return self._c_span_id
+
+    @span_id.setter
+    def span_id(self, value):
+        # type: (int) -> None
+        if isinstance(value, int):
+            try:
+                self._c_span_id = value
+            except OverflowError:
+                pass
+            else:
+                self._clear_raw(SPAN_FIELD_SPAN_ID)
+                return
+        self._set_raw(SPAN_FIELD_SPAN_ID, value)
+
+    @property
+    def parent_id(self):
+        # type: () -> typing.Optional[int]
+        if self._raw_fields & SPAN_FIELD_PARENT_ID or not self._set_fields & SPAN_FIELD_PARENT_ID:
+            return self._get(SPAN_FIELD_PARENT_ID, "parent_id")
+        if not self._has_parent_id:
+            return None
+        return self._c_parent_id
+
+    @parent_id.setter
+    def parent_id(self, value):
+        # type: (typing.Optional[int]) -> None
+        self._has_parent_id = value is not None
+        if value is None or isinstance(value, int):
+            try:
+                self._c_parent_id = value or 0
+            except OverflowError:
+                pass
+            else:
+                self._clear_raw(SPAN_FIELD_PARENT_ID)
+                return
+        self._set_raw(SPAN_FIELD_PARENT_ID, value)
+
+    @property
+    def start_ns(self):
+        # type: () -> int
+        if self._raw_fields & SPAN_FIELD_START_NS or not self._set_fields & SPAN_FIELD_START_NS:
+            return self._get(SPAN_FIELD_START_NS, "start_ns")
+        return self._c_start_ns
+
+    @start_ns.setter
+    def start_ns(self, value):
+        # type: (int) -> None
+        if isinstance(value, int):
+            try:
+                self._c_start_ns = value
+            except OverflowError:
+                pass
+            else:
+                self._clear_raw(SPAN_FIELD_START_NS)
+                return
+        self._set_raw(SPAN_FIELD_START_NS, value)
+
+    @property
+    def duration_ns(self):
+        # type: () -> typing.Optional[int]
+        if self._raw_fields & SPAN_FIELD_DURATION_NS or not self._set_fields & SPAN_FIELD_DURATION_NS:
+            return self._get(SPAN_FIELD_DURATION_NS, "duration_ns")
+        if not self._finished:
+            return None
+        return self._c_duration_ns
+
+    @duration_ns.setter
+    def duration_ns(self, value):
+        # type: (typing.Optional[int]) -> None
+        self._finished = value is not None
+        if value is None or isinstance(value, int):
+            try:
+                self._c_duration_ns = value or 0
+            except OverflowError:
+                pass
+            else:
+                self._clear_raw(SPAN_FIELD_DURATION_NS)
+                return
+        self._set_raw(SPAN_FIELD_DURATION_NS, value)
+
+    @property
+    def error(self):
+        # type: () -> int
+        if self._raw_fields & SPAN_FIELD_ERROR or not self._set_fields & SPAN_FIELD_ERROR:
+            return self._get(SPAN_FIELD_ERROR, "error")
+        return self._c_error
+
+    @error.setter
+    def error(self, value):
+        # type: (int) -> None
+        if isinstance(value, int):
+            try:
+                self._c_error = value
+            except OverflowError:
+                pass
+            else:
+                self._clear_raw(SPAN_FIELD_ERROR)
+                return
+        self._set_raw(SPAN_FIELD_ERROR, value)
+
+    @property
+    def _meta(self):
+        # type: () -> typing.Dict[typing.Any, typing.Any]
+        if not self._set_fields & SPAN_FIELD_META:
+            return _unset_field(self, "_meta")
+        return self._c_meta
+
+    @_meta.setter
+    def _meta(self, dict value):
+        # type: (typing.Dict[typing.Any, typing.Any]) -> None
+        self._c_meta = value
+        self._set_fields |= SPAN_FIELD_META
+
+    @property
+    def _metrics(self):
+        # type: () -> typing.Dict[typing.Any, typing.Any]
+        if not self._set_fields & SPAN_FIELD_METRICS:
+            return _unset_field(self, "_metrics")
+        return self._c_metrics
+
+    @_metrics.setter
+    def _metrics(self, dict value):
+        # type: (typing.Dict[typing.Any, typing.Any]) -> None
+        self._c_metrics = value
+        self._set_fields |= SPAN_FIELD_METRICS
+
+    @property
+    def _meta_struct(self):
+        # type: () -> typing.Dict[str, typing.Dict[str, typing.Any]]
+        if not self._set_fields & SPAN_FIELD_META_STRUCT:
+            return _unset_field(self, "_meta_struct")
+        return self._c_meta_struct
+
+    @_meta_struct.setter
+    def _meta_struct(self, dict value):
+        # type: (typing.Dict[str, typing.Dict[str, typing.Any]]) -> None
+        self._c_meta_struct = value
+        self._set_fields |= SPAN_FIELD_META_STRUCT
+
+    @property
+    def _links(self):
+        # type: () -> typing.Dict[int, typing.Any]
+        if not self._set_fields & SPAN_FIELD_LINKS:
+            return _unset_field(self, "_links")
+        return self._c_links
+
+    @_links.setter
+    def _links(self, dict value):
+        # type: (typing.Dict[int, typing.Any]) -> None
+        self._c_links = value
+        self._set_fields |= SPAN_FIELD_LINKS
@@ -16,6 +16,7 @@ from ddtrace.internal.constants import W3C_TRACEPARENT_KEY
 from ddtrace.internal.constants import W3C_TRACESTATE_KEY
 from ddtrace.internal.logger import get_logger
 from ddtrace.internal.utils.http import w3c_get_dd_list_member as _w3c_get_dd_list_member
+from ddtrace.propagation._codec import replace_dd_member as _replace_dd_member
 
 
 if TYPE_CHECKING:  # pragma: no cover
@@ -173,11 +174,7 @@ class Context(object):
         ts = self._meta.get(W3C_TRACESTATE_KEY, "")
         if ts and dd_list_member:
             # cut out the original dd list member from tracestate so we can replace it with the new one we created
-            ts_w_out_dd = re.sub("dd=(.+?)(?:,|$)", "", ts)
-            if ts_w_out_dd:
-                ts = "dd={},{}".format(dd_list_member, ts_w_out_dd)
-            else:
-                ts = "dd={}".format(dd_list_member)
+            ts = _replace_dd_member(ts, dd_list_member)
         # if there is no original tracestate value then tracestate is just the dd list member we created
         elif dd_list_member:
             ts = "dd={}".format(dd_list_member)
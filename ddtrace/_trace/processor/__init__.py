@@ -1,16 +1,15 @@
 import abc
-from collections import defaultdict
-from threading import Lock
-from threading import RLock
+import logging
 from typing import Dict  # noqa:F401
 from typing import Iterable  # noqa:F401
 from typing import List  # noqa:F401
 from typing import Optional  # noqa:F401
-from typing import Union  # noqa:F401
 
 import attr
 
 from ddtrace import config
+from ddtrace._trace.processor._trace_buffer import SpanCounts
+from ddtrace._trace.processor._trace_buffer import TraceBuffer
 from ddtrace._trace.span import Span  # noqa:F401
 from ddtrace._trace.span import _get_64_highest_order_bits_as_hex
 from ddtrace._trace.span import _is_top_level
@@ -31,11 +30,6 @@ if config._telemetry_enabled:
     from ddtrace.internal import telemetry
     from ddtrace.internal.telemetry.constants import TELEMETRY_NAMESPACE_TAG_TRACER
 
-try:
-    from typing import DefaultDict  # noqa:F401
-except ImportError:
-    from collections import defaultdict as DefaultDict
-
 log = get_logger(__name__)
 
 
@@ -260,92 +254,62 @@ class SpanAggregator(SpanProcessor):
           the trace_id have finished; or
         - A minimum threshold of spans (``partial_flush_min_spans``) have been
           finished in the collection and ``partial_flush_enabled`` is True.
-    """
 
-    @attr.s
-    class _Trace(object):
-        spans = attr.ib(default=attr.Factory(list))  # type: List[Span]
-        num_finished = attr.ib(type=int, default=0)  # type: int
+    The spans are aggregated in a native buffer which needs no lock, and the
+    trace processors and the writer are run on the flushed spans outside of it.
+    """
 
     _partial_flush_enabled = attr.ib(type=bool)
     _partial_flush_min_spans = attr.ib(type=int)
     _trace_processors = attr.ib(type=Iterable[TraceProcessor])
     _writer = attr.ib(type=TraceWriter)
-    _traces = attr.ib(
-        factory=lambda: defaultdict(lambda: SpanAggregator._Trace()),
-        init=False,
-        type=DefaultDict[int, "_Trace"],
-        repr=False,
-    )
-    if config._span_aggregator_rlock:
-        _lock = attr.ib(init=False, factory=RLock, repr=False, type=Union[RLock, Lock])
-    else:
-        _lock = attr.ib(init=False, factory=Lock, repr=False, type=Union[RLock, Lock])
+    _traces = attr.ib(init=False, factory=TraceBuffer, repr=False, type=TraceBuffer)
     # Tracks the number of spans created and tags each count with the api that was used
     # ex: otel api, opentracing api, datadog api
     _span_metrics = attr.ib(
         init=False,
-        factory=lambda: {
-            "spans_created": defaultdict(int),
-            "spans_finished": defaultdict(int),
-        },
-        type=Dict[str, DefaultDict],
+        default=attr.Factory(
+            lambda self: {
+                "spans_created": self._traces.created,
+                "spans_finished": self._traces.finished,
+            },
+            takes_self=True,
+        ),
+        type=Dict[str, SpanCounts],
     )
 
     def on_span_start(self, span):
         # type: (Span) -> None
-        with self._lock:
-            trace = self._traces[span.trace_id]
-            trace.spans.append(span)
-            self._span_metrics["spans_created"][span._span_api] += 1
-            self._queue_span_count_metrics("spans_created", "integration_name")
+        self._traces.add(span, span._span_api)
+        self._queue_span_count_metrics("spans_created", "integration_name")
 
     def on_span_finish(self, span):
         # type: (Span) -> None
-        with self._lock:
-            self._span_metrics["spans_finished"][span._span_api] += 1
-            trace = self._traces[span.trace_id]
-            trace.num_finished += 1
-            should_partial_flush = self._partial_flush_enabled and trace.num_finished >= self._partial_flush_min_spans
-            if trace.num_finished == len(trace.spans) or should_partial_flush:
-                trace_spans = trace.spans
-                trace.spans = []
-                if trace.num_finished < len(trace_spans):
-                    finished = []
-                    for s in trace_spans:
-                        if s.finished:
-                            finished.append(s)
-                        else:
-                            trace.spans.append(s)
-                else:
-                    finished = trace_spans
-
-                num_finished = len(finished)
-
-                if should_partial_flush:
-                    log.debug("Partially flushing %d spans for trace %d", num_finished, span.trace_id)
-                    finished[0].set_metric("_dd.py.partial_flush", num_finished)
-
-                trace.num_finished -= num_finished
-
-                if len(trace.spans) == 0:
-                    del self._traces[span.trace_id]
-
-                spans = finished  # type: Optional[List[Span]]
-                for tp in self._trace_processors:
-                    try:
-                        if spans is None:
-                            return
-                        spans = tp.process_trace(spans)
-                    except Exception:
-                        log.error("error applying processor %r", tp, exc_info=True)
-
-                self._queue_span_count_metrics("spans_finished", "integration_name")
-                self._writer.write(spans)
-                return
-
-            log.debug("trace %d has %d spans, %d finished", span.trace_id, len(trace.spans), trace.num_finished)
-            return None
+        flushed = self._traces.finish(span, span._span_api, self._partial_flush_enabled, self._partial_flush_min_spans)
+        if flushed is None:
+            if log.isEnabledFor(logging.DEBUG):
+                counts = self._traces.spans(span.trace_id)
+                if counts is not None:
+                    log.debug("trace %d has %d spans, %d finished", span.trace_id, *counts)
+            return
+
+        finished, partial_flush = flushed
+        if partial_flush:
+            num_finished = len(finished)
+            log.debug("Partially flushing %d spans for trace %d", num_finished, span.trace_id)
+            finished[0].set_metric("_dd.py.partial_flush", num_finished)
+
+        spans = finished  # type: Optional[List[Span]]
+        for tp in self._trace_processors:
+            try:
+                if spans is None:
+                    return
+                spans = tp.process_trace(spans)
+            except Exception:
+                log.error("error applying processor %r", tp, exc_info=True)
+
+        self._queue_span_count_metrics("spans_finished", "integration_name")
+        self._writer.write(spans)
 
     def shutdown(self, timeout):
         # type: (Optional[float]) -> None
@@ -357,7 +321,9 @@ class SpanAggregator(SpanProcessor):
             before exiting or :obj:`None` to block until flushing has successfully completed (default: :obj:`None`)
         :type timeout: :obj:`int` | :obj:`float` | :obj:`None`
         """
-        if config._telemetry_enabled and (self._span_metrics["spans_created"] or self._span_metrics["spans_finished"]):
+        if config._telemetry_enabled and (
+            self._span_metrics["spans_created"].total or self._span_metrics["spans_finished"].total
+        ):
             telemetry.telemetry_writer._is_periodic = False
             telemetry.telemetry_writer._enabled = True
             # on_span_start queue span created counts in batches of 100. This ensures all remaining counts are sent
@@ -379,9 +345,8 @@ class SpanAggregator(SpanProcessor):
         """Queues a telemetry count metric for span created and span finished"""
         # perf: telemetry_metrics_writer.add_count_metric(...) is an expensive operation.
         # We should avoid calling this method on every invocation of span finish and span start.
-        if config._telemetry_enabled and sum(self._span_metrics[metric_name].values()) >= min_count:
-            for tag_value, count in self._span_metrics[metric_name].items():
+        if config._telemetry_enabled and self._span_metrics[metric_name].total >= min_count:
+            for tag_value, count in self._span_metrics[metric_name].take().items():
                 telemetry.telemetry_writer.add_count_metric(
                     TELEMETRY_NAMESPACE_TAG_TRACER, metric_name, count, tags=((tag_name, tag_value),)
                 )
-            self._span_metrics[metric_name] = defaultdict(int)
@@ -0,0 +1,23 @@
+from typing import Dict
+from typing import List
+from typing import Optional
+from typing import Tuple
+
+from ddtrace._trace.span import Span
+
+class SpanCounts:
+    @property
+    def total(self) -> int: ...
+    def take(self) -> Dict[str, int]: ...
+
+class TraceBuffer:
+    @property
+    def created(self) -> SpanCounts: ...
+    @property
+    def finished(self) -> SpanCounts: ...
+    def __len__(self) -> int: ...
+    def add(self, span: Span, span_api: str) -> None: ...
+    def finish(
+        self, span: Span, span_api: str, partial_flush_enabled: bool, partial_flush_min_spans: int
+    ) -> Optional[Tuple[List[Span], bool]]: ...
+    def spans(self, trace_id: int) -> Optional[Tuple[int, int]]: ...
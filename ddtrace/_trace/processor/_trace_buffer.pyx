@@ -0,0 +1,141 @@
+"""
+Spans of the traces in progress, aggregated until they are flushed to the writer.
+
+Spans are added and finished without a lock: the bookkeeping neither releases the GIL nor runs any Python code, as the
+objects it needs are allocated before the state is updated, and the references it drops are not the last ones. This
+keeps the garbage collector, and so finalizers that could finish spans, from running in the middle of an update.
+"""
+from cpython.dict cimport PyDict_DelItem
+from cpython.dict cimport PyDict_GetItem
+from cpython.dict cimport PyDict_SetItem
+from cpython.ref cimport PyObject
+
+from ddtrace._trace._span cimport SpanData
+
+
+cdef extern from "Python.h":
+    # Returns a borrowed reference
+    PyObject* PyDict_SetDefault(object d, object key, object default) except NULL
+
+
+cdef class _Trace:
+    cdef list spans
+    cdef Py_ssize_t num_finished
+
+    def __cinit__(self):
+        self.spans = []
+
+
+cdef class SpanCounts:
+    """Number of spans, by span API."""
+
+    cdef dict _counts
+    cdef readonly Py_ssize_t total
+
+    def __cinit__(self):
+        self._counts = {}
+
+    cdef int add(self, object span_api) except -1:
+        # Counts are ints, which are not tracked by the garbage collector
+        cdef PyObject* count = PyDict_GetItem(self._counts, span_api)
+        PyDict_SetItem(self._counts, span_api, 1 if count is NULL else <object>count + 1)
+        self.total += 1
+        return 0
+
+    cpdef dict take(self):
+        # type: () -> typing.Dict[str, int]
+        """Return the counts so far, which are reset."""
+        cdef dict counts = {}
+        cdef dict taken = self._counts
+        self._counts = counts
+        self.total = 0
+        return taken
+
+
+cdef class TraceBuffer:
+    """Spans of the traces in progress, by trace id."""
+
+    cdef dict _traces
+    cdef readonly SpanCounts created
+    cdef readonly SpanCounts finished
+
+    def __cinit__(self):
+        self._traces = {}
+        self.created = SpanCounts()
+        self.finished = SpanCounts()
+
+    def __len__(self):
+        return len(self._traces)
+
+    cpdef add(self, SpanData span, object span_api):
+        # type: (Span, str) -> None
+        """Add a started span to its trace."""
+        cdef PyObject* found = PyDict_GetItem(self._traces, span._c_trace_id)
+        cdef _Trace trace
+        if found is NULL:
+            trace = _Trace()
+            found = PyDict_SetDefault(self._traces, span._c_trace_id, trace)
+        trace = <_Trace>found
+        trace.spans.append(span)
+        self.created.add(span_api)
+
+    cpdef tuple finish(
+        self, SpanData span, object span_api, bint partial_flush_enabled, Py_ssize_t partial_flush_min_spans
+    ):
+        # type: (Span, str, bool, int) -> typing.Optional[typing.Tuple[typing.List[Span], bool]]
+        """Count a finished span, and return the spans of its trace to flush, with whether they are partially flushed.
+
+        The trace is flushed once all its spans are finished or, when partial flushing is enabled, once at least
+        ``partial_flush_min_spans`` of them are, in which case only the finished spans are flushed. None is returned
+        when there is nothing to flush.
+        """
+        cdef PyObject* found
+        cdef _Trace trace
+        cdef list finished = None
+        cdef list unfinished = None
+        cdef Py_ssize_t num_finished, num_spans
+        cdef bint partial_flush
+
+        self.finished.add(span_api)
+        while True:
+            found = PyDict_GetItem(self._traces, span._c_trace_id)
+            if found is NULL:
+                return None
+            trace = <_Trace>found
+            num_finished = trace.num_finished + 1
+            num_spans = len(trace.spans)
+            partial_flush = partial_flush_enabled and num_finished >= partial_flush_min_spans
+
+            if num_finished != num_spans and not partial_flush:
+                trace.num_finished = num_finished
+                return None
+
+            if num_finished >= num_spans:
+                # The trace is referenced by this frame, so it is not deallocated with the entry
+                PyDict_DelItem(self._traces, span._c_trace_id)
+                return trace.spans, partial_flush
+
+            if finished is None:
+                # Allocating can run the garbage collector, so the trace is looked up again afterwards
+                finished = []
+                unfinished = []
+                continue
+
+            for s in trace.spans:
+                if (<SpanData>s)._finished:
+                    finished.append(s)
+                else:
+                    unfinished.append(s)
+            trace.spans = unfinished
+            trace.num_finished = num_finished - len(finished)
+            if not unfinished:
+                PyDict_DelItem(self._traces, span._c_trace_id)
+            return finished, partial_flush
+
+    def spans(self, trace_id):
+        # type: (int) -> typing.Optional[typing.Tuple[int, int]]
+        """Return the number of spans of a trace in progress, and how many of them are finished."""
+        cdef PyObject* found = PyDict_GetItem(self._traces, trace_id)
+        if found is NULL:
+            return None
+        return len((<_Trace>found).spans), (<_Trace>found).num_finished
@@ -11,6 +11,7 @@ from typing import Text  # noqa:F401
 from typing import Union  # noqa:F401
 
 from ddtrace import config
+from ddtrace._trace._span import SpanData
 from ddtrace._trace._span_link import SpanLink
 from ddtrace._trace.context import Context
 from ddtrace.constants import ANALYTICS_SAMPLE_RATE_KEY
@@ -66,31 +67,18 @@ def _get_64_highest_order_bits_as_hex(large_int):
     return "{:032x}".format(large_int)[:16]
 
 
-class Span(object):
+class Span(SpanData):
+    # The ids, timestamps, names and tags are fields of SpanData
     __slots__ = [
         # Public span attributes
-        "service",
-        "name",
-        "_resource",
         "_span_api",
-        "span_id",
-        "trace_id",
-        "parent_id",
-        "_meta",
-        "_meta_struct",
-        "error",
-        "_metrics",
         "_store",
-        "span_type",
-        "start_ns",
-        "duration_ns",
         # Internal attributes
         "_context",
         "_local_root",
         "_parent",
         "_ignored_exceptions",
         "_on_finish_callbacks",
-        "_links",
         "__weakref__",
     ]
 
@@ -203,10 +191,6 @@ class Span(object):
             return None
         return self._store.get(key)
 
-    @property
-    def _trace_id_64bits(self):
-        return _get_64_lowest_order_bits_as_int(self.trace_id)
-
     @property
     def start(self):
         # type: () -> float
@@ -15,14 +15,12 @@ LOGGER = get_logger(__name__)
 if asm_config._asm_libddwaf_available:
     try:
         from .ddwaf_types import DDWafRulesType
-        from .ddwaf_types import _observator
         from .ddwaf_types import ddwaf_config
         from .ddwaf_types import ddwaf_context_capsule
         from .ddwaf_types import ddwaf_get_version
         from .ddwaf_types import ddwaf_object
         from .ddwaf_types import ddwaf_object_free
-        from .ddwaf_types import ddwaf_result
-        from .ddwaf_types import ddwaf_run
+        from .ddwaf_types import ddwaf_object_free_fn
         from .ddwaf_types import py_ddwaf_context_init
         from .ddwaf_types import py_ddwaf_init
         from .ddwaf_types import py_ddwaf_known_addresses
@@ -92,8 +90,11 @@ if _DDWAF_LOADED:
             obfuscation_parameter_key_regexp: bytes,
             obfuscation_parameter_value_regexp: bytes,
         ):
+            # The data sent to the contexts is owned by their arena, so it must not be freed by the WAF
             config = ddwaf_config(
-                key_regex=obfuscation_parameter_key_regexp, value_regex=obfuscation_parameter_value_regexp
+                key_regex=obfuscation_parameter_key_regexp,
+                value_regex=obfuscation_parameter_value_regexp,
+                free_fn=ddwaf_object_free_fn(),
             )
             diagnostics = ddwaf_object()
             ruleset_map_object = ddwaf_object.create_without_limits(ruleset_map)
@@ -109,7 +110,6 @@ if _DDWAF_LOADED:
                     info.failed,
                     info.errors,
                 )
-            ddwaf_object_free(ctypes.byref(ruleset_map_object))
 
         @property
         def required_data(self) -> List[str]:
@@ -133,7 +133,6 @@ if _DDWAF_LOADED:
             diagnostics = ddwaf_object()
             result = py_ddwaf_update(self._handle, rules, diagnostics)
             self._set_info(diagnostics)
-            ddwaf_object_free(rules)
             if result:
                 LOGGER.debug("DDWAF.update_rules success.\ninfo %s", self.info)
                 self._handle = result
@@ -150,8 +149,10 @@ if _DDWAF_LOADED:
                 LOGGER.debug("DDWaf._at_request_start: failure to create the context.")
             return ctx
 
-        def _at_request_end(self) -> None:
-            pass
+        def _at_request_end(self, ctx: Optional[ddwaf_context_capsule]) -> None:
+            # The context is destroyed before the arena of the data it references is freed
+            if ctx is not None:
+                ctx.destroy()
 
         def run(
             self,
@@ -165,21 +166,19 @@ if _DDWAF_LOADED:
                 LOGGER.debug("DDWaf.run: dry run. no context created.")
                 return DDWaf_result([], {}, 0, (time.time() - start) * 1e6, False, 0, {})
 
-            result = ddwaf_result()
-            observator = _observator()
-            wrapper = ddwaf_object(data, observator=observator)
-            wrapper_ephemeral = ddwaf_object(ephemeral_data, observator=observator) if ephemeral_data else None
-            error = ddwaf_run(ctx.ctx, wrapper, wrapper_ephemeral, ctypes.byref(result), int(timeout_ms * 1000))
+            error, events, actions, derivatives, total_runtime, timeout, truncation = ctx.run(
+                data, ephemeral_data or None, int(timeout_ms * 1000)
+            )
             if error < 0:
-                LOGGER.debug("run DDWAF error: %d\ninput %s\nerror %s", error, wrapper.struct, self.info.errors)
+                LOGGER.debug("run DDWAF error: %d\ninput %s\nerror %s", error, data, self.info.errors)
             return DDWaf_result(
-                result.events.struct,
-                result.actions.struct,
-                result.total_runtime / 1e3,
+                events,
+                actions,
+                total_runtime / 1e3,
                 (time.time() - start) * 1e6,
-                result.timeout,
-                observator.truncation,
-                result.derivatives.struct,
+                timeout,
+                truncation,
+                derivatives,
             )
 
     def version() -> str:
@@ -216,7 +215,7 @@ else:
         def _at_request_start(self) -> None:
             return None
 
-        def _at_request_end(self) -> None:
+        def _at_request_end(self, ctx: Any) -> None:
             pass
 
     def version() -> str:
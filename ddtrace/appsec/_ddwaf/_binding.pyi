@@ -0,0 +1,17 @@
+import typing
+
+from ddtrace.appsec._ddwaf._object_arena import ObjectArena
+
+def load(context_init: int, run: int, context_destroy: int, result_free: int) -> None: ...
+
+class Context:
+    arena: ObjectArena
+    def __init__(self, handle: typing.Any, max_objects: int, max_depth: int, max_string_length: int) -> None: ...
+    def __bool__(self) -> bool: ...
+    def destroy(self) -> None: ...
+    def run(
+        self,
+        data: typing.Dict[str, typing.Any],
+        ephemeral_data: typing.Optional[typing.Dict[str, typing.Any]],
+        timeout: int,
+    ) -> typing.Tuple[int, typing.Any, typing.Any, typing.Any, int, bool, int]: ...
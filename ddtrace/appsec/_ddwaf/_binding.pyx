@@ -0,0 +1,205 @@
+"""
+Direct calls to the context API of libddwaf, with the results decoded into Python objects.
+
+The functions are resolved from the library loaded with ctypes, so that its path can still be configured. The WAF is
+run without the GIL, while a lock of the context keeps it from being run concurrently or destroyed in the meantime.
+"""
+from cpython.pythread cimport PyThread_acquire_lock
+from cpython.pythread cimport PyThread_allocate_lock
+from cpython.pythread cimport PyThread_free_lock
+from cpython.pythread cimport PyThread_release_lock
+from cpython.pythread cimport PyThread_type_lock
+from cpython.pythread cimport WAIT_LOCK
+from cpython.unicode cimport PyUnicode_DecodeUTF8
+from libc.stdint cimport uint64_t
+from libc.stdint cimport uintptr_t
+from libc.string cimport memset
+
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_ARRAY
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_BOOL
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_FLOAT
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_INVALID
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_MAP
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_NULL
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_SIGNED
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_STRING
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_UNSIGNED
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_context_destroy_fn
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_context_init_fn
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_object
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_result
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_result_free_fn
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_run_fn
+
+from ddtrace.appsec._ddwaf._object_arena import ObjectArena
+from ddtrace.internal.logger import get_logger
+
+
+log = get_logger(__name__)
+
+
+cdef ddwaf_context_init_fn _context_init = NULL
+cdef ddwaf_run_fn _run = NULL
+cdef ddwaf_context_destroy_fn _context_destroy = NULL
+cdef ddwaf_result_free_fn _result_free = NULL
+
+
+def load(uintptr_t context_init, uintptr_t run, uintptr_t context_destroy, uintptr_t result_free):
+    # type: (int, int, int, int) -> None
+    """Set the addresses of the libddwaf functions called by the contexts."""
+    global _context_init, _run, _context_destroy, _result_free
+
+    _context_init = <ddwaf_context_init_fn>context_init
+    _run = <ddwaf_run_fn>run
+    _context_destroy = <ddwaf_context_destroy_fn>context_destroy
+    _result_free = <ddwaf_result_free_fn>result_free
+
+
+cdef object _decode(const ddwaf_object* obj):
+    cdef const ddwaf_object* item
+    cdef uint64_t i
+    cdef dict map_
+    cdef list array
+
+    if obj.type == DDWAF_OBJ_STRING:
+        return PyUnicode_DecodeUTF8(obj.value.stringValue, obj.nbEntries, "ignore")
+    if obj.type == DDWAF_OBJ_MAP:
+        map_ = {}
+        for i in range(obj.nbEntries):
+            item = obj.value.array + i
+            map_[PyUnicode_DecodeUTF8(item.parameterName, item.parameterNameLength, "ignore")] = _decode(item)
+        return map_
+    if obj.type == DDWAF_OBJ_ARRAY:
+        array = []
+        for i in range(obj.nbEntries):
+            array.append(_decode(obj.value.array + i))
+        return array
+    if obj.type == DDWAF_OBJ_SIGNED:
+        return obj.value.intValue
+    if obj.type == DDWAF_OBJ_UNSIGNED:
+        return obj.value.uintValue
+    if obj.type == DDWAF_OBJ_BOOL:
+        return obj.value.boolean
+    if obj.type == DDWAF_OBJ_FLOAT:
+        return obj.value.f64
+    if obj.type != DDWAF_OBJ_NULL and obj.type != DDWAF_OBJ_INVALID:
+        log.debug("ddwaf_object decoding: unknown object type: %d", obj.type)
+    return None
+
+
+cdef object _MISSING = object()
+
+
+cdef class Context:
+    """A WAF context, with the arena of the data sent to it.
+
+    The persistent addresses are only pushed to the context when their value is not the object already pushed. The
+    ephemeral addresses are only used by the run they are sent to, so they are built in an arena of their own which is
+    freed as soon as the run returns.
+    """
+
+    cdef void* _ctx
+    cdef object _handle
+    cdef PyThread_type_lock _lock
+    cdef dict _pushed
+    cdef Py_ssize_t _max_objects
+    cdef Py_ssize_t _max_depth
+    cdef Py_ssize_t _max_string_length
+    cdef readonly object arena
+
+    def __cinit__(self, handle, Py_ssize_t max_objects, Py_ssize_t max_depth, Py_ssize_t max_string_length):
+        if _context_init is NULL:
+            raise RuntimeError("libddwaf functions are not loaded")
+        self._lock = PyThread_allocate_lock()
+        if self._lock is NULL:
+            raise MemoryError()
+        # The contexts keep the handle of the rules they are running alive
+        self._handle = handle
+        self._ctx = _context_init(<void*><uintptr_t>(handle.handle or 0))
+        self._pushed = {}
+        self._max_objects = max_objects
+        self._max_depth = max_depth
+        self._max_string_length = max_string_length
+        self.arena = ObjectArena()
+
+    def __dealloc__(self):
+        # The arena is only released after the context referencing its data
+        if self._ctx is not NULL:
+            _context_destroy(self._ctx)
+        if self._lock is not NULL:
+            PyThread_free_lock(self._lock)
+
+    def __bool__(self):
+        return self._ctx is not NULL
+
+    def destroy(self):
+        # type: () -> None
+        """Destroy the context, and then release the data sent to it."""
+        with nogil:
+            PyThread_acquire_lock(self._lock, WAIT_LOCK)
+            if self._ctx is not NULL:
+                _context_destroy(self._ctx)
+                self._ctx = NULL
+            PyThread_release_lock(self._lock)
+        self._pushed.clear()
+        self.arena.free()
+
+    def run(self, dict data, dict ephemeral_data, uint64_t timeout):
+        # type: (typing.Dict[str, typing.Any], typing.Optional[typing.Dict[str, typing.Any]], int) -> typing.Tuple
+        """Run the WAF on persistent and, if any, ephemeral addresses, with a timeout in microseconds.
+
+        Return the error code, the events, the actions and the derivatives of the run, its runtime in nanoseconds,
+        whether it timed out and the truncation flags of the limits applied to the data.
+        """
+        cdef ddwaf_result result
+        cdef dict new_data = {}
+        cdef uintptr_t persistent_address
+        cdef uintptr_t ephemeral_address = 0
+        cdef int truncation, ephemeral_truncation
+        cdef int error = -1
+        cdef object ephemeral_arena = None
+
+        for address, value in data.items():
+            if self._pushed.get(address, _MISSING) is not value:
+                new_data[address] = value
+        persistent_address, truncation = self.arena.build(
+            new_data, self._max_objects, self._max_depth, self._max_string_length
+        )
+        if ephemeral_data:
+            ephemeral_arena = ObjectArena()
+            # Ephemeral values are typically new objects for each run, or mutated between runs, so they are not cached
+            ephemeral_address, ephemeral_truncation = ephemeral_arena.build(
+                ephemeral_data, self._max_objects, self._max_depth, self._max_string_length, False
+            )
+            truncation |= ephemeral_truncation
+
+        memset(&result, 0, sizeof(ddwaf_result))
+        with nogil:
+            PyThread_acquire_lock(self._lock, WAIT_LOCK)
+            if self._ctx is not NULL:
+                error = _run(
+                    self._ctx,
+                    <ddwaf_object*>persistent_address,
+                    <ddwaf_object*>ephemeral_address,
+                    &result,
+                    timeout,
+                )
+            PyThread_release_lock(self._lock)
+        # Addresses are only known to the context once a run accepted them, otherwise they are pushed again next time
+        if error >= 0:
+            self._pushed.update(new_data)
+
+        try:
+            return (
+                error,
+                _decode(&result.events),
+                _decode(&result.actions),
+                _decode(&result.derivatives),
+                result.total_runtime,
+                result.timeout,
+                truncation,
+            )
+        finally:
+            _result_free(&result)
+            if ephemeral_arena is not None:
+                ephemeral_arena.free()
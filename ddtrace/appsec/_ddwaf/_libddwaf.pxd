@@ -0,0 +1,56 @@
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint64_t
+
+
+cdef extern from "stdbool.h":
+    ctypedef bint c_bool "bool"
+
+
+# Same layouts as in ddwaf.h, where the value of an object is an anonymous union
+cdef union ddwaf_value:
+    const char* stringValue
+    uint64_t uintValue
+    int64_t intValue
+    ddwaf_object* array
+    c_bool boolean
+    double f64
+
+
+cdef struct ddwaf_object:
+    const char* parameterName
+    uint64_t parameterNameLength
+    ddwaf_value value
+    uint64_t nbEntries
+    int type
+
+
+cdef struct ddwaf_result:
+    c_bool timeout
+    ddwaf_object events
+    ddwaf_object actions
+    ddwaf_object derivatives
+    uint64_t total_runtime
+
+
+cdef enum:
+    DDWAF_OBJ_INVALID = 0
+    DDWAF_OBJ_SIGNED = 1 << 0
+    DDWAF_OBJ_UNSIGNED = 1 << 1
+    DDWAF_OBJ_STRING = 1 << 2
+    DDWAF_OBJ_ARRAY = 1 << 3
+    DDWAF_OBJ_MAP = 1 << 4
+    DDWAF_OBJ_BOOL = 1 << 5
+    DDWAF_OBJ_FLOAT = 1 << 6
+    DDWAF_OBJ_NULL = 1 << 7
+
+
+ctypedef void* (*ddwaf_context_init_fn)(void* handle) noexcept
+ctypedef int (*ddwaf_run_fn)(
+    void* context,
+    ddwaf_object* persistent_data,
+    ddwaf_object* ephemeral_data,
+    ddwaf_result* result,
+    uint64_t timeout,
+) noexcept nogil
+ctypedef void (*ddwaf_context_destroy_fn)(void* context) noexcept nogil
+ctypedef void (*ddwaf_result_free_fn)(ddwaf_result* result) noexcept
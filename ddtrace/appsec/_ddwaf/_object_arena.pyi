@@ -0,0 +1,13 @@
+import typing
+
+class ObjectArena:
+    allocated: int
+    def build(
+        self,
+        struct: typing.Any,
+        max_objects: int,
+        max_depth: int,
+        max_string_length: int,
+        cache_values: bool = True,
+    ) -> typing.Tuple[int, int]: ...
+    def free(self) -> None: ...
@@ -0,0 +1,324 @@
+"""
+Conversion of Python objects into libddwaf's ``ddwaf_object`` trees.
+
+The nodes and strings of the trees are bump allocated from chunks owned by an arena, which are all released at once
+when the arena is freed. libddwaf must therefore not free the objects built here, which is why the WAF is configured
+without a ``free_fn``.
+"""
+from cpython.bytes cimport PyBytes_AS_STRING
+from cpython.bytes cimport PyBytes_GET_SIZE
+from cpython.long cimport PyLong_AsUnsignedLongLongMask
+from libc.stdint cimport int64_t
+from libc.stdint cimport uintptr_t
+from libc.stdlib cimport free
+from libc.stdlib cimport malloc
+from libc.string cimport memcpy
+from libc.string cimport memset
+
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_ARRAY
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_BOOL
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_FLOAT
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_MAP
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_NULL
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_SIGNED
+from ddtrace.appsec._ddwaf._libddwaf cimport DDWAF_OBJ_STRING
+from ddtrace.appsec._ddwaf._libddwaf cimport ddwaf_object
+
+
+cdef extern from "Python.h":
+    bint PyUnicode_IS_ASCII(object s)
+    const char* PyUnicode_AsUTF8AndSize(object s, Py_ssize_t* size) except NULL
+    bytes PyUnicode_AsEncodedString(object s, const char* encoding, const char* errors)
+
+
+cdef enum:
+    _TRUNC_STRING_LENGTH = 1
+    _TRUNC_CONTAINER_DEPTH = 4
+    _TRUNC_CONTAINER_SIZE = 2
+
+    # Most requests fit in the first chunk, the following ones are twice as large as the previous one
+    _FIRST_CHUNK_SIZE = 16 * 1024
+    _MAX_CHUNK_SIZE = 1024 * 1024
+
+
+cdef struct _Chunk:
+    _Chunk* next
+    size_t size
+    size_t used
+
+
+cdef class _Subtree:
+    # The object is referenced so that its id is not reused while it is cached
+    cdef object struct
+    cdef const ddwaf_object* obj
+    cdef int truncation
+    cdef Py_ssize_t max_objects
+    cdef Py_ssize_t max_depth
+    cdef Py_ssize_t max_string_length
+
+
+cdef class ObjectArena:
+    """Memory of the ``ddwaf_object`` trees built for a WAF context.
+
+    The subtrees of the values of the maps at the root of the trees, such as the addresses sent to the WAF, are cached
+    by object identity until the arena is freed, so values sent again are not converted again. They are assumed not to
+    be modified in the meantime.
+    """
+
+    cdef _Chunk* _chunks
+    cdef size_t _next_chunk_size
+    cdef dict _subtrees
+    cdef readonly size_t allocated
+
+    def __cinit__(self):
+        self._chunks = NULL
+        self._next_chunk_size = _FIRST_CHUNK_SIZE
+        self._subtrees = {}
+        self.allocated = 0
+
+    def __dealloc__(self):
+        self._free()
+
+    cdef void _free(self):
+        cdef _Chunk* chunk = self._chunks
+        cdef _Chunk* next_chunk
+        while chunk is not NULL:
+            next_chunk = chunk.next
+            free(chunk)
+            chunk = next_chunk
+        self._chunks = NULL
+        self._next_chunk_size = _FIRST_CHUNK_SIZE
+        self.allocated = 0
+
+    cdef void* _alloc(self, size_t size) except NULL:
+        cdef _Chunk* chunk = self._chunks
+        cdef size_t chunk_size
+        cdef void* ptr
+
+        # Keep the nodes aligned, whatever the size of the strings allocated before them
+        size = (size + 7) & ~(<size_t>7)
+        if chunk is not NULL and chunk.size - chunk.used >= size:
+            ptr = <char*>chunk + sizeof(_Chunk) + chunk.used
+            chunk.used += size
+            return ptr
+
+        chunk_size = self._next_chunk_size
+        if size > chunk_size:
+            # Too large for a chunk of its own: the current one keeps being used for the next allocations
+            chunk = <_Chunk*>malloc(sizeof(_Chunk) + size)
+            if chunk is NULL:
+                raise MemoryError()
+            chunk.size = chunk.used = size
+            if self._chunks is NULL:
+                chunk.next = NULL
+                self._chunks = chunk
+            else:
+                chunk.next = self._chunks.next
+                self._chunks.next = chunk
+        else:
+            chunk = <_Chunk*>malloc(sizeof(_Chunk) + chunk_size)
+            if chunk is NULL:
+                raise MemoryError()
+            chunk.size = chunk_size
+            chunk.used = size
+            chunk.next = self._chunks
+            self._chunks = chunk
+            if chunk_size < _MAX_CHUNK_SIZE:
+                self._next_chunk_size = chunk_size * 2
+        self.allocated += sizeof(_Chunk) + chunk.size
+        return <char*>chunk + sizeof(_Chunk)
+
+    cdef const char* _copy(self, const char* data, Py_ssize_t size) except NULL:
+        cdef char* copy = <char*>self._alloc(size + 1)
+        memcpy(copy, data, size)
+        copy[size] = 0
+        return copy
+
+    cdef int _string(
+        self, ddwaf_object* obj, object string, Py_ssize_t max_string_length, int* truncation
+    ) except -1:
+        cdef Py_ssize_t size
+        cdef const char* data
+
+        if isinstance(string, str):
+            if PyUnicode_IS_ASCII(string):
+                # The UTF-8 encoding of ASCII strings is their data, which is not copied
+                data = PyUnicode_AsUTF8AndSize(string, &size)
+            else:
+                string = PyUnicode_AsEncodedString(string, "utf-8", "ignore")
+                data = PyBytes_AS_STRING(string)
+                size = PyBytes_GET_SIZE(string)
+        else:
+            data = PyBytes_AS_STRING(string)
+            size = PyBytes_GET_SIZE(string)
+
+        # Difference of 1 to take the null char at the end on the C side into account
+        if size > max_string_length - 1:
+            truncation[0] |= _TRUNC_STRING_LENGTH
+            size = max_string_length - 1 if max_string_length > 0 else 0
+
+        obj.value.stringValue = self._copy(data, size)
+        obj.nbEntries = size
+        obj.type = DDWAF_OBJ_STRING
+        return 0
+
+    cdef ddwaf_object* _grow(self, ddwaf_object* items, Py_ssize_t* capacity) except NULL:
+        # Only needed by containers which yield more items than their length
+        cdef Py_ssize_t grown_capacity = 2 * capacity[0] + 1
+        cdef ddwaf_object* grown = <ddwaf_object*>self._alloc(grown_capacity * sizeof(ddwaf_object))
+        if capacity[0]:
+            memcpy(grown, items, capacity[0] * sizeof(ddwaf_object))
+        capacity[0] = grown_capacity
+        return grown
+
+    cdef int _build(
+        self,
+        ddwaf_object* obj,
+        object struct,
+        Py_ssize_t max_objects,
+        Py_ssize_t max_depth,
+        Py_ssize_t max_string_length,
+        int* truncation,
+        bint cache_values,
+    ) except -1:
+        cdef ddwaf_object* items
+        cdef ddwaf_object* item
+        cdef ddwaf_object key_obj
+        cdef Py_ssize_t capacity, count, index
+
+        memset(obj, 0, sizeof(ddwaf_object))
+
+        if isinstance(struct, bool):
+            obj.value.boolean = struct is True
+            obj.type = DDWAF_OBJ_BOOL
+        elif isinstance(struct, int):
+            # Integers are sent on 64 signed bits, the larger ones are wrapped around
+            obj.value.intValue = <int64_t>PyLong_AsUnsignedLongLongMask(struct)
+            obj.type = DDWAF_OBJ_SIGNED
+        elif isinstance(struct, (str, bytes)):
+            self._string(obj, struct, max_string_length, truncation)
+        elif isinstance(struct, float):
+            obj.value.f64 = struct
+            obj.type = DDWAF_OBJ_FLOAT
+        elif isinstance(struct, (list, dict)):
+            if max_depth <= 0:
+                truncation[0] |= _TRUNC_CONTAINER_DEPTH
+                max_objects = 0
+            capacity = min(len(struct), max_objects)
+            items = <ddwaf_object*>self._alloc(capacity * sizeof(ddwaf_object)) if capacity else NULL
+            count = 0
+            index = -1
+
+            if isinstance(struct, list):
+                obj.type = DDWAF_OBJ_ARRAY
+                for elt in struct:
+                    index += 1
+                    if index >= max_objects:
+                        truncation[0] |= _TRUNC_CONTAINER_SIZE
+                        break
+                    if count == capacity:
+                        items = self._grow(items, &capacity)
+                    self._build(items + count, elt, max_objects, max_depth - 1, max_string_length, truncation, False)
+                    count += 1
+            else:
+                obj.type = DDWAF_OBJ_MAP
+                # order is unspecified and could lead to problems if max_objects is reached
+                for key, val in struct.items():
+                    index += 1
+                    if not isinstance(key, (bytes, str)):  # discards non string keys
+                        continue
+                    if index >= max_objects:
+                        truncation[0] |= _TRUNC_CONTAINER_SIZE
+                        break
+                    # patch for libddwaf 1.17.0
+                    if isinstance(val, int) and key == "status_code":
+                        val = str(val)
+                    # end_patch
+                    if count == capacity:
+                        items = self._grow(items, &capacity)
+                    item = items + count
+                    if cache_values:
+                        self._build_cached(item, val, max_objects, max_depth - 1, max_string_length, truncation)
+                    else:
+                        self._build(item, val, max_objects, max_depth - 1, max_string_length, truncation, False)
+                    # The key is converted like a string value, into a node which is then discarded
+                    self._string(&key_obj, key, max_string_length, truncation)
+                    item.parameterName = key_obj.value.stringValue
+                    item.parameterNameLength = key_obj.nbEntries
+                    count += 1
+
+            obj.value.array = items
+            obj.nbEntries = count
+        elif struct is not None:
+            self._string(obj, str(struct), max_string_length, truncation)
+        else:
+            obj.type = DDWAF_OBJ_NULL
+        return 0
+
+    cdef int _build_cached(
+        self,
+        ddwaf_object* obj,
+        object struct,
+        Py_ssize_t max_objects,
+        Py_ssize_t max_depth,
+        Py_ssize_t max_string_length,
+        int* truncation,
+    ) except -1:
+        cdef _Subtree subtree
+        cdef int subtree_truncation = 0
+
+        # Scalars are cheaper to convert than to look up
+        if not isinstance(struct, (str, bytes, list, dict)):
+            return self._build(obj, struct, max_objects, max_depth, max_string_length, truncation, False)
+
+        key = id(struct)
+        subtree = self._subtrees.get(key)
+        if (
+            subtree is not None
+            and subtree.max_objects == max_objects
+            and subtree.max_depth == max_depth
+            and subtree.max_string_length == max_string_length
+        ):
+            # The nodes of the subtree are shared, only its root is copied
+            memcpy(obj, subtree.obj, sizeof(ddwaf_object))
+            truncation[0] |= subtree.truncation
+            return 0
+
+        self._build(obj, struct, max_objects, max_depth, max_string_length, &subtree_truncation, False)
+        truncation[0] |= subtree_truncation
+
+        subtree = _Subtree()
+        subtree.struct = struct
+        subtree.obj = obj
+        subtree.truncation = subtree_truncation
+        subtree.max_objects = max_objects
+        subtree.max_depth = max_depth
+        subtree.max_string_length = max_string_length
+        self._subtrees[key] = subtree
+        return 0
+
+    def build(
+        self,
+        object struct,
+        Py_ssize_t max_objects,
+        Py_ssize_t max_depth,
+        Py_ssize_t max_string_length,
+        bint cache_values=True,
+    ):
+        # type: (typing.Any, int, int, int, bool) -> typing.Tuple[int, int]
+        """Build the ``ddwaf_object`` tree of a Python structure in the arena.
+
+        Return the address of the root of the tree, which stays valid until the arena is freed, and the truncation
+        flags of the limits that were applied. Without ``cache_values``, the values of the root map are neither looked
+        up in nor added to the cache, for data which is only sent once or may be modified before it is sent again.
+        """
+        cdef ddwaf_object* root = <ddwaf_object*>self._alloc(sizeof(ddwaf_object))
+        cdef int truncation = 0
+        self._build(root, struct, max_objects, max_depth, max_string_length, &truncation, cache_values)
+        return <uintptr_t>root, truncation
+
+    def free(self):
+        # type: () -> None
+        """Release the memory of all the trees built in the arena."""
+        self._subtrees.clear()
+        self._free()
@@ -8,6 +8,9 @@ from typing import Dict
 from typing import List
 from typing import Union
 
+from ddtrace.appsec._ddwaf import _binding
+from ddtrace.appsec._ddwaf._binding import Context
+from ddtrace.appsec._ddwaf._object_arena import ObjectArena
 from ddtrace.internal.logger import get_logger
 from ddtrace.settings.asm import config as asm_config
 
@@ -113,69 +116,11 @@ class ddwaf_object(ctypes.Structure):
         max_depth: int = DDWAF_MAX_CONTAINER_DEPTH,
         max_string_length: int = DDWAF_MAX_STRING_LENGTH,
     ) -> None:
-        def truncate_string(string: bytes) -> bytes:
-            if len(string) > max_string_length - 1:
-                observator.truncation |= _TRUNC_STRING_LENGTH
-                # difference of 1 to take null char at the end on the C side into account
-                return string[: max_string_length - 1]
-            return string
-
-        if isinstance(struct, bool):
-            ddwaf_object_bool(self, struct)
-        elif isinstance(struct, int):
-            ddwaf_object_signed(self, struct)
-        elif isinstance(struct, str):
-            ddwaf_object_string(self, truncate_string(struct.encode("UTF-8", errors="ignore")))
-        elif isinstance(struct, bytes):
-            ddwaf_object_string(self, truncate_string(struct))
-        elif isinstance(struct, float):
-            ddwaf_object_float(self, struct)
-        elif isinstance(struct, list):
-            if max_depth <= 0:
-                observator.truncation |= _TRUNC_CONTAINER_DEPTH
-                max_objects = 0
-            array = ddwaf_object_array(self)
-            for counter_object, elt in enumerate(struct):
-                if counter_object >= max_objects:
-                    observator.truncation |= _TRUNC_CONTAINER_SIZE
-                    break
-                obj = ddwaf_object(
-                    elt,
-                    observator=observator,
-                    max_objects=max_objects,
-                    max_depth=max_depth - 1,
-                    max_string_length=max_string_length,
-                )
-                ddwaf_object_array_add(array, obj)
-        elif isinstance(struct, dict):
-            if max_depth <= 0:
-                observator.truncation |= _TRUNC_CONTAINER_DEPTH
-                max_objects = 0
-            map_o = ddwaf_object_map(self)
-            # order is unspecified and could lead to problems if max_objects is reached
-            for counter_object, (key, val) in enumerate(struct.items()):
-                if not isinstance(key, (bytes, str)):  # discards non string keys
-                    continue
-                if counter_object >= max_objects:
-                    observator.truncation |= _TRUNC_CONTAINER_SIZE
-                    break
-                res_key = truncate_string(key.encode("UTF-8", errors="ignore") if isinstance(key, str) else key)
-                # patch for libddwaf 1.17.0
-                if key == "status_code" and isinstance(val, int):
-                    val = str(val)
-                # end_patch
-                obj = ddwaf_object(
-                    val,
-                    observator=observator,
-                    max_objects=max_objects,
-                    max_depth=max_depth - 1,
-                    max_string_length=max_string_length,
-                )
-                ddwaf_object_map_add(map_o, res_key, obj)
-        elif struct is not None:
-            ddwaf_object_string(self, truncate_string(str(struct).encode("UTF-8", errors="ignore")))
-        else:
-            ddwaf_object_null(self)
+        # The tree is built in an arena kept alive by the object, so it must not be freed with ddwaf_object_free
+        self._arena = ObjectArena()
+        address, truncation = self._arena.build(struct, max_objects, max_depth, max_string_length)
+        observator.truncation |= truncation
+        ctypes.memmove(ctypes.addressof(self), address, ctypes.sizeof(ddwaf_object))
 
     @classmethod
     def create_without_limits(cls, struct: DDWafRulesType) -> "ddwaf_object":
@@ -331,21 +276,8 @@ class ddwaf_handle_capsule:
         return bool(self.handle)
 
 
-class ddwaf_context_capsule:
-    def __init__(self, ctx: ddwaf_context) -> None:
-        self.ctx = ctx
-        self.free_fn = ddwaf_context_destroy
-
-    def __del__(self):
-        if self.ctx:
-            try:
-                self.free_fn(self.ctx)
-            except TypeError:
-                pass
-            self.ctx = None
-
-    def __bool__(self):
-        return bool(self.ctx)
+# contexts are created, run and destroyed by the compiled binding
+ddwaf_context_capsule = Context
 
 
 ddwaf_log_cb = ctypes.POINTER(
@@ -416,7 +348,9 @@ ddwaf_context_init = ctypes.CFUNCTYPE(ddwaf_context, ddwaf_handle)(
 
 
 def py_ddwaf_context_init(handle: ddwaf_handle_capsule) -> ddwaf_context_capsule:
-    return ddwaf_context_capsule(ddwaf_context_init(handle.handle))
+    return ddwaf_context_capsule(
+        handle, DDWAF_MAX_CONTAINER_SIZE, DDWAF_MAX_CONTAINER_DEPTH, DDWAF_MAX_STRING_LENGTH
+    )
 
 
 ddwaf_run = ctypes.CFUNCTYPE(
@@ -433,6 +367,13 @@ ddwaf_result_free = ctypes.CFUNCTYPE(None, ddwaf_result_p)(
     ((1, "result"),),
 )
 
+_binding.load(
+    ctypes.cast(ddwaf_context_init, ctypes.c_void_p).value,
+    ctypes.cast(ddwaf_run, ctypes.c_void_p).value,
+    ctypes.cast(ddwaf_context_destroy, ctypes.c_void_p).value,
+    ctypes.cast(ddwaf_result_free, ctypes.c_void_p).value,
+)
+
 ddwaf_object_invalid = ctypes.CFUNCTYPE(ddwaf_object_p, ddwaf_object_p)(
     ("ddwaf_object_invalid", ddwaf),
     ((3, "object"),),
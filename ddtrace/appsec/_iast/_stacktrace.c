@@ -1,6 +1,8 @@
 #include <Python.h>
 #include <frameobject.h>
 #include <patchlevel.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifdef _WIN32
 #define DD_TRACE_INSTALLED_PREFIX "\\ddtrace\\"
@@ -12,43 +14,85 @@
 #define SITE_PACKAGES_PREFIX "/site-packages/"
 #endif
 
-#if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION >= 11
+/* From 3.11, the stack is walked through the interpreter frames, which does not create frame objects for them. This
+ * relies on the layout of `_PyInterpreterFrame`, which is only available with `Py_BUILD_CORE` from 3.12, and which
+ * 3.13 changed again. */
+#if PY_VERSION_HEX >= 0x030b0000 && PY_VERSION_HEX < 0x030d0000 &&                                                   \
+  (PY_VERSION_HEX < 0x030c0000 || defined(Py_BUILD_CORE))
+#define _STACKTRACE_INTERPRETER_FRAMES
+#if PY_VERSION_HEX >= 0x030c0000
+/* https://github.com/python/cpython/issues/108216#issuecomment-1696565797 */
+#undef _PyGC_FINALIZED
+#endif
 #include <internal/pycore_frame.h>
-#define GET_LINENO(frame) PyFrame_GetLineNumber((PyFrameObject*)frame)
-#define GET_FRAME(tstate) PyThreadState_GetFrame(tstate)
-#define GET_PREVIOUS(frame) PyFrame_GetBack(frame)
-#define FRAME_DECREF(frame) Py_DecRef(frame)
-#define FRAME_XDECREF(frame) Py_XDECREF(frame)
-#define FILENAME_DECREF(filename) Py_DecRef(filename)
-#define FILENAME_XDECREF(filename)                                                                                     \
-    if (filename)                                                                                                      \
-    Py_DecRef(filename)
-static inline PyObject*
-GET_FILENAME(PyFrameObject* frame)
+#endif
+
+/* Whether the frames of a code object are user code only depends on its filename and on the current working
+ * directory, so it is cached by code object address, and the cache is cleared when the working directory changes.
+ * The cache is direct-mapped, colliding entries evict each other. */
+
+/* Number of entries in the cache; must be a power of 2 */
+#define USER_CODE_CACHE_SIZE 1024
+
+typedef struct
 {
-    PyCodeObject* code = PyFrame_GetCode(frame);
-    if (!code) {
-        return NULL;
+    /* Strong reference, so that the address cannot be reused while it is in the cache */
+    PyObject* code;
+    int user_code;
+} user_code_cache_entry_t;
+
+static user_code_cache_entry_t user_code_cache[USER_CODE_CACHE_SIZE];
+static PyObject* user_code_cache_cwd = NULL;
+
+/* Clear the cache if the working directory is not the one it was filled for. Return -1 on error. */
+static int
+user_code_cache_set_cwd(PyObject* cwd_obj)
+{
+    if (cwd_obj == user_code_cache_cwd)
+        return 0;
+
+    if (user_code_cache_cwd != NULL) {
+        int same = PyObject_RichCompareBool(cwd_obj, user_code_cache_cwd, Py_EQ);
+        if (same < 0)
+            return -1;
+        if (!same) {
+            for (size_t i = 0; i < USER_CODE_CACHE_SIZE; i++)
+                Py_CLEAR(user_code_cache[i].code);
+        }
     }
-    PyObject* filename = PyObject_GetAttrString((PyObject*)code, "co_filename");
-    Py_DecRef(code);
-    return filename;
+
+    Py_INCREF(cwd_obj);
+    Py_XSETREF(user_code_cache_cwd, cwd_obj);
+    return 0;
+}
+
+/* Return 1 if the frames of `code` are user code, 0 if not, and -1 on error. The working directory is only converted
+ * into `cwd_bytes` when the decision is not cached. */
+static int
+is_user_code(PyCodeObject* code, PyObject* cwd_obj, PyObject** cwd_bytes)
+{
+    /* Objects are at least 16-byte aligned */
+    user_code_cache_entry_t* entry = &user_code_cache[((uintptr_t)code >> 4) & (USER_CODE_CACHE_SIZE - 1)];
+    if (entry->code == (PyObject*)code)
+        return entry->user_code;
+
+    if (*cwd_bytes == NULL && !PyUnicode_FSConverter(cwd_obj, cwd_bytes))
+        return -1;
+    const char* cwd = PyBytes_AsString(*cwd_bytes);
+    if (!cwd)
+        return -1;
+    const char* filename = PyUnicode_AsUTF8(code->co_filename);
+    if (!filename)
+        return -1;
+
+    int user_code = !(((strstr(filename, DD_TRACE_INSTALLED_PREFIX) != NULL && strstr(filename, TESTS_PREFIX) == NULL)) ||
+                      (strstr(filename, SITE_PACKAGES_PREFIX) != NULL || strstr(filename, cwd) == NULL));
+
+    Py_INCREF(code);
+    Py_XSETREF(entry->code, (PyObject*)code);
+    entry->user_code = user_code;
+    return user_code;
 }
-#else
-#define GET_FRAME(tstate) tstate->frame
-#define GET_PREVIOUS(frame) frame->f_back
-#define GET_FILENAME(frame) frame->f_code->co_filename
-#define FRAME_DECREF(frame)
-#define FRAME_XDECREF(frame)
-#define FILENAME_DECREF(filename)
-#define FILENAME_XDECREF(filename)
-#if PY_MAJOR_VERSION >= 3 && PY_MINOR_VERSION >= 10
-/* See: https://bugs.python.org/issue44964 */
-#define GET_LINENO(frame) PyCode_Addr2Line(frame->f_code, frame->f_lasti * 2)
-#else
-#define GET_LINENO(frame) PyCode_Addr2Line(frame->f_code, frame->f_lasti)
-#endif
-#endif
 
 /**
  * get_file_and_line
@@ -62,74 +106,86 @@ static PyObject*
 get_file_and_line(PyObject* Py_UNUSED(module), PyObject* cwd_obj)
 {
     PyThreadState* tstate = PyThreadState_Get();
-    if (!tstate) {
-        goto exit_0;
-    }
-
-    int line;
-    PyObject* filename_o = NULL;
-    PyObject* result = NULL;
     PyObject* cwd_bytes = NULL;
-    char* cwd = NULL;
+    PyObject* result = NULL;
+    int user_code = 0;
 
-    if (!PyUnicode_FSConverter(cwd_obj, &cwd_bytes)) {
-        goto exit_0;
-    }
-    cwd = PyBytes_AsString(cwd_bytes);
-    if (!cwd) {
-        goto exit_0;
-    }
+    if (user_code_cache_set_cwd(cwd_obj) < 0)
+        goto exit;
 
-    PyFrameObject* frame = GET_FRAME(tstate);
-    if (!frame) {
-        goto exit_0;
-    }
+#ifdef _STACKTRACE_INTERPRETER_FRAMES
+    for (_PyInterpreterFrame* frame = tstate->cframe->current_frame; frame != NULL; frame = frame->previous) {
+#if PY_VERSION_HEX >= 0x030c0000
+        /* Shim frames pushed on entry from C have no Python code worth reporting */
+        if (frame->owner == FRAME_OWNED_BY_CSTACK)
+            continue;
+#endif
+        if (_PyFrame_IsIncomplete(frame))
+            continue;
 
-    while (NULL != frame) {
-        filename_o = GET_FILENAME(frame);
-        if (!filename_o) {
+        PyCodeObject* code = frame->f_code;
+        user_code = is_user_code(code, cwd_obj, &cwd_bytes);
+        if (user_code < 0)
             goto exit;
+        if (user_code) {
+            int line = PyCode_Addr2Line(code, _PyInterpreterFrame_LASTI(frame) * sizeof(_Py_CODEUNIT));
+            result = Py_BuildValue("(Oi)", code->co_filename, line);
+            break;
         }
-        const char* filename = PyUnicode_AsUTF8(filename_o);
-        if (((strstr(filename, DD_TRACE_INSTALLED_PREFIX) != NULL && strstr(filename, TESTS_PREFIX) == NULL)) ||
-            (strstr(filename, SITE_PACKAGES_PREFIX) != NULL || strstr(filename, cwd) == NULL)) {
-            PyFrameObject* prev_frame = GET_PREVIOUS(frame);
-            FRAME_DECREF(frame);
-            FILENAME_DECREF(filename_o);
-            frame = prev_frame;
-            continue;
+    }
+#elif PY_VERSION_HEX >= 0x030b0000
+    PyFrameObject* frame = PyThreadState_GetFrame(tstate);
+    while (frame != NULL) {
+        PyCodeObject* code = PyFrame_GetCode(frame);
+        user_code = is_user_code(code, cwd_obj, &cwd_bytes);
+        if (user_code > 0)
+            result = Py_BuildValue("(Oi)", code->co_filename, PyFrame_GetLineNumber(frame));
+        Py_DECREF(code);
+        if (user_code != 0) {
+            Py_DECREF(frame);
+            break;
         }
-        /*
-         frame->f_lineno will not always return the correct line number
-         you need to call PyCode_Addr2Line().
-        */
-        line = GET_LINENO(frame);
-        PyObject* line_obj = Py_BuildValue("i", line);
-        if (!line_obj) {
+        PyFrameObject* back = PyFrame_GetBack(frame);
+        Py_DECREF(frame);
+        frame = back;
+    }
+    if (user_code < 0)
+        goto exit;
+#else
+    for (PyFrameObject* frame = tstate->frame; frame != NULL; frame = frame->f_back) {
+        PyCodeObject* code = frame->f_code;
+        user_code = is_user_code(code, cwd_obj, &cwd_bytes);
+        if (user_code < 0)
             goto exit;
+        if (user_code) {
+            /*
+             frame->f_lineno will not always return the correct line number
+             you need to call PyCode_Addr2Line().
+            */
+#if PY_VERSION_HEX >= 0x030a0000
+            /* See: https://bugs.python.org/issue44964 */
+            int line = PyCode_Addr2Line(code, frame->f_lasti * 2);
+#else
+            int line = PyCode_Addr2Line(code, frame->f_lasti);
+#endif
+            result = Py_BuildValue("(Oi)", code->co_filename, line);
+            break;
         }
-        result = PyTuple_Pack(2, filename_o, line_obj);
-        break;
     }
-    if (result == NULL) {
-        goto exit_0;
+#endif
+
+    if (!user_code) {
+        // Return "", -1
+        result = Py_BuildValue("(si)", "", -1);
     }
 
 exit:
-    Py_DecRef(cwd_bytes);
-    FRAME_XDECREF(frame);
-    FILENAME_XDECREF(filename_o);
-    return result;
-
-exit_0:; // fix: "a label can only be part of a statement and a declaration is not a statement" error
-    // Return "", -1
-    PyObject* line_obj = Py_BuildValue("i", -1);
-    filename_o = PyUnicode_FromString("");
-    result = PyTuple_Pack(2, filename_o, line_obj);
-    Py_DecRef(cwd_bytes);
-    FRAME_XDECREF(frame);
-    FILENAME_XDECREF(filename_o);
-    Py_DecRef(line_obj);
+    Py_XDECREF(cwd_bytes);
+    if (result == NULL && PyErr_Occurred()) {
+        // Errors are not reported, as before
+        PyErr_Clear();
+        result = Py_BuildValue("(si)", "", -1);
+    }
     return result;
 }
 
@@ -37,6 +37,64 @@ api_is_tainted(py::object tainted_object)
     return false;
 }
 
+/**
+ * api_get_tainted_arguments
+ *
+ * Check all the arguments of a sink at once, fetching the taint map a single time instead of once per argument.
+ *
+ * @param self The Python extension module.
+ * @param args An array of Python objects.
+ *   @param args[0] Sequence of the arguments. Only the non-empty text arguments can be tainted.
+ * @param nargs The number of arguments in the 'args' array.
+ * @return List of the (index, ranges) tuples of the tainted arguments, in their order.
+ */
+PyObject*
+api_get_tainted_arguments(PyObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    if (nargs != 1 or !args) {
+        py::set_error(PyExc_ValueError, MSG_ERROR_N_PARAMS);
+        return nullptr;
+    }
+
+    PyObject* arguments = PySequence_Fast(args[0], "[IAST] Arguments must be a sequence");
+    if (not arguments) {
+        return nullptr;
+    }
+    PyObject* result = PyList_New(0);
+    if (not result) {
+        Py_DECREF(arguments);
+        return nullptr;
+    }
+
+    TaintRangeMapType* tx_map = initializer->get_tainting_map();
+    if (tx_map and not tx_map->empty()) {
+        const Py_ssize_t size = PySequence_Fast_GET_SIZE(arguments);
+        PyObject** items = PySequence_Fast_ITEMS(arguments);
+        try {
+            for (Py_ssize_t i = 0; i < size; i++) {
+                PyObject* argument = items[i];
+                if (not is_text(argument) or get_pyobject_size(argument) == 0) {
+                    continue;
+                }
+                const auto& [ranges, ranges_error] = get_ranges(argument, tx_map);
+                if (ranges_error or ranges.empty()) {
+                    continue;
+                }
+                if (PyList_Append(result, py::make_tuple(i, ranges).ptr()) < 0) {
+                    Py_CLEAR(result);
+                    break;
+                }
+            }
+        } catch (py::error_already_set& e) {
+            e.restore();
+            Py_CLEAR(result);
+        }
+    }
+
+    Py_DECREF(arguments);
+    return result;
+}
+
 void
 pyexport_tainted_ops(py::module& m)
 {
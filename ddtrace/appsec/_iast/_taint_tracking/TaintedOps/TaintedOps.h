@@ -19,5 +19,8 @@ is_tainted(PyObject* tainted_object, TaintRangeMapType* tx_taint_map);
 bool
 api_is_tainted(py::object tainted_object);
 
+PyObject*
+api_get_tainted_arguments(PyObject* self, PyObject* const* args, Py_ssize_t nargs);
+
 void
 pyexport_tainted_ops(py::module& m);
\ No newline at end of file
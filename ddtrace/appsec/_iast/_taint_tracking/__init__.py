@@ -2,6 +2,7 @@ import os
 from typing import Any
 from typing import Dict
 from typing import List
+from typing import Sequence
 from typing import Tuple
 from typing import Union
 
@@ -62,6 +63,12 @@ if _is_python_version_supported():
 
     new_pyobject_id = ops.new_pyobject_id
     set_ranges_from_values = ops.set_ranges_from_values
+    _get_tainted_arguments = ops.get_tainted_arguments
+else:
+
+    def _get_tainted_arguments(arguments: Sequence[Any]) -> List[Tuple[int, List]]:
+        # Nothing is tainted without the native module
+        return []
 
 
 __all__ = [
@@ -73,6 +80,7 @@ __all__ = [
     "TagMappingMode",
     "TaintRange",
     "get_ranges",
+    "get_tainted_arguments",
     "set_ranges",
     "copy_ranges_from_strings",
     "copy_and_shift_ranges_from_strings",
@@ -133,6 +141,15 @@ def is_pyobject_tainted(pyobject: Any) -> bool:
     return False
 
 
+def get_tainted_arguments(arguments: Sequence[Any]) -> List[Tuple[int, List]]:
+    """Return the index and the ranges of the tainted arguments of a sink, all checked in a single native call."""
+    try:
+        return _get_tainted_arguments(arguments)
+    except (TypeError, ValueError) as e:
+        iast_taint_log_error("Checking tainted arguments error: %s" % e)
+    return []
+
+
 def taint_pyobject(pyobject: Any, source_name: Any, source_value: Any, source_origin=None) -> Any:
     # Pyobject must be Text with len > 1
     if not pyobject or not isinstance(pyobject, IAST.TEXT_TYPES):
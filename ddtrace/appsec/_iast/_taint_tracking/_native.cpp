@@ -44,6 +44,7 @@ static struct PyModuleDef aspects = { PyModuleDef_HEAD_INIT,
 static PyMethodDef OpsMethods[] = {
     { "new_pyobject_id", (PyCFunction)api_new_pyobject_id, METH_FASTCALL, "new pyobject id" },
     { "set_ranges_from_values", ((PyCFunction)api_set_ranges_from_values), METH_FASTCALL, "set_ranges_from_values" },
+    { "get_tainted_arguments", ((PyCFunction)api_get_tainted_arguments), METH_FASTCALL, "get_tainted_arguments" },
     { nullptr, nullptr, 0, nullptr }
 };
 
@@ -87,14 +87,13 @@ def _iast_report_cmdi(shell_args: Union[str, List[str]]) -> None:
     _set_metric_iast_executed_sink(CommandInjection.vulnerability_type)
 
     if AppSecIastSpanProcessor.is_span_analyzed() and CommandInjection.has_quota():
+        from .._taint_tracking import get_tainted_arguments
         from .._taint_tracking import is_pyobject_tainted
         from .._taint_tracking.aspects import join_aspect
 
         if isinstance(shell_args, (list, tuple)):
-            for arg in shell_args:
-                if is_pyobject_tainted(arg):
-                    report_cmdi = join_aspect(" ".join, 1, " ", shell_args)
-                    break
+            if get_tainted_arguments(shell_args):
+                report_cmdi = join_aspect(" ".join, 1, " ", shell_args)
         elif is_pyobject_tainted(shell_args):
             report_cmdi = shell_args
 
@@ -118,7 +118,7 @@ def _iast_report_header_injection(headers_args) -> None:
         "vary",
     }
     from .._metrics import _set_metric_iast_executed_sink
-    from .._taint_tracking import is_pyobject_tainted
+    from .._taint_tracking import get_tainted_arguments
     from .._taint_tracking.aspects import add_aspect
 
     header_name, header_value = headers_args
@@ -131,6 +131,6 @@ def _iast_report_header_injection(headers_args) -> None:
     _set_metric_iast_executed_sink(HeaderInjection.vulnerability_type)
 
     if AppSecIastSpanProcessor.is_span_analyzed() and HeaderInjection.has_quota():
-        if is_pyobject_tainted(header_name) or is_pyobject_tainted(header_value):
+        if get_tainted_arguments((header_name, header_value)):
             header_evidence = add_aspect(add_aspect(header_name, HEADER_NAME_VALUE_SEPARATOR), header_value)
             HeaderInjection.report(evidence_value=header_evidence)
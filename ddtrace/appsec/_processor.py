@@ -432,8 +432,6 @@ class AppSecSpanProcessor(SpanProcessor):
                 if not has_triggers(span) and _asm_request_context.in_context():
                     log.debug("metrics waf call")
                     _asm_request_context.call_waf_callback()
-
-                self._ddwaf._at_request_end()
         finally:
             # release asm context if it was created by the span
             _asm_request_context.unregister(span)
@@ -441,6 +439,8 @@ class AppSecSpanProcessor(SpanProcessor):
             if span.span_type != SpanTypes.WEB:
                 return
 
+            # after the context callbacks, which can still run the WAF
+            self._ddwaf._at_request_end(self._span_to_waf_ctx.get(span))
             to_delete = []
             for iterspan, ctx in self._span_to_waf_ctx.items():
                 # delete all the ddwaf ctxs associated with this span or finished or deleted ones
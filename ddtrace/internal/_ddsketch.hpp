@@ -0,0 +1,426 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Native implementation of DDSketch, the quantile sketch used for the latency distributions reported to the agent.
+//
+// Only the configuration used by the tracer is implemented: a logarithmic key mapping, with dense stores collapsing
+// their lowest bins (positive values) and highest bins (negative values) past a bin limit. The stores evolve exactly
+// like those of the ddsketch package (LogCollapsingLowestDenseDDSketch), so that to_proto() produces the same bytes as
+// DDSketchProto.to_proto(sketch).SerializeToString() for the same sequence of values.
+//
+// This is used directly by the span stats and data streams aggregators, and exposed to Python by the _ddsketch
+// extension.
+
+namespace ddtrace {
+
+// Relative accuracy of the sketches computed by the backend: 0.775%
+constexpr double ddsketch_relative_accuracy = 0.00775;
+constexpr int ddsketch_bin_limit = 2048;
+
+class LogarithmicMapping
+{
+  public:
+    explicit LogarithmicMapping(double relative_accuracy)
+    {
+        const double gamma_mantissa = 2 * relative_accuracy / (1 - relative_accuracy);
+        gamma_ = 1 + gamma_mantissa;
+        // Same operations, in the same order, as the Python implementation, so that keys are identical
+        multiplier_ = 1 / std::log1p(gamma_mantissa);
+        multiplier_ *= std::log(2.0);
+        min_possible_ = std::numeric_limits<double>::min() * gamma_;
+    }
+
+    int key(double value) const
+    {
+        return static_cast<int>(std::ceil(std::log(value) / std::log(2.0) * multiplier_) + offset_);
+    }
+
+    // Value which the key stands for: values mapped to the key are within the relative accuracy of it
+    double value(int key) const { return std::pow(2.0, (key - offset_) / multiplier_) * (2.0 / (1 + gamma_)); }
+
+    double gamma() const { return gamma_; }
+    double offset() const { return offset_; }
+    double min_possible() const { return min_possible_; }
+
+  private:
+    double gamma_;
+    double multiplier_;
+    double offset_ = 0.0;
+    double min_possible_;
+};
+
+// Dense store of bins which collapses its lowest bins (or highest ones, if collapse_lowest is false) once the range
+// of keys exceeds bin_limit.
+class CollapsingDenseStore
+{
+  public:
+    static constexpr int chunk_size = 128;
+
+    CollapsingDenseStore(int bin_limit, bool collapse_lowest)
+      : bin_limit_(bin_limit)
+      , collapse_lowest_(collapse_lowest)
+    {
+    }
+
+    void add(int key, double weight = 1.0)
+    {
+        const int idx = get_index(key);
+        bins_[idx] += weight;
+        count_ += weight;
+    }
+
+    void merge(const CollapsingDenseStore& store)
+    {
+        if (store.count_ == 0) {
+            return;
+        }
+        if (count_ == 0) {
+            *this = store;
+            return;
+        }
+        if (store.min_key_ < min_key_ || store.max_key_ > max_key_) {
+            extend_range(store.min_key_, store.max_key_);
+        }
+
+        if (collapse_lowest_) {
+            // Keys of store below our minimum are accounted in our lowest bin
+            int collapse_start = store.min_key_ - store.offset_;
+            int collapse_end = std::min(min_key_, store.max_key_ + 1) - store.offset_;
+            if (collapse_end > collapse_start) {
+                bins_[0] += sum(store.bins_, collapse_start, collapse_end);
+            } else {
+                collapse_end = collapse_start;
+            }
+            add_bins(store, collapse_end + store.offset_, store.max_key_ + 1);
+        } else {
+            // Keys of store above our maximum are accounted in our highest bin
+            const int collapse_end = store.max_key_ - store.offset_ + 1;
+            int collapse_start = std::max(max_key_ + 1, store.min_key_) - store.offset_;
+            if (collapse_end > collapse_start) {
+                bins_.back() += sum(store.bins_, collapse_start, collapse_end);
+            } else {
+                collapse_start = collapse_end;
+            }
+            add_bins(store, store.min_key_, collapse_start + store.offset_);
+        }
+        count_ += store.count_;
+    }
+
+    // Key of the bin holding the value of the given rank. With lower, the value is the lowest such that more than
+    // rank values are lower or equal to it; otherwise, at least rank + 1 values are.
+    int key_at_rank(double rank, bool lower = true) const
+    {
+        double running_count = 0.0;
+        for (size_t i = 0; i < bins_.size(); ++i) {
+            running_count += bins_[i];
+            if ((lower && running_count > rank) || (!lower && running_count >= rank + 1)) {
+                return static_cast<int>(i) + offset_;
+            }
+        }
+        return max_key_;
+    }
+
+    const std::vector<double>& bins() const { return bins_; }
+    int offset() const { return offset_; }
+    double count() const { return count_; }
+
+  private:
+    static double sum(const std::vector<double>& bins, int start, int end)
+    {
+        double total = 0.0;
+        for (int i = start; i < end; ++i) {
+            total += bins[i];
+        }
+        return total;
+    }
+
+    // Add the bins of store for keys in [start_key, end_key), which must all be in range of both stores. This is a
+    // plain loop over contiguous arrays, which the compiler vectorizes.
+    void add_bins(const CollapsingDenseStore& store, int start_key, int end_key)
+    {
+        if (end_key <= start_key) {
+            return;
+        }
+        double* dst = bins_.data() + (start_key - offset_);
+        const double* src = store.bins_.data() + (start_key - store.offset_);
+        const size_t n = static_cast<size_t>(end_key - start_key);
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] += src[i];
+        }
+    }
+
+    int length() const { return static_cast<int>(bins_.size()); }
+
+    int get_index(int key)
+    {
+        if (collapse_lowest_ ? key < min_key_ : key > max_key_) {
+            if (is_collapsed_) {
+                return collapse_lowest_ ? 0 : length() - 1;
+            }
+            extend_range(key, key);
+            if (is_collapsed_) {
+                return collapse_lowest_ ? 0 : length() - 1;
+            }
+        } else if (collapse_lowest_ ? key > max_key_ : key < min_key_) {
+            extend_range(key, key);
+        }
+        return key - offset_;
+    }
+
+    int get_new_length(int new_min_key, int new_max_key) const
+    {
+        const int desired_length = new_max_key - new_min_key + 1;
+        return std::min(chunk_size * ((desired_length + chunk_size - 1) / chunk_size), bin_limit_);
+    }
+
+    void extend_range(int key, int second_key)
+    {
+        const int new_min_key = std::min({ key, second_key, min_key_ });
+        const int new_max_key = std::max({ key, second_key, max_key_ });
+
+        if (bins_.empty()) {
+            bins_.assign(get_new_length(new_min_key, new_max_key), 0.0);
+            offset_ = new_min_key;
+            adjust(new_min_key, new_max_key);
+        } else if (new_min_key >= min_key_ && new_max_key < offset_ + length()) {
+            min_key_ = new_min_key;
+            max_key_ = new_max_key;
+        } else {
+            const int new_length = get_new_length(new_min_key, new_max_key);
+            if (new_length > length()) {
+                bins_.resize(new_length, 0.0);
+            }
+            adjust(new_min_key, new_max_key);
+        }
+    }
+
+    void adjust(int new_min_key, int new_max_key)
+    {
+        if (new_max_key - new_min_key + 1 <= length()) {
+            center_bins(new_min_key, new_max_key);
+            min_key_ = new_min_key;
+            max_key_ = new_max_key;
+            return;
+        }
+
+        // The range of keys is too wide: collapse the bins that do not fit
+        if (collapse_lowest_) {
+            new_min_key = new_max_key - length() + 1;
+            if (new_min_key >= max_key_) {
+                // Everything falls in the lowest bin
+                offset_ = new_min_key;
+                min_key_ = new_min_key;
+                std::fill(bins_.begin(), bins_.end(), 0.0);
+                bins_[0] = count_;
+            } else {
+                const int shift = offset_ - new_min_key;
+                if (shift < 0) {
+                    const int collapse_start = min_key_ - offset_;
+                    const int collapse_end = new_min_key - offset_;
+                    const double collapsed = sum(bins_, collapse_start, collapse_end);
+                    std::fill(bins_.begin() + collapse_start, bins_.begin() + collapse_end, 0.0);
+                    bins_[collapse_end] += collapsed;
+                }
+                min_key_ = new_min_key;
+                shift_bins(shift);
+            }
+            max_key_ = new_max_key;
+        } else {
+            new_max_key = new_min_key + length() - 1;
+            if (new_max_key <= min_key_) {
+                // Everything falls in the highest bin
+                offset_ = new_min_key;
+                max_key_ = new_max_key;
+                std::fill(bins_.begin(), bins_.end(), 0.0);
+                bins_.back() = count_;
+            } else {
+                const int shift = offset_ - new_min_key;
+                if (shift > 0) {
+                    const int collapse_start = new_max_key - offset_ + 1;
+                    const int collapse_end = max_key_ - offset_ + 1;
+                    const double collapsed = sum(bins_, collapse_start, collapse_end);
+                    std::fill(bins_.begin() + collapse_start, bins_.begin() + collapse_end, 0.0);
+                    bins_[collapse_start - 1] += collapsed;
+                }
+                max_key_ = new_max_key;
+                shift_bins(shift);
+            }
+            min_key_ = new_min_key;
+        }
+        is_collapsed_ = true;
+    }
+
+    void center_bins(int new_min_key, int new_max_key)
+    {
+        const int middle_key = new_min_key + (new_max_key - new_min_key + 1) / 2;
+        shift_bins(offset_ + length() / 2 - middle_key);
+    }
+
+    // Move the bins right (shift > 0) or left (shift < 0), filling in with empty bins
+    void shift_bins(int shift)
+    {
+        if (shift > 0) {
+            const size_t kept = bins_.size() > static_cast<size_t>(shift) ? bins_.size() - shift : 0;
+            bins_.resize(kept);
+            bins_.insert(bins_.begin(), shift, 0.0);
+        } else if (shift < 0) {
+            const size_t dropped = std::min(bins_.size(), static_cast<size_t>(-shift));
+            bins_.erase(bins_.begin(), bins_.begin() + dropped);
+            bins_.resize(bins_.size() + static_cast<size_t>(-shift), 0.0);
+        }
+        offset_ -= shift;
+    }
+
+    std::vector<double> bins_;
+    int offset_ = 0;
+    int min_key_ = INT_MAX;
+    int max_key_ = INT_MIN;
+    double count_ = 0.0;
+    int bin_limit_;
+    bool collapse_lowest_;
+    bool is_collapsed_ = false;
+};
+
+class DDSketch
+{
+  public:
+    DDSketch()
+      : DDSketch(ddsketch_relative_accuracy, ddsketch_bin_limit)
+    {
+    }
+
+    DDSketch(double relative_accuracy, int bin_limit)
+      : mapping_(relative_accuracy)
+      , store_(bin_limit, true)
+      , negative_store_(bin_limit, false)
+    {
+    }
+
+    void add(double value, double weight = 1.0)
+    {
+        if (value > mapping_.min_possible()) {
+            store_.add(mapping_.key(value), weight);
+        } else if (value < -mapping_.min_possible()) {
+            negative_store_.add(mapping_.key(-value), weight);
+        } else {
+            zero_count_ += weight;
+        }
+        count_ += weight;
+        sum_ += value * weight;
+    }
+
+    // Both sketches must have been created with the same parameters
+    void merge(const DDSketch& sketch)
+    {
+        store_.merge(sketch.store_);
+        negative_store_.merge(sketch.negative_store_);
+        zero_count_ += sketch.zero_count_;
+        count_ += sketch.count_;
+        sum_ += sketch.sum_;
+    }
+
+    // Approximate value at the given quantile, in [0, 1]. The sketch must not be empty.
+    double get_quantile_value(double quantile) const
+    {
+        const double rank = quantile * (count_ - 1);
+        if (rank < negative_store_.count()) {
+            const double reversed_rank = negative_store_.count() - rank - 1;
+            return -mapping_.value(negative_store_.key_at_rank(reversed_rank, false));
+        }
+        if (rank < zero_count_ + negative_store_.count()) {
+            return 0.0;
+        }
+        return mapping_.value(store_.key_at_rank(rank - zero_count_ - negative_store_.count()));
+    }
+
+    double count() const { return count_; }
+    double sum() const { return sum_; }
+    double zero_count() const { return zero_count_; }
+
+    // Append the DDSketch protobuf message to out
+    void to_proto(std::string& out) const
+    {
+        std::string mapping;
+        proto_double(mapping, 1, mapping_.gamma());
+        proto_double(mapping, 2, mapping_.offset());
+        // interpolation (3) is NONE, the default value
+
+        proto_message(out, 1, mapping);
+        proto_message(out, 2, store_proto(store_));
+        proto_message(out, 3, store_proto(negative_store_));
+        proto_double(out, 4, zero_count_);
+    }
+
+  private:
+    static void proto_varint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static void proto_fixed64(std::string& out, double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>(bits >> (8 * i)));
+        }
+    }
+
+    // proto3 does not serialize fields holding their default value
+    static void proto_double(std::string& out, uint32_t field, double value)
+    {
+        if (value != 0.0) {
+            proto_varint(out, (field << 3) | 1);
+            proto_fixed64(out, value);
+        }
+    }
+
+    static void proto_message(std::string& out, uint32_t field, const std::string& msg)
+    {
+        proto_varint(out, (field << 3) | 2);
+        proto_varint(out, msg.size());
+        out.append(msg);
+    }
+
+    static std::string store_proto(const CollapsingDenseStore& store)
+    {
+        std::string msg;
+        const std::vector<double>& bins = store.bins();
+        if (!bins.empty()) {
+            // contiguousBinCounts (2), packed
+            proto_varint(msg, (2 << 3) | 2);
+            proto_varint(msg, bins.size() * 8);
+            for (double count : bins) {
+                proto_fixed64(msg, count);
+            }
+        }
+        if (store.offset() != 0) {
+            // contiguousBinIndexOffset (3), zig-zag encoded
+            const int32_t offset = store.offset();
+            proto_varint(msg, (3 << 3) | 0);
+            proto_varint(msg, (static_cast<uint32_t>(offset) << 1) ^ static_cast<uint32_t>(offset >> 31));
+        }
+        return msg;
+    }
+
+    LogarithmicMapping mapping_;
+    CollapsingDenseStore store_;
+    CollapsingDenseStore negative_store_;
+    double zero_count_ = 0.0;
+    double count_ = 0.0;
+    double sum_ = 0.0;
+};
+
+} // namespace ddtrace
@@ -0,0 +1,16 @@
+from libcpp.string cimport string
+
+
+cdef extern from "_ddsketch.hpp" namespace "ddtrace":
+    cdef cppclass CDDSketch "ddtrace::DDSketch":
+        void add(double value, double weight) except +
+        void merge(const CDDSketch& sketch) except +
+        double get_quantile_value(double quantile)
+        double count()
+        double sum()
+        double zero_count()
+        void to_proto(string& out) except +
+
+
+cdef class DDSketch:
+    cdef CDDSketch _sketch
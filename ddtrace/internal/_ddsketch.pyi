@@ -0,0 +1,13 @@
+from typing import Optional
+
+class DDSketch:
+    def add(self, value: float, weight: float = 1.0) -> None: ...
+    def merge(self, sketch: "DDSketch") -> None: ...
+    def get_quantile_value(self, quantile: float) -> Optional[float]: ...
+    @property
+    def count(self) -> float: ...
+    @property
+    def sum(self) -> float: ...
+    @property
+    def zero_count(self) -> float: ...
+    def to_proto(self) -> bytes: ...
@@ -0,0 +1,54 @@
+from libcpp.string cimport string
+
+
+cdef class DDSketch:
+    """DDSketch with the relative accuracy (0.775%) and bin limit (2048) used by the backend.
+
+    This is a drop-in replacement for ``ddsketch.LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)``, whose
+    protobuf encoding is identical to ``DDSketchProto.to_proto(sketch).SerializeToString()``.
+    """
+
+    def add(self, double value, double weight=1.0):
+        # type: (float, float) -> None
+        """Add a value to the sketch."""
+        if weight <= 0.0:
+            raise ValueError("weight must be a positive float, got %r" % weight)
+        self._sketch.add(value, weight)
+
+    def merge(self, DDSketch sketch not None):
+        # type: (DDSketch) -> None
+        """Merge the values of another sketch into this one."""
+        self._sketch.merge(sketch._sketch)
+
+    def get_quantile_value(self, double quantile):
+        # type: (float) -> typing.Optional[float]
+        """Return the approximate value at the given quantile, or None if the quantile is invalid or there are no
+        values."""
+        if quantile < 0 or quantile > 1 or self._sketch.count() == 0:
+            return None
+        return self._sketch.get_quantile_value(quantile)
+
+    @property
+    def count(self):
+        # type: () -> float
+        """The number of values added to the sketch."""
+        return self._sketch.count()
+
+    @property
+    def sum(self):
+        # type: () -> float
+        """The sum of the values added to the sketch."""
+        return self._sketch.sum()
+
+    @property
+    def zero_count(self):
+        # type: () -> float
+        """The number of values added to the sketch which are too close to 0 to be mapped to a bin."""
+        return self._sketch.zero_count()
+
+    def to_proto(self):
+        # type: () -> bytes
+        """Return the sketch serialized as a DDSketch protobuf message."""
+        cdef string out
+        self._sketch.to_proto(out)
+        return out
@@ -7,6 +7,14 @@ from json import dumps as json_dumps
 import threading
 from json import dumps as json_dumps
 
+from ddtrace._trace._span cimport SPAN_FIELD_DURATION_NS
+from ddtrace._trace._span cimport SPAN_FIELD_ERROR
+from ddtrace._trace._span cimport SPAN_FIELD_PARENT_ID
+from ddtrace._trace._span cimport SPAN_FIELD_SPAN_ID
+from ddtrace._trace._span cimport SPAN_FIELD_START_NS
+from ddtrace._trace._span cimport SPAN_FIELD_TRACE_ID
+from ddtrace._trace._span cimport SpanData
+
 from ._utils cimport PyBytesLike_Check
 
 
@@ -670,19 +678,23 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
         raise TypeError("Unhandled metrics type: %r" % type(metrics))
 
     cdef int pack_span(self, object span, void *dd_origin) except? -1:
+        cdef SpanData s = <SpanData?> span
         cdef int ret
         cdef Py_ssize_t L
         cdef int has_span_type
         cdef int has_meta
         cdef int has_metrics
 
-        has_error = <bint> (span.error != 0)
-        has_span_type = <bint> (span.span_type is not None)
-        has_meta = <bint> (len(span._meta) > 0 or dd_origin is not NULL)
-        has_metrics = <bint> (len(span._metrics) > 0)
-        has_parent_id = <bint> (span.parent_id is not None)
-        has_links = <bint> (len(span._links) > 0)
-        has_meta_struct = <bint> (len(span._meta_struct) > 0)
+        if s._raw_fields & SPAN_FIELD_ERROR:
+            has_error = <bint> (s.error != 0)
+        else:
+            has_error = <bint> (s._c_error != 0)
+        has_span_type = <bint> (s._c_span_type is not None)
+        has_meta = <bint> (len(s._c_meta) > 0 or dd_origin is not NULL)
+        has_metrics = <bint> (len(s._c_metrics) > 0)
+        has_parent_id = <bint> s._has_parent_id
+        has_links = <bint> (len(s._c_links) > 0)
+        has_meta_struct = <bint> (len(s._c_meta_struct) > 0)
 
         L = 7 + has_span_type + has_meta + has_metrics + has_error + has_parent_id + has_links + has_meta_struct
 
@@ -692,7 +704,10 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
             ret = pack_bytes(&self.pk, <char *> b"trace_id", 8)
             if ret != 0:
                 return ret
-            ret = pack_number(&self.pk, span._trace_id_64bits)
+            if s._raw_fields & SPAN_FIELD_TRACE_ID:
+                ret = pack_number(&self.pk, s._trace_id_64bits)
+            else:
+                ret = msgpack_pack_uint64(&self.pk, s._c_trace_id_64bits)
             if ret != 0:
                 return ret
 
@@ -700,49 +715,63 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 ret = pack_bytes(&self.pk, <char *> b"parent_id", 9)
                 if ret != 0:
                     return ret
-                ret = pack_number(&self.pk, span.parent_id)
+                if s._raw_fields & SPAN_FIELD_PARENT_ID:
+                    ret = pack_number(&self.pk, s.parent_id)
+                else:
+                    ret = msgpack_pack_uint64(&self.pk, s._c_parent_id)
                 if ret != 0:
                     return ret
 
             ret = pack_bytes(&self.pk, <char *> b"span_id", 7)
             if ret != 0:
                 return ret
-            ret = pack_number(&self.pk, span.span_id)
+            if s._raw_fields & SPAN_FIELD_SPAN_ID:
+                ret = pack_number(&self.pk, s.span_id)
+            else:
+                ret = msgpack_pack_uint64(&self.pk, s._c_span_id)
             if ret != 0:
                 return ret
 
             ret = pack_bytes(&self.pk, <char *> b"service", 7)
             if ret != 0:
                 return ret
-            ret = pack_text(&self.pk, span.service)
+            ret = pack_text(&self.pk, s._c_service)
             if ret != 0:
                 return ret
 
             ret = pack_bytes(&self.pk, <char *> b"resource", 8)
             if ret != 0:
                 return ret
-            ret = pack_text(&self.pk, span.resource)
+            ret = pack_text(&self.pk, s._c_resource[0])
             if ret != 0:
                 return ret
 
             ret = pack_bytes(&self.pk, <char *> b"name", 4)
             if ret != 0:
                 return ret
-            ret = pack_text(&self.pk, span.name)
+            ret = pack_text(&self.pk, s._c_name)
             if ret != 0:
                 return ret
 
             ret = pack_bytes(&self.pk, <char *> b"start", 5)
             if ret != 0:
                 return ret
-            ret = pack_number(&self.pk, span.start_ns)
+            if s._raw_fields & SPAN_FIELD_START_NS:
+                ret = pack_number(&self.pk, s.start_ns)
+            else:
+                ret = msgpack_pack_int64(&self.pk, s._c_start_ns)
             if ret != 0:
                 return ret
 
             ret = pack_bytes(&self.pk, <char *> b"duration", 8)
             if ret != 0:
                 return ret
-            ret = pack_number(&self.pk, span.duration_ns)
+            if s._raw_fields & SPAN_FIELD_DURATION_NS:
+                ret = pack_number(&self.pk, s.duration_ns)
+            elif s._finished:
+                ret = msgpack_pack_int64(&self.pk, s._c_duration_ns)
+            else:
+                ret = msgpack_pack_nil(&self.pk)
             if ret != 0:
                 return ret
 
@@ -758,7 +787,7 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 ret = pack_bytes(&self.pk, <char *> b"type", 4)
                 if ret != 0:
                     return ret
-                ret = pack_text(&self.pk, span.span_type)
+                ret = pack_text(&self.pk, s._c_span_type)
                 if ret != 0:
                     return ret
 
@@ -766,7 +795,7 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 ret = pack_bytes(&self.pk, <char *> b"span_links", 10)
                 if ret != 0:
                     return ret
-                ret = self._pack_links(span._links)
+                ret = self._pack_links(s._c_links)
                 if ret != 0:
                     return ret
 
@@ -775,7 +804,7 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 if ret != 0:
                     return ret
 
-                ret = self._pack_meta(span._meta, <char *> dd_origin)
+                ret = self._pack_meta(s._c_meta, <char *> dd_origin)
                 if ret != 0:
                     return ret
 
@@ -784,10 +813,10 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 if ret != 0:
                     return ret
 
-                ret = msgpack_pack_map(&self.pk, len(span._meta_struct))
+                ret = msgpack_pack_map(&self.pk, len(s._c_meta_struct))
                 if ret != 0:
                     return ret
-                for k, v in span._meta_struct.items():
+                for k, v in s._c_meta_struct.items():
                     ret = pack_text(&self.pk, k)
                     if ret != 0:
                         return ret
@@ -802,7 +831,7 @@ cdef class MsgpackEncoderV03(MsgpackEncoderBase):
                 ret = pack_bytes(&self.pk, <char *> b"metrics", 7)
                 if ret != 0:
                     return ret
-                ret = self._pack_metrics(span._metrics)
+                ret = self._pack_metrics(s._c_metrics)
                 if ret != 0:
                     return ret
 
@@ -847,62 +876,94 @@ cdef class MsgpackEncoderV05(MsgpackEncoderBase):
     cdef void * get_dd_origin_ref(self, str dd_origin):
         return <void *> PyLong_AsLong(self._st._index(dd_origin))
 
-    cdef int pack_span(self, object span, void *dd_origin) except? -1:
+    cdef int _pack_raw_ints(self, SpanData s) except? -1:
         cdef int ret
 
-        ret = msgpack_pack_array(&self.pk, 12)
-        if ret != 0:
-            return ret
-
-        ret = self._pack_string(span.service)
-        if ret != 0:
-            return ret
-        ret = self._pack_string(span.name)
-        if ret != 0:
-            return ret
-        ret = self._pack_string(span.resource)
+        _ = s._trace_id_64bits
+        ret = msgpack_pack_uint64(&self.pk, _ if _ is not None else 0)
         if ret != 0:
             return ret
 
-        _ = span._trace_id_64bits
+        _ = s.span_id
         ret = msgpack_pack_uint64(&self.pk, _ if _ is not None else 0)
         if ret != 0:
             return ret
 
-        _ = span.span_id
+        _ = s.parent_id
         ret = msgpack_pack_uint64(&self.pk, _ if _ is not None else 0)
         if ret != 0:
             return ret
 
-        _ = span.parent_id
-        ret = msgpack_pack_uint64(&self.pk, _ if _ is not None else 0)
+        _ = s.start_ns
+        ret = msgpack_pack_int64(&self.pk, _ if _ is not None else 0)
         if ret != 0:
             return ret
 
-        _ = span.start_ns
+        _ = s.duration_ns
         ret = msgpack_pack_int64(&self.pk, _ if _ is not None else 0)
         if ret != 0:
             return ret
 
-        _ = span.duration_ns
-        ret = msgpack_pack_int64(&self.pk, _ if _ is not None else 0)
+        _ = s.error
+        return msgpack_pack_int32(&self.pk, _ if _ is not None else 0)
+
+    cdef int pack_span(self, object span, void *dd_origin) except? -1:
+        cdef SpanData s = <SpanData?> span
+        cdef int ret
+
+        ret = msgpack_pack_array(&self.pk, 12)
         if ret != 0:
             return ret
 
-        _ = span.error
-        ret = msgpack_pack_int32(&self.pk, _ if _ is not None else 0)
+        ret = self._pack_string(s._c_service)
         if ret != 0:
             return ret
+        ret = self._pack_string(s._c_name)
+        if ret != 0:
+            return ret
+        ret = self._pack_string(s._c_resource[0])
+        if ret != 0:
+            return ret
+
+        if s._raw_fields:
+            # Some of the integer fields were set to values that do not fit their C field
+            ret = self._pack_raw_ints(s)
+            if ret != 0:
+                return ret
+        else:
+            ret = msgpack_pack_uint64(&self.pk, s._c_trace_id_64bits)
+            if ret != 0:
+                return ret
+
+            ret = msgpack_pack_uint64(&self.pk, s._c_span_id)
+            if ret != 0:
+                return ret
+
+            ret = msgpack_pack_uint64(&self.pk, s._c_parent_id if s._has_parent_id else 0)
+            if ret != 0:
+                return ret
+
+            ret = msgpack_pack_int64(&self.pk, s._c_start_ns)
+            if ret != 0:
+                return ret
+
+            ret = msgpack_pack_int64(&self.pk, s._c_duration_ns if s._finished else 0)
+            if ret != 0:
+                return ret
+
+            ret = msgpack_pack_int32(&self.pk, s._c_error)
+            if ret != 0:
+                return ret
 
         span_links = ""
-        if span._links:
-            span_links = json_dumps([link.to_dict() for _, link in span._links.items()])
+        if s._c_links:
+            span_links = json_dumps([link.to_dict() for _, link in s._c_links.items()])
 
-        ret = msgpack_pack_map(&self.pk, len(span._meta) + (dd_origin is not NULL) + (len(span_links) > 0))
+        ret = msgpack_pack_map(&self.pk, len(s._c_meta) + (dd_origin is not NULL) + (len(span_links) > 0))
         if ret != 0:
             return ret
-        if span._meta:
-            for k, v in span._meta.items():
+        if s._c_meta:
+            for k, v in s._c_meta.items():
                 ret = self._pack_string(k)
                 if ret != 0:
                     return ret
@@ -924,11 +985,11 @@ cdef class MsgpackEncoderV05(MsgpackEncoderBase):
             if ret != 0:
                 return ret
 
-        ret = msgpack_pack_map(&self.pk, len(span._metrics))
+        ret = msgpack_pack_map(&self.pk, len(s._c_metrics))
         if ret != 0:
             return ret
-        if span._metrics:
-            for k, v in span._metrics.items():
+        if s._c_metrics:
+            for k, v in s._c_metrics.items():
                 ret = self._pack_string(k)
                 if ret != 0:
                     return ret
@@ -936,7 +997,7 @@ cdef class MsgpackEncoderV05(MsgpackEncoderBase):
                 if ret != 0:
                     return ret
 
-        ret = self._pack_string(span.span_type)
+        ret = self._pack_string(s._c_span_type)
         if ret != 0:
             return ret
 
@@ -0,0 +1,15 @@
+import typing
+
+from ddtrace._trace.span import Span
+from ddtrace.sampling_rule import SamplingRule
+
+class GlobMatcher:
+    pattern: str
+    def __init__(self, pattern: str) -> None: ...
+    def match(self, subject: str) -> bool: ...
+
+class SamplingRuleMatcher:
+    def __init__(self, rules: typing.List[SamplingRule]) -> None: ...
+    def compiled_for(self, rules: typing.List[SamplingRule]) -> bool: ...
+    def first_match(self, span: Span) -> int: ...
+    def check_tags(self, index: int, meta: typing.Dict[str, str], metrics: typing.Dict[str, float]) -> bool: ...
@@ -0,0 +1,291 @@
+"""
+Native glob matching, and evaluation of sampling rules.
+
+Glob patterns support ``*`` as a zero-or-more-characters wildcard and ``?`` as a single character wildcard, with no
+escape sequences, and match case insensitively. A pattern is compiled once into the literal segments between its
+``*`` wildcards: the first and last segments are anchored to the start and end of the subject, and the others are
+searched for left to right, so matching never backtracks over a segment once it has been found. Subjects are not memoized, so high-cardinality values (e.g. resource names) cost the same as any other.
+"""
+cimport cython
+from cpython.unicode cimport PyUnicode_CheckExact
+
+
+cdef extern from "Python.h":
+    bint PyUnicode_IS_ASCII(object o)
+
+
+cdef enum GlobKind:
+    # Only made of * wildcards, matches anything
+    GLOB_ANY
+    # No * wildcard, matches subjects of the same length
+    GLOB_EXACT
+    # Anchored first and last segments, with segments searched for in between
+    GLOB_SEGMENTS
+
+
+cdef inline Py_UCS4 _lower_ascii(Py_UCS4 c):
+    if c >= 0x41 and c <= 0x5A:  # A-Z
+        return <Py_UCS4>(<unsigned int>c + 0x20)
+    return c
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+cdef inline bint _segment_at(str subject, Py_ssize_t pos, str segment):
+    cdef Py_ssize_t i
+    cdef Py_UCS4 c
+    for i in range(len(segment)):
+        c = segment[i]
+        if c != u"?" and c != _lower_ascii(subject[pos + i]):
+            return False
+    return True
+
+
+# Return the position of the leftmost occurrence of segment in subject[start:end], or -1
+cdef inline Py_ssize_t _find_segment(str subject, Py_ssize_t start, Py_ssize_t end, str segment):
+    cdef Py_ssize_t pos
+    for pos in range(start, end - len(segment) + 1):
+        if _segment_at(subject, pos, segment):
+            return pos
+    return -1
+
+
+cdef class GlobMatcher:
+    """Case insensitive glob pattern, compiled for repeated matching."""
+
+    cdef readonly str pattern
+    cdef GlobKind _kind
+    cdef str _first
+    cdef str _last
+    cdef tuple _middle
+    cdef Py_ssize_t _min_length
+
+    def __init__(self, pattern):
+        # type: (str) -> None
+        self.pattern = pattern.lower()
+
+        segments = self.pattern.split("*")
+        self._min_length = sum(len(segment) for segment in segments)
+        if len(segments) == 1:
+            self._kind = GLOB_EXACT
+        elif self._min_length == 0:
+            self._kind = GLOB_ANY
+        else:
+            self._kind = GLOB_SEGMENTS
+        self._first = segments[0]
+        self._last = segments[-1]
+        # Consecutive * wildcards leave empty segments, which match anywhere
+        self._middle = tuple(segment for segment in segments[1:-1] if segment)
+
+    cpdef bint match(self, subject):
+        # type: (str) -> bool
+        cdef str s
+        cdef Py_ssize_t n, pos, end
+
+        if self._kind == GLOB_ANY:
+            return True
+
+        s = subject if PyUnicode_CheckExact(subject) else str(subject)
+        # ASCII subjects are lowered while they are compared, others must be lowered first as lowering them can change
+        # their length
+        if not PyUnicode_IS_ASCII(s):
+            s = s.lower()
+
+        n = len(s)
+        if n < self._min_length:
+            return False
+        if self._kind == GLOB_EXACT:
+            return n == self._min_length and _segment_at(s, 0, self._first)
+
+        end = n - len(self._last)
+        if not _segment_at(s, 0, self._first) or not _segment_at(s, end, self._last):
+            return False
+        pos = len(self._first)
+        for segment in self._middle:
+            pos = _find_segment(s, pos, end, segment)
+            if pos < 0:
+                return False
+            pos += len(<str>segment)
+        return True
+
+    def __repr__(self):
+        return "{}({!r})".format(self.__class__.__name__, self.pattern)
+
+
+cdef enum FieldKind:
+    FIELD_NO_RULE
+    FIELD_GLOB
+    # Deprecated regular expression, function or exact value, evaluated by the rule
+    FIELD_LEGACY
+
+
+# Result of a glob in the memo of a span evaluation
+cdef enum MemoResult:
+    MEMO_UNKNOWN
+    MEMO_FALSE
+    MEMO_TRUE
+
+
+cdef enum:
+    # Memos of up to this many globs are kept on the stack
+    STACK_MEMO_SIZE = 64
+
+
+cdef class _FieldMatcher:
+    cdef FieldKind kind
+    cdef object pattern
+    cdef GlobMatcher glob
+    cdef Py_ssize_t slot
+
+
+cdef class _TagMatcher:
+    cdef object key
+    cdef GlobMatcher glob
+    cdef Py_ssize_t slot
+
+
+cdef class _CompiledRule:
+    cdef object rule
+    cdef _FieldMatcher service
+    cdef _FieldMatcher name
+    cdef _FieldMatcher resource
+    cdef tuple tags
+
+
+cdef inline bint _memo_match(GlobMatcher glob, object subject, Py_ssize_t slot, unsigned char* memo) except -1:
+    if memo[slot] == MEMO_UNKNOWN:
+        memo[slot] = MEMO_TRUE if glob.match(subject) else MEMO_FALSE
+    return memo[slot] == MEMO_TRUE
+
+
+cdef bint _tag_matches(GlobMatcher glob, object key, object meta, object metrics) except -1:
+    if glob.match(str(meta.get(key))):
+        return True
+
+    # If the value doesn't match in meta, check the metrics
+    value = metrics.get(key)
+    if isinstance(value, float):
+        # Matching floating point values with a non-zero decimal part is not supported: only the * pattern matches them
+        if not value.is_integer():
+            return glob.pattern == "*"
+        value = int(value)
+    return glob.match(str(value))
+
+
+cdef class SamplingRuleMatcher:
+    """Evaluate a span against a list of sampling rules at once.
+
+    The globs of all the rules are compiled together, so that a glob shared by several rules is only matched once per
+    span.
+    """
+
+    cdef list _rules
+    cdef tuple _compiled
+    cdef Py_ssize_t _slots
+
+    def __init__(self, rules):
+        # type: (typing.List[SamplingRule]) -> None
+        self._rules = list(rules)
+        slots = {}
+        self._compiled = tuple(self._compile(rule, slots) for rule in self._rules)
+        self._slots = len(slots)
+
+    cdef _FieldMatcher _compile_field(self, object field, object pattern, object no_rule, dict slots):
+        cdef _FieldMatcher matcher = _FieldMatcher()
+        matcher.pattern = pattern
+        if pattern is no_rule:
+            matcher.kind = FIELD_NO_RULE
+        elif isinstance(pattern, GlobMatcher):
+            matcher.kind = FIELD_GLOB
+            matcher.glob = pattern
+            matcher.slot = slots.setdefault((field, matcher.glob.pattern), len(slots))
+        else:
+            matcher.kind = FIELD_LEGACY
+        return matcher
+
+    cdef _CompiledRule _compile(self, object rule, dict slots):
+        cdef _CompiledRule compiled = _CompiledRule()
+        cdef _TagMatcher tag
+        compiled.rule = rule
+        compiled.service = self._compile_field("service", rule.service, rule.NO_RULE, slots)
+        compiled.name = self._compile_field("name", rule.name, rule.NO_RULE, slots)
+        compiled.resource = self._compile_field("resource", rule.resource, rule.NO_RULE, slots)
+        tags = []
+        for key, glob in rule._tag_value_matchers.items():
+            tag = _TagMatcher()
+            tag.key = key
+            tag.glob = glob
+            tag.slot = slots.setdefault(("tag", key, tag.glob.pattern), len(slots))
+            tags.append(tag)
+        compiled.tags = tuple(tags)
+        return compiled
+
+    def compiled_for(self, rules):
+        # type: (typing.List[SamplingRule]) -> bool
+        """Return whether this matcher was compiled for exactly these rules."""
+        cdef Py_ssize_t i
+        if len(rules) != len(self._rules):
+            return False
+        for i in range(len(self._rules)):
+            if rules[i] is not self._rules[i]:
+                return False
+        return True
+
+    cdef bint _field_matches(self, _CompiledRule rule, _FieldMatcher field, object value, unsigned char* memo) except -1:
+        if field.kind == FIELD_NO_RULE:
+            return True
+        if field.kind == FIELD_GLOB:
+            return _memo_match(field.glob, value, field.slot, memo)
+        return rule.rule._pattern_matches(value, field.pattern)
+
+    cdef bint _rule_matches(
+        self, _CompiledRule rule, object span, object service, object name, object resource, unsigned char* memo
+    ) except -1:
+        cdef _TagMatcher tag
+        if rule.tags:
+            meta = span._meta
+            metrics = span._metrics
+            for tag in rule.tags:
+                if memo[tag.slot] == MEMO_UNKNOWN:
+                    memo[tag.slot] = MEMO_TRUE if _tag_matches(tag.glob, tag.key, meta, metrics) else MEMO_FALSE
+                if memo[tag.slot] != MEMO_TRUE:
+                    return False
+        return (
+            self._field_matches(rule, rule.service, service, memo)
+            and self._field_matches(rule, rule.name, name, memo)
+            and self._field_matches(rule, rule.resource, resource, memo)
+        )
+
+    def first_match(self, span):
+        # type: (Span) -> int
+        """Return the index of the first rule matching the span, or -1 if none does."""
+        cdef unsigned char stack_memo[STACK_MEMO_SIZE]
+        cdef bytearray heap_memo
+        cdef unsigned char* memo = stack_memo
+        cdef Py_ssize_t i
+
+        if self._slots > STACK_MEMO_SIZE:
+            heap_memo = bytearray(self._slots)
+            memo = <unsigned char*><char*>heap_memo
+        else:
+            for i in range(self._slots):
+                memo[i] = MEMO_UNKNOWN
+
+        # The fields are read once for all the rules
+        service = span.service
+        name = span.name
+        resource = span.resource
+        for i in range(len(self._compiled)):
+            if self._rule_matches(self._compiled[i], span, service, name, resource, memo):
+                return i
+        return -1
+
+    def check_tags(self, Py_ssize_t index, meta, metrics):
+        # type: (int, typing.Dict[str, str], typing.Dict[str, float]) -> bool
+        """Return whether all the tags of a rule match the given span tags and metrics."""
+        cdef _CompiledRule rule = self._compiled[index]
+        cdef _TagMatcher tag
+        for tag in rule.tags:
+            if not _tag_matches(tag.glob, tag.key, meta, metrics):
+                return False
+        return True
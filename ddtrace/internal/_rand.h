@@ -0,0 +1,38 @@
+#pragma once
+
+#include "_stdint.h"
+
+/* Per-thread state of the pseudorandom generator of _rand.pyx */
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DD_RAND_THREAD_LOCAL __declspec(thread)
+#else
+#define DD_RAND_THREAD_LOCAL __thread
+#endif
+
+typedef struct
+{
+    /* Generation of the seed the state was derived from, 0 until the thread first generates a number */
+    uint64_t generation;
+    uint64_t state;
+} dd_rand_thread_state;
+
+static DD_RAND_THREAD_LOCAL dd_rand_thread_state dd_rand_thread;
+
+static inline dd_rand_thread_state*
+dd_rand_get_thread_state(void)
+{
+    return &dd_rand_thread;
+}
+
+/* Atomically increment the counter and return its new value */
+static inline uint64_t
+dd_rand_increment(uint64_t* counter)
+{
+#ifdef _MSC_VER
+    return (uint64_t)_InterlockedIncrement64((volatile __int64*)counter);
+#else
+    return __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+#endif
+}
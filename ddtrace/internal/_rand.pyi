@@ -1,3 +1,6 @@
+import typing
+
 def seed() -> None: ...
-def rand64bits(check_pid: bool = True) -> int: ...
-def rand128bits(check_pid: bool = True) -> int: ...
+def rand64bits() -> int: ...
+def rand128bits() -> int: ...
+def fill_rand64bits(out: typing.Any) -> None: ...
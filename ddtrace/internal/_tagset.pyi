@@ -14,5 +14,5 @@ class TagsetMaxSizeDecodeError(TagsetDecodeError):
     max_size: int
     def __init__(self, value: Dict[str, str], max_size: int): ...
 
-def decode_tagset_string(tagset: str) -> Dict[str, str]: ...
+def decode_tagset_string(tagset: str, max_size: int = 512) -> Dict[str, str]: ...
 def encode_tagset_values(values: Dict[str, str], max_size: int = 512) -> str: ...
@@ -7,7 +7,21 @@ Tagset eBNF::
     value = { ? ASCII 32-126 ? - comma };
     equal or comma = "=" | ",";
     space = " ";
+
+Tagsets are decoded and encoded over the ASCII bytes of their strings: separators are found with memchr, which the C
+library vectorizes, characters are validated with a lookup table, and strings are only created for the decoded keys
+and values, or for the encoded tagset.
 """
+from cpython.mem cimport PyMem_Free
+from cpython.mem cimport PyMem_Malloc
+from libc.string cimport memchr
+from libc.string cimport memcpy
+
+
+cdef extern from "Python.h":
+    bint PyUnicode_IS_ASCII(object o)
+    void* PyUnicode_DATA(object o)
+    str PyUnicode_DecodeASCII(const char* s, Py_ssize_t size, const char* errors)
 
 
 class TagsetEncodeError(ValueError):
@@ -73,29 +87,52 @@ class TagsetMaxSizeDecodeError(TagsetDecodeError):
         super(TagsetMaxSizeDecodeError, self).__init__(msg)
 
 
-cdef inline int is_equal(int c):
-    # '='
-    return c == 61
+cdef enum:
+    # Classes of characters, in the lookup table
+    KEY_CHAR = 1
+    VALUE_CHAR = 2
 
+    # Tagsets of up to this size are encoded on the stack
+    STACK_BUFFER_SIZE = 512
 
-cdef inline int is_comma(int c):
-    # ','
-    return c == 44
 
+cdef unsigned char CHAR_CLASSES[256]
 
-cdef inline int is_valid_key_char(int c):
+
+cdef void _init_char_classes():
+    cdef int c
+    for c in range(256):
+        CHAR_CLASSES[c] = 0
     # string.printable - " ,="
-    # 32 = " "
-    # 44 = ",""
+    # 44 = ","
     # 61 = "="
-    return (33 <= c <= 43) or (45 <= c <= 60) or (62 <= c <= 126)
+    for c in range(33, 127):
+        if c != 44 and c != 61:
+            CHAR_CLASSES[c] = KEY_CHAR | VALUE_CHAR
+    # Same as keys except spaces and equals are allowed in values
+    # 32 = " "
+    CHAR_CLASSES[32] = VALUE_CHAR
+    CHAR_CLASSES[61] = VALUE_CHAR
+
+
+_init_char_classes()
+
 
+# Index of the first character of data[start:end] which is not of the given class, or -1
+cdef inline Py_ssize_t _find_invalid(const char* data, Py_ssize_t start, Py_ssize_t end, unsigned char char_class):
+    cdef Py_ssize_t i
+    for i in range(start, end):
+        if not (CHAR_CLASSES[<unsigned char>data[i]] & char_class):
+            return i
+    return -1
 
-# Same as is_valid_key_char except spaces are allowed
-cdef inline int is_valid_value_char(int c):
-    # string.printable - ","
-    # 44 = ",""
-    return c == 32 or is_equal(c) or is_valid_key_char(c)
+
+# Index of the first c in data[start:end], or end
+cdef inline Py_ssize_t _find(const char* data, Py_ssize_t start, Py_ssize_t end, char c):
+    cdef const char* found = <const char*>memchr(data + start, c, end - start)
+    if found == NULL:
+        return end
+    return found - data
 
 
 cpdef dict decode_tagset_string(str tagset, int max_size=512):
@@ -116,79 +153,87 @@ cpdef dict decode_tagset_string(str tagset, int max_size=512):
     :raises TagsetDecodeError: When the provided format is not valid
     """
     cdef dict res = {}
-    cdef str c
-    cdef int o
-    cdef str cur_val = ""
-    cdef str cur_key = ""
-    cdef int is_parsing_key = 1
+    cdef const char* data
+    cdef Py_ssize_t n, key_start, key_end, value_start, value_end, next_key_start, invalid
 
     # No tagset provided, short circuit the response
     if not tagset:
         return res
 
     # Raise an exception that the incoming tagset string exceeds the max size
-    if len(tagset) > max_size:
+    n = len(tagset)
+    if n > max_size:
         raise TagsetMaxSizeDecodeError(tagset, max_size)
 
-    # DEV: Parse in a single pass of `tagset`
-    #      `is_parsing_key` is used to know if we are on
-    #      right or left side of an `=`
-    for c in tagset:
-        o = ord(c)
-        if is_parsing_key:
-            if is_equal(o):
-                if not cur_key:
-                    raise TagsetDecodeError("Empty keys are not allowed: {!r}".format(tagset))
-                is_parsing_key = 0
-                continue
-
-            if not is_valid_key_char(o):
-                raise TagsetDecodeError("Unexpected {!r} character for key {}: {!r}".format(c, cur_key, tagset))
-            cur_key += c
-        else:
-            if is_comma(o):
-                cur_val = cur_val.strip(" ")
-                if not cur_val:
-                    raise TagsetDecodeError("Empty values are not allowed: {!r}".format(tagset))
-                res[cur_key] = cur_val
-                cur_key, cur_val, is_parsing_key = "", "", 1
-                continue
-
-            if not is_valid_value_char(o):
+    if not PyUnicode_IS_ASCII(tagset):
+        raise TagsetDecodeError("Unexpected non-ASCII character: {!r}".format(tagset))
+    data = <const char*>PyUnicode_DATA(tagset)
+
+    # DEV: Keys end at the first "=", and values at the next ",". A trailing "," is allowed.
+    key_start = 0
+    while key_start < n:
+        key_end = _find(data, key_start, n, b"=")
+        invalid = _find_invalid(data, key_start, key_end, KEY_CHAR)
+        if invalid >= 0:
+            raise TagsetDecodeError(
+                "Unexpected {!r} character for key {}: {!r}".format(
+                    tagset[invalid], tagset[key_start:invalid], tagset
+                )
+            )
+        if key_end == n:
+            raise TagsetDecodeError(
+                "Expected value for key {!r} instead got EOF: {!r}".format(tagset[key_start:], tagset)
+            )
+        if key_end == key_start:
+            raise TagsetDecodeError("Empty keys are not allowed: {!r}".format(tagset))
+
+        value_start = key_end + 1
+        value_end = _find(data, value_start, n, b",")
+        next_key_start = value_end + 1
+        invalid = _find_invalid(data, value_start, value_end, VALUE_CHAR)
+        if invalid >= 0:
+            raise TagsetDecodeError(
+                "Unexpected character {!r} for value {}={}: {!r}".format(
+                    tagset[invalid], tagset[key_start:key_end], tagset[value_start:invalid], tagset
+                ),
+            )
+
+        # Strip leading/trailing spaces from the value
+        while value_start < value_end and data[value_start] == b" ":
+            value_start += 1
+        while value_end > value_start and data[value_end - 1] == b" ":
+            value_end -= 1
+        if value_start == value_end:
+            if next_key_start > n:
                 raise TagsetDecodeError(
-                    "Unexpected character {!r} for value {}={}: {!r}".format(c, cur_key, cur_val, tagset),
+                    "Expected value for key {!r} instead got EOF: {!r}".format(tagset[key_start:key_end], tagset)
                 )
-            cur_val += c
+            raise TagsetDecodeError("Empty values are not allowed: {!r}".format(tagset))
 
-    # Reached EOF, do we have a key/value pair we need to save?
-    if cur_key:
-        cur_val = cur_val.strip(" ")
-        if cur_val:
-            res[cur_key] = cur_val
-        else:
-            raise TagsetDecodeError("Expected value for key {!r} instead got EOF: {!r}".format(cur_key, tagset))
+        res[tagset[key_start:key_end]] = tagset[value_start:value_end]
+        key_start = next_key_start
 
     return res
 
-cdef bint _key_is_valid(str key):
-    """Helper to ensure a key's characters are all valid"""
-    if not key:
-        return 0
-
-    for c in key:
-        if not is_valid_key_char(ord(c)):
-            return 0
-    return 1
 
+# Bounds of the ASCII data of s without its leading and trailing spaces, if all its characters are of the given class
+cdef bint _strip_valid(str s, unsigned char char_class, const char** start, Py_ssize_t* size):
+    cdef const char* data
+    cdef Py_ssize_t begin = 0
+    cdef Py_ssize_t end = len(s)
 
-cdef bint _value_is_valid(str value):
-    """Helper to ensure a values's characters are all valid"""
-    if not value:
+    if not PyUnicode_IS_ASCII(s):
+        return 0
+    data = <const char*>PyUnicode_DATA(s)
+    while begin < end and data[begin] == b" ":
+        begin += 1
+    while end > begin and data[end - 1] == b" ":
+        end -= 1
+    if begin == end or _find_invalid(data, begin, end, char_class) >= 0:
         return 0
 
-    for c in value:
-        if not is_valid_value_char(ord(c)):
-            return 0
+    start[0] = data + begin
+    size[0] = end - begin
     return 1
 
 
@@ -210,31 +255,50 @@ cpdef str encode_tagset_values(object values, int max_size=512):
     :raises TagsetMaxSizeEncodeError: Raised when we will exceed the provided max size
     :raises TagsetEncodeError: Raised when we encounter an exception character in a key or value
     """
-    cdef str res = ""
+    cdef char stack_buffer[STACK_BUFFER_SIZE]
+    cdef char* buffer = stack_buffer
+    cdef Py_ssize_t length = 0
+    cdef Py_ssize_t encoded_length
+    cdef const char* key_data
+    cdef const char* value_data
+    cdef Py_ssize_t key_size, value_size
     cdef str key
     cdef str value
-    cdef int i
-
-    for i, (key, value) in enumerate(values.items()):
-        # Strip any leading/trailing spaces
-        key = key.strip(" ")
-        value = value.strip(" ")
-
-        if not _key_is_valid(key):
-            raise TagsetEncodeError("Key is not valid: {!r}".format(key))
-        if not _value_is_valid(value):
-            raise TagsetEncodeError("Value is not valid: {!r}".format(value))
-
-        encoded = "{}={}".format(key, value)
-        # Prefix every item except the first with `,` for separator
-        if i > 0:
-            encoded = "," + encoded
-
-        # Raise an exception that we will exceed the max size
-        # The exception has the value up until now if the caller
-        # wants to use the partially encoded value
-        if len(res) + len(encoded) > max_size:
-            raise TagsetMaxSizeEncodeError(values, max_size, res)
-
-        res += encoded
-    return res
+
+    items = values.items()
+    if max_size > STACK_BUFFER_SIZE:
+        buffer = <char*>PyMem_Malloc(max_size)
+        if buffer == NULL:
+            raise MemoryError()
+
+    try:
+        for key, value in items:
+            # Leading/trailing spaces are stripped
+            if not _strip_valid(key, KEY_CHAR, &key_data, &key_size):
+                raise TagsetEncodeError("Key is not valid: {!r}".format(key.strip(" ")))
+            if not _strip_valid(value, VALUE_CHAR, &value_data, &value_size):
+                raise TagsetEncodeError("Value is not valid: {!r}".format(value.strip(" ")))
+
+            # Prefix every item except the first with `,` for separator
+            encoded_length = key_size + 1 + value_size + (length > 0)
+
+            # Raise an exception that we will exceed the max size
+            # The exception has the value up until now if the caller
+            # wants to use the partially encoded value
+            if length + encoded_length > max_size:
+                raise TagsetMaxSizeEncodeError(values, max_size, PyUnicode_DecodeASCII(buffer, length, NULL))
+
+            if length > 0:
+                buffer[length] = b","
+                length += 1
+            memcpy(buffer + length, key_data, key_size)
+            length += key_size
+            buffer[length] = b"="
+            length += 1
+            memcpy(buffer + length, value_data, value_size)
+            length += value_size
+
+        return PyUnicode_DecodeASCII(buffer, length, NULL)
+    finally:
+        if buffer != stack_buffer:
+            PyMem_Free(buffer)
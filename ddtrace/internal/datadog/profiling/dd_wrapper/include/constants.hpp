@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 // Default value for the max frames; this number will always be overridden by whatever the default
 // is for ddtrace/settings/profiling.py:ProfilingConfig.max_frames, but should conform
 constexpr unsigned int g_default_max_nframes = 64;
@@ -7,3 +10,21 @@ constexpr unsigned int g_default_max_nframes = 64;
 // Maximum number of frames admissible in the Profiling backend.  If a user exceeds this number, then
 // their stacks may be silently truncated, which is unfortunate.
 constexpr unsigned int g_backend_max_nframes = 512;
+
+// Default number of timestamped samples kept per profile period when the timeline is enabled.  Timestamped samples
+// are stored individually by libdatadog rather than aggregated, so past this number, samples are aggregated again.
+constexpr size_t g_default_max_timeline_samples = 16384;
+
+// Once a profile exceeds its memory budget, stacks are truncated to this number of frames.
+constexpr unsigned int g_degraded_max_nframes = 16;
+
+// Estimated cost of the items held by a profile, for its memory accounting.  libdatadog deduplicates stacks and
+// aggregates samples with the same stack and labels, so these are only charged the first time they are seen in a
+// period.
+constexpr size_t g_location_bytes = 64;
+constexpr size_t g_sample_bytes = 64;
+constexpr size_t g_label_bytes = 32;
+constexpr size_t g_string_overhead_bytes = 64;
+
+// Default size, in bytes, of the ring of files profiles are spooled to.  Past this size, the oldest files are removed.
+constexpr uint64_t g_default_spool_max_bytes = 256ULL * 1024 * 1024;
@@ -21,6 +21,18 @@ extern "C"
     void ddup_config_profiler_version(std::string_view profiler_version);
     void ddup_config_url(std::string_view url);
     void ddup_config_max_nframes(int max_nframes);
+    void ddup_config_timeline(bool enabled, unsigned int max_samples);
+    void ddup_config_memory_budget(uint64_t bytes);
+
+    // Writes profiles to a ring of files in `directory`, of at most `max_bytes`, instead of uploading them
+    void ddup_config_spool(std::string_view directory, uint64_t max_bytes);
+
+    // Collects the given sample types into a separate profile, uploaded at most every `upload_period_ms`
+    // (0 uploads it along with the default profile).  Must be called before ddup_init().
+    void ddup_config_profile(std::string_view name,
+                             unsigned int sample_types,
+                             int64_t period,
+                             uint64_t upload_period_ms);
 
     void ddup_config_user_tag(std::string_view key, std::string_view val);
     void ddup_config_sample_type(unsigned int type);
@@ -30,8 +42,24 @@ extern "C"
     void ddup_set_runtime_id(std::string_view runtime_id);
     bool ddup_upload();
 
+    // Waits for spooled profiles to be written; returns false if the timeout expired first
+    bool ddup_flush_spool(uint64_t timeout_ms);
+
+    // Uploads the profiles spooled in `directory`, removing them once sent; returns the number of profiles sent,
+    // or -1 if the uploader could not be created.  Does not require ddup_init().
+    int64_t ddup_replay_spool(std::string_view directory);
+    void ddup_get_profile_stats(uint64_t* periods_over_budget,
+                                uint64_t* dropped_labels,
+                                uint64_t* collapsed_stacks,
+                                uint64_t* evicted_strings);
+
     // Proxy functions to the underlying sample
     Datadog::Sample* ddup_start_sample();
+    Datadog::Sample* ddup_start_sample_for(unsigned int sample_types);
+
+    // Starts a new snapshot of the given sample types, such as the live heap, replacing the samples of the previous
+    // one in their profile if it has not been uploaded yet
+    void ddup_start_snapshot(unsigned int sample_types);
     void ddup_push_walltime(Datadog::Sample* sample, int64_t walltime, int64_t count);
     void ddup_push_cputime(Datadog::Sample* sample, int64_t cputime, int64_t count);
     void ddup_push_acquire(Datadog::Sample* sample, int64_t acquire_time, int64_t count);
@@ -51,11 +79,13 @@ extern "C"
     void ddup_push_trace_resource_container(Datadog::Sample* sample, std::string_view trace_resource_container);
     void ddup_push_exceptioninfo(Datadog::Sample* sample, std::string_view exception_type, int64_t count);
     void ddup_push_class_name(Datadog::Sample* sample, std::string_view class_name);
+    void ddup_push_monotonic_ns(Datadog::Sample* sample, int64_t monotonic_ns);
     void ddup_push_frame(Datadog::Sample* sample,
                          std::string_view _name,
                          std::string_view _filename,
                          uint64_t address,
                          int64_t line);
+    void ddup_clear_frames(Datadog::Sample* sample);
     void ddup_flush_sample(Datadog::Sample* sample);
     void ddup_drop_sample(Datadog::Sample* sample);
 
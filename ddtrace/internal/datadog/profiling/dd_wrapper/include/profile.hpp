@@ -4,6 +4,7 @@
 #include "types.hpp"
 
 #include <atomic>
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -33,16 +34,47 @@ class Profile
     std::atomic<bool> first_time{ true };
     std::mutex profile_mtx{};
 
-    // Storage for strings
+    // Storage for strings.  libdatadog copies strings when samples are added, so they only need to outlive the
+    // samples being built: the storage is renewed every period, and the previous one is kept for one more period
+    // for samples started before the profile was cycled.
     std::deque<std::string> string_storage{};
+    std::deque<std::string> last_string_storage{};
     StringTable strings{};
     std::mutex string_table_mtx{};
 
+    // Memory budget, in bytes, for a profile period; 0 means unlimited
+    std::atomic<size_t> memory_budget{ 0 };
+    std::atomic<size_t> period_bytes{ 0 };
+    std::atomic<bool> over_budget{ false };
+
+    // Hashes of the stacks and samples seen in the current period, for accounting; guarded by profile_mtx
+    std::unordered_set<uint64_t> seen_stacks{};
+    std::unordered_set<uint64_t> seen_samples{};
+
+    // Degradation counters
+    std::atomic<uint64_t> periods_over_budget{ 0 };
+    std::atomic<uint64_t> dropped_labels{ 0 };
+    std::atomic<uint64_t> collapsed_stacks{ 0 };
+    std::atomic<uint64_t> evicted_strings{ 0 };
+
+    void charge(size_t bytes);
+    void account(const ddog_prof_Sample& sample, bool timestamped);
+
     // Configuration
     SampleType type_mask{ 0 };
     unsigned int max_nframes{ g_default_max_nframes };
+    int64_t period{ 1 };
     ddog_prof_Period default_period{};
 
+    // Upload cadence; a zero period means the profile is uploaded every time uploads are requested
+    std::chrono::nanoseconds upload_period{ 0 };
+    std::chrono::steady_clock::time_point last_upload{};
+
+    // Timeline; the count of timestamped samples is per period, and guarded by profile_mtx
+    bool timeline_enabled{ false };
+    size_t max_timeline_samples{ g_default_max_timeline_samples };
+    size_t timeline_samples{ 0 };
+
     // Sampler setup
     void setup_samplers();
 
@@ -60,22 +92,36 @@ class Profile
   public:
     // State management
     void one_time_init(SampleType type, unsigned int _max_nframes);
+    void set_timeline(bool enabled, size_t max_samples);
+    void set_memory_budget(size_t bytes);
+    void set_period(int64_t _period);
+    void set_upload_period(std::chrono::nanoseconds _upload_period);
     bool cycle_buffers();
     void reset();
     void postfork_child();
 
+    // Whether the upload period has elapsed since the last upload; if so, the profile is considered uploaded
+    bool upload_due();
+
     // Getters
+    SampleType get_type_mask() const;
     size_t get_sample_type_length();
     ddog_prof_Profile& profile_borrow();
     void profile_release();
 
-    // String table manipulation
-    std::string_view insert_or_get(std::string_view str);
+    // String table manipulation; over the memory budget, new evictable strings are replaced by a placeholder
+    std::string_view insert_or_get(std::string_view str, bool evictable = false);
+
+    // Memory budget
+    bool is_over_budget() const;
+    void count_dropped_label();
+    void count_collapsed_stack();
+    ProfileStats get_stats() const;
 
     // constref getters
     const ValueIndex& val();
 
-    // collect
-    bool collect(const ddog_prof_Sample& sample);
+    // collect; endtime_ns is the time the sample was taken, in nanoseconds since the UNIX epoch, or 0 if unknown
+    bool collect(const ddog_prof_Sample& sample, int64_t endtime_ns);
 };
 } // namespace Datadog
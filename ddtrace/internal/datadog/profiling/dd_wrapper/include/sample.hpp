@@ -15,12 +15,11 @@ extern "C"
 
 namespace Datadog {
 
-class SampleManager; // friend
-
 class Sample
 {
   private:
-    static inline Profile profile_state{}; // TODO pointer to global state?
+    // The profile this sample is collected into; owned by the SampleManager
+    Profile& profile;
     unsigned int max_nframes;
     SampleType type_mask;
     std::string errmsg;
@@ -30,12 +29,18 @@ class Sample
     size_t dropped_frames = 0;
     uint64_t samples = 0;
 
+    // Whether the stack was shortened because the profile is over its memory budget
+    bool collapsed = false;
+
     // Storage for labels
     std::vector<ddog_prof_Label> labels{};
 
     // Storage for values
     std::vector<int64_t> values = {};
 
+    // Time the sample was taken, in nanoseconds since the UNIX epoch
+    int64_t endtime_ns = 0;
+
   public:
     // Helpers
     bool push_label(ExportLabelKey key, std::string_view val);
@@ -43,6 +48,9 @@ class Sample
     void push_frame_impl(std::string_view name, std::string_view filename, uint64_t address, int64_t line);
     void clear_buffers();
 
+    // Removes the frames pushed so far, e.g. when the stack could not be unwound completely
+    void clear_frames();
+
     // Add values
     bool push_walltime(int64_t walltime, int64_t count);
     bool push_cputime(int64_t cputime, int64_t count);
@@ -63,6 +71,10 @@ class Sample
     bool push_exceptioninfo(std::string_view exception_type, int64_t count);
     bool push_class_name(std::string_view class_name);
 
+    // Sets the time the sample was taken, from a CLOCK_MONOTONIC timestamp.  By default, this is the time the
+    // sample was started.
+    bool push_monotonic_ns(int64_t monotonic_ns);
+
     // Assumes frames are pushed in leaf-order
     void push_frame(std::string_view name,     // for ddog_prof_Function
                     std::string_view filename, // for ddog_prof_Function
@@ -73,14 +85,7 @@ class Sample
     // Flushes the current buffer, clearing it
     bool flush_sample();
 
-    static ddog_prof_Profile& profile_borrow();
-    static void profile_release();
-    static void profile_clear_state();
-    static void postfork_child();
-    Sample(SampleType _type_mask, unsigned int _max_nframes);
-
-    // friend class SampleManager;
-    friend class SampleManager;
+    Sample(Profile& _profile, unsigned int _max_nframes);
 };
 
 } // namespace Datadog
@@ -1,34 +1,79 @@
 #pragma once
 
 #include "constants.hpp"
+#include "profile.hpp"
 #include "sample.hpp"
 #include "types.hpp"
+#include "uploader.hpp"
 
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
 
 #include <vector>
 
 namespace Datadog {
 
+// A named profile, collecting some of the sample types and uploaded on its own cadence
+struct ProfileConfig
+{
+    std::string name;
+    unsigned int type_mask;
+    int64_t period;
+    std::chrono::nanoseconds upload_period;
+};
+
 class SampleManager
 {
   private:
     static inline unsigned int max_nframes{ g_default_max_nframes };
     static inline SampleType type_mask{ SampleType::All };
     static inline std::mutex init_mutex{};
+    static inline bool timeline_enabled{ false };
+    static inline size_t max_timeline_samples{ g_default_max_timeline_samples };
+    static inline size_t memory_budget{ 0 };
+    static inline std::vector<ProfileConfig> profile_configs{};
+
+    // Created by init() and never modified afterwards, so that samples can hold references to them.  Sample types
+    // which aren't claimed by a configured profile go to the default profile, if any.
+    static inline std::vector<std::unique_ptr<Profile>> profiles{};
+    static inline Profile* default_profile{ nullptr };
+
+    static Profile& make_profile(SampleType types, int64_t period, std::chrono::nanoseconds upload_period);
+    static Profile* find_profile(unsigned int types);
 
   public:
     // Configuration
     static void add_type(unsigned int type);
+    static void add_profile(std::string_view name,
+                            unsigned int types,
+                            int64_t period,
+                            std::chrono::nanoseconds upload_period);
     static void set_max_nframes(unsigned int _max_nframes);
+    static void set_timeline(bool enabled, size_t max_samples);
+    static void set_memory_budget(size_t bytes);
 
-    // Sampling entrypoint (this could also be called `build_ptr()`)
-    static Sample* start_sample();
+    // Sampling entrypoint (this could also be called `build_ptr()`).  The sample is collected into the profile
+    // holding the given sample types, or into the default profile if none are given; returns nullptr if there is
+    // no such profile.
+    static Sample* start_sample(unsigned int types = 0);
     static void drop_sample(Sample* sample);
 
+    // Drops the samples collected so far into the profile holding the given sample types, if it holds no others, so
+    // that a new snapshot replaces the previous one rather than adding to it until the profile is uploaded
+    static void start_snapshot(unsigned int types);
+
+    // Uploads the profiles which are due, and starts a new period for them
+    static bool upload(Uploader& uploader);
+
+    // Degradations applied because of the memory budget, over all profiles
+    static ProfileStats get_stats();
+
     // Handles state management after forks
     static void postfork_child();
 
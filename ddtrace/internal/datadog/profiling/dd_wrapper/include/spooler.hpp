@@ -0,0 +1,78 @@
+#pragma once
+
+#include "constants.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C"
+{
+#include "datadog/profiling.h"
+}
+
+namespace Datadog {
+
+class Uploader;
+
+// A serialized profile waiting to be written to the spool
+struct SpoolEntry
+{
+    std::vector<uint8_t> data;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+// Writes serialized profiles to a size-capped ring of files in a directory, rather than uploading them, for
+// deployments where the agent cannot be reached.  Files are written by a background thread, so that spooling does
+// not block the caller on disk I/O, and can be uploaded later with `replay()`.
+//
+// Each profile is written to its own file, named after the time range it covers so that the files sort
+// chronologically; when the files exceed the size of the ring, the oldest ones are removed.
+class Spooler
+{
+  private:
+    static inline std::string directory{};
+    static inline uint64_t max_bytes{ g_default_spool_max_bytes };
+
+    // Profiles not written yet, guarded by queue_mtx.  The writer thread is detached and still waits on the
+    // condition variable when static objects are destroyed at exit, so these two are never destroyed.
+    static inline std::mutex& queue_mtx = *new std::mutex();                           // NOLINT
+    static inline std::condition_variable& queue_cv = *new std::condition_variable(); // NOLINT
+    static inline std::deque<SpoolEntry> queue{};
+    static inline uint64_t queued_bytes{ 0 };
+    static inline bool writing{ false };
+    static inline bool writer_started{ false };
+    static inline uint64_t seq{ 0 };
+
+    static void run();
+    static bool write_entry(const SpoolEntry& entry, uint64_t entry_seq);
+    static void trim();
+
+  public:
+    // Configuration
+    static void set_directory(std::string_view _directory);
+    static void set_max_bytes(uint64_t _max_bytes);
+    static bool is_enabled();
+
+    // Queues a serialized profile to be written by the background thread
+    static void enqueue(ddog_ByteSlice data, ddog_Timespec start, ddog_Timespec end);
+
+    // Waits until the queued profiles are written, or the timeout expires; returns whether the queue was drained
+    static bool flush(std::chrono::milliseconds timeout);
+
+    // Uploads the profiles spooled in `_directory`, oldest first, removing each one once it is sent.  Stops at the
+    // first failure, leaving the remaining files for a later attempt.  Returns the number of profiles sent.
+    static int64_t replay(std::string_view _directory, Uploader& uploader);
+
+    static void prefork();
+    static void postfork_parent();
+    static void postfork_child();
+};
+
+} // namespace Datadog
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Datadog {
 enum SampleType : unsigned int
 {
@@ -32,4 +34,14 @@ struct ValueIndex
     unsigned short heap_space;
 };
 
+// Counters for the degradations applied to samples once a profile exceeds its memory budget.  They are cumulative
+// over the lifetime of the process.
+struct ProfileStats
+{
+    uint64_t periods_over_budget;
+    uint64_t dropped_labels;
+    uint64_t collapsed_stacks;
+    uint64_t evicted_strings;
+};
+
 } // namespace Datadog
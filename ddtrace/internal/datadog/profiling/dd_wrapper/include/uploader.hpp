@@ -34,7 +34,11 @@ class Uploader
     std::unique_ptr<ddog_prof_Exporter, DdogProfExporterDeleter> ddog_exporter;
 
   public:
+    // Serializes the profile, and sends it or writes it to the spool
     bool upload(ddog_prof_Profile& profile);
+
+    // Sends an already serialized profile
+    bool send(ddog_ByteSlice data, ddog_Timespec start, ddog_Timespec end);
     static void cancel_inflight();
     static void lock();
     static void unlock();
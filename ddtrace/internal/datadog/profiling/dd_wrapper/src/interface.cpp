@@ -3,6 +3,7 @@
 #include "profile.hpp"
 #include "sample.hpp"
 #include "sample_manager.hpp"
+#include "spooler.hpp"
 #include "uploader.hpp"
 #include "uploader_builder.hpp"
 
@@ -20,6 +21,7 @@ void
 ddup_postfork_child()
 {
     Datadog::Uploader::postfork_child();
+    Datadog::Spooler::postfork_child();
     Datadog::SampleManager::postfork_child();
 }
 
@@ -27,6 +29,7 @@ void
 ddup_postfork_parent()
 {
     Datadog::Uploader::postfork_parent();
+    Datadog::Spooler::postfork_parent();
 }
 
 // Since we don't control the internal state of libdatadog's exporter and we want to prevent state-tearing
@@ -37,6 +40,7 @@ void
 ddup_prefork()
 {
     Datadog::Uploader::prefork();
+    Datadog::Spooler::prefork();
 }
 
 // Configuration
@@ -105,6 +109,34 @@ ddup_config_max_nframes(int max_nframes) // cppcheck-suppress unusedFunction
     Datadog::SampleManager::set_max_nframes(max_nframes);
 }
 
+void
+ddup_config_timeline(bool enabled, unsigned int max_samples) // cppcheck-suppress unusedFunction
+{
+    Datadog::SampleManager::set_timeline(enabled, max_samples);
+}
+
+void
+ddup_config_profile(std::string_view name, // cppcheck-suppress unusedFunction
+                    unsigned int sample_types,
+                    int64_t period,
+                    uint64_t upload_period_ms)
+{
+    Datadog::SampleManager::add_profile(name, sample_types, period, std::chrono::milliseconds(upload_period_ms));
+}
+
+void
+ddup_config_spool(std::string_view directory, uint64_t max_bytes) // cppcheck-suppress unusedFunction
+{
+    Datadog::Spooler::set_directory(directory);
+    Datadog::Spooler::set_max_bytes(max_bytes);
+}
+
+void
+ddup_config_memory_budget(uint64_t bytes) // cppcheck-suppress unusedFunction
+{
+    Datadog::SampleManager::set_memory_budget(bytes);
+}
+
 bool
 ddup_is_initialized() // cppcheck-suppress unusedFunction
 {
@@ -134,6 +166,18 @@ ddup_start_sample() // cppcheck-suppress unusedFunction
     return Datadog::SampleManager::start_sample();
 }
 
+Datadog::Sample*
+ddup_start_sample_for(unsigned int sample_types) // cppcheck-suppress unusedFunction
+{
+    return Datadog::SampleManager::start_sample(sample_types);
+}
+
+void
+ddup_start_snapshot(unsigned int sample_types) // cppcheck-suppress unusedFunction
+{
+    Datadog::SampleManager::start_snapshot(sample_types);
+}
+
 void
 ddup_push_walltime(Datadog::Sample* sample, int64_t walltime, int64_t count) // cppcheck-suppress unusedFunction
 {
@@ -237,6 +281,12 @@ ddup_push_class_name(Datadog::Sample* sample, std::string_view class_name) // cp
     sample->push_class_name(class_name);
 }
 
+void
+ddup_push_monotonic_ns(Datadog::Sample* sample, int64_t monotonic_ns) // cppcheck-suppress unusedFunction
+{
+    sample->push_monotonic_ns(monotonic_ns);
+}
+
 void
 ddup_push_frame(Datadog::Sample* sample, // cppcheck-suppress unusedFunction
                 std::string_view _name,
@@ -247,6 +297,12 @@ ddup_push_frame(Datadog::Sample* sample, // cppcheck-suppress unusedFunction
     sample->push_frame(_name, _filename, address, line);
 }
 
+void
+ddup_clear_frames(Datadog::Sample* sample) // cppcheck-suppress unusedFunction
+{
+    sample->clear_frames();
+}
+
 void
 ddup_flush_sample(Datadog::Sample* sample) // cppcheck-suppress unusedFunction
 {
@@ -274,18 +330,50 @@ ddup_upload() // cppcheck-suppress unusedFunction
         //     be modified.  It gets released and cleared after uploading.
         //   * Uploading cancels inflight uploads. There are better ways to do this, but this is what
         //     we have for now.
+        //   * Only the profiles whose upload period has elapsed are uploaded.
         auto uploader = Datadog::UploaderBuilder::build();
         struct
         {
-            void operator()(Datadog::Uploader& uploader)
-            {
-                uploader.upload(Datadog::Sample::profile_borrow());
-                Datadog::Sample::profile_release();
-                Datadog::Sample::profile_clear_state();
-            }
+            bool& success;
+            void operator()(Datadog::Uploader& uploader) { success = Datadog::SampleManager::upload(uploader); }
             void operator()(const std::string& err) { std::cerr << "Failed to create uploader: " << err << std::endl; }
-        } visitor;
+        } visitor{ success };
         std::visit(visitor, uploader);
     }
     return success;
 }
+
+void
+ddup_get_profile_stats(uint64_t* periods_over_budget, // cppcheck-suppress unusedFunction
+                       uint64_t* dropped_labels,
+                       uint64_t* collapsed_stacks,
+                       uint64_t* evicted_strings)
+{
+    const Datadog::ProfileStats stats = Datadog::SampleManager::get_stats();
+    *periods_over_budget = stats.periods_over_budget;
+    *dropped_labels = stats.dropped_labels;
+    *collapsed_stacks = stats.collapsed_stacks;
+    *evicted_strings = stats.evicted_strings;
+}
+
+bool
+ddup_flush_spool(uint64_t timeout_ms) // cppcheck-suppress unusedFunction
+{
+    return Datadog::Spooler::flush(std::chrono::milliseconds(timeout_ms));
+}
+
+int64_t
+ddup_replay_spool(std::string_view directory) // cppcheck-suppress unusedFunction
+{
+    int64_t sent = -1;
+    auto uploader = Datadog::UploaderBuilder::build();
+    struct
+    {
+        std::string_view directory;
+        int64_t& sent;
+        void operator()(Datadog::Uploader& uploader) { sent = Datadog::Spooler::replay(directory, uploader); }
+        void operator()(const std::string& err) { std::cerr << "Failed to create uploader: " << err << std::endl; }
+    } visitor{ directory, sent };
+    std::visit(visitor, uploader);
+    return sent;
+}
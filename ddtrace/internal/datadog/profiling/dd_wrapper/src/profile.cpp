@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <iostream>
+#include <new>
 
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -30,6 +31,39 @@ make_profile(const ddog_prof_Slice_ValueType& sample_types,
     return true;
 }
 
+// Replaces the evictable strings which cannot be stored once the memory budget is exceeded
+constexpr std::string_view evicted_string = "<evicted>";
+
+inline uint64_t
+hash_combine(uint64_t seed, uint64_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Strings in samples are interned, so within a period, stacks and labels can be identified by the address of their
+// strings rather than by their contents.
+uint64_t
+hash_sample(const ddog_prof_Sample& sample, uint64_t& stack_hash)
+{
+    uint64_t hash = sample.locations.len;
+    for (size_t i = 0; i < sample.locations.len; ++i) {
+        const ddog_prof_Location& loc = sample.locations.ptr[i]; // NOLINT (cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        hash = hash_combine(hash, reinterpret_cast<uintptr_t>(loc.function.name.ptr)); // NOLINT
+        hash = hash_combine(hash, reinterpret_cast<uintptr_t>(loc.function.filename.ptr)); // NOLINT
+        hash = hash_combine(hash, static_cast<uint64_t>(loc.line));
+        hash = hash_combine(hash, loc.address);
+    }
+    stack_hash = hash;
+
+    for (size_t i = 0; i < sample.labels.len; ++i) {
+        const ddog_prof_Label& label = sample.labels.ptr[i]; // NOLINT (cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        hash = hash_combine(hash, reinterpret_cast<uintptr_t>(label.key.ptr)); // NOLINT
+        hash = hash_combine(hash, reinterpret_cast<uintptr_t>(label.str.ptr)); // NOLINT
+        hash = hash_combine(hash, static_cast<uint64_t>(label.num));
+    }
+    return hash;
+}
+
 }
 
 bool
@@ -38,6 +72,19 @@ Datadog::Profile::cycle_buffers()
     const std::lock_guard<std::mutex> lock(profile_mtx);
 
     std::swap(last_profile, cur_profile);
+    timeline_samples = 0;
+
+    // Start accounting for the new period
+    seen_stacks.clear();
+    seen_samples.clear();
+    period_bytes.store(0);
+    over_budget.store(false);
+    {
+        const std::lock_guard<std::mutex> strings_lock(string_table_mtx);
+        strings.clear();
+        std::swap(last_string_storage, string_storage);
+        string_storage.clear();
+    }
 
     // Clear the profile before using it
     auto res = ddog_prof_Profile_reset(&cur_profile, nullptr);
@@ -91,12 +138,18 @@ Datadog::Profile::setup_samplers()
     }
 
     // Whatever the first sampler happens to be is the default "period" for the profile
-    // The value of 1 is a pointless default.
+    // The value of 1 is a pointless default, unless a period was configured.
     if (!samplers.empty()) {
-        default_period = { .type_ = samplers[0], .value = 1 };
+        default_period = { .type_ = samplers[0], .value = period };
     }
 }
 
+Datadog::SampleType
+Datadog::Profile::get_type_mask() const
+{
+    return type_mask;
+}
+
 size_t
 Datadog::Profile::get_sample_type_length()
 {
@@ -133,6 +186,7 @@ Datadog::Profile::one_time_init(SampleType type, unsigned int _max_nframes)
 
     // nframes
     max_nframes = _max_nframes;
+    last_upload = std::chrono::steady_clock::now();
 
     // Set the type mask
     const unsigned int mask_as_int = type & SampleType::All;
@@ -163,7 +217,7 @@ Datadog::Profile::one_time_init(SampleType type, unsigned int _max_nframes)
 }
 
 std::string_view
-Datadog::Profile::insert_or_get(std::string_view str)
+Datadog::Profile::insert_or_get(std::string_view str, bool evictable)
 {
     const std::lock_guard<std::mutex> lock(string_table_mtx); // Serialize access
 
@@ -172,8 +226,18 @@ Datadog::Profile::insert_or_get(std::string_view str)
         return *str_it;
     }
 
+    // Past the budget, new evictable strings are not stored anymore.  The names and filenames of frames are always
+    // stored, so that the frames stay meaningful; deep stacks are collapsed instead.
+    if (evictable && over_budget.load(std::memory_order_relaxed)) {
+        ++evicted_strings;
+        return evicted_string;
+    }
+
     string_storage.emplace_back(str);
     strings.insert(string_storage.back());
+    if (memory_budget.load() > 0) {
+        charge(str.size() + g_string_overhead_bytes);
+    }
     return string_storage.back();
 }
 
@@ -183,12 +247,124 @@ Datadog::Profile::val()
     return val_idx;
 }
 
+void
+Datadog::Profile::set_timeline(bool enabled, size_t max_samples)
+{
+    const std::lock_guard<std::mutex> lock(profile_mtx);
+    timeline_enabled = enabled;
+    max_timeline_samples = max_samples > 0 ? max_samples : g_default_max_timeline_samples;
+}
+
+void
+Datadog::Profile::set_period(int64_t _period)
+{
+    if (_period > 0) {
+        period = _period;
+    }
+}
+
+void
+Datadog::Profile::set_upload_period(std::chrono::nanoseconds _upload_period)
+{
+    upload_period = _upload_period;
+}
+
+bool
+Datadog::Profile::upload_due()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (upload_period.count() > 0) {
+        // Uploads are requested on the caller's own schedule, which does not line up exactly with this period:
+        // consider the profile due slightly early rather than a whole round late.
+        if (now - last_upload + upload_period / 10 < upload_period) {
+            return false;
+        }
+    }
+    last_upload = now;
+    return true;
+}
+
+void
+Datadog::Profile::set_memory_budget(size_t bytes)
+{
+    memory_budget.store(bytes);
+}
+
+void
+Datadog::Profile::charge(size_t bytes)
+{
+    const size_t total = period_bytes.fetch_add(bytes) + bytes;
+    if (total > memory_budget.load() && !over_budget.exchange(true)) {
+        ++periods_over_budget;
+    }
+}
+
+void
+Datadog::Profile::account(const ddog_prof_Sample& sample, bool timestamped)
+{
+    uint64_t stack_hash = 0;
+    const uint64_t sample_hash = hash_sample(sample, stack_hash);
+
+    size_t bytes = 0;
+    if (seen_stacks.insert(stack_hash).second) {
+        bytes += sample.locations.len * g_location_bytes + sizeof(uint64_t);
+    }
+    // Timestamped samples are never aggregated
+    if (seen_samples.insert(sample_hash).second || timestamped) {
+        bytes += g_sample_bytes + sample.labels.len * g_label_bytes + sample.values.len * sizeof(int64_t);
+    }
+    if (bytes > 0) {
+        charge(bytes);
+    }
+}
+
+bool
+Datadog::Profile::is_over_budget() const
+{
+    return over_budget.load(std::memory_order_relaxed);
+}
+
+void
+Datadog::Profile::count_dropped_label()
+{
+    ++dropped_labels;
+}
+
+void
+Datadog::Profile::count_collapsed_stack()
+{
+    ++collapsed_stacks;
+}
+
+Datadog::ProfileStats
+Datadog::Profile::get_stats() const
+{
+    return {
+        .periods_over_budget = periods_over_budget.load(),
+        .dropped_labels = dropped_labels.load(),
+        .collapsed_stacks = collapsed_stacks.load(),
+        .evicted_strings = evicted_strings.load(),
+    };
+}
+
 bool
-Datadog::Profile::collect(const ddog_prof_Sample& sample)
+Datadog::Profile::collect(const ddog_prof_Sample& sample, int64_t endtime_ns)
 {
-    // TODO this should propagate some kind of timestamp for timeline support
     const std::lock_guard<std::mutex> lock(profile_mtx);
-    auto res = ddog_prof_Profile_add(&cur_profile, sample, 0);
+
+    // libdatadog keeps timestamped samples individually instead of aggregating them, so only give a timestamp to
+    // as many samples per period as the budget allows; the rest are aggregated as usual.
+    int64_t timestamp = 0;
+    if (timeline_enabled && endtime_ns > 0 && timeline_samples < max_timeline_samples) {
+        timestamp = endtime_ns;
+        ++timeline_samples;
+    }
+
+    if (memory_budget.load() > 0) {
+        account(sample, timestamp != 0);
+    }
+
+    auto res = ddog_prof_Profile_add(&cur_profile, sample, timestamp);
     if (!res.ok) {          // NOLINT (cppcoreguidelines-pro-type-union-access)
         auto err = res.err; // NOLINT (cppcoreguidelines-pro-type-union-access)
         const std::string errmsg = err_to_msg(&err, "Error adding sample to profile");
@@ -202,6 +378,9 @@ Datadog::Profile::collect(const ddog_prof_Sample& sample)
 void
 Datadog::Profile::postfork_child()
 {
+    // Another thread may have been holding the string table lock when the process forked; that thread does not
+    // exist in the child, so the lock is recreated rather than unlocked.
+    new (&string_table_mtx) std::mutex(); // NOLINT (cppcoreguidelines-owning-memory)
     profile_mtx.unlock();
     cycle_buffers();
 }
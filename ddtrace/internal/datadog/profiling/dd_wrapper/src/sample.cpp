@@ -1,31 +1,76 @@
 #include "sample.hpp"
 
+#include <chrono>
 #include <thread>
 
-Datadog::Sample::Sample(SampleType _type_mask, unsigned int _max_nframes)
-  : max_nframes{ _max_nframes }
-  , type_mask{ _type_mask }
+#include <time.h>
+
+namespace {
+
+inline int64_t
+get_monotonic_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000LL + ts.tv_nsec;
+}
+
+// Samples are stamped from the monotonic clock so that their order is not affected by adjustments of the system
+// clock, but libdatadog expects timestamps relative to the UNIX epoch.  The offset between both clocks is taken
+// once, the first time it is needed.
+int64_t
+monotonic_to_epoch_ns(int64_t monotonic_ns)
+{
+    static const int64_t offset = []() {
+        const int64_t epoch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+        return epoch_ns - get_monotonic_ns();
+    }();
+    return monotonic_ns + offset;
+}
+
+// Labels which multiply the number of distinct samples without being needed to attribute them; these are the first
+// to go once the profile is over its memory budget.
+inline bool
+is_droppable(Datadog::ExportLabelKey key)
+{
+    switch (key) {
+        case Datadog::ExportLabelKey::task_id:
+        case Datadog::ExportLabelKey::task_name:
+        case Datadog::ExportLabelKey::span_id:
+        case Datadog::ExportLabelKey::local_root_span_id:
+        case Datadog::ExportLabelKey::lock_name:
+        case Datadog::ExportLabelKey::class_name:
+        case Datadog::ExportLabelKey::trace_resource_container:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+Datadog::Sample::Sample(Profile& _profile, unsigned int _max_nframes)
+  : profile{ _profile }
+  , max_nframes{ _max_nframes }
+  , type_mask{ _profile.get_type_mask() }
+  , endtime_ns{ monotonic_to_epoch_ns(get_monotonic_ns()) }
 {
     // Initialize values
-    values.resize(profile_state.get_sample_type_length());
+    values.resize(profile.get_sample_type_length());
     std::fill(values.begin(), values.end(), 0);
 
     // Initialize other state
     locations.reserve(max_nframes + 1); // +1 for a "truncated frames" virtual frame
 }
 
-void
-Datadog::Sample::profile_clear_state()
-{
-    profile_state.cycle_buffers();
-}
-
 void
 Datadog::Sample::push_frame_impl(std::string_view name, std::string_view filename, uint64_t address, int64_t line)
 {
     static const ddog_prof_Mapping null_mapping = { 0, 0, 0, to_slice(""), to_slice("") };
-    name = profile_state.insert_or_get(name);
-    filename = profile_state.insert_or_get(filename);
+    name = profile.insert_or_get(name);
+    filename = profile.insert_or_get(filename);
 
     const ddog_prof_Location loc = {
         .mapping = null_mapping, // No support for mappings in Python
@@ -45,10 +90,16 @@ Datadog::Sample::push_frame_impl(std::string_view name, std::string_view filenam
 void
 Datadog::Sample::push_frame(std::string_view name, std::string_view filename, uint64_t address, int64_t line)
 {
+    // Over the memory budget, deep stacks are collapsed to keep the number of distinct locations down
+    unsigned int limit = max_nframes;
+    if (profile.is_over_budget() && limit > g_degraded_max_nframes) {
+        limit = g_degraded_max_nframes;
+    }
 
-    if (locations.size() <= max_nframes) {
+    if (locations.size() <= limit) {
         push_frame_impl(name, filename, address, line);
     } else {
+        collapsed = collapsed || limit < max_nframes;
         ++dropped_frames;
     }
 }
@@ -66,8 +117,9 @@ Datadog::Sample::push_label(const ExportLabelKey key, std::string_view val)
         return true;
     }
 
-    // Otherwise, persist the val string and add the label
-    val = profile_state.insert_or_get(val);
+    // Otherwise, persist the val string and add the label.  Over the memory budget, the new values of droppable
+    // labels are replaced by a placeholder, while the values which are already stored are kept.
+    val = profile.insert_or_get(val, is_droppable(key));
     auto& label = labels.emplace_back();
     label.key = to_slice(key_sv);
     label.str = to_slice(val);
@@ -84,6 +136,10 @@ Datadog::Sample::push_label(const ExportLabelKey key, int64_t val)
     if (key_sv.empty()) {
         return true;
     }
+    if (is_droppable(key) && profile.is_over_budget()) {
+        profile.count_dropped_label();
+        return true;
+    }
 
     auto& label = labels.emplace_back();
     label.key = to_slice(key_sv);
@@ -93,13 +149,20 @@ Datadog::Sample::push_label(const ExportLabelKey key, int64_t val)
     return true;
 }
 
+void
+Datadog::Sample::clear_frames()
+{
+    locations.clear();
+    dropped_frames = 0;
+    collapsed = false;
+}
+
 void
 Datadog::Sample::clear_buffers()
 {
     std::fill(values.begin(), values.end(), 0);
     labels.clear();
-    locations.clear();
-    dropped_frames = 0;
+    clear_frames();
 }
 
 bool
@@ -110,6 +173,9 @@ Datadog::Sample::flush_sample()
           "<" + std::to_string(dropped_frames) + " frame" + (1 == dropped_frames ? "" : "s") + " omitted>";
         Sample::push_frame_impl(name, "", 0, 0);
     }
+    if (collapsed) {
+        profile.count_collapsed_stack();
+    }
 
     const ddog_prof_Sample sample = {
         .locations = { locations.data(), locations.size() },
@@ -117,7 +183,7 @@ Datadog::Sample::flush_sample()
         .labels = { labels.data(), labels.size() },
     };
 
-    const bool ret = profile_state.collect(sample);
+    const bool ret = profile.collect(sample, endtime_ns);
     clear_buffers();
     return ret;
 }
@@ -128,8 +194,8 @@ Datadog::Sample::push_cputime(int64_t cputime, int64_t count)
     // NB all push-type operations return bool for semantic uniformity,
     // even if they can't error.  This should promote generic code.
     if (0U != (type_mask & SampleType::CPU)) {
-        values[profile_state.val().cpu_time] += cputime * count;
-        values[profile_state.val().cpu_count] += count;
+        values[profile.val().cpu_time] += cputime * count;
+        values[profile.val().cpu_count] += count;
         return true;
     }
     std::cout << "bad push cpu" << std::endl;
@@ -140,8 +206,8 @@ bool
 Datadog::Sample::push_walltime(int64_t walltime, int64_t count)
 {
     if (0U != (type_mask & SampleType::Wall)) {
-        values[profile_state.val().wall_time] += walltime * count;
-        values[profile_state.val().wall_count] += count;
+        values[profile.val().wall_time] += walltime * count;
+        values[profile.val().wall_count] += count;
         return true;
     }
     std::cout << "bad push wall" << std::endl;
@@ -153,7 +219,7 @@ Datadog::Sample::push_exceptioninfo(std::string_view exception_type, int64_t cou
 {
     if (0U != (type_mask & SampleType::Exception)) {
         push_label(ExportLabelKey::exception_type, exception_type);
-        values[profile_state.val().exception_count] += count;
+        values[profile.val().exception_count] += count;
         return true;
     }
     std::cout << "bad push except" << std::endl;
@@ -164,8 +230,8 @@ bool
 Datadog::Sample::push_acquire(int64_t acquire_time, int64_t count) // NOLINT (bugprone-easily-swappable-parameters)
 {
     if (0U != (type_mask & SampleType::LockAcquire)) {
-        values[profile_state.val().lock_acquire_time] += acquire_time;
-        values[profile_state.val().lock_acquire_count] += count;
+        values[profile.val().lock_acquire_time] += acquire_time;
+        values[profile.val().lock_acquire_count] += count;
         return true;
     }
     std::cout << "bad push acquire" << std::endl;
@@ -176,8 +242,8 @@ bool
 Datadog::Sample::push_release(int64_t lock_time, int64_t count) // NOLINT (bugprone-easily-swappable-parameters)
 {
     if (0U != (type_mask & SampleType::LockRelease)) {
-        values[profile_state.val().lock_release_time] += lock_time;
-        values[profile_state.val().lock_release_count] += count;
+        values[profile.val().lock_release_time] += lock_time;
+        values[profile.val().lock_release_count] += count;
         return true;
     }
     std::cout << "bad push release" << std::endl;
@@ -193,8 +259,8 @@ Datadog::Sample::push_alloc(int64_t size, int64_t count) // NOLINT (bugprone-eas
     }
 
     if (0U != (type_mask & SampleType::Allocation)) {
-        values[profile_state.val().alloc_space] += size;
-        values[profile_state.val().alloc_count] += count;
+        values[profile.val().alloc_space] += size;
+        values[profile.val().alloc_count] += count;
         return true;
     }
     std::cout << "bad push alloc" << std::endl;
@@ -210,7 +276,7 @@ Datadog::Sample::push_heap(int64_t size)
     }
 
     if (0U != (type_mask & SampleType::Heap)) {
-        values[profile_state.val().heap_space] += size;
+        values[profile.val().heap_space] += size;
         return true;
     }
     std::cout << "bad push heap" << std::endl;
@@ -316,20 +382,13 @@ Datadog::Sample::push_class_name(std::string_view class_name)
     return true;
 }
 
-ddog_prof_Profile&
-Datadog::Sample::profile_borrow()
-{
-    return profile_state.profile_borrow();
-}
-
-void
-Datadog::Sample::profile_release()
-{
-    profile_state.profile_release();
-}
-
-void
-Datadog::Sample::postfork_child()
+bool
+Datadog::Sample::push_monotonic_ns(int64_t monotonic_ns)
 {
-    profile_state.postfork_child();
+    if (monotonic_ns <= 0) {
+        std::cout << "bad push monotonic_ns" << std::endl;
+        return false;
+    }
+    endtime_ns = monotonic_to_epoch_ns(monotonic_ns);
+    return true;
 }
@@ -1,12 +1,23 @@
 #include "sample_manager.hpp"
 #include "types.hpp"
 
+#include <iostream>
+
 void
 Datadog::SampleManager::add_type(unsigned int type)
 {
     type_mask = static_cast<SampleType>((type_mask | type) & SampleType::All);
 }
 
+void
+Datadog::SampleManager::add_profile(std::string_view name,
+                                    unsigned int types,
+                                    int64_t period,
+                                    std::chrono::nanoseconds upload_period)
+{
+    profile_configs.push_back({ std::string{ name }, types & SampleType::All, period, upload_period });
+}
+
 void
 Datadog::SampleManager::set_max_nframes(unsigned int _max_nframes)
 {
@@ -21,10 +32,45 @@ Datadog::SampleManager::set_max_nframes(unsigned int _max_nframes)
     }
 }
 
+void
+Datadog::SampleManager::set_timeline(bool enabled, size_t max_samples)
+{
+    timeline_enabled = enabled;
+    if (max_samples > 0) {
+        max_timeline_samples = max_samples;
+    }
+}
+
+void
+Datadog::SampleManager::set_memory_budget(size_t bytes)
+{
+    memory_budget = bytes;
+}
+
+Datadog::Profile*
+Datadog::SampleManager::find_profile(unsigned int types)
+{
+    if (types != 0) {
+        for (auto& profile : profiles) {
+            if (0U != (profile->get_type_mask() & types)) {
+                return profile.get();
+            }
+        }
+    }
+    if (default_profile == nullptr && !profiles.empty()) {
+        return profiles.front().get();
+    }
+    return default_profile;
+}
+
 Datadog::Sample*
-Datadog::SampleManager::start_sample()
+Datadog::SampleManager::start_sample(unsigned int types)
 {
-    return new Datadog::Sample(type_mask, max_nframes); // NOLINT(cppcoreguidelines-owning-memory)
+    Profile* profile = find_profile(types);
+    if (profile == nullptr) {
+        return nullptr;
+    }
+    return new Datadog::Sample(*profile, max_nframes); // NOLINT(cppcoreguidelines-owning-memory)
 }
 
 void
@@ -33,14 +79,85 @@ Datadog::SampleManager::drop_sample(Datadog::Sample* sample)
     delete sample; // NOLINT(cppcoreguidelines-owning-memory)
 }
 
+void
+Datadog::SampleManager::start_snapshot(unsigned int types)
+{
+    Profile* profile = find_profile(types);
+    if (profile != nullptr && 0U == (profile->get_type_mask() & ~types)) {
+        profile->cycle_buffers();
+    }
+}
+
+bool
+Datadog::SampleManager::upload(Uploader& uploader)
+{
+    bool success = true;
+    for (auto& profile : profiles) {
+        if (!profile->upload_due()) {
+            continue;
+        }
+        success = uploader.upload(profile->profile_borrow()) && success;
+        profile->profile_release();
+        profile->cycle_buffers();
+    }
+    return success;
+}
+
+Datadog::ProfileStats
+Datadog::SampleManager::get_stats()
+{
+    ProfileStats stats{};
+    for (const auto& profile : profiles) {
+        const ProfileStats profile_stats = profile->get_stats();
+        stats.periods_over_budget += profile_stats.periods_over_budget;
+        stats.dropped_labels += profile_stats.dropped_labels;
+        stats.collapsed_stacks += profile_stats.collapsed_stacks;
+        stats.evicted_strings += profile_stats.evicted_strings;
+    }
+    return stats;
+}
+
 void
 Datadog::SampleManager::postfork_child()
 {
-    Datadog::Sample::postfork_child();
+    for (auto& profile : profiles) {
+        profile->postfork_child();
+    }
+}
+
+Datadog::Profile&
+Datadog::SampleManager::make_profile(SampleType types, int64_t period, std::chrono::nanoseconds upload_period)
+{
+    auto& profile = profiles.emplace_back(std::make_unique<Profile>());
+    profile->set_period(period);
+    profile->set_upload_period(upload_period);
+    profile->one_time_init(types, max_nframes);
+    profile->set_timeline(timeline_enabled, max_timeline_samples);
+    profile->set_memory_budget(memory_budget);
+    return *profile;
 }
 
 void
 Datadog::SampleManager::init()
 {
-    Datadog::Sample::profile_state.one_time_init(type_mask, max_nframes);
+    const std::lock_guard<std::mutex> lock(init_mutex);
+    if (!profiles.empty()) {
+        return;
+    }
+
+    // Each sample type is collected by a single profile: the first one configured with it
+    unsigned int remaining = type_mask;
+    for (const auto& config : profile_configs) {
+        const unsigned int types = config.type_mask & remaining;
+        if (types == 0) {
+            std::cerr << "Profile " << config.name << " has no sample types of its own, skipping" << std::endl;
+            continue;
+        }
+        remaining &= ~types;
+        make_profile(static_cast<SampleType>(types), config.period, config.upload_period);
+    }
+
+    if (remaining != 0) {
+        default_profile = &make_profile(static_cast<SampleType>(remaining), 1, std::chrono::nanoseconds{ 0 });
+    }
 }
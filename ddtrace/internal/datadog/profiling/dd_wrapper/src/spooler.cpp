@@ -0,0 +1,316 @@
+#include "spooler.hpp"
+#include "uploader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::string_view spool_prefix = "profile_";
+constexpr std::string_view spool_suffix = ".pprof";
+
+struct SpoolFile
+{
+    std::string name;
+    uint64_t size;
+};
+
+inline int64_t
+to_ns(ddog_Timespec ts)
+{
+    return ts.seconds * 1'000'000'000LL + ts.nanoseconds;
+}
+
+inline ddog_Timespec
+from_ns(int64_t ns)
+{
+    return { .seconds = ns / 1'000'000'000LL, .nanoseconds = static_cast<uint32_t>(ns % 1'000'000'000LL) };
+}
+
+inline bool
+is_spool_file(std::string_view name)
+{
+    return name.size() > spool_prefix.size() + spool_suffix.size() &&
+           name.substr(0, spool_prefix.size()) == spool_prefix &&
+           name.substr(name.size() - spool_suffix.size()) == spool_suffix;
+}
+
+// Spooled files, oldest first
+std::vector<SpoolFile>
+list_spool_files(const std::string& directory)
+{
+    std::vector<SpoolFile> files;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        return files;
+    }
+
+    while (const dirent* entry = readdir(dir)) { // NOLINT (concurrency-mt-unsafe)
+        const std::string_view name{ static_cast<const char*>(entry->d_name) };
+        if (!is_spool_file(name)) {
+            continue;
+        }
+        struct stat st
+        {};
+        const std::string path = directory + "/" + std::string{ name };
+        if (stat(path.c_str(), &st) == 0) {
+            files.push_back({ std::string{ name }, static_cast<uint64_t>(st.st_size) });
+        }
+    }
+    closedir(dir);
+
+    // Names start with the zero-padded start time of the profile, so they sort chronologically
+    std::sort(files.begin(), files.end(), [](const SpoolFile& a, const SpoolFile& b) { return a.name < b.name; });
+    return files;
+}
+
+bool
+write_all(int fd, const uint8_t* data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written; // NOLINT (cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool
+read_all(const std::string& path, std::vector<uint8_t>& data)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT (cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st
+    {};
+    bool ok = fstat(fd, &st) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(st.st_size));
+        size_t offset = 0;
+        while (offset < data.size()) {
+            const ssize_t n = read(fd, data.data() + offset, data.size() - offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            offset += static_cast<size_t>(n);
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+} // namespace
+
+void
+Datadog::Spooler::set_directory(std::string_view _directory)
+{
+    if (!_directory.empty()) {
+        directory = _directory;
+    }
+}
+
+void
+Datadog::Spooler::set_max_bytes(uint64_t _max_bytes)
+{
+    if (_max_bytes > 0) {
+        max_bytes = _max_bytes;
+    }
+}
+
+bool
+Datadog::Spooler::is_enabled()
+{
+    return !directory.empty();
+}
+
+void
+Datadog::Spooler::enqueue(ddog_ByteSlice data, ddog_Timespec start, ddog_Timespec end)
+{
+    const std::lock_guard<std::mutex> lock(queue_mtx);
+
+    // The writer thread is started on first use, so that nothing runs unless spooling is actually used
+    if (!writer_started) {
+        std::thread(run).detach();
+        writer_started = true;
+    }
+
+    // If the writer cannot keep up, the oldest profiles would be removed from the ring anyway
+    while (!queue.empty() && queued_bytes + data.len > max_bytes) {
+        queued_bytes -= queue.front().data.size();
+        queue.pop_front();
+        std::cerr << "Profile spool is falling behind, dropping a profile" << std::endl;
+    }
+
+    queue.push_back({ std::vector<uint8_t>(data.ptr, data.ptr + data.len), to_ns(start), to_ns(end) }); // NOLINT
+    queued_bytes += data.len;
+    queue_cv.notify_all();
+}
+
+bool
+Datadog::Spooler::flush(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    return queue_cv.wait_for(lock, timeout, [] { return queue.empty() && !writing; });
+}
+
+void
+Datadog::Spooler::run()
+{
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    for (;;) {
+        queue_cv.wait(lock, [] { return !queue.empty(); });
+
+        SpoolEntry entry = std::move(queue.front());
+        queue.pop_front();
+        queued_bytes -= entry.data.size();
+        const uint64_t entry_seq = seq++;
+        writing = true;
+
+        // Disk I/O happens without the lock, so that producers and forks are never held up by it
+        lock.unlock();
+        if (write_entry(entry, entry_seq)) {
+            trim();
+        }
+        lock.lock();
+
+        writing = false;
+        queue_cv.notify_all();
+    }
+}
+
+bool
+Datadog::Spooler::write_entry(const SpoolEntry& entry, uint64_t entry_seq)
+{
+    // Creating the directory fails harmlessly if it already exists
+    mkdir(directory.c_str(), 0700);
+
+    std::array<char, 128> name{};
+    std::snprintf(name.data(), // NOLINT (cppcoreguidelines-pro-type-vararg)
+                  name.size(),
+                  "%.*s%020" PRId64 "_%020" PRId64 "_%d_%" PRIu64 "%.*s",
+                  static_cast<int>(spool_prefix.size()),
+                  spool_prefix.data(),
+                  entry.start_ns,
+                  entry.end_ns,
+                  static_cast<int>(getpid()),
+                  entry_seq,
+                  static_cast<int>(spool_suffix.size()),
+                  spool_suffix.data());
+    const std::string path = directory + "/" + name.data();
+
+    // Write to a temporary file first, so that a partially written profile is never replayed
+    const std::string tmp_path = path + ".tmp";
+    const int fd =
+      open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600); // NOLINT (cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) {
+        std::cerr << "Error spooling profile to " << tmp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const bool ok = write_all(fd, entry.data.data(), entry.data.size());
+    close(fd);
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error spooling profile to " << path << ": " << std::strerror(errno) << std::endl;
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void
+Datadog::Spooler::trim()
+{
+    const std::vector<SpoolFile> files = list_spool_files(directory);
+    uint64_t total = 0;
+    for (const auto& file : files) {
+        total += file.size;
+    }
+
+    // Always keep the newest profile, even if it does not fit in the ring on its own
+    for (size_t i = 0; i + 1 < files.size() && total > max_bytes; ++i) {
+        const std::string path = directory + "/" + files[i].name;
+        if (unlink(path.c_str()) == 0) {
+            total -= files[i].size;
+        }
+    }
+}
+
+int64_t
+Datadog::Spooler::replay(std::string_view _directory, Uploader& uploader)
+{
+    const std::string replay_directory{ _directory };
+    int64_t sent = 0;
+    for (const auto& file : list_spool_files(replay_directory)) {
+        int64_t start_ns = 0;
+        int64_t end_ns = 0;
+        const std::string format = std::string{ spool_prefix } + "%" SCNd64 "_%" SCNd64 "_";
+        if (std::sscanf(file.name.c_str(), format.c_str(), &start_ns, &end_ns) != 2) { // NOLINT
+            continue;
+        }
+
+        const std::string path = replay_directory + "/" + file.name;
+        std::vector<uint8_t> data;
+        if (!read_all(path, data)) {
+            std::cerr << "Error reading spooled profile " << path << std::endl;
+            continue;
+        }
+
+        const ddog_ByteSlice slice = { .ptr = data.data(), .len = data.size() };
+        if (!uploader.send(slice, from_ns(start_ns), from_ns(end_ns))) {
+            break;
+        }
+        unlink(path.c_str());
+        ++sent;
+    }
+    return sent;
+}
+
+void
+Datadog::Spooler::prefork()
+{
+    queue_mtx.lock();
+}
+
+void
+Datadog::Spooler::postfork_parent()
+{
+    queue_mtx.unlock();
+}
+
+void
+Datadog::Spooler::postfork_child()
+{
+    // The writer thread does not exist in the child, and the queued profiles belong to the parent, which still
+    // writes them.  The condition variable may have been waited on by the writer, so it is recreated.
+    queue.clear();
+    queued_bytes = 0;
+    writing = false;
+    writer_started = false;
+    new (&queue_cv) std::condition_variable(); // NOLINT (cppcoreguidelines-owning-memory)
+    queue_mtx.unlock();
+}
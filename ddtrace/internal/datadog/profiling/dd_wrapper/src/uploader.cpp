@@ -1,5 +1,6 @@
 #include "uploader.hpp"
 #include "libdatadog_helpers.hpp"
+#include "spooler.hpp"
 
 using namespace Datadog;
 
@@ -39,6 +40,20 @@ Datadog::Uploader::upload(ddog_prof_Profile& profile)
     }
     ddog_prof_EncodedProfile* encoded = &result.ok; // NOLINT (cppcoreguidelines-pro-type-union-access)
 
+    // When spooling, the profile is written to disk to be uploaded later
+    bool ret = true;
+    if (Spooler::is_enabled()) {
+        Spooler::enqueue(ddog_Vec_U8_as_slice(&encoded->buffer), encoded->start, encoded->end);
+    } else {
+        ret = send(ddog_Vec_U8_as_slice(&encoded->buffer), encoded->start, encoded->end);
+    }
+    ddog_prof_EncodedProfile_drop(encoded);
+    return ret;
+}
+
+bool
+Datadog::Uploader::send(ddog_ByteSlice data, ddog_Timespec start, ddog_Timespec end)
+{
     // If we have any custom tags, set them now
     ddog_Vec_Tag tags = ddog_Vec_Tag_new();
     add_tag(tags, ExportTagKey::runtime_id, runtime_id, errmsg);
@@ -46,19 +61,18 @@ Datadog::Uploader::upload(ddog_prof_Profile& profile)
     // Build the request object
     const ddog_prof_Exporter_File file = {
         .name = to_slice("auto.pprof"),
-        .file = ddog_Vec_U8_as_slice(&encoded->buffer),
+        .file = data,
     };
     const uint64_t max_timeout_ms = 5000; // 5s is a common timeout parameter for Datadog profilers
     auto build_res = ddog_prof_Exporter_Request_build(ddog_exporter.get(),
-                                                      encoded->start,
-                                                      encoded->end,
+                                                      start,
+                                                      end,
                                                       ddog_prof_Exporter_Slice_File_empty(),
                                                       { .ptr = &file, .len = 1 },
                                                       &tags,
                                                       nullptr,
                                                       nullptr,
                                                       max_timeout_ms);
-    ddog_prof_EncodedProfile_drop(encoded);
 
     if (build_res.tag ==
         DDOG_PROF_EXPORTER_REQUEST_BUILD_RESULT_ERR) { // NOLINT (cppcoreguidelines-pro-type-union-access)
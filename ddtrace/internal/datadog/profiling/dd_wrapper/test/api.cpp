@@ -1,7 +1,16 @@
 #include "interface.hpp"
 #include "test_utils.hpp"
+#include "types.hpp"
 #include <gtest/gtest.h>
 
+#include <array>
+#include <string>
+#include <string_view>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <time.h>
+
 // NOTE: cmake gives us an old gtest, and rather than update I just use the
 //       "workaround" in the following link
 //       https://stackoverflow.com/a/71257678
@@ -118,6 +127,34 @@ TEST(UploadDeathTest, SingleSampleTooManyFrames)
     EXPECT_EXIT(single_toomanyframes_sample(), ::testing::ExitedWithCode(0), "");
 }
 
+void
+cleared_frames_sample()
+{
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 8);
+
+    // A stack that could not be unwound completely is cleared, including the frames omitted over the limit, and the
+    // sample can be reused
+    auto h = ddup_start_sample();
+    for (int i = 0; i < 16; i++) {
+        ddup_push_frame(h, "my_partial_frame", "my_test_file", 1, 1);
+    }
+    ddup_clear_frames(h);
+    ddup_push_walltime(h, 1.0, 1);
+    ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+    ddup_flush_sample(h);
+    ddup_drop_sample(h);
+    h = nullptr;
+
+    ddup_upload();
+
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, ClearedFramesSample)
+{
+    EXPECT_EXIT(cleared_frames_sample(), ::testing::ExitedWithCode(0), "");
+}
+
 void
 lotsa_frames_lotsa_samples()
 {
@@ -162,6 +199,204 @@ TEST(UploadDeathTest, LotsaSamplesLotsaFrames)
     EXPECT_EXIT(lotsa_frames_lotsa_samples(), ::testing::ExitedWithCode(0), "");
 }
 
+void
+timeline_samples()
+{
+    // Only keep a few timestamped samples; the rest should be aggregated
+    ddup_config_timeline(true, 16);
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 64);
+
+    for (int i = 0; i < 100; i++) {
+        auto h = ddup_start_sample();
+        ddup_push_walltime(h, 1.0, 1);
+        if (i % 2 == 0) {
+            // Explicit timestamp, as a renderer would provide
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ddup_push_monotonic_ns(h, static_cast<int64_t>(ts.tv_sec) * 1'000'000'000LL + ts.tv_nsec);
+        }
+        ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+        ddup_flush_sample(h);
+        ddup_drop_sample(h);
+        h = nullptr;
+    }
+
+    // Upload.  It'll fail, but whatever
+    ddup_upload();
+
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, TimelineSamples)
+{
+    EXPECT_EXIT(timeline_samples(), ::testing::ExitedWithCode(0), "");
+}
+
+void
+memory_budget()
+{
+    // A tiny budget, so that it is exceeded after a few samples
+    ddup_config_memory_budget(4096);
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 64);
+
+    for (int i = 0; i < 1000; i++) {
+        auto h = ddup_start_sample();
+        ddup_push_walltime(h, 1.0, 1);
+        ddup_push_task_name(h, "task_" + std::to_string(i));
+        ddup_push_span_id(h, i);
+        for (int j = 0; j < 32; j++) {
+            const std::string name = "frame_" + std::to_string(i) + "_" + std::to_string(j);
+            ddup_push_frame(h, name, "my_test_file", 0, j);
+        }
+        ddup_flush_sample(h);
+        ddup_drop_sample(h);
+        h = nullptr;
+    }
+
+    uint64_t periods_over_budget = 0;
+    uint64_t dropped_labels = 0;
+    uint64_t collapsed_stacks = 0;
+    uint64_t evicted_strings = 0;
+    ddup_get_profile_stats(&periods_over_budget, &dropped_labels, &collapsed_stacks, &evicted_strings);
+    if (periods_over_budget != 1 || dropped_labels == 0 || collapsed_stacks == 0 || evicted_strings == 0) {
+        std::exit(1);
+    }
+
+    // Upload.  It'll fail, but whatever
+    ddup_upload();
+
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, MemoryBudget)
+{
+    EXPECT_EXIT(memory_budget(), ::testing::ExitedWithCode(0), "");
+}
+
+void
+multiple_profiles()
+{
+    // Heap samples go to their own profile, uploaded at most every 5 minutes
+    ddup_config_profile("heap", Datadog::SampleType::Heap, 1, 300'000);
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 64);
+
+    for (int i = 0; i < 100; i++) {
+        auto h = ddup_start_sample_for(Datadog::SampleType::Heap);
+        if (h == nullptr) {
+            std::exit(1);
+        }
+        ddup_push_heap(h, 1024);
+        ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+        ddup_flush_sample(h);
+        ddup_drop_sample(h);
+
+        h = ddup_start_sample_for(Datadog::SampleType::CPU | Datadog::SampleType::Wall);
+        if (h == nullptr) {
+            std::exit(1);
+        }
+        ddup_push_cputime(h, 1, 1);
+        ddup_push_walltime(h, 1, 1);
+        ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+        ddup_flush_sample(h);
+        ddup_drop_sample(h);
+        h = nullptr;
+    }
+
+    // Upload.  It'll fail, but whatever
+    ddup_upload();
+
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, MultipleProfiles)
+{
+    EXPECT_EXIT(multiple_profiles(), ::testing::ExitedWithCode(0), "");
+}
+
+void
+heap_snapshots()
+{
+    ddup_config_profile("heap", Datadog::SampleType::Heap, 1, 300'000);
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 64);
+
+    // Each snapshot replaces the previous one in the heap profile, which is not due for upload yet
+    for (int i = 0; i < 10; i++) {
+        ddup_start_snapshot(Datadog::SampleType::Heap);
+        for (int j = 0; j < 100; j++) {
+            auto h = ddup_start_sample_for(Datadog::SampleType::Heap);
+            if (h == nullptr) {
+                std::exit(1);
+            }
+            ddup_push_heap(h, 1024);
+            ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+            ddup_flush_sample(h);
+            ddup_drop_sample(h);
+        }
+        ddup_upload();
+    }
+
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, HeapSnapshots)
+{
+    EXPECT_EXIT(heap_snapshots(), ::testing::ExitedWithCode(0), "");
+}
+
+int
+count_spooled(const std::string& directory)
+{
+    int count = 0;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+    while (const dirent* entry = readdir(dir)) {
+        const std::string_view name{ static_cast<const char*>(entry->d_name) };
+        if (name.size() > 6 && name.substr(name.size() - 6) == ".pprof") {
+            ++count;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+void
+spool_profiles()
+{
+    std::array<char, 32> directory_template = { "/tmp/dd_wrapper_spool_XXXXXX" };
+    const char* directory = mkdtemp(directory_template.data());
+    if (directory == nullptr) {
+        std::exit(1);
+    }
+
+    // Profiles are written to disk rather than uploaded
+    ddup_config_spool(directory, 1024 * 1024);
+    configure("my_test_service", "my_test_env", "0.0.1", "https://localhost:8126", "cpython", "3.10.6", "3.100", 64);
+
+    for (int upload = 0; upload < 3; upload++) {
+        for (int i = 0; i < 100; i++) {
+            auto h = ddup_start_sample();
+            ddup_push_walltime(h, 1.0, 1);
+            ddup_push_frame(h, "my_test_frame", "my_test_file", 1, 1);
+            ddup_flush_sample(h);
+            ddup_drop_sample(h);
+            h = nullptr;
+        }
+        ddup_upload();
+    }
+
+    if (!ddup_flush_spool(5000) || count_spooled(directory) != 3) {
+        std::exit(1);
+    }
+    std::exit(0);
+}
+
+TEST(UploadDeathTest, SpoolProfiles)
+{
+    EXPECT_EXIT(spool_profiles(), ::testing::ExitedWithCode(0), "");
+}
+
 int
 main(int argc, char** argv)
 {
@@ -7,6 +7,7 @@ try:
     is_available = True
 
 except Exception as e:
+    from types import FrameType  # noqa:F401
     from typing import Dict  # noqa:F401
     from typing import Optional  # noqa:F401
 
@@ -22,6 +23,22 @@ except Exception as e:
         def wrapper(*args, **kwargs):
             raise NotImplementedError("{} is not implemented on this platform".format(func.__name__))
 
+    SAMPLE_TYPE_CPU = 1 << 0
+    SAMPLE_TYPE_WALL = 1 << 1
+    SAMPLE_TYPE_EXCEPTION = 1 << 2
+    SAMPLE_TYPE_LOCK_ACQUIRE = 1 << 3
+    SAMPLE_TYPE_LOCK_RELEASE = 1 << 4
+    SAMPLE_TYPE_ALLOCATION = 1 << 5
+    SAMPLE_TYPE_HEAP = 1 << 6
+
+    @not_implemented
+    def add_profile(name, sample_types, upload_period=0.0, period=1):  # type: (str, int, float, int) -> None
+        pass
+
+    @not_implemented
+    def start_snapshot(sample_types):  # type: (int) -> None
+        pass
+
     @not_implemented
     def init(
         env,  # type: Optional[str]
@@ -30,6 +47,10 @@ except Exception as e:
         tags,  # type: Optional[Dict[str, str]]
         max_nframes,  # type: Optional[int]
         url,  # type: Optional[str]
+        timeline_enabled=False,  # type: bool
+        memory_budget=None,  # type: Optional[int]
+        spool_dir=None,  # type: Optional[str]
+        spool_max_bytes=None,  # type: Optional[int]
     ):
         pass
 
@@ -37,7 +58,22 @@ except Exception as e:
     def upload():  # type: () -> None
         pass
 
+    @not_implemented
+    def flush_spool(timeout):  # type: (float) -> bool
+        pass
+
+    @not_implemented
+    def replay_spool(directory):  # type: (str) -> int
+        pass
+
+    @not_implemented
+    def get_profile_stats():  # type: () -> Dict[str, int]
+        pass
+
     class SampleHandle:
+        def __init__(self, sample_types=0):  # type: (int) -> None
+            pass
+
         @not_implemented
         def push_cputime(self, value, count):  # type: (int, int) -> None
             pass
@@ -70,6 +106,10 @@ except Exception as e:
         def push_frame(self, name, filename, address, line):  # type: (str, str, int, int) -> None
             pass
 
+        @not_implemented
+        def push_pyframes(self, frame, max_nframes):  # type: (Optional[FrameType], int) -> int
+            pass
+
         @not_implemented
         def push_threadinfo(self, thread_id, thread_native_id, thread_name):  # type: (int, int, Optional[str]) -> None
             pass
@@ -86,6 +126,10 @@ except Exception as e:
         def push_class_name(self, class_name):  # type: (str) -> None
             pass
 
+        @not_implemented
+        def push_monotonic_ns(self, monotonic_ns):  # type: (int) -> None
+            pass
+
         @not_implemented
         def push_span(self, span, endpoint_collection_enabled):  # type: (Optional[Span], bool) -> None
             pass
@@ -1,3 +1,4 @@
+from types import FrameType
 from typing import Dict
 from typing import Optional
 from typing import Union
@@ -5,6 +6,16 @@ from ddtrace._trace.span import Span
 
 StringType = Union[str, bytes, None]
 
+SAMPLE_TYPE_CPU: int
+SAMPLE_TYPE_WALL: int
+SAMPLE_TYPE_EXCEPTION: int
+SAMPLE_TYPE_LOCK_ACQUIRE: int
+SAMPLE_TYPE_LOCK_RELEASE: int
+SAMPLE_TYPE_ALLOCATION: int
+SAMPLE_TYPE_HEAP: int
+
+def add_profile(name: str, sample_types: int, upload_period: float = ..., period: int = ...) -> None: ...
+def start_snapshot(sample_types: int) -> None: ...
 def init(
     env: StringType,
     service: StringType,
@@ -12,10 +23,18 @@ def init(
     tags: Optional[Dict[Union[str, bytes], Union[str, bytes]]],
     max_nframes: Optional[int],
     url: Optional[str],
+    timeline_enabled: bool = ...,
+    memory_budget: Optional[int] = ...,
+    spool_dir: StringType = ...,
+    spool_max_bytes: Optional[int] = ...,
 ) -> None: ...
 def upload() -> None: ...
+def flush_spool(timeout: float) -> bool: ...
+def replay_spool(directory: StringType) -> int: ...
+def get_profile_stats() -> Dict[str, int]: ...
 
 class SampleHandle:
+    def __init__(self, sample_types: int = ...) -> None: ...
     def push_cputime(self, value: int, count: int) -> None: ...
     def push_walltime(self, value: int, count: int) -> None: ...
     def push_acquire(self, value: int, count: int) -> None: ...
@@ -24,10 +43,12 @@ class SampleHandle:
     def push_heap(self, value: int) -> None: ...
     def push_lock_name(self, lock_name: StringType) -> None: ...
     def push_frame(self, name: StringType, filename: StringType, address: int, line: int) -> None: ...
+    def push_pyframes(self, frame: Optional[FrameType], max_nframes: int) -> int: ...
     def push_threadinfo(self, thread_id: int, thread_native_id: int, thread_name: StringType) -> None: ...
     def push_task_id(self, task_id: Optional[int]) -> None: ...
     def push_task_name(self, task_name: StringType) -> None: ...
     def push_exceptioninfo(self, exc_type: Union[None, bytes, str, type], count: int) -> None: ...
     def push_class_name(self, class_name: StringType) -> None: ...
+    def push_monotonic_ns(self, monotonic_ns: int) -> None: ...
     def push_span(self, span: Optional[Span], endpoint_collection_enabled: bool) -> None: ...
     def flush_sample(self) -> None: ...
@@ -2,6 +2,7 @@
 # cython: language_level=3
 
 import platform
+from types import FrameType
 from typing import Dict
 from typing import Optional
 from typing import Union
@@ -16,6 +17,15 @@ from ddtrace._trace.span import Span
 
 StringType = Union[str, bytes, None]
 
+# Sample types, as in Datadog::SampleType; they can be combined
+SAMPLE_TYPE_CPU = 1 << 0
+SAMPLE_TYPE_WALL = 1 << 1
+SAMPLE_TYPE_EXCEPTION = 1 << 2
+SAMPLE_TYPE_LOCK_ACQUIRE = 1 << 3
+SAMPLE_TYPE_LOCK_RELEASE = 1 << 4
+SAMPLE_TYPE_ALLOCATION = 1 << 5
+SAMPLE_TYPE_HEAP = 1 << 6
+
 
 cdef extern from "stdint.h":
     ctypedef unsigned long long uint64_t
@@ -40,6 +50,10 @@ cdef extern from "interface.hpp":
     void ddup_config_profiler_version(string_view profiler_version)
     void ddup_config_url(string_view url)
     void ddup_config_max_nframes(int max_nframes)
+    void ddup_config_timeline(bint enabled, unsigned int max_samples)
+    void ddup_config_memory_budget(uint64_t bytes)
+    void ddup_config_spool(string_view directory, uint64_t max_bytes)
+    void ddup_config_profile(string_view name, unsigned int sample_types, int64_t period, uint64_t upload_period_ms)
 
     void ddup_config_user_tag(string_view key, string_view val)
     void ddup_config_sample_type(unsigned int type)
@@ -47,6 +61,8 @@ cdef extern from "interface.hpp":
     void ddup_init()
 
     Sample *ddup_start_sample()
+    Sample *ddup_start_sample_for(unsigned int sample_types)
+    void ddup_start_snapshot(unsigned int sample_types)
     void ddup_push_walltime(Sample *sample, int64_t walltime, int64_t count)
     void ddup_push_cputime(Sample *sample, int64_t cputime, int64_t count)
     void ddup_push_acquire(Sample *sample, int64_t acquire_time, int64_t count)
@@ -63,11 +79,21 @@ cdef extern from "interface.hpp":
     void ddup_push_trace_resource_container(Sample *sample, string_view trace_resource_container)
     void ddup_push_exceptioninfo(Sample *sample, string_view exception_type, int64_t count)
     void ddup_push_class_name(Sample *sample, string_view class_name)
+    void ddup_push_monotonic_ns(Sample *sample, int64_t monotonic_ns)
     void ddup_push_frame(Sample *sample, string_view _name, string_view _filename, uint64_t address, int64_t line)
     void ddup_flush_sample(Sample *sample)
     void ddup_drop_sample(Sample *sample)
     void ddup_set_runtime_id(string_view _id)
     bint ddup_upload() nogil
+    bint ddup_flush_spool(uint64_t timeout_ms) nogil
+    int64_t ddup_replay_spool(string_view directory) nogil
+    void ddup_get_profile_stats(uint64_t *periods_over_budget,
+                                uint64_t *dropped_labels,
+                                uint64_t *collapsed_stacks,
+                                uint64_t *evicted_strings)
+
+cdef extern from "frame_walker.hpp":
+    int64_t ddup_push_pyframes(Sample *sample, object frame, unsigned int max_nframes)
 
 # Create wrappers for cython
 cdef call_ddup_config_service(bytes service):
@@ -124,13 +150,36 @@ cdef int64_t clamp_to_int64_unsigned(value):
 
 
 # Public API
+def add_profile(name: str, sample_types: int, upload_period: float = 0.0, period: int = 1) -> None:
+    """Collect the given sample types into a separate profile, uploaded at most every `upload_period` seconds.
+
+    Must be called before init(). With an upload period of 0, the profile is uploaded along with the default one.
+    """
+    name_bytes = ensure_binary_or_empty(name)
+    ddup_config_profile(
+        string_view(<const char*>name_bytes, len(name_bytes)),
+        sample_types,
+        clamp_to_int64_unsigned(period),
+        clamp_to_uint64_unsigned(int(upload_period * 1000)),
+    )
+
+
+def start_snapshot(sample_types: int) -> None:
+    """Start a new snapshot of the given sample types, replacing the previous one if it was not uploaded yet."""
+    ddup_start_snapshot(sample_types)
+
+
 def init(
         service: StringType = None,
         env: StringType = None,
         version: StringType = None,
         tags: Optional[Dict[Union[str, bytes], Union[str, bytes]]] = None,
         max_nframes: Optional[int] = None,
-        url: StringType = None) -> None:
+        url: StringType = None,
+        timeline_enabled: bool = False,
+        memory_budget: Optional[int] = None,
+        spool_dir: StringType = None,
+        spool_max_bytes: Optional[int] = None) -> None:
 
     # Try to provide a ddtrace-specific default service if one is not given
     service = service or DEFAULT_SERVICE_NAME
@@ -156,6 +205,18 @@ def init(
         for key, val in tags.items():
             if key and val:
                 call_ddup_config_user_tag(ensure_binary_or_empty(key), ensure_binary_or_empty(val))
+    if timeline_enabled:
+        # 0 keeps the default number of timestamped samples per profile
+        ddup_config_timeline(True, 0)
+    if memory_budget:
+        ddup_config_memory_budget(clamp_to_uint64_unsigned(memory_budget))
+    if spool_dir:
+        # Profiles are written to disk instead of being uploaded
+        spool_dir_bytes = ensure_binary_or_empty(spool_dir)
+        ddup_config_spool(
+            string_view(<const char*>spool_dir_bytes, len(spool_dir_bytes)),
+            clamp_to_uint64_unsigned(spool_max_bytes or 0),
+        )
     ddup_init()
 
 
@@ -166,11 +227,44 @@ def upload() -> None:
         ddup_upload()
 
 
+def flush_spool(timeout: float) -> bool:
+    cdef uint64_t timeout_ms = clamp_to_uint64_unsigned(int(timeout * 1000))
+    cdef bint flushed
+    with nogil:
+        flushed = ddup_flush_spool(timeout_ms)
+    return flushed
+
+
+def replay_spool(directory: StringType) -> int:
+    directory_bytes = ensure_binary_or_empty(directory)
+    cdef const char *directory_ptr = directory_bytes
+    cdef size_t directory_len = len(directory_bytes)
+    cdef int64_t sent
+    with nogil:
+        sent = ddup_replay_spool(string_view(directory_ptr, directory_len))
+    return sent
+
+
+def get_profile_stats() -> Dict[str, int]:
+    cdef uint64_t periods_over_budget = 0
+    cdef uint64_t dropped_labels = 0
+    cdef uint64_t collapsed_stacks = 0
+    cdef uint64_t evicted_strings = 0
+    ddup_get_profile_stats(&periods_over_budget, &dropped_labels, &collapsed_stacks, &evicted_strings)
+    return {
+        "periods_over_budget": periods_over_budget,
+        "dropped_labels": dropped_labels,
+        "collapsed_stacks": collapsed_stacks,
+        "evicted_strings": evicted_strings,
+    }
+
+
 cdef class SampleHandle:
     cdef Sample *ptr
 
-    def __cinit__(self):
-        self.ptr = ddup_start_sample()
+    def __cinit__(self, unsigned int sample_types = 0):
+        # The sample types select the profile the sample is collected into
+        self.ptr = ddup_start_sample_for(sample_types)
 
     def __dealloc__(self):
         if self.ptr is not NULL:
@@ -219,6 +313,14 @@ cdef class SampleHandle:
                     clamp_to_int64_unsigned(line),
             )
 
+    def push_pyframes(self, frame: Optional[FrameType], max_nframes: int) -> int:
+        # Walks the frame chain natively and pushes up to `max_nframes` frames, leaf first.  Returns the number of
+        # frames pushed, or -1 if the stack could not be unwound, in which case the frames of the sample are cleared
+        # and it should not be flushed.
+        if self.ptr is NULL:
+            return 0
+        return ddup_push_pyframes(self.ptr, frame, clamp_to_int64_unsigned(max_nframes))
+
     def push_threadinfo(self, thread_id: int, thread_native_id: int, thread_name: StringType) -> None:
         if self.ptr is not NULL:
             thread_id = thread_id if thread_id is not None else 0
@@ -261,6 +363,12 @@ cdef class SampleHandle:
             class_name_bytes = ensure_binary_or_empty(class_name)
             ddup_push_class_name(self.ptr, string_view(<const char*>class_name_bytes, len(class_name_bytes)))
 
+    def push_monotonic_ns(self, monotonic_ns: int) -> None:
+        # Overrides the time the sample was taken, which defaults to when the handle was created.  The value is a
+        # CLOCK_MONOTONIC timestamp, e.g. from time.monotonic_ns().
+        if self.ptr is not NULL:
+            ddup_push_monotonic_ns(self.ptr, clamp_to_int64_unsigned(monotonic_ns))
+
     def push_span(self, span: Optional[Span], endpoint_collection_enabled: bool) -> None:
         if self.ptr is NULL:
             return
@@ -0,0 +1,18 @@
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstdint>
+
+// Forward decl of the sample type
+namespace Datadog {
+class Sample;
+}
+
+// Walks the frame chain starting at `frame` (leaf first), pushing up to `max_nframes` frames directly into
+// `sample`.  Must be called with the GIL held.  Returns the number of frames pushed, or -1 if a non-frame or
+// non-code object was encountered during unwinding, in which case the frames of the sample are cleared and the
+// sample should be dropped.
+int64_t
+ddup_push_pyframes(Datadog::Sample* sample, PyObject* frame, unsigned int max_nframes);
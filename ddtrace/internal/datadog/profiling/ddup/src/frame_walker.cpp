@@ -0,0 +1,101 @@
+#include "frame_walker.hpp"
+#include "interface.hpp"
+
+#include <frameobject.h>
+
+#include <string_view>
+
+namespace {
+
+inline PyCodeObject*
+frame_get_code(PyFrameObject* frame)
+{
+#if PY_VERSION_HEX >= 0x03090000
+    return PyFrame_GetCode(frame);
+#else
+    Py_XINCREF(frame->f_code);
+    return frame->f_code;
+#endif
+}
+
+inline PyFrameObject*
+frame_get_back(PyFrameObject* frame)
+{
+#if PY_VERSION_HEX >= 0x03090000
+    return PyFrame_GetBack(frame);
+#else
+    Py_XINCREF(frame->f_back);
+    return frame->f_back;
+#endif
+}
+
+inline std::string_view
+unicode_to_string_view(PyObject* str)
+{
+    static constexpr std::string_view unknown = "<unknown>";
+    if (str == nullptr || !PyUnicode_Check(str)) {
+        return unknown;
+    }
+
+    Py_ssize_t len = 0;
+    const char* data = PyUnicode_AsUTF8AndSize(str, &len);
+    if (data == nullptr) {
+        // e.g., lone surrogates; don't leave an exception set on the caller
+        PyErr_Clear();
+        return unknown;
+    }
+    return { data, static_cast<size_t>(len) };
+}
+
+} // namespace
+
+int64_t
+ddup_push_pyframes(Datadog::Sample* sample, PyObject* top, unsigned int max_nframes)
+{
+    // DEV: There are reports that Python 3.11 returns non-frame objects when retrieving frame objects and doing
+    // stack unwinding.  Just as the pure-Python walker, we bail out on the whole sample in this case rather than
+    // reporting potentially incomplete and/or inaccurate data.
+    if (top == nullptr || !PyFrame_Check(top)) {
+        ddup_clear_frames(sample);
+        return -1;
+    }
+
+    auto* frame = reinterpret_cast<PyFrameObject*>(top); // NOLINT (cppcoreguidelines-pro-type-reinterpret-cast)
+    Py_INCREF(frame);
+
+    int64_t nframes = 0;
+    while (frame != nullptr && nframes < max_nframes) {
+        PyCodeObject* code = frame_get_code(frame);
+        if (code == nullptr || !PyCode_Check(code)) {
+            Py_XDECREF(code);
+            Py_DECREF(frame);
+            ddup_clear_frames(sample);
+            return -1;
+        }
+
+        // The UTF-8 representation of the names is cached in the string objects, which the code object keeps alive
+        // while the frame is pushed, so they are not cached per code object here
+        const int lineno = PyFrame_GetLineNumber(frame);
+        ddup_push_frame(sample,
+                        unicode_to_string_view(code->co_name),
+                        unicode_to_string_view(code->co_filename),
+                        0,
+                        lineno < 0 ? 0 : lineno);
+        Py_DECREF(code);
+        ++nframes;
+
+        PyFrameObject* back = frame_get_back(frame);
+        Py_DECREF(frame);
+        frame = back;
+
+        if (frame != nullptr && !PyFrame_Check(frame)) {
+            Py_DECREF(frame);
+            // Don't leave a partial stack in the sample, in case it is flushed anyway
+            ddup_clear_frames(sample);
+            return -1;
+        }
+    }
+    Py_XDECREF(frame);
+
+    return nframes;
+}
@@ -148,6 +148,34 @@ def SampleTest(value, name, exc_type, lineno, span, endpoint):
     return test
 
 
+def PyFramesTest():
+    InitNormal()
+    frame = sys._getframe()
+    depth = 0
+    f = frame
+    while f is not None:
+        depth += 1
+        f = f.f_back
+
+    # The whole stack, or at most max_nframes frames, leaf first
+    h = _ddup.SampleHandle()
+    assert h.push_pyframes(frame, 512) == depth
+    h.push_walltime(1, 1)
+    h.flush_sample()
+    h = _ddup.SampleHandle()
+    assert h.push_pyframes(frame, 1) == 1
+    h.push_walltime(1, 1)
+    h.flush_sample()
+
+    # Stacks which cannot be unwound are reported, and leave no frames in the sample
+    h = _ddup.SampleHandle()
+    assert h.push_pyframes(None, 512) == -1
+    assert h.push_pyframes(object(), 512) == -1
+    assert h.push_pyframes(frame.f_code, 512) == -1
+    h.push_walltime(1, 1)
+    h.flush_sample()
+
+
 def MakeSpan(span_id, service, span_type, add_local_root):
     return Span(span_id, service, span_type, Span(span_id, service, span_type) if add_local_root else None)
 
@@ -186,5 +214,6 @@ for test in InitTypeTests:
     assert run_test(test)
 assert run_test(InitNormal)
 assert run_test(SampleTestSimple)
+assert run_test(PyFramesTest)
 for test in SampleTypeTests:
     assert run_test(test)
@@ -12,6 +12,7 @@
 #include "python_headers.hpp"
 
 #include "dd_wrapper/include/interface.hpp"
+#include "dd_wrapper/include/types.hpp"
 #include "echion/render.h"
 
 namespace Datadog {
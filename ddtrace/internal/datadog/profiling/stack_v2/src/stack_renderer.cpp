@@ -22,7 +22,7 @@ StackRenderer::render_thread_begin(PyThreadState* tstate,
     if (failed) {
         return;
     }
-    sample = ddup_start_sample();
+    sample = ddup_start_sample_for(SampleType::CPU | SampleType::Wall);
     if (sample == nullptr) {
         std::cerr << "Failed to create a sample.  Stack v2 sampler will be disabled." << std::endl;
         failed = true;
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "_ddsketch.hpp"
+
+// Aggregation of the Data Streams Monitoring checkpoints and Kafka offsets, by time bucket.
+//
+// Each thread accumulates its checkpoints in its own shard, so that producers never contend with each other or with
+// the periodic flush on a single table: the flush only swaps the shards out, and merges them afterwards. Shards are
+// locked only for short sections that never release the GIL, so a fork can never happen while one is held.
+
+namespace ddtrace {
+
+inline void
+hash_combine(size_t& seed, size_t hash)
+{
+    seed ^= hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+struct PathwayAggrKey
+{
+    // The tags of the edge leading to the checkpoint, joined with commas
+    std::string edge_tags;
+    uint64_t hash = 0;
+    uint64_t parent_hash = 0;
+
+    bool operator==(const PathwayAggrKey& other) const
+    {
+        return hash == other.hash && parent_hash == other.parent_hash && edge_tags == other.edge_tags;
+    }
+
+    struct Hash
+    {
+        size_t operator()(const PathwayAggrKey& key) const
+        {
+            size_t seed = std::hash<std::string>{}(key.edge_tags);
+            hash_combine(seed, std::hash<uint64_t>{}(key.hash));
+            hash_combine(seed, std::hash<uint64_t>{}(key.parent_hash));
+            return seed;
+        }
+    };
+};
+
+struct PartitionKey
+{
+    std::string topic;
+    int64_t partition = 0;
+
+    bool operator==(const PartitionKey& other) const
+    {
+        return partition == other.partition && topic == other.topic;
+    }
+
+    struct Hash
+    {
+        size_t operator()(const PartitionKey& key) const
+        {
+            size_t seed = std::hash<std::string>{}(key.topic);
+            hash_combine(seed, std::hash<int64_t>{}(key.partition));
+            return seed;
+        }
+    };
+};
+
+struct ConsumerPartitionKey
+{
+    std::string group;
+    std::string topic;
+    int64_t partition = 0;
+
+    bool operator==(const ConsumerPartitionKey& other) const
+    {
+        return partition == other.partition && topic == other.topic && group == other.group;
+    }
+
+    struct Hash
+    {
+        size_t operator()(const ConsumerPartitionKey& key) const
+        {
+            size_t seed = std::hash<std::string>{}(key.group);
+            hash_combine(seed, std::hash<std::string>{}(key.topic));
+            hash_combine(seed, std::hash<int64_t>{}(key.partition));
+            return seed;
+        }
+    };
+};
+
+struct PathwayStats
+{
+    DDSketch full_pathway_latency;
+    DDSketch edge_latency;
+    DDSketch payload_size;
+
+    void merge(const PathwayStats& other)
+    {
+        full_pathway_latency.merge(other.full_pathway_latency);
+        edge_latency.merge(other.edge_latency);
+        payload_size.merge(other.payload_size);
+    }
+};
+
+// Values in the order in which their keys were first seen, so that payloads are stable
+template<typename Key, typename Value>
+class InsertionOrderedMap
+{
+  public:
+    Value& get(const Key& key)
+    {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            return entries_[it->second].second;
+        }
+        index_.emplace(key, entries_.size());
+        entries_.emplace_back(key, Value{});
+        return entries_.back().second;
+    }
+
+    const std::vector<std::pair<Key, Value>>& entries() const { return entries_; }
+
+  private:
+    std::vector<std::pair<Key, Value>> entries_;
+    std::unordered_map<Key, size_t, typename Key::Hash> index_;
+};
+
+class PathwayBucket
+{
+  public:
+    explicit PathwayBucket(int64_t start_ns)
+      : start_ns_(start_ns)
+    {
+    }
+
+    PathwayStats& pathway_stats(const PathwayAggrKey& key) { return pathway_stats_.get(key); }
+
+    // Only the latest offsets are kept
+    void track_produce(const PartitionKey& key, int64_t offset)
+    {
+        int64_t& latest = produce_offsets_.get(key);
+        latest = std::max(latest, offset);
+    }
+
+    void track_commit(const ConsumerPartitionKey& key, int64_t offset)
+    {
+        int64_t& latest = commit_offsets_.get(key);
+        latest = std::max(latest, offset);
+    }
+
+    void merge(const PathwayBucket& other)
+    {
+        for (const auto& [key, stats] : other.pathway_stats_.entries()) {
+            pathway_stats(key).merge(stats);
+        }
+        for (const auto& [key, offset] : other.produce_offsets_.entries()) {
+            track_produce(key, offset);
+        }
+        for (const auto& [key, offset] : other.commit_offsets_.entries()) {
+            track_commit(key, offset);
+        }
+    }
+
+    int64_t start_ns() const { return start_ns_; }
+    const std::vector<std::pair<PathwayAggrKey, PathwayStats>>& pathway_stats() const
+    {
+        return pathway_stats_.entries();
+    }
+    const std::vector<std::pair<PartitionKey, int64_t>>& produce_offsets() const { return produce_offsets_.entries(); }
+    const std::vector<std::pair<ConsumerPartitionKey, int64_t>>& commit_offsets() const
+    {
+        return commit_offsets_.entries();
+    }
+
+  private:
+    int64_t start_ns_;
+    InsertionOrderedMap<PathwayAggrKey, PathwayStats> pathway_stats_;
+    InsertionOrderedMap<PartitionKey, int64_t> produce_offsets_;
+    InsertionOrderedMap<ConsumerPartitionKey, int64_t> commit_offsets_;
+};
+
+// Buckets in the order in which they were first seen
+class PathwayBuckets
+{
+  public:
+    PathwayBucket& get(int64_t start_ns)
+    {
+        // Checkpoints are mostly created in the latest bucket
+        for (auto it = buckets_.rbegin(); it != buckets_.rend(); ++it) {
+            if ((*it)->start_ns() == start_ns) {
+                return **it;
+            }
+        }
+        buckets_.push_back(std::make_unique<PathwayBucket>(start_ns));
+        return *buckets_.back();
+    }
+
+    void merge(const PathwayBuckets& other)
+    {
+        for (const auto& bucket : other.buckets_) {
+            get(bucket->start_ns()).merge(*bucket);
+        }
+    }
+
+    bool empty() const { return buckets_.empty(); }
+    size_t size() const { return buckets_.size(); }
+    const PathwayBucket& at(size_t index) const { return *buckets_[index]; }
+    void swap(PathwayBuckets& other) { buckets_.swap(other.buckets_); }
+
+  private:
+    std::vector<std::unique_ptr<PathwayBucket>> buckets_;
+};
+
+class DataStreamsAggregator
+{
+  public:
+    static constexpr size_t shard_count = 16;
+
+    void add_checkpoint(int64_t bucket_start_ns,
+                        const PathwayAggrKey& key,
+                        double edge_latency_sec,
+                        double full_pathway_latency_sec,
+                        double payload_size)
+    {
+        Shard& shard = shards_[shard_index()];
+        const std::lock_guard<std::mutex> lock(shard.mtx);
+
+        PathwayStats& stats = shard.buckets.get(bucket_start_ns).pathway_stats(key);
+        stats.full_pathway_latency.add(full_pathway_latency_sec);
+        stats.edge_latency.add(edge_latency_sec);
+        stats.payload_size.add(payload_size);
+    }
+
+    void track_produce(int64_t bucket_start_ns, const PartitionKey& key, int64_t offset)
+    {
+        Shard& shard = shards_[shard_index()];
+        const std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.buckets.get(bucket_start_ns).track_produce(key, offset);
+    }
+
+    void track_commit(int64_t bucket_start_ns, const ConsumerPartitionKey& key, int64_t offset)
+    {
+        Shard& shard = shards_[shard_index()];
+        const std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.buckets.get(bucket_start_ns).track_commit(key, offset);
+    }
+
+    // Take everything accumulated so far out of the shards; merge() then combines them into a single list of buckets
+    void take(std::vector<PathwayBuckets>& taken)
+    {
+        for (Shard& shard : shards_) {
+            const std::lock_guard<std::mutex> lock(shard.mtx);
+            if (!shard.buckets.empty()) {
+                taken.emplace_back();
+                taken.back().swap(shard.buckets);
+            }
+        }
+    }
+
+    // Does not touch the shards, so this can run without the GIL
+    static void merge(std::vector<PathwayBuckets>& taken, PathwayBuckets& merged)
+    {
+        for (PathwayBuckets& buckets : taken) {
+            if (merged.empty()) {
+                merged.swap(buckets);
+            } else {
+                merged.merge(buckets);
+            }
+        }
+        taken.clear();
+    }
+
+    // Merge a copy of everything accumulated so far, leaving the shards untouched
+    void copy(PathwayBuckets& merged)
+    {
+        for (Shard& shard : shards_) {
+            const std::lock_guard<std::mutex> lock(shard.mtx);
+            merged.merge(shard.buckets);
+        }
+    }
+
+  private:
+    struct Shard
+    {
+        std::mutex mtx;
+        PathwayBuckets buckets;
+    };
+
+    // Threads are assigned shards round-robin, the first time they create a checkpoint
+    static size_t shard_index()
+    {
+        static std::atomic<size_t> next_index{ 0 };
+        thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return index;
+    }
+
+    std::array<Shard, shard_count> shards_;
+};
+
+// Key reused by the thread creating a checkpoint, so that looking up an existing pathway does not allocate
+inline PathwayAggrKey*
+pathway_key_buffer()
+{
+    thread_local PathwayAggrKey key;
+    return &key;
+}
+
+} // namespace ddtrace
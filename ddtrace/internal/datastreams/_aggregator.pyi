@@ -0,0 +1,29 @@
+import typing
+
+from .._ddsketch import DDSketch
+
+class DataStreamsAggregator:
+    def add_checkpoint(
+        self,
+        bucket_start_ns: int,
+        edge_tags: typing.Iterable[str],
+        hash_value: int,
+        parent_hash: int,
+        edge_latency_sec: float,
+        full_pathway_latency_sec: float,
+        payload_size: float,
+    ) -> None: ...
+    def track_produce(self, bucket_start_ns: int, topic: str, partition: int, offset: int) -> None: ...
+    def track_commit(self, bucket_start_ns: int, group: str, topic: str, partition: int, offset: int) -> None: ...
+    def flush(self, bucket_size_ns: int) -> typing.List[typing.Dict[str, typing.Any]]: ...
+    def clear(self) -> None: ...
+    def snapshot(
+        self,
+    ) -> typing.Dict[
+        int,
+        typing.Tuple[
+            typing.Dict[typing.Tuple[str, int, int], typing.Tuple[DDSketch, DDSketch, DDSketch]],
+            typing.Dict[typing.Tuple[str, int], int],
+            typing.Dict[typing.Tuple[str, str, int], int],
+        ],
+    ]: ...
@@ -0,0 +1,269 @@
+from cpython.unicode cimport PyUnicode_CheckExact
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint64_t
+from libcpp.pair cimport pair
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
+from ddtrace.internal._ddsketch cimport CDDSketch
+from ddtrace.internal._ddsketch cimport DDSketch
+
+from ddtrace.internal.compat import ensure_text
+
+
+cdef extern from "Python.h":
+    const char* PyUnicode_AsUTF8AndSize(object o, Py_ssize_t* size) except NULL
+
+
+cdef extern from "_aggregator.hpp" namespace "ddtrace":
+    cdef cppclass PathwayAggrKey:
+        string edge_tags
+        uint64_t hash
+        uint64_t parent_hash
+
+    cdef cppclass PartitionKey:
+        string topic
+        int64_t partition
+
+    cdef cppclass ConsumerPartitionKey:
+        string group
+        string topic
+        int64_t partition
+
+    cdef cppclass PathwayStats:
+        CDDSketch full_pathway_latency
+        CDDSketch edge_latency
+        CDDSketch payload_size
+
+    cdef cppclass PathwayBucket:
+        int64_t start_ns() const
+        const vector[pair[PathwayAggrKey, PathwayStats]]& pathway_stats() const
+        const vector[pair[PartitionKey, int64_t]]& produce_offsets() const
+        const vector[pair[ConsumerPartitionKey, int64_t]]& commit_offsets() const
+
+    cdef cppclass PathwayBuckets:
+        bint empty() const
+        size_t size() const
+        const PathwayBucket& at(size_t index) const
+
+    cdef cppclass CDataStreamsAggregator "ddtrace::DataStreamsAggregator":
+        void add_checkpoint(
+            int64_t bucket_start_ns,
+            const PathwayAggrKey& key,
+            double edge_latency_sec,
+            double full_pathway_latency_sec,
+            double payload_size,
+        ) except +
+        void track_produce(int64_t bucket_start_ns, const PartitionKey& key, int64_t offset) except +
+        void track_commit(int64_t bucket_start_ns, const ConsumerPartitionKey& key, int64_t offset) except +
+        void take(vector[PathwayBuckets]& taken) except +
+        void copy(PathwayBuckets& merged) except +
+
+    void merge_pathway_buckets "ddtrace::DataStreamsAggregator::merge"(
+        vector[PathwayBuckets]& taken, PathwayBuckets& merged
+    ) except + nogil
+
+    PathwayAggrKey* pathway_key_buffer()
+
+
+cdef inline object _text(object value):
+    if PyUnicode_CheckExact(value):
+        return value
+    if isinstance(value, bytes):
+        return ensure_text(value)
+    return str(value)
+
+
+cdef inline void _append(string& out, object value) except *:
+    cdef Py_ssize_t size
+    # The text is kept referenced while its buffer is copied
+    cdef str text = _text(value)
+    cdef const char* data = PyUnicode_AsUTF8AndSize(text, &size)
+    out.append(data, size)
+
+
+cdef inline str _str(const string& value):
+    return value.decode("utf-8", "replace")
+
+
+cdef inline DDSketch _sketch(const CDDSketch& sketch):
+    cdef DDSketch copy = DDSketch()
+    copy._sketch = sketch
+    return copy
+
+
+cdef class DataStreamsAggregator:
+    """Aggregate Data Streams Monitoring checkpoints and Kafka offsets, by time bucket."""
+
+    cdef CDataStreamsAggregator _aggregator
+
+    def add_checkpoint(
+        self,
+        int64_t bucket_start_ns,
+        edge_tags,
+        uint64_t hash_value,
+        uint64_t parent_hash,
+        double edge_latency_sec,
+        double full_pathway_latency_sec,
+        double payload_size,
+    ):
+        # type: (int, typing.Iterable[str], int, int, float, float, float) -> None
+        cdef PathwayAggrKey* key = pathway_key_buffer()
+        cdef bint first = True
+        key.edge_tags.clear()
+        for tag in edge_tags:
+            if not first:
+                key.edge_tags.push_back(c",")
+            _append(key.edge_tags, tag)
+            first = False
+        key.hash = hash_value
+        key.parent_hash = parent_hash
+        self._aggregator.add_checkpoint(
+            bucket_start_ns, key[0], edge_latency_sec, full_pathway_latency_sec, payload_size
+        )
+
+    def track_produce(self, int64_t bucket_start_ns, topic, int64_t partition, int64_t offset):
+        # type: (int, str, int, int) -> None
+        cdef PartitionKey key
+        _append(key.topic, topic)
+        key.partition = partition
+        self._aggregator.track_produce(bucket_start_ns, key, offset)
+
+    def track_commit(self, int64_t bucket_start_ns, group, topic, int64_t partition, int64_t offset):
+        # type: (int, str, str, int, int) -> None
+        cdef ConsumerPartitionKey key
+        _append(key.group, group)
+        _append(key.topic, topic)
+        key.partition = partition
+        self._aggregator.track_commit(bucket_start_ns, key, offset)
+
+    def flush(self, int64_t bucket_size_ns):
+        # type: (int) -> typing.List[typing.Dict]
+        """Return the serialized buckets of everything added so far, which is cleared.
+
+        The shards are only locked while they are swapped out, so producers are not held up by the serialization.
+        """
+        cdef vector[PathwayBuckets] taken
+        cdef PathwayBuckets merged
+        cdef const PathwayBucket* bucket
+        cdef const pair[PathwayAggrKey, PathwayStats]* entry
+        cdef const pair[PartitionKey, int64_t]* produce
+        cdef const pair[ConsumerPartitionKey, int64_t]* commit
+        cdef string buf
+        cdef size_t i, j
+
+        self._aggregator.take(taken)
+        if taken.empty():
+            return []
+
+        with nogil:
+            merge_pathway_buckets(taken, merged)
+
+        serialized_buckets = []
+        for i in range(merged.size()):
+            bucket = &merged.at(i)
+
+            stats = []
+            for j in range(bucket.pathway_stats().size()):
+                entry = &bucket.pathway_stats()[j]
+                buf.clear()
+                entry.second.full_pathway_latency.to_proto(buf)
+                pathway_latency = buf
+                buf.clear()
+                entry.second.edge_latency.to_proto(buf)
+                edge_latency = buf
+                stats.append(
+                    {
+                        "EdgeTags": _str(entry.first.edge_tags).split(","),
+                        "Hash": entry.first.hash,
+                        "ParentHash": entry.first.parent_hash,
+                        "PathwayLatency": pathway_latency,
+                        "EdgeLatency": edge_latency,
+                    }
+                )
+
+            backlogs = []
+            for j in range(bucket.commit_offsets().size()):
+                commit = &bucket.commit_offsets()[j]
+                backlogs.append(
+                    {
+                        "Tags": [
+                            "type:kafka_commit",
+                            "consumer_group:" + _str(commit.first.group),
+                            "topic:" + _str(commit.first.topic),
+                            "partition:" + str(commit.first.partition),
+                        ],
+                        "Value": commit.second,
+                    }
+                )
+            for j in range(bucket.produce_offsets().size()):
+                produce = &bucket.produce_offsets()[j]
+                backlogs.append(
+                    {
+                        "Tags": [
+                            "type:kafka_produce",
+                            "topic:" + _str(produce.first.topic),
+                            "partition:" + str(produce.first.partition),
+                        ],
+                        "Value": produce.second,
+                    }
+                )
+
+            serialized_buckets.append(
+                {
+                    "Start": bucket.start_ns(),
+                    "Duration": bucket_size_ns,
+                    "Stats": stats,
+                    "Backlogs": backlogs,
+                }
+            )
+        return serialized_buckets
+
+    def clear(self):
+        # type: () -> None
+        """Discard everything added so far."""
+        cdef vector[PathwayBuckets] taken
+        self._aggregator.take(taken)
+
+    def snapshot(self):
+        # type: () -> typing.Dict[int, typing.Tuple[typing.Dict, typing.Dict, typing.Dict]]
+        """Return a copy of everything added so far, by bucket start time.
+
+        Each bucket is a tuple of the pathway sketches (full pathway latency, edge latency and payload size) by
+        (edge tags, hash, parent hash), of the latest produce offsets by (topic, partition), and of the latest commit
+        offsets by (group, topic, partition).
+        """
+        cdef PathwayBuckets merged
+        cdef const PathwayBucket* bucket
+        cdef const pair[PathwayAggrKey, PathwayStats]* entry
+        cdef const pair[PartitionKey, int64_t]* produce
+        cdef const pair[ConsumerPartitionKey, int64_t]* commit
+        cdef size_t i, j
+
+        self._aggregator.copy(merged)
+
+        buckets = {}
+        for i in range(merged.size()):
+            bucket = &merged.at(i)
+
+            pathway_stats = {}
+            for j in range(bucket.pathway_stats().size()):
+                entry = &bucket.pathway_stats()[j]
+                pathway_stats[(_str(entry.first.edge_tags), entry.first.hash, entry.first.parent_hash)] = (
+                    _sketch(entry.second.full_pathway_latency),
+                    _sketch(entry.second.edge_latency),
+                    _sketch(entry.second.payload_size),
+                )
+            produce_offsets = {}
+            for j in range(bucket.produce_offsets().size()):
+                produce = &bucket.produce_offsets()[j]
+                produce_offsets[(_str(produce.first.topic), produce.first.partition)] = produce.second
+            commit_offsets = {}
+            for j in range(bucket.commit_offsets().size()):
+                commit = &bucket.commit_offsets()[j]
+                commit_offsets[(_str(commit.first.group), _str(commit.first.topic), commit.first.partition)] = (
+                    commit.second
+                )
+
+            buckets[bucket.start_ns()] = (pathway_stats, produce_offsets, commit_offsets)
+        return buckets
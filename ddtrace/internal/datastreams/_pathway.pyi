@@ -0,0 +1,10 @@
+import typing
+
+def fnv1_64(data: bytes) -> int: ...
+def compute_pathway_hash(service: str, env: str, tags: typing.Iterable[str], parent_hash: int) -> int: ...
+def encode_var_uint_64(v: int) -> bytes: ...
+def decode_var_uint_64(b: bytes) -> typing.Tuple[int, bytes]: ...
+def encode_var_int_64(v: int) -> bytes: ...
+def decode_var_int_64(b: bytes) -> typing.Tuple[int, bytes]: ...
+def encode_pathway(hash_value: int, pathway_start_ms: int, current_edge_start_ms: int) -> bytes: ...
+def decode_pathway(data: bytes) -> typing.Tuple[int, int, int]: ...
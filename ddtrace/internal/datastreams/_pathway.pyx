@@ -0,0 +1,178 @@
+"""
+Native implementations of the hashing and encoding of Data Streams Monitoring pathways.
+
+Hashes use the Fowler/Noll/Vo FNV-1 64 bits algorithm (see http://isthe.com/chongo/tech/comp/fnv/). Pathways are
+encoded as the little-endian 64 bits hash of the pathway, followed by the zig-zag varint encoded start times of the
+pathway and of the current edge, in milliseconds.
+"""
+cimport cython
+from cpython.bytes cimport PyBytes_FromStringAndSize
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint8_t
+from libc.stdint cimport uint64_t
+
+
+cdef extern from "Python.h":
+    const char* PyUnicode_AsUTF8AndSize(object o, Py_ssize_t* size) except NULL
+
+
+cdef uint64_t FNV_64_PRIME = 0x100000001B3
+cdef uint64_t FNV1_64_INIT = 0xCBF29CE484222325
+
+# Varints are decoded from at most this many bytes, the last of which holds 8 bits. Encoding a varint can take one
+# more byte.
+cdef int MAX_VAR_LEN_64 = 9
+
+
+cdef inline uint64_t _fnv1_64_update(uint64_t hval, const uint8_t* data, Py_ssize_t size) nogil:
+    cdef Py_ssize_t i
+    for i in range(size):
+        hval = hval * FNV_64_PRIME
+        hval = hval ^ data[i]
+    return hval
+
+
+cdef inline uint64_t _fnv1_64_update_uint64(uint64_t hval, uint64_t value) nogil:
+    # Hash the little-endian representation of value, as struct.pack("<Q", value) would produce it
+    cdef int i
+    for i in range(8):
+        hval = hval * FNV_64_PRIME
+        hval = hval ^ ((value >> (8 * i)) & 0xFF)
+    return hval
+
+
+cdef inline uint64_t _fnv1_64_update_str(uint64_t hval, str value) except? 0:
+    cdef Py_ssize_t size
+    cdef const char* data = PyUnicode_AsUTF8AndSize(value, &size)
+    return _fnv1_64_update(hval, <const uint8_t*>data, size)
+
+
+def fnv1_64(const uint8_t[:] data):
+    # type: (bytes) -> int
+    """Returns the 64 bit FNV-1 hash value for the given data."""
+    if data.shape[0] == 0:
+        return FNV1_64_INIT
+    return _fnv1_64_update(FNV1_64_INIT, &data[0], data.shape[0])
+
+
+def compute_pathway_hash(str service, str env, tags, uint64_t parent_hash):
+    # type: (str, str, typing.Iterable[str], int) -> int
+    """Return the hash of a checkpoint, given the tags of the edge leading to it and the hash of its parent.
+
+    This is the FNV-1 64 hash of the little-endian hash of the node (the concatenation of service, env and tags) and
+    of the parent hash, computed without building the intermediate byte strings.
+    """
+    cdef uint64_t node_hash = _fnv1_64_update_str(FNV1_64_INIT, service)
+    node_hash = _fnv1_64_update_str(node_hash, env)
+    for tag in tags:
+        node_hash = _fnv1_64_update_str(node_hash, tag)
+
+    cdef uint64_t hval = _fnv1_64_update_uint64(FNV1_64_INIT, node_hash)
+    return _fnv1_64_update_uint64(hval, parent_hash)
+
+
+cdef inline int _encode_var_uint_64(uint64_t v, uint8_t* out) nogil:
+    cdef int n = 0
+    cdef int i
+    for i in range(MAX_VAR_LEN_64):
+        if v < 0x80:
+            break
+        out[n] = (v & 0xFF) | 0x80
+        n += 1
+        v >>= 7
+    out[n] = v & 0xFF
+    return n + 1
+
+
+cdef inline uint64_t _zig_zag(int64_t v) nogil:
+    return (<uint64_t>v << 1) ^ <uint64_t>(v >> 63)
+
+
+cdef inline int64_t _unzig_zag(uint64_t v) nogil:
+    return <int64_t>(v >> 1) ^ -<int64_t>(v & 1)
+
+
+# Decode a varint from data[*offset:], and advance offset past it. Returns -1 if the data is truncated.
+@cython.boundscheck(False)
+cdef inline int _decode_var_uint_64(const uint8_t[:] data, Py_ssize_t* offset, uint64_t* value) nogil:
+    cdef uint64_t x = 0
+    cdef int s = 0
+    cdef int i
+    cdef uint64_t n
+    for i in range(MAX_VAR_LEN_64):
+        if offset[0] + i >= data.shape[0]:
+            return -1
+        n = data[offset[0] + i]
+        if n < 0x80 or i == MAX_VAR_LEN_64 - 1:
+            value[0] = x | n << s
+            offset[0] += i + 1
+            return 0
+        x |= (n & 0x7F) << s
+        s += 7
+    return -1
+
+
+def encode_var_uint_64(uint64_t v):
+    # type: (int) -> bytes
+    cdef uint8_t buf[10]
+    cdef int n = _encode_var_uint_64(v, buf)
+    return PyBytes_FromStringAndSize(<char*>buf, n)
+
+
+def decode_var_uint_64(const uint8_t[:] b):
+    # type: (bytes) -> typing.Tuple[int, bytes]
+    cdef Py_ssize_t offset = 0
+    cdef uint64_t v
+    if _decode_var_uint_64(b, &offset, &v) < 0:
+        raise EOFError()
+    return v, bytes(b[offset:])
+
+
+def encode_var_int_64(int64_t v):
+    # type: (int) -> bytes
+    return encode_var_uint_64(_zig_zag(v))
+
+
+def decode_var_int_64(const uint8_t[:] b):
+    # type: (bytes) -> typing.Tuple[int, bytes]
+    cdef Py_ssize_t offset = 0
+    cdef uint64_t v
+    if _decode_var_uint_64(b, &offset, &v) < 0:
+        raise EOFError()
+    return _unzig_zag(v), bytes(b[offset:])
+
+
+def encode_pathway(uint64_t hash_value, int64_t pathway_start_ms, int64_t current_edge_start_ms):
+    # type: (int, int, int) -> bytes
+    """Encode a pathway context, for propagation."""
+    # The hash, and two varints
+    cdef uint8_t buf[8 + 2 * 10]
+    cdef int n = 8
+    cdef int i
+    for i in range(8):
+        buf[i] = (hash_value >> (8 * i)) & 0xFF
+    n += _encode_var_uint_64(_zig_zag(pathway_start_ms), &buf[n])
+    n += _encode_var_uint_64(_zig_zag(current_edge_start_ms), &buf[n])
+    return PyBytes_FromStringAndSize(<char*>buf, n)
+
+
+def decode_pathway(const uint8_t[:] data):
+    # type: (bytes) -> typing.Tuple[int, int, int]
+    """Decode a pathway context into its hash, and the start times of the pathway and current edge in milliseconds.
+
+    Raises EOFError if the data is truncated.
+    """
+    cdef uint64_t hash_value = 0
+    cdef uint64_t pathway_start
+    cdef uint64_t current_edge_start
+    cdef Py_ssize_t offset = 8
+    cdef int i
+    if data.shape[0] < 8:
+        raise EOFError()
+    for i in range(8):
+        hash_value |= (<uint64_t>data[i]) << (8 * i)
+    if _decode_var_uint_64(data, &offset, &pathway_start) < 0:
+        raise EOFError()
+    if _decode_var_uint_64(data, &offset, &current_edge_start) < 0:
+        raise EOFError()
+    return hash_value, _unzig_zag(pathway_start), _unzig_zag(current_edge_start)
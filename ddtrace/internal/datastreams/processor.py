@@ -1,23 +1,18 @@
 # coding: utf-8
 import base64
-from collections import defaultdict
 from functools import partial
 import gzip
 import os
-import struct
 import threading
 import time
 import typing
-from typing import DefaultDict  # noqa:F401
 from typing import Dict  # noqa:F401
+from typing import Iterator  # noqa:F401
 from typing import List  # noqa:F401
 from typing import NamedTuple  # noqa:F401
 from typing import Optional  # noqa:F401
 from typing import Union  # noqa:F401
 
-from ddsketch import LogCollapsingLowestDenseDDSketch
-from ddsketch.pb.proto import DDSketchProto
-
 import ddtrace
 from ddtrace import config
 from ddtrace.internal import compat
@@ -25,6 +20,7 @@ from ddtrace.internal.atexit import register_on_exit_signal
 from ddtrace.internal.constants import DEFAULT_SERVICE_NAME
 from ddtrace.internal.utils.retry import fibonacci_backoff_with_jitter
 
+from .._ddsketch import DDSketch  # noqa:F401
 from .._encoding import packb
 from ..agent import get_connection
 from ..compat import get_connection_response
@@ -33,9 +29,10 @@ from ..hostname import get_hostname
 from ..logger import get_logger
 from ..periodic import PeriodicService
 from ..writer import _human_size
-from .encoding import decode_var_int_64
-from .encoding import encode_var_int_64
-from .fnv import fnv1_64
+from ._aggregator import DataStreamsAggregator
+from ._pathway import compute_pathway_hash
+from ._pathway import decode_pathway
+from ._pathway import encode_pathway
 
 
 def gzip_compress(payload):
@@ -75,10 +72,11 @@ class PathwayStats(object):
 
     __slots__ = ("full_pathway_latency", "edge_latency", "payload_size")
 
-    def __init__(self):
-        self.full_pathway_latency = LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)
-        self.edge_latency = LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)
-        self.payload_size = LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)
+    def __init__(self, full_pathway_latency, edge_latency, payload_size):
+        # type: (DDSketch, DDSketch, DDSketch) -> None
+        self.full_pathway_latency = full_pathway_latency
+        self.edge_latency = edge_latency
+        self.payload_size = payload_size
 
 
 PartitionKey = NamedTuple("PartitionKey", [("topic", str), ("partition", int)])
@@ -86,13 +84,52 @@ ConsumerPartitionKey = NamedTuple("ConsumerPartitionKey", [("group", str), ("top
 Bucket = NamedTuple(
     "Bucket",
     [
-        ("pathway_stats", DefaultDict[PathwayAggrKey, PathwayStats]),
-        ("latest_produce_offsets", DefaultDict[PartitionKey, int]),
-        ("latest_commit_offsets", DefaultDict[ConsumerPartitionKey, int]),
+        ("pathway_stats", Dict[PathwayAggrKey, PathwayStats]),
+        ("latest_produce_offsets", Dict[PartitionKey, int]),
+        ("latest_commit_offsets", Dict[ConsumerPartitionKey, int]),
     ],
 )
 
 
+class BucketsView(typing.Mapping[int, Bucket]):
+    """View of the buckets aggregated so far, by bucket start time.
+
+    Every access copies the aggregated stats, so this is only meant for debugging and tests.
+    """
+
+    def __init__(self, aggregator):
+        # type: (DataStreamsAggregator) -> None
+        self._aggregator = aggregator
+
+    def _snapshot(self):
+        # type: () -> Dict[int, Bucket]
+        return {
+            bucket_time_ns: Bucket(
+                {key: PathwayStats(*sketches) for key, sketches in pathway_stats.items()},
+                {PartitionKey(*key): offset for key, offset in produce_offsets.items()},
+                {ConsumerPartitionKey(*key): offset for key, offset in commit_offsets.items()},
+            )
+            for bucket_time_ns, (pathway_stats, produce_offsets, commit_offsets) in self._aggregator.snapshot().items()
+        }
+
+    def __getitem__(self, bucket_time_ns):
+        # type: (int) -> Bucket
+        return self._snapshot()[bucket_time_ns]
+
+    def __iter__(self):
+        # type: () -> Iterator[int]
+        return iter(self._snapshot())
+
+    def __len__(self):
+        # type: () -> int
+        return len(self._aggregator.snapshot())
+
+    def clear(self):
+        # type: () -> None
+        """Discard the buckets aggregated so far."""
+        self._aggregator.clear()
+
+
 class DataStreamsProcessor(PeriodicService):
     """DataStreamsProcessor for computing, collecting and submitting data stream stats to the Datadog Agent."""
 
@@ -107,9 +144,9 @@ class DataStreamsProcessor(PeriodicService):
         self._timeout = timeout
         # Have the bucket size match the interval in which flushes occur.
         self._bucket_size_ns = int(interval * 1e9)  # type: int
-        self._buckets = defaultdict(
-            lambda: Bucket(defaultdict(PathwayStats), defaultdict(int), defaultdict(int))
-        )  # type: DefaultDict[int, Bucket]
+        # Producers only lock the shard of their own thread, so they never wait on each other or on the flush
+        self._aggregator = DataStreamsAggregator()
+        self._buckets = BucketsView(self._aggregator)
         self._headers = {
             "Datadog-Meta-Lang": "python",
             "Datadog-Meta-Tracer-Version": ddtrace.__version__,
@@ -153,92 +190,26 @@ class DataStreamsProcessor(PeriodicService):
             return
 
         now_ns = int(now_sec * 1e9)
-
-        with self._lock:
-            # Align the span into the corresponding stats bucket
-            bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
-            aggr_key = (",".join(edge_tags), hash_value, parent_hash)
-            stats = self._buckets[bucket_time_ns].pathway_stats[aggr_key]
-            stats.full_pathway_latency.add(full_pathway_latency_sec)
-            stats.edge_latency.add(edge_latency_sec)
-            stats.payload_size.add(payload_size)
-            self._buckets[bucket_time_ns].pathway_stats[aggr_key] = stats
+        # Align the checkpoint into the corresponding stats bucket
+        bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
+        self._aggregator.add_checkpoint(
+            bucket_time_ns, edge_tags, hash_value, parent_hash, edge_latency_sec, full_pathway_latency_sec, payload_size
+        )
 
     def track_kafka_produce(self, topic, partition, offset, now_sec):
         now_ns = int(now_sec * 1e9)
-        key = PartitionKey(topic, partition)
-        with self._lock:
-            bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
-            self._buckets[bucket_time_ns].latest_produce_offsets[key] = max(
-                offset, self._buckets[bucket_time_ns].latest_produce_offsets[key]
-            )
+        bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
+        self._aggregator.track_produce(bucket_time_ns, topic, partition, offset)
 
     def track_kafka_commit(self, group, topic, partition, offset, now_sec):
         now_ns = int(now_sec * 1e9)
-        key = ConsumerPartitionKey(group, topic, partition)
-        with self._lock:
-            bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
-            self._buckets[bucket_time_ns].latest_commit_offsets[key] = max(
-                offset, self._buckets[bucket_time_ns].latest_commit_offsets[key]
-            )
+        bucket_time_ns = now_ns - (now_ns % self._bucket_size_ns)
+        self._aggregator.track_commit(bucket_time_ns, group, topic, partition, offset)
 
     def _serialize_buckets(self):
         # type: () -> List[Dict]
-        """Serialize and update the buckets."""
-        serialized_buckets = []
-        serialized_bucket_keys = []
-        for bucket_time_ns, bucket in self._buckets.items():
-            bucket_aggr_stats = []
-            backlogs = []
-            serialized_bucket_keys.append(bucket_time_ns)
-
-            for aggr_key, stat_aggr in bucket.pathway_stats.items():
-                edge_tags, hash_value, parent_hash = aggr_key
-                serialized_bucket = {
-                    "EdgeTags": [compat.ensure_text(tag) for tag in edge_tags.split(",")],
-                    "Hash": hash_value,
-                    "ParentHash": parent_hash,
-                    "PathwayLatency": DDSketchProto.to_proto(stat_aggr.full_pathway_latency).SerializeToString(),
-                    "EdgeLatency": DDSketchProto.to_proto(stat_aggr.edge_latency).SerializeToString(),
-                }
-                bucket_aggr_stats.append(serialized_bucket)
-            for consumer_key, offset in bucket.latest_commit_offsets.items():
-                backlogs.append(
-                    {
-                        "Tags": [
-                            "type:kafka_commit",
-                            "consumer_group:" + consumer_key.group,
-                            "topic:" + consumer_key.topic,
-                            "partition:" + str(consumer_key.partition),
-                        ],
-                        "Value": offset,
-                    }
-                )
-            for producer_key, offset in bucket.latest_produce_offsets.items():
-                backlogs.append(
-                    {
-                        "Tags": [
-                            "type:kafka_produce",
-                            "topic:" + producer_key.topic,
-                            "partition:" + str(producer_key.partition),
-                        ],
-                        "Value": offset,
-                    }
-                )
-            serialized_buckets.append(
-                {
-                    "Start": bucket_time_ns,
-                    "Duration": self._bucket_size_ns,
-                    "Stats": bucket_aggr_stats,
-                    "Backlogs": backlogs,
-                }
-            )
-
-        # Clear out buckets that have been serialized
-        for key in serialized_bucket_keys:
-            del self._buckets[key]
-
-        return serialized_buckets
+        """Serialize and clear the buckets."""
+        return self._aggregator.flush(self._bucket_size_ns)
 
     def _flush_stats(self, payload):
         # type: (bytes) -> None
@@ -304,10 +275,7 @@ class DataStreamsProcessor(PeriodicService):
     def decode_pathway(self, data):
         # type: (bytes) -> DataStreamsCtx
         try:
-            hash_value = struct.unpack("<Q", data[:8])[0]
-            data = data[8:]
-            pathway_start_ms, data = decode_var_int_64(data)
-            current_edge_start_ms, data = decode_var_int_64(data)
+            hash_value, pathway_start_ms, current_edge_start_ms = decode_pathway(data)
             ctx = DataStreamsCtx(self, hash_value, float(pathway_start_ms) / 1e3, float(current_edge_start_ms) / 1e3)
             # reset context of current thread every time we decode
             self._current_context.value = ctx
@@ -380,11 +348,7 @@ class DataStreamsCtx:
 
     def encode(self):
         # type: () -> bytes
-        return (
-            struct.pack("<Q", self.hash)
-            + encode_var_int_64(int(self.pathway_start_sec * 1e3))
-            + encode_var_int_64(int(self.current_edge_start_sec * 1e3))
-        )
+        return encode_pathway(self.hash, int(self.pathway_start_sec * 1e3), int(self.current_edge_start_sec * 1e3))
 
     def encode_b64(self):
         # type: () -> str
@@ -394,14 +358,7 @@ class DataStreamsCtx:
         return data_streams_context
 
     def _compute_hash(self, tags, parent_hash):
-        def get_bytes(s):
-            return bytes(s, encoding="utf-8")
-
-        b = get_bytes(self.service) + get_bytes(self.env)
-        for t in tags:
-            b += get_bytes(t)
-        node_hash = fnv1_64(b)
-        return fnv1_64(struct.pack("<Q", node_hash) + struct.pack("<Q", parent_hash))
+        return compute_pathway_hash(self.service, self.env, tags, parent_hash)
 
     def set_checkpoint(
         self,
@@ -593,7 +593,7 @@ msgpack_pack_double(msgpack_packer* x, double d)
 #if PY_VERSION_HEX <= 0x030B0000
     _PyFloat_Pack8(d, &buf[1], 0);
 #else
-    PyFloat_Pack8(d, &buf[1], 0);
+    PyFloat_Pack8(d, (char*)&buf[1], 0);
 #endif
     msgpack_pack_append_buffer(x, buf, 9);
 }
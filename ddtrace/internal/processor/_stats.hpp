@@ -0,0 +1,350 @@
+#pragma once
+
+#include <Python.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "_ddsketch.hpp"
+#include "pack.h"
+
+// Aggregation of span stats for the client-side stats computation.
+//
+// Each thread accumulates its spans in its own shard, so that concurrent span finishes do not contend on a single
+// table; shards are merged into one list of buckets when stats are flushed. Shards are locked only for short sections
+// that never release the GIL, so a fork can never happen while one is held.
+
+namespace ddtrace {
+
+template<typename String>
+struct BasicSpanAggrKey
+{
+    String name;
+    String service;
+    String resource;
+    String type;
+    int64_t http_status_code = 0;
+    bool synthetics = false;
+};
+
+// Keys are looked up with views of the span attributes, and only copied when they are first inserted
+using SpanAggrKey = BasicSpanAggrKey<std::string>;
+using SpanAggrKeyView = BasicSpanAggrKey<std::string_view>;
+
+struct SpanAggrKeyViewHash
+{
+    static void combine(size_t& seed, size_t hash) { seed ^= hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); }
+
+    size_t operator()(const SpanAggrKeyView& key) const
+    {
+        const std::hash<std::string_view> hash_string;
+        size_t seed = hash_string(key.name);
+        combine(seed, hash_string(key.service));
+        combine(seed, hash_string(key.resource));
+        combine(seed, hash_string(key.type));
+        combine(seed, std::hash<int64_t>{}(key.http_status_code));
+        combine(seed, static_cast<size_t>(key.synthetics));
+        return seed;
+    }
+};
+
+struct SpanAggrKeyViewEqual
+{
+    bool operator()(const SpanAggrKeyView& a, const SpanAggrKeyView& b) const
+    {
+        return a.http_status_code == b.http_status_code && a.synthetics == b.synthetics && a.name == b.name &&
+               a.service == b.service && a.resource == b.resource && a.type == b.type;
+    }
+};
+
+struct SpanAggrStats
+{
+    uint64_t hits = 0;
+    uint64_t top_level_hits = 0;
+    uint64_t errors = 0;
+    int64_t duration = 0;
+    DDSketch ok_distribution;
+    DDSketch err_distribution;
+
+    void merge(const SpanAggrStats& other)
+    {
+        hits += other.hits;
+        top_level_hits += other.top_level_hits;
+        errors += other.errors;
+        duration += other.duration;
+        ok_distribution.merge(other.ok_distribution);
+        err_distribution.merge(other.err_distribution);
+    }
+};
+
+// Aggregated stats of the spans which ended in a time bucket, in the order in which their keys were first seen
+class StatsBucket
+{
+  public:
+    explicit StatsBucket(int64_t start_ns)
+      : start_ns_(start_ns)
+    {
+    }
+
+    StatsBucket(const StatsBucket&) = delete;
+    StatsBucket& operator=(const StatsBucket&) = delete;
+
+    SpanAggrStats& get(const SpanAggrKeyView& key)
+    {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            return entries_[it->second].second;
+        }
+
+        // The deque never moves its elements, so the index can refer to the strings of the keys it holds
+        entries_.emplace_back(
+          SpanAggrKey{
+            std::string(key.name),
+            std::string(key.service),
+            std::string(key.resource),
+            std::string(key.type),
+            key.http_status_code,
+            key.synthetics,
+          },
+          SpanAggrStats{});
+        const SpanAggrKey& owned = entries_.back().first;
+        index_.emplace(
+          SpanAggrKeyView{ owned.name, owned.service, owned.resource, owned.type, owned.http_status_code, owned.synthetics },
+          entries_.size() - 1);
+        return entries_.back().second;
+    }
+
+    void merge(const StatsBucket& other)
+    {
+        for (const auto& [key, stats] : other.entries_) {
+            get(SpanAggrKeyView{ key.name, key.service, key.resource, key.type, key.http_status_code, key.synthetics })
+              .merge(stats);
+        }
+    }
+
+    int64_t start_ns() const { return start_ns_; }
+    const std::deque<std::pair<SpanAggrKey, SpanAggrStats>>& entries() const { return entries_; }
+
+  private:
+    int64_t start_ns_;
+    std::deque<std::pair<SpanAggrKey, SpanAggrStats>> entries_;
+    std::unordered_map<SpanAggrKeyView, size_t, SpanAggrKeyViewHash, SpanAggrKeyViewEqual> index_;
+};
+
+// Buckets in the order in which they were first seen
+class StatsBuckets
+{
+  public:
+    StatsBucket& get(int64_t start_ns)
+    {
+        // Spans mostly end in the latest bucket
+        for (auto it = buckets_.rbegin(); it != buckets_.rend(); ++it) {
+            if ((*it)->start_ns() == start_ns) {
+                return **it;
+            }
+        }
+        buckets_.push_back(std::make_unique<StatsBucket>(start_ns));
+        return *buckets_.back();
+    }
+
+    void merge(const StatsBuckets& other)
+    {
+        for (const auto& bucket : other.buckets_) {
+            get(bucket->start_ns()).merge(*bucket);
+        }
+    }
+
+    bool empty() const { return buckets_.empty(); }
+    void swap(StatsBuckets& other) { buckets_.swap(other.buckets_); }
+    const std::vector<std::unique_ptr<StatsBucket>>& buckets() const { return buckets_; }
+
+  private:
+    std::vector<std::unique_ptr<StatsBucket>> buckets_;
+};
+
+class SpanStatsAggregator
+{
+  public:
+    static constexpr size_t shard_count = 16;
+
+    void add(int64_t bucket_start_ns,
+             const SpanAggrKeyView& key,
+             int64_t duration_ns,
+             bool is_top_level,
+             bool is_error)
+    {
+        Shard& shard = shards_[shard_index()];
+        const std::lock_guard<std::mutex> lock(shard.mtx);
+
+        SpanAggrStats& stats = shard.buckets.get(bucket_start_ns).get(key);
+        stats.hits += 1;
+        stats.duration += duration_ns;
+        if (is_top_level) {
+            stats.top_level_hits += 1;
+        }
+        if (is_error) {
+            stats.errors += 1;
+            stats.err_distribution.add(static_cast<double>(duration_ns));
+        } else {
+            stats.ok_distribution.add(static_cast<double>(duration_ns));
+        }
+    }
+
+    // Take everything accumulated so far out of the shards; merge() then combines them into a single list of buckets
+    void take(std::vector<StatsBuckets>& taken)
+    {
+        for (Shard& shard : shards_) {
+            const std::lock_guard<std::mutex> lock(shard.mtx);
+            if (!shard.buckets.empty()) {
+                taken.emplace_back();
+                taken.back().swap(shard.buckets);
+            }
+        }
+    }
+
+    // Does not touch the shards, so this can run without the GIL
+    static void merge(std::vector<StatsBuckets>& taken, StatsBuckets& merged)
+    {
+        for (StatsBuckets& buckets : taken) {
+            if (merged.empty()) {
+                merged.swap(buckets);
+            } else {
+                merged.merge(buckets);
+            }
+        }
+        taken.clear();
+    }
+
+  private:
+    struct Shard
+    {
+        std::mutex mtx;
+        StatsBuckets buckets;
+    };
+
+    // Threads are assigned shards round-robin, the first time they finish a span
+    static size_t shard_index()
+    {
+        static std::atomic<size_t> next_index{ 0 };
+        thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return index;
+    }
+
+    std::array<Shard, shard_count> shards_;
+};
+
+// Values of the stats payload, all of which must outlive the call to pack_stats_payload
+struct StatsPayloadInfo
+{
+    std::string_view hostname;
+    std::string_view env;
+    std::string_view version;
+    int64_t bucket_size_ns;
+};
+
+// The payload is packed the way packb() packs the equivalent dict: non-positive integers are signed, and the keys of
+// each map are written in the same order.
+inline int
+pack_stats_int(msgpack_packer* pk, int64_t value)
+{
+    if (value > 0) {
+        return msgpack_pack_unsigned_long_long(pk, static_cast<unsigned long long>(value));
+    }
+    return msgpack_pack_long_long(pk, value);
+}
+
+inline int
+pack_stats_str(msgpack_packer* pk, std::string_view value)
+{
+    if (msgpack_pack_raw(pk, value.size()) != 0) {
+        return -1;
+    }
+    return msgpack_pack_raw_body(pk, value.data(), value.size());
+}
+
+inline int
+pack_stats_sketch(msgpack_packer* pk, const DDSketch& sketch, std::string& buf)
+{
+    buf.clear();
+    sketch.to_proto(buf);
+    if (msgpack_pack_bin(pk, buf.size()) != 0) {
+        return -1;
+    }
+    return msgpack_pack_raw_body(pk, buf.data(), buf.size());
+}
+
+inline int
+pack_stats_entry(msgpack_packer* pk, const SpanAggrKey& key, const SpanAggrStats& stats, std::string& buf)
+{
+    const size_t size = 10 + (key.service.empty() ? 0 : 1) + (key.type.empty() ? 0 : 1);
+    if (msgpack_pack_map(pk, size) != 0 || pack_stats_str(pk, "Name") != 0 || pack_stats_str(pk, key.name) != 0 ||
+        pack_stats_str(pk, "Resource") != 0 || pack_stats_str(pk, key.resource) != 0 ||
+        pack_stats_str(pk, "Synthetics") != 0 ||
+        (key.synthetics ? msgpack_pack_true(pk) : msgpack_pack_false(pk)) != 0 ||
+        pack_stats_str(pk, "HTTPStatusCode") != 0 || pack_stats_int(pk, key.http_status_code) != 0 ||
+        pack_stats_str(pk, "Hits") != 0 || pack_stats_int(pk, static_cast<int64_t>(stats.hits)) != 0 ||
+        pack_stats_str(pk, "TopLevelHits") != 0 || pack_stats_int(pk, static_cast<int64_t>(stats.top_level_hits)) != 0 ||
+        pack_stats_str(pk, "Duration") != 0 || pack_stats_int(pk, stats.duration) != 0 ||
+        pack_stats_str(pk, "Errors") != 0 || pack_stats_int(pk, static_cast<int64_t>(stats.errors)) != 0 ||
+        pack_stats_str(pk, "OkSummary") != 0 || pack_stats_sketch(pk, stats.ok_distribution, buf) != 0 ||
+        pack_stats_str(pk, "ErrorSummary") != 0 || pack_stats_sketch(pk, stats.err_distribution, buf) != 0) {
+        return -1;
+    }
+    if (!key.service.empty() && (pack_stats_str(pk, "Service") != 0 || pack_stats_str(pk, key.service) != 0)) {
+        return -1;
+    }
+    if (!key.type.empty() && (pack_stats_str(pk, "Type") != 0 || pack_stats_str(pk, key.type) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+// Pack the whole stats payload. Must be called with the GIL held, as the packer allocates with PyMem_Realloc.
+inline int
+pack_stats_payload(msgpack_packer* pk, const StatsBuckets& buckets, const StatsPayloadInfo& info)
+{
+    const size_t size = 2 + (info.env.empty() ? 0 : 1) + (info.version.empty() ? 0 : 1);
+    if (msgpack_pack_map(pk, size) != 0 || pack_stats_str(pk, "Stats") != 0 ||
+        msgpack_pack_array(pk, buckets.buckets().size()) != 0) {
+        return -1;
+    }
+
+    std::string buf;
+    for (const auto& bucket : buckets.buckets()) {
+        if (msgpack_pack_map(pk, 3) != 0 || pack_stats_str(pk, "Start") != 0 ||
+            pack_stats_int(pk, bucket->start_ns()) != 0 || pack_stats_str(pk, "Duration") != 0 ||
+            pack_stats_int(pk, info.bucket_size_ns) != 0 || pack_stats_str(pk, "Stats") != 0 ||
+            msgpack_pack_array(pk, bucket->entries().size()) != 0) {
+            return -1;
+        }
+        for (const auto& [key, stats] : bucket->entries()) {
+            if (pack_stats_entry(pk, key, stats, buf) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    if (pack_stats_str(pk, "Hostname") != 0 || pack_stats_str(pk, info.hostname) != 0) {
+        return -1;
+    }
+    if (!info.env.empty() && (pack_stats_str(pk, "Env") != 0 || pack_stats_str(pk, info.env) != 0)) {
+        return -1;
+    }
+    if (!info.version.empty() && (pack_stats_str(pk, "Version") != 0 || pack_stats_str(pk, info.version) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+} // namespace ddtrace
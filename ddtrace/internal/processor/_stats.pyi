@@ -0,0 +1,17 @@
+import typing
+
+class SpanStatsAggregator:
+    def add(
+        self,
+        bucket_start_ns: int,
+        name: typing.Union[str, bytes],
+        service: typing.Union[str, bytes],
+        resource: typing.Union[str, bytes],
+        span_type: typing.Union[str, bytes],
+        http_status_code: int,
+        synthetics: bool,
+        duration_ns: int,
+        is_top_level: bool,
+        is_error: bool,
+    ) -> None: ...
+    def flush(self, hostname: str, env: str, version: str, bucket_size_ns: int) -> typing.Optional[bytes]: ...
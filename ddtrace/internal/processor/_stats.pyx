@@ -0,0 +1,153 @@
+from cpython.bytes cimport PyBytes_FromStringAndSize
+from cpython.mem cimport PyMem_Free
+from cpython.mem cimport PyMem_Malloc
+from cpython.unicode cimport PyUnicode_CheckExact
+from libc.stdint cimport int64_t
+from libcpp.vector cimport vector
+
+from ddtrace.internal.compat import ensure_text
+
+
+cdef extern from "Python.h":
+    const char* PyUnicode_AsUTF8AndSize(object o, Py_ssize_t* size) except NULL
+
+
+cdef extern from "<string_view>" namespace "std" nogil:
+    cdef cppclass string_view:
+        string_view()
+        string_view(const char* s, size_t count)
+
+
+cdef extern from "_stats.hpp":
+    # From pack.h, which has no include guard
+    struct msgpack_packer:
+        char* buf
+        size_t length
+        size_t buf_size
+
+
+cdef extern from "_stats.hpp" namespace "ddtrace":
+    cdef cppclass SpanAggrKeyView:
+        string_view name
+        string_view service
+        string_view resource
+        string_view type
+        int64_t http_status_code
+        bint synthetics
+
+    cdef cppclass StatsBuckets:
+        bint empty()
+
+    cdef cppclass CSpanStatsAggregator "ddtrace::SpanStatsAggregator":
+        void add(
+            int64_t bucket_start_ns,
+            const SpanAggrKeyView& key,
+            int64_t duration_ns,
+            bint is_top_level,
+            bint is_error,
+        ) except +
+        void take(vector[StatsBuckets]& taken) except +
+
+    void merge_stats_buckets "ddtrace::SpanStatsAggregator::merge"(
+        vector[StatsBuckets]& taken, StatsBuckets& merged
+    ) except + nogil
+
+    cdef cppclass StatsPayloadInfo:
+        string_view hostname
+        string_view env
+        string_view version
+        int64_t bucket_size_ns
+
+    int pack_stats_payload(msgpack_packer* pk, const StatsBuckets& buckets, const StatsPayloadInfo& info) except +
+
+
+# Initial size of the payload buffer, which grows as needed
+cdef size_t PAYLOAD_BUFFER_SIZE = 64 * 1024
+
+
+cdef inline object _text(object value):
+    if PyUnicode_CheckExact(value):
+        return value
+    if isinstance(value, bytes):
+        return ensure_text(value)
+    return str(value)
+
+
+cdef inline string_view _view(str value):
+    # The UTF-8 representation is cached in the string object, so the view is valid as long as the object is alive
+    cdef Py_ssize_t size
+    cdef const char* data = PyUnicode_AsUTF8AndSize(value, &size)
+    return string_view(data, size)
+
+
+cdef class SpanStatsAggregator:
+    """Aggregate the stats of finished spans, by time bucket and aggregation key."""
+
+    cdef CSpanStatsAggregator _aggregator
+
+    def add(
+        self,
+        int64_t bucket_start_ns,
+        name,
+        service,
+        resource,
+        span_type,
+        int64_t http_status_code,
+        bint synthetics,
+        int64_t duration_ns,
+        bint is_top_level,
+        bint is_error,
+    ):
+        # type: (...) -> None
+        cdef SpanAggrKeyView key
+        # Keep references to the converted strings until the key has been looked up
+        name = _text(name)
+        service = _text(service)
+        resource = _text(resource)
+        span_type = _text(span_type)
+
+        key.name = _view(name)
+        key.service = _view(service)
+        key.resource = _view(resource)
+        key.type = _view(span_type)
+        key.http_status_code = http_status_code
+        key.synthetics = synthetics
+        self._aggregator.add(bucket_start_ns, key, duration_ns, is_top_level, is_error)
+
+    def flush(self, hostname, env, version, int64_t bucket_size_ns):
+        # type: (str, str, str, int) -> typing.Optional[bytes]
+        """Return the msgpack-encoded stats payload for all the spans added so far, or None if there are none.
+
+        The aggregated stats are cleared.
+        """
+        cdef vector[StatsBuckets] taken
+        cdef StatsBuckets merged
+        cdef StatsPayloadInfo info
+        cdef msgpack_packer pk
+
+        self._aggregator.take(taken)
+        if taken.empty():
+            return None
+
+        with nogil:
+            merge_stats_buckets(taken, merged)
+
+        hostname = _text(hostname)
+        env = _text(env)
+        version = _text(version)
+        info.hostname = _view(hostname)
+        info.env = _view(env)
+        info.version = _view(version)
+        info.bucket_size_ns = bucket_size_ns
+
+        pk.buf = <char*>PyMem_Malloc(PAYLOAD_BUFFER_SIZE)
+        if pk.buf == NULL:
+            raise MemoryError("Unable to allocate internal buffer.")
+        pk.buf_size = PAYLOAD_BUFFER_SIZE
+        pk.length = 0
+        try:
+            if pack_stats_payload(&pk, merged, info) != 0:
+                raise MemoryError("Unable to grow internal buffer.")
+            return PyBytes_FromStringAndSize(pk.buf, pk.length)
+        finally:
+            PyMem_Free(pk.buf)
@@ -23,13 +23,13 @@ from ddtrace.internal.constants import BLOCKED_RESPONSE_JSON
 from ddtrace.internal.constants import DEFAULT_TIMEOUT
 from ddtrace.internal.constants import SAMPLING_DECISION_TRACE_TAG_KEY
 from ddtrace.internal.constants import W3C_TRACESTATE_ORIGIN_KEY
-from ddtrace.internal.constants import W3C_TRACESTATE_PARENT_ID_KEY
 from ddtrace.internal.constants import W3C_TRACESTATE_SAMPLING_PRIORITY_KEY
 from ddtrace.internal.http import HTTPConnection
 from ddtrace.internal.http import HTTPSConnection
 from ddtrace.internal.uds import UDSHTTPConnection
 from ddtrace.internal.utils import _get_metas_to_propagate
 from ddtrace.internal.utils.cache import cached
+from ddtrace.propagation._codec import tracestate_add_p as w3c_tracestate_add_p  # noqa:F401
 
 
 ConnectionType = Union[HTTPSConnection, HTTPConnection, UDSHTTPConnection]
@@ -204,16 +204,6 @@ def w3c_encode_tag(args):
     return tag_val.replace("=", "~")
 
 
-def w3c_tracestate_add_p(tracestate, span_id):
-    # Adds last datadog parent_id to tracestate. This tag is used to reconnect a trace with non-datadog spans
-    p_member = "{}:{:016x}".format(W3C_TRACESTATE_PARENT_ID_KEY, span_id)
-    if "dd=" in tracestate:
-        return tracestate.replace("dd=", f"dd={p_member};")
-    elif tracestate:
-        return f"dd={p_member},{tracestate}"
-    return f"dd={p_member}"
-
-
 class Response(object):
     """
     Custom API Response object to represent a response from calling the API.
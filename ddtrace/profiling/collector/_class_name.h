@@ -0,0 +1,215 @@
+#ifndef _DDTRACE_CLASS_NAME_H
+#define _DDTRACE_CLASS_NAME_H
+
+#include <string.h>
+
+#include <Python.h>
+
+/* Resolve the name of the class a code object is defined in, the way the profiler reports it: only functions whose
+ * first argument is named `self` or `cls` are considered methods.
+ *
+ * From Python 3.11, code objects carry their qualified name, so the class name is a property of the code object and
+ * is cached here, keyed by the code object address. It is the name of the class which defines the method, which for
+ * an inherited method is not the class of `self`. Before 3.11, the class name can only be inferred from the value of
+ * the first argument in the frame locals; in that case, only the name of that argument is cached.
+ *
+ * All functions must be called with the GIL held. This is header-only as the cache is private to each extension
+ * that uses it.
+ *
+ * Evicting an entry releases a code object, which can deallocate it and run weakref callbacks. Where no arbitrary
+ * code may run, such as from an allocator hook, `class_name_lookup_deferred` keeps the evicted code objects aside
+ * until the next call to `class_name_lookup` or `class_name_cache_release_pending`. */
+
+/* Number of entries in the cache; must be a power of 2 */
+#define CLASS_NAME_CACHE_SIZE 4096
+
+typedef struct
+{
+    /* Strong reference, so that the address cannot be reused while it is in the cache */
+    PyObject* code;
+    /* From 3.11, the class name; before, the name of the `self`/`cls` argument or an empty string */
+    PyObject* value;
+} class_name_cache_entry_t;
+
+static class_name_cache_entry_t* class_name_cache = NULL;
+static PyObject* class_name_empty_string = NULL;
+
+/* Maximum number of evicted code objects waiting to be released; beyond that, entries are not replaced */
+#define CLASS_NAME_CACHE_MAX_PENDING 64
+
+static PyObject* class_name_cache_pending[CLASS_NAME_CACHE_MAX_PENDING];
+static size_t class_name_cache_pending_count = 0;
+
+/* Release the code objects evicted by `class_name_lookup_deferred`. This can run arbitrary code. */
+static inline void
+class_name_cache_release_pending(void)
+{
+    /* The count is read again after each release, as the callbacks it runs can evict more entries */
+    while (class_name_cache_pending_count > 0) {
+        PyObject* code = class_name_cache_pending[--class_name_cache_pending_count];
+        Py_DECREF(code);
+    }
+}
+
+static inline class_name_cache_entry_t*
+class_name_cache_slot(PyObject* code)
+{
+    if (class_name_cache == NULL) {
+        class_name_cache = PyMem_RawCalloc(CLASS_NAME_CACHE_SIZE, sizeof(class_name_cache_entry_t));
+        if (class_name_cache == NULL)
+            return NULL;
+    }
+
+    /* Objects are at least 16-byte aligned; direct-mapped, colliding entries evict each other */
+    return &class_name_cache[((uintptr_t)code >> 4) & (CLASS_NAME_CACHE_SIZE - 1)];
+}
+
+/* Return a new reference to the name of the first argument of `code` if it is `self` or `cls`, or an empty string */
+static inline PyObject*
+class_name_self_argname(PyCodeObject* code)
+{
+    if (class_name_empty_string == NULL) {
+        class_name_empty_string = PyUnicode_InternFromString("");
+        if (class_name_empty_string == NULL)
+            return NULL;
+    }
+
+    if (code->co_argcount == 0) {
+        Py_INCREF(class_name_empty_string);
+        return class_name_empty_string;
+    }
+
+#if PY_VERSION_HEX >= 0x030b0000
+    PyObject* varnames = PyCode_GetVarnames(code);
+#else
+    PyObject* varnames = code->co_varnames;
+    Py_XINCREF(varnames);
+#endif
+    if (varnames == NULL)
+        return NULL;
+
+    PyObject* result = class_name_empty_string;
+    if (PyTuple_Check(varnames) && PyTuple_GET_SIZE(varnames) > 0) {
+        PyObject* argname = PyTuple_GET_ITEM(varnames, 0);
+        if (PyUnicode_Check(argname) && (PyUnicode_CompareWithASCIIString(argname, "self") == 0 ||
+                                         PyUnicode_CompareWithASCIIString(argname, "cls") == 0))
+            result = argname;
+    }
+    Py_INCREF(result);
+    Py_DECREF(varnames);
+    return result;
+}
+
+#if PY_VERSION_HEX >= 0x030b0000
+/* Return a new reference to the class name found in `qualname`, the qualified name of a method */
+static inline PyObject*
+class_name_parse_qualname(PyObject* qualname_obj)
+{
+    if (class_name_empty_string == NULL) {
+        class_name_empty_string = PyUnicode_InternFromString("");
+        if (class_name_empty_string == NULL)
+            return NULL;
+    }
+
+    /* e.g. "func.<locals>.Class.method" -> "Class" */
+    Py_ssize_t size;
+    const char* qualname = PyUnicode_AsUTF8AndSize(qualname_obj, &size);
+    if (qualname == NULL)
+        return NULL;
+
+    const char* end = qualname + size;
+    while (end > qualname && *(end - 1) != '.')
+        end--;
+    if (end == qualname) {
+        /* Not in a class */
+        Py_INCREF(class_name_empty_string);
+        return class_name_empty_string;
+    }
+    end--;
+
+    const char* start = end;
+    while (start > qualname && *(start - 1) != '.')
+        start--;
+
+    if ((size_t)(end - start) == sizeof("<locals>") - 1 && memcmp(start, "<locals>", end - start) == 0) {
+        /* A function nested in a function */
+        Py_INCREF(class_name_empty_string);
+        return class_name_empty_string;
+    }
+
+    return PyUnicode_FromStringAndSize(start, end - start);
+}
+
+/* Return a new reference to the class name found in the qualified name of `code` */
+static inline PyObject*
+class_name_from_qualname(PyCodeObject* code)
+{
+    PyObject* argname = class_name_self_argname(code);
+    if (argname == NULL || argname == class_name_empty_string)
+        return argname;
+    Py_DECREF(argname);
+
+    return class_name_parse_qualname(code->co_qualname);
+}
+#endif
+
+static inline PyObject*
+class_name_cache_lookup(PyObject* code_obj, int can_release)
+{
+    PyCodeObject* code = (PyCodeObject*)code_obj;
+    class_name_cache_entry_t* slot = class_name_cache_slot(code_obj);
+    if (slot != NULL && slot->code == code_obj) {
+        Py_INCREF(slot->value);
+        return slot->value;
+    }
+
+#if PY_VERSION_HEX >= 0x030b0000
+    PyObject* value = class_name_from_qualname(code);
+#else
+    PyObject* value = class_name_self_argname(code);
+#endif
+    if (value == NULL)
+        return NULL;
+
+    if (slot != NULL) {
+        PyObject* old_code = slot->code;
+        if (old_code != NULL && !can_release) {
+            if (class_name_cache_pending_count == CLASS_NAME_CACHE_MAX_PENDING)
+                /* Keep the entry, the value is only returned */
+                return value;
+            class_name_cache_pending[class_name_cache_pending_count++] = old_code;
+            old_code = NULL;
+        }
+        PyObject* old_value = slot->value;
+        Py_INCREF(code_obj);
+        Py_INCREF(value);
+        slot->code = code_obj;
+        slot->value = value;
+        /* Decref last: this may run arbitrary code that could re-enter the cache. Releasing the value, a string, does
+         * not run any code. */
+        Py_XDECREF(old_code);
+        Py_XDECREF(old_value);
+    }
+
+    return value;
+}
+
+/* Return a new reference to the cached value for `code_obj`, which must be a code object.
+ *
+ * From 3.11, this is the class name; before, this is the name of the argument which holds the instance or the class
+ * in frames of `code`, or an empty string if there is none. Returns NULL with an exception set on error. */
+static inline PyObject*
+class_name_lookup(PyObject* code_obj)
+{
+    class_name_cache_release_pending();
+    return class_name_cache_lookup(code_obj, 1);
+}
+
+/* Same as `class_name_lookup`, but never releases a code object: those evicted from the cache are released later */
+static inline PyObject*
+class_name_lookup_deferred(PyObject* code_obj)
+{
+    return class_name_cache_lookup(code_obj, 0);
+}
+
+#endif
@@ -117,7 +117,7 @@ class _ProfiledLock(wrapt.ObjectProxy):
                 if self._self_export_libdd_enabled:
                     thread_native_id = _threading.get_thread_native_id(thread_id)
 
-                    handle = ddup.SampleHandle()
+                    handle = ddup.SampleHandle(ddup.SAMPLE_TYPE_LOCK_ACQUIRE)
                     handle.push_lock_name(self._self_name)
                     handle.push_acquire(end - start, 1)  # AFAICT, capture_pct does not adjust anything here
                     handle.push_threadinfo(thread_id, thread_native_id, thread_name)
@@ -126,6 +126,8 @@ class _ProfiledLock(wrapt.ObjectProxy):
 
                     if self._self_tracer is not None:
                         handle.push_span(self._self_tracer.current_span(), self._self_endpoint_collection_enabled)
+                    if frames:
+                        handle.push_class_name(frames[0].class_name)
                     for frame in frames:
                         handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
                     handle.flush_sample()
@@ -171,7 +173,7 @@ class _ProfiledLock(wrapt.ObjectProxy):
                         if self._self_export_libdd_enabled:
                             thread_native_id = _threading.get_thread_native_id(thread_id)
 
-                            handle = ddup.SampleHandle()
+                            handle = ddup.SampleHandle(ddup.SAMPLE_TYPE_LOCK_RELEASE)
                             handle.push_lock_name(self._self_name)
                             handle.push_release(
                                 end - self._self_acquired_at, 1
@@ -184,6 +186,8 @@ class _ProfiledLock(wrapt.ObjectProxy):
                                 handle.push_span(
                                     self._self_tracer.current_span(), self._self_endpoint_collection_enabled
                                 )
+                            if frames:
+                                handle.push_class_name(frames[0].class_name)
                             for frame in frames:
                                 handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
                             handle.flush_sample()
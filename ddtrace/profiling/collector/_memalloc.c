@@ -279,6 +279,7 @@ memalloc_heap_py(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args))
         return NULL;
     }
 
+    memalloc_tb_release_pending();
     return memalloc_heap();
 }
 
@@ -313,6 +314,7 @@ iterevents_new(PyTypeObject* type, PyObject* Py_UNUSED(args), PyObject* Py_UNUSE
     iestate->alloc_tracker = global_alloc_tracker;
     /* reset the current traceback list */
     global_alloc_tracker = alloc_tracker_new();
+    memalloc_tb_release_pending();
     iestate->seq_index = 0;
 
     PyObject* iter_and_count = PyTuple_New(3);
@@ -4,6 +4,7 @@
 #include <Python.h>
 #include <frameobject.h>
 
+#include "_class_name.h"
 #include "_memalloc_tb.h"
 #include "_pymacro.h"
 
@@ -82,6 +83,13 @@ void
 memalloc_tb_deinit(void)
 {
     PyMem_RawFree(traceback_buffer);
+    memalloc_tb_release_pending();
+}
+
+void
+memalloc_tb_release_pending(void)
+{
+    class_name_cache_release_pending();
 }
 
 void
@@ -90,6 +98,7 @@ traceback_free(traceback_t* tb)
     for (uint16_t nframe = 0; nframe < tb->nframe; nframe++) {
         Py_DECREF(tb->frames[nframe].filename);
         Py_DECREF(tb->frames[nframe].name);
+        Py_DECREF(tb->frames[nframe].class_name);
     }
     PyMem_RawFree(tb);
 }
@@ -134,6 +143,26 @@ memalloc_convert_frame(PyFrameObject* pyframe, frame_t* frame)
 
     Py_INCREF(frame->filename);
 
+    /* The class name can only be resolved from the code object from 3.11. Before that, it requires looking up the
+     * frame locals, which is too expensive to do on every allocation. */
+    frame->class_name = NULL;
+#ifdef _PY311_AND_LATER
+    if (code != NULL) {
+        /* Allocations can happen while an exception is being handled: don't clobber it */
+        PyObject *exc_type, *exc_value, *exc_traceback;
+        PyErr_Fetch(&exc_type, &exc_value, &exc_traceback);
+        /* Releasing the code objects evicted from the cache could run arbitrary code from within the allocator */
+        frame->class_name = class_name_lookup_deferred((PyObject*)code);
+        if (frame->class_name == NULL)
+            PyErr_Clear();
+        PyErr_Restore(exc_type, exc_value, exc_traceback);
+    }
+#endif
+    if (frame->class_name == NULL) {
+        frame->class_name = empty_string;
+        Py_INCREF(frame->class_name);
+    }
+
 #ifdef _PY39_AND_LATER
     Py_XDECREF(code);
 #endif
@@ -224,9 +253,8 @@ traceback_to_tuple(traceback_t* tb)
         PyTuple_SET_ITEM(frame_tuple, 1, PyLong_FromUnsignedLong(frame->lineno));
         PyTuple_SET_ITEM(frame_tuple, 2, frame->name);
         Py_INCREF(frame->name);
-        /* Class name */
-        PyTuple_SET_ITEM(frame_tuple, 3, empty_string);
-        Py_INCREF(empty_string);
+        PyTuple_SET_ITEM(frame_tuple, 3, frame->class_name);
+        Py_INCREF(frame->class_name);
 
         // Try to set the class.  If we cannot (e.g., if the sofile is reloaded
         // without module initialization), then this will result in an error if
@@ -17,6 +17,7 @@ typedef struct
 {
     PyObject* filename;
     PyObject* name;
+    PyObject* class_name;
     unsigned int lineno;
 } frame_t;
 #if defined(_MSC_VER)
@@ -51,6 +52,9 @@ int
 memalloc_tb_init(uint16_t max_nframe);
 void
 memalloc_tb_deinit();
+/* Release what the allocator hook could not; must be called with the GIL held, outside of the hook */
+void
+memalloc_tb_release_pending(void);
 
 void
 traceback_free(traceback_t* tb);
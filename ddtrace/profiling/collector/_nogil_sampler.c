@@ -0,0 +1,928 @@
+/* process_vm_readv */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+/* The sampler reads the thread states and the interpreter frames of the running threads without holding the GIL.
+ * This relies on the layout of `_PyInterpreterFrame`, which is only available with `Py_BUILD_CORE`, and on
+ * `process_vm_readv`, which is Linux-specific. Thread states only carry their native thread id from 3.11, which we
+ * need to read the thread CPU clocks safely, and 3.13 changed the frame layout again. */
+#if defined(__linux__) && defined(Py_BUILD_CORE) && PY_VERSION_HEX >= 0x030b0000 && PY_VERSION_HEX < 0x030d0000
+#define _NOGIL_SAMPLER_SUPPORTED
+#endif
+
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+#if PY_VERSION_HEX >= 0x030c0000
+/* https://github.com/python/cpython/issues/108216#issuecomment-1696565797 */
+#undef _PyGC_FINALIZED
+#endif
+#include <internal/pycore_frame.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "_class_name.h"
+#include "_utils.h"
+
+/* Upper bound on the number of thread states visited per sampling pass, in case a torn read makes us loop */
+#define NOGIL_SAMPLER_MAX_THREADS 4096
+/* Upper bound on the number of interpreter frames visited per stored frame, for the same reason. Frames which are not
+ * stored (shim and incomplete frames) are rare, so a stack reaching this is truncated like a deep one. */
+#define NOGIL_SAMPLER_MAX_VISITED_FRAMES_FACTOR 2
+/* Default number of samples buffered between two calls to `collect()` */
+#define NOGIL_SAMPLER_DEFAULT_CAPACITY 1024
+/* Number of distinct code objects, and bytes of their copied strings and line tables, buffered between two calls to
+ * `collect()`; samples which do not fit are dropped */
+#define NOGIL_SAMPLER_MAX_CODES 2048
+#define NOGIL_SAMPLER_STRINGS_SIZE (512 * 1024)
+/* Longer names are truncated, longer line tables only give the line numbers of the beginning of the function */
+#define NOGIL_SAMPLER_MAX_STRING_LENGTH 1024
+#define NOGIL_SAMPLER_MAX_LINETABLE_SIZE 8192
+/* Size of the hash index of the code table; must be a power of 2 larger than the number of codes */
+#define NOGIL_SAMPLER_CODE_INDEX_SIZE (2 * NOGIL_SAMPLER_MAX_CODES)
+
+/* Characters or bytes copied into the strings of a code table */
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+    /* PyUnicode_1BYTE_KIND, PyUnicode_2BYTE_KIND or PyUnicode_4BYTE_KIND; 1 for bytes */
+    uint8_t kind;
+} copied_str_t;
+
+/* What is needed from a code object to report its frames, copied while the code object is referenced by the frame
+ * being unwound. The code object itself is never read again: once the frame is gone, it may be freed and its address
+ * reused. */
+typedef struct
+{
+    /* The address of the code object and of the objects it references tell it apart from another code object
+     * allocated at the same address; they are only compared, never dereferenced */
+    uintptr_t code;
+    uintptr_t name_addr;
+    uintptr_t filename_addr;
+    uintptr_t qualname_addr;
+    uintptr_t linetable_addr;
+    int firstlineno;
+    /* Whether the first argument is named `self` or `cls` */
+    bool is_method;
+
+    copied_str_t name;
+    copied_str_t filename;
+    copied_str_t qualname;
+    copied_str_t linetable;
+} code_info_t;
+
+/* The code objects referenced by the samples taken since the last call to `collect()` */
+typedef struct
+{
+    code_info_t* codes;
+    size_t count;
+    /* Open addressing index of `codes` by code object address, -1 for empty slots */
+    int32_t* index;
+    char* strings;
+    size_t strings_size;
+} code_table_t;
+
+typedef struct
+{
+    /* Index of the code object in the code table of the sample */
+    uint32_t code_index;
+    int lineno;
+} raw_frame_t;
+
+typedef struct
+{
+    unsigned long thread_id;
+    unsigned long native_thread_id;
+    /* CLOCK_MONOTONIC time the sample was taken at */
+    int64_t monotonic_ns;
+    int64_t wall_time_ns;
+    /* Absolute CPU time of the thread, or -1 if it could not be read */
+    int64_t cpu_time_ns;
+    uint16_t nframes;
+} raw_sample_t;
+
+typedef struct
+{
+    /* The interpreter we sample; this is the one the sampler was started from */
+    PyInterpreterState* interp;
+    pid_t pid;
+    uint16_t max_nframes;
+    atomic_uint_fast64_t interval_ns;
+    /* Sampling threads exit as soon as this does not match the value they were started with */
+    atomic_uint_fast64_t thread_seq_num;
+    /* The sampling thread, joined before the sampler is reconfigured; only accessed with the GIL held */
+    pthread_t thread;
+    bool thread_running;
+
+    /* Ring of samples waiting to be collected, and the code objects they reference, protected by `lock` */
+    pthread_mutex_t lock;
+    raw_sample_t* samples;
+    raw_frame_t* frames;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    code_table_t* codes;
+    /* The table swapped in by the next `collect()`, or NULL while a collection is using it */
+    code_table_t* spare_codes;
+
+    /* Counters since start */
+    uint64_t sample_count;
+    uint64_t dropped_validation;
+    uint64_t dropped_full;
+} nogil_sampler_t;
+
+static nogil_sampler_t sampler = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* Copy `size` bytes at `src` into `dst` through the kernel, so that reading memory that was freed or unmapped in the
+ * meantime fails instead of crashing the process. */
+static inline bool
+safe_copy(void* dst, const void* src, size_t size)
+{
+    struct iovec local = { .iov_base = dst, .iov_len = size };
+    struct iovec remote = { .iov_base = (void*)src, .iov_len = size };
+    return process_vm_readv(sampler.pid, &local, 1, &remote, 1, 0) == (ssize_t)size;
+}
+
+static inline int64_t
+monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t
+thread_cpu_time_ns(unsigned long native_thread_id)
+{
+    /* This is what glibc's pthread_getcpuclockid returns (MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED)), but building
+     * it from the native thread id rather than the pthread_t means the kernel returns EINVAL if the thread is gone,
+     * rather than glibc dereferencing a dangling pthread handle. */
+    clockid_t clock_id = (clockid_t)((~(clockid_t)native_thread_id) << 3) | 6;
+    struct timespec ts;
+    if (clock_gettime(clock_id, &ts) != 0)
+        return -1;
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static code_table_t*
+code_table_new(void)
+{
+    code_table_t* table = PyMem_RawCalloc(1, sizeof(code_table_t));
+    if (table == NULL)
+        return NULL;
+    table->codes = p_new(code_info_t, NOGIL_SAMPLER_MAX_CODES);
+    table->index = p_new(int32_t, NOGIL_SAMPLER_CODE_INDEX_SIZE);
+    table->strings = p_new(char, NOGIL_SAMPLER_STRINGS_SIZE);
+    if (table->codes == NULL || table->index == NULL || table->strings == NULL) {
+        PyMem_RawFree(table->codes);
+        PyMem_RawFree(table->index);
+        PyMem_RawFree(table->strings);
+        PyMem_RawFree(table);
+        return NULL;
+    }
+    memset(table->index, 0xff, sizeof(int32_t) * NOGIL_SAMPLER_CODE_INDEX_SIZE);
+    return table;
+}
+
+static void
+code_table_clear(code_table_t* table)
+{
+    table->count = 0;
+    table->strings_size = 0;
+    memset(table->index, 0xff, sizeof(int32_t) * NOGIL_SAMPLER_CODE_INDEX_SIZE);
+}
+
+/* Reserve `size` bytes aligned for any kind of characters in the strings of `table`, or return NULL if they are full */
+static char*
+code_table_reserve(code_table_t* table, size_t size, uint32_t* offset)
+{
+    size_t start = (table->strings_size + 3) & ~(size_t)3;
+    if (start > NOGIL_SAMPLER_STRINGS_SIZE || size > NOGIL_SAMPLER_STRINGS_SIZE - start)
+        return NULL;
+    table->strings_size = start + size;
+    *offset = (uint32_t)start;
+    return table->strings + start;
+}
+
+/* Copy the characters of the str object at `addr` into `table` */
+static bool
+code_table_copy_str(code_table_t* table, uintptr_t addr, copied_str_t* str)
+{
+    PyASCIIObject header;
+    if (addr == 0 || !safe_copy(&header, (const void*)addr, sizeof(header)) || !header.state.compact)
+        return false;
+
+    unsigned int kind = header.state.kind;
+    if (kind != PyUnicode_1BYTE_KIND && kind != PyUnicode_2BYTE_KIND && kind != PyUnicode_4BYTE_KIND)
+        return false;
+    Py_ssize_t length = header.length;
+    if (length < 0)
+        return false;
+    if (length > NOGIL_SAMPLER_MAX_STRING_LENGTH)
+        length = NOGIL_SAMPLER_MAX_STRING_LENGTH;
+
+    /* Same as PyUnicode_DATA for compact strings */
+    const char* data =
+      (const char*)addr + (header.state.ascii ? sizeof(PyASCIIObject) : sizeof(PyCompactUnicodeObject));
+    char* copy = code_table_reserve(table, (size_t)length * kind, &str->offset);
+    if (copy == NULL || !safe_copy(copy, data, (size_t)length * kind))
+        return false;
+    str->length = (uint32_t)length;
+    str->kind = (uint8_t)kind;
+    return true;
+}
+
+/* Copy the bytes of the bytes object at `addr` into `table` */
+static bool
+code_table_copy_bytes(code_table_t* table, uintptr_t addr, copied_str_t* str)
+{
+    PyVarObject header;
+    if (addr == 0 || !safe_copy(&header, (const void*)addr, sizeof(header)) || Py_SIZE(&header) < 0)
+        return false;
+
+    size_t size = (size_t)Py_SIZE(&header);
+    if (size > NOGIL_SAMPLER_MAX_LINETABLE_SIZE)
+        size = NOGIL_SAMPLER_MAX_LINETABLE_SIZE;
+    char* copy = code_table_reserve(table, size, &str->offset);
+    if (copy == NULL || !safe_copy(copy, (const char*)addr + offsetof(PyBytesObject, ob_sval), size))
+        return false;
+    str->length = (uint32_t)size;
+    str->kind = 1;
+    return true;
+}
+
+/* Whether the str object at `addr` is the ASCII string `expected` */
+static bool
+remote_str_equals(uintptr_t addr, const char* expected)
+{
+    size_t size = strlen(expected);
+    PyASCIIObject header;
+    char data[8];
+    if (addr == 0 || size > sizeof(data) || !safe_copy(&header, (const void*)addr, sizeof(header)) ||
+        !header.state.compact || !header.state.ascii || (size_t)header.length != size)
+        return false;
+    return safe_copy(data, (const char*)addr + sizeof(PyASCIIObject), size) && memcmp(data, expected, size) == 0;
+}
+
+/* Return the index in `table` of the code object at `addr`, whose header was copied into `code`, adding it if needed.
+ * Returns -1 if the code object could not be read or the table is full. */
+static int32_t
+code_table_get(code_table_t* table, uintptr_t addr, const PyCodeObject* code)
+{
+    size_t slot = (addr >> 4) & (NOGIL_SAMPLER_CODE_INDEX_SIZE - 1);
+    for (;; slot = (slot + 1) & (NOGIL_SAMPLER_CODE_INDEX_SIZE - 1)) {
+        int32_t index = table->index[slot];
+        if (index < 0)
+            break;
+        const code_info_t* info = &table->codes[index];
+        if (info->code == addr && info->name_addr == (uintptr_t)code->co_name &&
+            info->filename_addr == (uintptr_t)code->co_filename &&
+            info->qualname_addr == (uintptr_t)code->co_qualname &&
+            info->linetable_addr == (uintptr_t)code->co_linetable && info->firstlineno == code->co_firstlineno)
+            return index;
+    }
+
+    /* The index is twice as large as the table, so there is always an empty slot */
+    if (table->count >= NOGIL_SAMPLER_MAX_CODES)
+        return -1;
+
+    code_info_t* info = &table->codes[table->count];
+    info->code = addr;
+    info->name_addr = (uintptr_t)code->co_name;
+    info->filename_addr = (uintptr_t)code->co_filename;
+    info->qualname_addr = (uintptr_t)code->co_qualname;
+    info->linetable_addr = (uintptr_t)code->co_linetable;
+    info->firstlineno = code->co_firstlineno;
+    info->is_method = false;
+    if (code->co_argcount > 0 && code->co_localsplusnames != NULL) {
+        /* The arguments are the first local variables */
+        uintptr_t argname;
+        if (safe_copy(&argname,
+                      (const char*)code->co_localsplusnames + offsetof(PyTupleObject, ob_item),
+                      sizeof(argname)))
+            info->is_method = remote_str_equals(argname, "self") || remote_str_equals(argname, "cls");
+    }
+
+    size_t strings_size = table->strings_size;
+    if (!code_table_copy_str(table, info->name_addr, &info->name) ||
+        !code_table_copy_str(table, info->filename_addr, &info->filename) ||
+        !code_table_copy_str(table, info->qualname_addr, &info->qualname) ||
+        !code_table_copy_bytes(table, info->linetable_addr, &info->linetable)) {
+        table->strings_size = strings_size;
+        return -1;
+    }
+
+    table->index[slot] = (int32_t)table->count;
+    return (int32_t)table->count++;
+}
+
+static int
+linetable_read_varint(const uint8_t** ptr, const uint8_t* limit)
+{
+    unsigned int read, value = 0, shift = 0;
+    do {
+        if (*ptr >= limit || shift > 24)
+            return 0;
+        read = *(*ptr)++;
+        value |= (read & 63) << shift;
+        shift += 6;
+    } while (read & 64);
+    return (int)value;
+}
+
+/* Same as PyCode_Addr2Line, from the copy of the line table of `info`. Returns -1 if the line is unknown. */
+static int
+code_info_addr2line(const code_info_t* info, const code_table_t* table, int lasti)
+{
+    if (lasti < 0)
+        return info->firstlineno;
+
+    const uint8_t* ptr = (const uint8_t*)table->strings + info->linetable.offset;
+    const uint8_t* limit = ptr + info->linetable.length;
+    int computed_line = info->firstlineno;
+    int line = -1;
+    int end = 0;
+
+    /* See Objects/locations.md in CPython for the format of the entries */
+    while (end <= lasti) {
+        if (ptr >= limit)
+            return -1;
+        uint8_t first = *ptr;
+        int code = (first >> 3) & 15;
+        const uint8_t* next = ptr + 1;
+        if (code == PY_CODE_LOCATION_INFO_NO_COLUMNS || code == PY_CODE_LOCATION_INFO_LONG) {
+            unsigned int delta = (unsigned int)linetable_read_varint(&next, limit);
+            computed_line += (delta & 1) ? -(int)(delta >> 1) : (int)(delta >> 1);
+        } else if (code >= PY_CODE_LOCATION_INFO_ONE_LINE0 && code <= PY_CODE_LOCATION_INFO_ONE_LINE2) {
+            computed_line += code - PY_CODE_LOCATION_INFO_ONE_LINE0;
+        }
+        line = code == PY_CODE_LOCATION_INFO_NONE ? -1 : computed_line;
+        end += ((first & 7) + 1) * (int)sizeof(_Py_CODEUNIT);
+
+        do {
+            ptr++;
+        } while (ptr < limit && (*ptr & 128) == 0);
+    }
+
+    return line;
+}
+
+/* Unwind at most `max_nframes` frames of a thread state we've copied, into `frames`, adding the code objects to
+ * `table`. Returns the number of frames, -1 if the stack could not be read consistently, or -2 if the table is full.
+ */
+static int
+unwind_thread(const PyThreadState* tstate, raw_frame_t* frames, uint16_t max_nframes, code_table_t* table)
+{
+    if (tstate->cframe == NULL)
+        return 0;
+
+    _PyCFrame cframe;
+    if (!safe_copy(&cframe, tstate->cframe, sizeof(cframe)))
+        return -1;
+
+    _PyInterpreterFrame* top = cframe.current_frame;
+    _PyInterpreterFrame* addr = top;
+    PyCodeObject* top_code = NULL;
+    _Py_CODEUNIT* top_prev_instr = NULL;
+    int nframes = 0;
+
+    /* A torn read can make the chain of frames cyclic, so the frames visited are bounded too, not only the ones we
+     * store */
+    const int max_visited = NOGIL_SAMPLER_MAX_VISITED_FRAMES_FACTOR * max_nframes;
+    for (int visited = 0; addr != NULL && nframes < max_nframes && visited < max_visited; visited++) {
+        _PyInterpreterFrame frame;
+        if (!safe_copy(&frame, addr, offsetof(_PyInterpreterFrame, localsplus)))
+            return -1;
+        if (visited == 0) {
+            top_code = frame.f_code;
+            top_prev_instr = frame.prev_instr;
+        }
+        addr = frame.previous;
+
+#if PY_VERSION_HEX >= 0x030c0000
+        /* Shim frames pushed on entry from C have no Python code worth reporting */
+        if (frame.owner == FRAME_OWNED_BY_CSTACK)
+            continue;
+#endif
+
+        PyCodeObject code;
+        const char* code_addr = (const char*)frame.f_code;
+        if (code_addr == NULL || !safe_copy(&code, code_addr, offsetof(PyCodeObject, co_code_adaptive)))
+            return -1;
+
+        /* Same as _PyFrame_IsIncomplete, computed from addresses only */
+        const _Py_CODEUNIT* code_start = (const _Py_CODEUNIT*)(code_addr + offsetof(PyCodeObject, co_code_adaptive));
+        if (frame.owner != FRAME_OWNED_BY_GENERATOR && frame.prev_instr < code_start + code._co_firsttraceable)
+            continue;
+
+        int32_t code_index = code_table_get(table, (uintptr_t)code_addr, &code);
+        if (code_index < 0)
+            return -2;
+        int lasti = (int)((frame.prev_instr - code_start) * sizeof(_Py_CODEUNIT));
+        frames[nframes].code_index = (uint32_t)code_index;
+        frames[nframes].lineno = code_info_addr2line(&table->codes[code_index], table, lasti);
+        nframes++;
+    }
+
+    /* Validate the copy: if the thread moved to another frame while we were unwinding it, what we read may mix two
+     * different stacks. The address of the top frame alone is not enough, since the slot could have been reused by
+     * another call in the meantime, so its code and instruction are checked as well. */
+    if (!safe_copy(&cframe, tstate->cframe, sizeof(cframe)) || cframe.current_frame != top)
+        return -1;
+    if (top != NULL) {
+        _PyInterpreterFrame frame;
+        if (!safe_copy(&frame, top, offsetof(_PyInterpreterFrame, localsplus)) || frame.f_code != top_code ||
+            frame.prev_instr != top_prev_instr)
+            return -1;
+    }
+
+    return nframes;
+}
+
+/* Must be called with `sampler.lock` held */
+static void
+sampler_commit(const raw_sample_t* sample, const raw_frame_t* frames)
+{
+    if (sampler.count >= sampler.capacity) {
+        sampler.dropped_full++;
+    } else {
+        size_t index = (sampler.head + sampler.count) % sampler.capacity;
+        sampler.samples[index] = *sample;
+        memcpy(&sampler.frames[index * sampler.max_nframes], frames, sizeof(raw_frame_t) * sample->nframes);
+        sampler.count++;
+        sampler.sample_count++;
+    }
+}
+
+static void
+sampler_drop_invalid(void)
+{
+    pthread_mutex_lock(&sampler.lock);
+    sampler.dropped_validation++;
+    pthread_mutex_unlock(&sampler.lock);
+}
+
+static void
+sample_threads(int64_t now_ns, int64_t wall_time_ns, raw_frame_t* frames, uint16_t max_nframes)
+{
+    /* This is a plain read of interp->threads.head and does not take any lock */
+    PyThreadState* addr = PyInterpreterState_ThreadHead(sampler.interp);
+
+    for (int i = 0; addr != NULL && i < NOGIL_SAMPLER_MAX_THREADS; i++) {
+        PyThreadState tstate;
+        if (!safe_copy(&tstate, addr, sizeof(tstate)) || tstate.interp != sampler.interp) {
+            /* The list changed under our feet; we cannot trust the rest of it */
+            sampler_drop_invalid();
+            return;
+        }
+        addr = tstate.next;
+
+        /* The frames reference the code table, which is swapped by `collect()` along with the samples, so they are
+         * resolved and committed at once */
+        pthread_mutex_lock(&sampler.lock);
+        int nframes = unwind_thread(&tstate, frames, max_nframes, sampler.codes);
+        if (nframes == -1) {
+            sampler.dropped_validation++;
+        } else if (nframes == -2) {
+            sampler.dropped_full++;
+        } else if (nframes > 0) {
+            raw_sample_t sample = {
+                .thread_id = tstate.thread_id,
+                .native_thread_id = tstate.native_thread_id,
+                .monotonic_ns = now_ns,
+                .wall_time_ns = wall_time_ns,
+                .cpu_time_ns = thread_cpu_time_ns(tstate.native_thread_id),
+                .nframes = (uint16_t)nframes,
+            };
+            sampler_commit(&sample, frames);
+        }
+        pthread_mutex_unlock(&sampler.lock);
+    }
+}
+
+static void*
+sampling_thread(void* arg)
+{
+    const uint64_t seq_num = (uint64_t)(uintptr_t)arg;
+    /* The sampler is only reconfigured once this thread has been joined */
+    const uint16_t max_nframes = sampler.max_nframes;
+    raw_frame_t* frames = PyMem_RawMalloc(sizeof(raw_frame_t) * max_nframes);
+    if (frames == NULL)
+        return NULL;
+
+    int64_t prev = monotonic_ns();
+    while (atomic_load(&sampler.thread_seq_num) == seq_num) {
+        int64_t now = monotonic_ns();
+        sample_threads(now, now - prev, frames, max_nframes);
+        prev = now;
+
+        int64_t interval_ns = (int64_t)atomic_load(&sampler.interval_ns);
+        struct timespec ts = { .tv_sec = interval_ns / 1000000000LL, .tv_nsec = interval_ns % 1000000000LL };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+            ;
+    }
+
+    PyMem_RawFree(frames);
+    return NULL;
+}
+
+/* Stop the sampling thread, if any, and wait for it to exit. The sampling thread never takes the GIL, so this can
+ * be called with the GIL held; it waits for at most one sampling pass and one interval. */
+static void
+sampler_thread_join(void)
+{
+    atomic_fetch_add(&sampler.thread_seq_num, 1);
+    if (sampler.thread_running) {
+        pthread_join(sampler.thread, NULL);
+        sampler.thread_running = false;
+    }
+}
+
+static void
+nogil_sampler_postfork_child(void)
+{
+    /* The sampling thread does not exist in the child; the collector restarts us if needed */
+    pthread_mutex_init(&sampler.lock, NULL);
+    atomic_fetch_add(&sampler.thread_seq_num, 1);
+    sampler.thread_running = false;
+    sampler.head = 0;
+    sampler.count = 0;
+    if (sampler.codes != NULL)
+        code_table_clear(sampler.codes);
+}
+
+static PyObject*
+copied_str_to_unicode(const code_table_t* table, const copied_str_t* str)
+{
+    return PyUnicode_FromKindAndData(str->kind, table->strings + str->offset, str->length);
+}
+
+/* Return a new reference to the (filename, function_name, class_name) tuple of a code object of `table` */
+static PyObject*
+code_info_to_tuple(const code_table_t* table, const code_info_t* info)
+{
+    PyObject* filename = copied_str_to_unicode(table, &info->filename);
+    PyObject* name = copied_str_to_unicode(table, &info->name);
+    PyObject* class_name = NULL;
+    if (filename != NULL && name != NULL) {
+        if (info->is_method) {
+            PyObject* qualname = copied_str_to_unicode(table, &info->qualname);
+            if (qualname != NULL) {
+                class_name = class_name_parse_qualname(qualname);
+                Py_DECREF(qualname);
+            }
+        } else {
+            class_name = PyUnicode_FromStringAndSize(NULL, 0);
+        }
+    }
+
+    PyObject* result = NULL;
+    if (class_name != NULL)
+        result = PyTuple_Pack(3, filename, name, class_name);
+    Py_XDECREF(filename);
+    Py_XDECREF(name);
+    Py_XDECREF(class_name);
+    return result;
+}
+
+/* `code_tuples` caches the result of `code_info_to_tuple` for each code object of `table` */
+static PyObject*
+raw_sample_to_tuple(const raw_sample_t* sample,
+                    const raw_frame_t* frames,
+                    const code_table_t* table,
+                    PyObject** code_tuples)
+{
+    PyObject* stack = PyTuple_New(sample->nframes);
+    if (stack == NULL)
+        return NULL;
+
+    for (uint16_t i = 0; i < sample->nframes; i++) {
+        uint32_t code_index = frames[i].code_index;
+        if (code_tuples[code_index] == NULL) {
+            code_tuples[code_index] = code_info_to_tuple(table, &table->codes[code_index]);
+            if (code_tuples[code_index] == NULL) {
+                Py_DECREF(stack);
+                return NULL;
+            }
+        }
+
+        PyObject* code_tuple = code_tuples[code_index];
+        PyObject* frame = Py_BuildValue("(OiOO)",
+                                        PyTuple_GET_ITEM(code_tuple, 0),
+                                        frames[i].lineno < 0 ? 0 : frames[i].lineno,
+                                        PyTuple_GET_ITEM(code_tuple, 1),
+                                        PyTuple_GET_ITEM(code_tuple, 2));
+        if (frame == NULL) {
+            Py_DECREF(stack);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(stack, i, frame);
+    }
+
+    return Py_BuildValue("(kkLLNL)",
+                         sample->thread_id,
+                         sample->native_thread_id,
+                         (long long)sample->wall_time_ns,
+                         (long long)sample->cpu_time_ns,
+                         stack,
+                         (long long)sample->monotonic_ns);
+}
+#endif
+
+PyDoc_STRVAR(nogil_sampler_start__doc__,
+             "start($module, interval, max_nframe)\n"
+             "--\n"
+             "\n"
+             "Start sampling the stacks of the threads of the current interpreter from a native thread.\n"
+             "\n"
+             "The sampling thread never acquires the GIL.\n"
+             "\n"
+             "  interval\n"
+             "    The interval between two samples, in seconds.\n"
+             "  max_nframe\n"
+             "    The maximum number of frames collected in stack traces.\n");
+static PyObject*
+nogil_sampler_start(PyObject* Py_UNUSED(module), PyObject* args)
+{
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    double interval;
+    long max_nframe;
+
+    if (!PyArg_ParseTuple(args, "dl", &interval, &max_nframe))
+        return NULL;
+
+    if (interval <= 0) {
+        PyErr_SetString(PyExc_ValueError, "the interval must be positive");
+        return NULL;
+    }
+
+    if (max_nframe < 1 || max_nframe > UINT16_MAX) {
+        PyErr_Format(PyExc_ValueError, "the number of frames must be in range [1; %lu]", (unsigned long)UINT16_MAX);
+        return NULL;
+    }
+
+    static bool atfork_registered = false;
+    if (!atfork_registered) {
+        pthread_atfork(NULL, NULL, nogil_sampler_postfork_child);
+        atfork_registered = true;
+    }
+
+    /* Stop any running sampling thread before its buffers are reallocated */
+    sampler_thread_join();
+    uint64_t seq_num = atomic_load(&sampler.thread_seq_num);
+
+    pthread_mutex_lock(&sampler.lock);
+    sampler.pid = getpid();
+
+    /* Make sure the kernel lets us read our own memory, e.g., this is not blocked by a seccomp profile */
+    PyThreadState* tstate = PyThreadState_Get();
+    PyThreadState copy;
+    if (!safe_copy(&copy, tstate, sizeof(copy))) {
+        pthread_mutex_unlock(&sampler.lock);
+        PyErr_SetFromErrno(PyExc_OSError);
+        return NULL;
+    }
+
+    if (sampler.max_nframes != max_nframe || sampler.samples == NULL) {
+        PyMem_RawFree(sampler.samples);
+        PyMem_RawFree(sampler.frames);
+        sampler.capacity = NOGIL_SAMPLER_DEFAULT_CAPACITY;
+        sampler.samples = p_new(raw_sample_t, sampler.capacity);
+        sampler.frames = p_new(raw_frame_t, sampler.capacity * max_nframe);
+        if (sampler.samples == NULL || sampler.frames == NULL) {
+            PyMem_RawFree(sampler.samples);
+            PyMem_RawFree(sampler.frames);
+            sampler.samples = NULL;
+            sampler.frames = NULL;
+            pthread_mutex_unlock(&sampler.lock);
+            return PyErr_NoMemory();
+        }
+    }
+
+    if (sampler.codes == NULL)
+        sampler.codes = code_table_new();
+    if (sampler.spare_codes == NULL)
+        sampler.spare_codes = code_table_new();
+    if (sampler.codes == NULL || sampler.spare_codes == NULL) {
+        pthread_mutex_unlock(&sampler.lock);
+        return PyErr_NoMemory();
+    }
+    code_table_clear(sampler.codes);
+
+    sampler.interp = tstate->interp;
+    sampler.max_nframes = (uint16_t)max_nframe;
+    sampler.head = 0;
+    sampler.count = 0;
+    sampler.sample_count = 0;
+    sampler.dropped_validation = 0;
+    sampler.dropped_full = 0;
+    atomic_store(&sampler.interval_ns, (uint_fast64_t)(interval * 1e9));
+    pthread_mutex_unlock(&sampler.lock);
+
+    int ret = pthread_create(&sampler.thread, NULL, sampling_thread, (void*)(uintptr_t)seq_num);
+    if (ret != 0) {
+        errno = ret;
+        PyErr_SetFromErrno(PyExc_OSError);
+        return NULL;
+    }
+    sampler.thread_running = true;
+
+    Py_RETURN_NONE;
+#else
+    (void)args;
+    PyErr_SetString(PyExc_NotImplementedError, "GIL-free sampling is not supported on this platform");
+    return NULL;
+#endif
+}
+
+PyDoc_STRVAR(nogil_sampler_stop__doc__,
+             "stop($module, /)\n"
+             "--\n"
+             "\n"
+             "Stop the sampling thread.\n");
+static PyObject*
+nogil_sampler_stop(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args))
+{
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    sampler_thread_join();
+#endif
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(nogil_sampler_set_interval__doc__,
+             "set_interval($module, interval)\n"
+             "--\n"
+             "\n"
+             "Set the interval between two samples, in seconds.\n");
+static PyObject*
+nogil_sampler_set_interval(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    double interval;
+
+    if (!PyArg_ParseTuple(args, "d", &interval))
+        return NULL;
+
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    if (interval > 0)
+        atomic_store(&sampler.interval_ns, (uint_fast64_t)(interval * 1e9));
+#endif
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(nogil_sampler_collect__doc__,
+             "collect($module, /)\n"
+             "--\n"
+             "\n"
+             "Return the samples taken since the last call, as a list of\n"
+             "(thread_id, thread_native_id, wall_time_ns, cpu_time_ns, frames, monotonic_ns) tuples.\n"
+             "\n"
+             "The frames are (filename, lineno, function_name, class_name) tuples, leaf first.\n"
+             "The CPU time is the absolute CPU time of the thread, or -1 if unknown.\n"
+             "monotonic_ns is the CLOCK_MONOTONIC time the sample was taken at.\n");
+static PyObject*
+nogil_sampler_collect(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args))
+{
+    PyObject* result = PyList_New(0);
+    if (result == NULL)
+        return NULL;
+
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    if (sampler.samples == NULL)
+        return result;
+
+    /* Swap the ring content and the code table it references out, so that the sampling thread does not wait on us
+     * while we resolve the frames */
+    pthread_mutex_lock(&sampler.lock);
+    code_table_t* table = NULL;
+    size_t count = sampler.count;
+    raw_sample_t* samples = p_new(raw_sample_t, count ? count : 1);
+    raw_frame_t* frames = p_new(raw_frame_t, (count ? count : 1) * sampler.max_nframes);
+    uint16_t max_nframes = sampler.max_nframes;
+    /* The spare table is only missing while another collection uses it, e.g. from a finalizer it ran */
+    if (samples != NULL && frames != NULL && sampler.spare_codes != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            size_t index = (sampler.head + i) % sampler.capacity;
+            samples[i] = sampler.samples[index];
+            memcpy(&frames[i * max_nframes],
+                   &sampler.frames[index * max_nframes],
+                   sizeof(raw_frame_t) * samples[i].nframes);
+        }
+        sampler.head = 0;
+        sampler.count = 0;
+        table = sampler.codes;
+        sampler.codes = sampler.spare_codes;
+        sampler.spare_codes = NULL;
+    }
+    pthread_mutex_unlock(&sampler.lock);
+
+    PyObject** code_tuples = NULL;
+    if (table != NULL)
+        code_tuples = PyMem_RawCalloc(table->count ? table->count : 1, sizeof(PyObject*));
+    if (samples == NULL || frames == NULL || (table != NULL && code_tuples == NULL)) {
+        Py_CLEAR(result);
+        PyErr_NoMemory();
+    }
+
+    for (size_t i = 0; result != NULL && table != NULL && i < count; i++) {
+        PyObject* sample = raw_sample_to_tuple(&samples[i], &frames[i * max_nframes], table, code_tuples);
+        if (sample == NULL || PyList_Append(result, sample) < 0)
+            Py_CLEAR(result);
+        Py_XDECREF(sample);
+    }
+
+    if (table != NULL) {
+        if (code_tuples != NULL) {
+            for (size_t i = 0; i < table->count; i++)
+                Py_XDECREF(code_tuples[i]);
+            PyMem_RawFree(code_tuples);
+        }
+        code_table_clear(table);
+        pthread_mutex_lock(&sampler.lock);
+        sampler.spare_codes = table;
+        pthread_mutex_unlock(&sampler.lock);
+    }
+    PyMem_RawFree(samples);
+    PyMem_RawFree(frames);
+#endif
+
+    return result;
+}
+
+PyDoc_STRVAR(nogil_sampler_stats__doc__,
+             "stats($module, /)\n"
+             "--\n"
+             "\n"
+             "Return a dict with the number of samples taken, and the number of samples dropped because they\n"
+             "failed validation or because the buffer was full.\n");
+static PyObject*
+nogil_sampler_stats(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args))
+{
+    unsigned long long sample_count = 0, dropped_validation = 0, dropped_full = 0;
+
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    pthread_mutex_lock(&sampler.lock);
+    sample_count = sampler.sample_count;
+    dropped_validation = sampler.dropped_validation;
+    dropped_full = sampler.dropped_full;
+    pthread_mutex_unlock(&sampler.lock);
+#endif
+
+    return Py_BuildValue("{sKsKsK}",
+                         "samples",
+                         sample_count,
+                         "dropped_validation",
+                         dropped_validation,
+                         "dropped_full",
+                         dropped_full);
+}
+
+static PyMethodDef module_methods[] = {
+    { "start", (PyCFunction)nogil_sampler_start, METH_VARARGS, nogil_sampler_start__doc__ },
+    { "stop", (PyCFunction)nogil_sampler_stop, METH_NOARGS, nogil_sampler_stop__doc__ },
+    { "set_interval", (PyCFunction)nogil_sampler_set_interval, METH_VARARGS, nogil_sampler_set_interval__doc__ },
+    { "collect", (PyCFunction)nogil_sampler_collect, METH_NOARGS, nogil_sampler_collect__doc__ },
+    { "stats", (PyCFunction)nogil_sampler_stats, METH_NOARGS, nogil_sampler_stats__doc__ },
+    /* sentinel */
+    { NULL, NULL, 0, NULL }
+};
+
+PyDoc_STRVAR(module_doc, "Module to sample the stacks of Python threads without acquiring the GIL.");
+
+static struct PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT, "_nogil_sampler", module_doc, 0, /* non-negative size to be able to unload the module */
+    module_methods,        NULL,             NULL,       NULL, NULL,
+};
+
+PyMODINIT_FUNC
+PyInit__nogil_sampler(void)
+{
+    PyObject* m = PyModule_Create(&module_def);
+    if (m == NULL)
+        return NULL;
+
+#ifdef _NOGIL_SAMPLER_SUPPORTED
+    PyObject* is_supported = Py_True;
+#else
+    PyObject* is_supported = Py_False;
+#endif
+    Py_INCREF(is_supported);
+    if (PyModule_AddObject(m, "is_supported", is_supported) < 0) {
+        Py_DECREF(is_supported);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    return m;
+}
@@ -0,0 +1,13 @@
+import typing
+
+
+# (thread_id, thread_native_id, wall_time_ns, cpu_time_ns, frames)
+SampleType = typing.Tuple[int, int, int, int, typing.Tuple[typing.Tuple[str, int, str, str], ...]]
+
+is_supported: bool
+
+def start(interval: float, max_nframe: int) -> None: ...
+def stop() -> None: ...
+def set_interval(interval: float) -> None: ...
+def collect() -> typing.List[SampleType]: ...
+def stats() -> typing.Dict[str, int]: ...
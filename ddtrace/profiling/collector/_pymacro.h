@@ -1,6 +1,10 @@
 #ifndef _DDTRACE_MEMALLOC_PYMACRO
 #define _DDTRACE_MEMALLOC_PYMACRO
 
+#if PY_VERSION_HEX >= 0x030b0000
+#define _PY311_AND_LATER
+#endif
+
 #if PY_VERSION_HEX >= 0x03090000
 #define _PY39_AND_LATER
 #endif
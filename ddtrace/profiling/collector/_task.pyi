@@ -4,4 +4,7 @@ import typing
 def get_task(
     thread_id: int,
 ) -> typing.Tuple[typing.Optional[int], typing.Optional[str], typing.Optional[types.FrameType]]: ...
-def list_tasks() -> typing.List[typing.Tuple[int, str, types.FrameType]]: ...
+def sample_tasks(
+    thread_id: int, max_tasks: int
+) -> typing.Tuple[typing.List[typing.Tuple[int, str, types.FrameType]], int]: ...
+def list_tasks(thread_id: int) -> typing.List[typing.Tuple[int, str, types.FrameType]]: ...
@@ -1,3 +1,7 @@
+from cpython.genobject cimport PyGen_CheckExact
+from cpython.object cimport PyObject
+from cpython.weakref cimport PyWeakref_GetObject
+
 import sys
 from types import ModuleType
 import weakref
@@ -8,6 +12,11 @@ from .. import _asyncio
 from .. import _threading
 
 
+cdef extern from "Python.h":
+    bint PyCoro_CheckExact(object obj)
+    bint PyAsyncGen_CheckExact(object obj)
+
+
 _gevent_tracer = None
 
 
@@ -57,21 +66,95 @@ def install_greenlet_tracer(gevent):
     _gevent_tracer = DDGreenletTracer(gevent)
 
 
+cdef str _PENDING = "PENDING"
+
+# Position of the next task to sample when only sampling a subset of the tasks, so that successive collections
+# cycle through all the tasks. It is kept per event loop, as each thread samples the tasks of its own loop; the
+# greenlets of the threads without any loop share a single offset.
+_sample_offsets = weakref.WeakKeyDictionary()
+cdef Py_ssize_t _greenlets_sample_offset = 0
+
+
 cdef _asyncio_task_get_frame(task):
-    coro = task._coro
-    if hasattr(coro, "cr_frame"):
+    coro = getattr(task, "_coro", None)
+    # Check for the exact built-in types first, so that the common cases do not need any failed attribute lookup.
+    if PyCoro_CheckExact(coro):
         # async def
         return coro.cr_frame
-    elif hasattr(coro, "gi_frame"):
+    elif PyGen_CheckExact(coro):
         # legacy coroutines
         return coro.gi_frame
-    elif hasattr(coro, "ag_frame"):
+    elif PyAsyncGen_CheckExact(coro):
         # async generators
         return coro.ag_frame
+    elif hasattr(coro, "cr_frame"):
+        return coro.cr_frame
+    elif hasattr(coro, "gi_frame"):
+        return coro.gi_frame
+    elif hasattr(coro, "ag_frame"):
+        return coro.ag_frame
     # unknown
     return None
 
 
+cdef _asyncio_task_get_name(task):
+    IF PY_VERSION_HEX >= 0x03080000:
+        # Call the method directly rather than going through the indirection set up by the _asyncio module
+        return task.get_name()
+    ELSE:
+        return _asyncio._task_get_name(task)
+
+
+cdef _asyncio_current_task(loop):
+    tasks_module = sys.modules.get("asyncio.tasks")
+    current_tasks = getattr(tasks_module, "_current_tasks", None)
+    if type(current_tasks) is dict:
+        # This is what asyncio.current_task does, without the function calls
+        return (<dict>current_tasks).get(loop)
+    return _asyncio.current_task(loop)
+
+
+cdef inline bint _asyncio_task_is_pending(task, loop):
+    return getattr(task, "_loop", None) is loop and getattr(task, "_state", None) == _PENDING
+
+
+cdef list _asyncio_pending_tasks(loop):
+    """Return the pending tasks of a loop.
+
+    This reads the task registries of asyncio directly rather than calling ``asyncio.all_tasks``, which goes through
+    several Python function calls for each task.
+    """
+    cdef list tasks = []
+    cdef PyObject* task
+
+    tasks_module = sys.modules.get("asyncio.tasks")
+    # Python ≥ 3.12 splits the registry between scheduled and eager tasks
+    weak_tasks = getattr(tasks_module, "_scheduled_tasks", None)
+    if weak_tasks is None:
+        weak_tasks = getattr(tasks_module, "_all_tasks", None)
+    weak_tasks_data = getattr(weak_tasks, "data", None)
+
+    if type(weak_tasks_data) is not set:
+        # Unknown asyncio implementation
+        return list(_asyncio.all_tasks(loop))
+
+    # Take a copy: dropping references below may trigger the removal callback of the WeakSet.
+    for ref in list(<set>weak_tasks_data):
+        task = PyWeakref_GetObject(ref)
+        if task is NULL or <object>task is None:
+            continue
+        if _asyncio_task_is_pending(<object>task, loop):
+            tasks.append(<object>task)
+
+    eager_tasks = getattr(tasks_module, "_eager_tasks", None)
+    if type(eager_tasks) is set:
+        for eager_task in list(<set>eager_tasks):
+            if _asyncio_task_is_pending(eager_task, loop):
+                tasks.append(eager_task)
+
+    return tasks
+
+
 cpdef get_task(thread_id):
     """Return the task id and name for a thread."""
     task_id = None
@@ -80,10 +163,10 @@ cpdef get_task(thread_id):
 
     loop = _asyncio.get_event_loop_for_thread(thread_id)
     if loop is not None:
-        task = _asyncio.current_task(loop)
+        task = _asyncio_current_task(loop)
         if task is not None:
             task_id = id(task)
-            task_name = _asyncio._task_get_name(task)
+            task_name = _asyncio_task_get_name(task)
             frame = _asyncio_task_get_frame(task)
 
     # gevent greenlet support:
@@ -99,41 +182,77 @@ cpdef get_task(thread_id):
     return task_id, task_name, frame
 
 
-cpdef list_tasks(thread_id):
-    # type: (...) -> typing.List[typing.Tuple[int, str, types.FrameType]]
-    """Return the list of running tasks.
+cpdef sample_tasks(thread_id, Py_ssize_t max_tasks):
+    # type: (...) -> typing.Tuple[typing.List[typing.Tuple[int, str, types.FrameType]], int]
+    """Return the running tasks of a thread, or a subset of them.
 
-    This is computed for gevent by taking the list of existing threading.Thread object and removing if any real OS
-    thread that might be running.
+    When there are more than ``max_tasks`` tasks, only ``max_tasks`` of them are returned. Successive calls return
+    the next tasks in a round-robin fashion. The names and frames are only retrieved for the returned tasks.
 
-    :return: [(task_id, task_name, task_frame), ...]"""
+    :param max_tasks: The maximum number of tasks to return, or 0 to return all of them.
+    :return: ([(task_id, task_name, task_frame), ...], total number of tasks)"""
+    global _greenlets_sample_offset
 
-    tasks = []
+    cdef list greenlets = []
+    cdef list pending = []
+    cdef list tasks
+    cdef Py_ssize_t ntasks, ngreenlets, index, i, offset
 
     if _gevent_tracer is not None:
         if type(_threading.get_thread_by_id(thread_id)).__name__.endswith("_MainThread"):
             # Under normal circumstances, the Hub is running in the main thread.
             # Python will only ever have a single instance of a _MainThread
             # class, so if we find it we attribute all the greenlets to it.
-            tasks.extend(
-                [
-                    (
-                        greenlet_id,
-                        _threading.get_thread_name(greenlet_id),
-                        greenlet.gr_frame
-                    )
-                    for greenlet_id, greenlet in dict(_gevent_tracer.greenlets).items()
-                    if not greenlet.dead
-                ]
-            )
+            greenlets = [
+                (
+                    greenlet_id,
+                    _threading.get_thread_name(greenlet_id),
+                    greenlet.gr_frame
+                )
+                for greenlet_id, greenlet in dict(_gevent_tracer.greenlets).items()
+                if not greenlet.dead
+            ]
 
     loop = _asyncio.get_event_loop_for_thread(thread_id)
     if loop is not None:
-        tasks.extend([
-            (id(task),
-                _asyncio._task_get_name(task),
-                _asyncio_task_get_frame(task))
-            for task in _asyncio.all_tasks(loop)
-        ])
+        pending = _asyncio_pending_tasks(loop)
 
-    return tasks
+    ngreenlets = len(greenlets)
+    ntasks = ngreenlets + len(pending)
+
+    if max_tasks <= 0 or ntasks <= max_tasks:
+        return greenlets + [
+            (id(task), _asyncio_task_get_name(task), _asyncio_task_get_frame(task)) for task in pending
+        ], ntasks
+
+    if loop is None:
+        offset = _greenlets_sample_offset
+    else:
+        offset = _sample_offsets.get(loop, 0)
+
+    tasks = []
+    for i in range(max_tasks):
+        index = (offset + i) % ntasks
+        if index < ngreenlets:
+            tasks.append(greenlets[index])
+        else:
+            task = pending[index - ngreenlets]
+            tasks.append((id(task), _asyncio_task_get_name(task), _asyncio_task_get_frame(task)))
+    offset = (offset + max_tasks) % ntasks
+    if loop is None:
+        _greenlets_sample_offset = offset
+    else:
+        _sample_offsets[loop] = offset
+
+    return tasks, ntasks
+
+
+cpdef list_tasks(thread_id):
+    # type: (...) -> typing.List[typing.Tuple[int, str, types.FrameType]]
+    """Return the list of running tasks.
+
+    This is computed for gevent by taking the list of existing threading.Thread object and removing if any real OS
+    thread that might be running.
+
+    :return: [(task_id, task_name, task_frame), ...]"""
+    return sample_tasks(thread_id, 0)[0]
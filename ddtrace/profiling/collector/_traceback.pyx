@@ -8,6 +8,10 @@ from ddtrace.profiling.event import DDFrame
 log = get_logger(__name__)
 
 
+cdef extern from "_class_name.h":
+    object class_name_lookup(object code)
+
+
 cpdef _extract_class_name(frame):
     # type: (...) -> str
     """Extract class name from a frame, if possible.
@@ -15,9 +19,15 @@ cpdef _extract_class_name(frame):
     :param frame: The frame object.
     """
     code = frame.f_code
-    if code.co_argcount > 0:
-        # Retrieve the name of the first argument, if the code object has any
-        argname = code.co_varnames[0]
+    IF PY_VERSION_HEX >= 0x030b0000:
+        # The class name is derived from the qualified name of the code object, and cached. This avoids accessing
+        # f_locals, which forces the locals of the frame to be materialized.
+        return class_name_lookup(code)
+    ELSE:
+        # Only the name of the first argument is cached; its value still needs to be looked up in the frame.
+        argname = class_name_lookup(code)
+        if not argname:
+            return ""
         try:
             value = frame.f_locals[argname]
         except Exception:
@@ -26,11 +36,9 @@ cpdef _extract_class_name(frame):
         try:
             if argname == "self":
                 return object.__getattribute__(type(value), "__name__")  # use type() and object.__getattribute__ to avoid side-effects
-            if argname == "cls":
-                return object.__getattribute__(value, "__name__")
+            return object.__getattribute__(value, "__name__")
         except AttributeError:
             return ""
-    return ""
 
 
 cpdef traceback_to_frames(traceback, max_nframes):
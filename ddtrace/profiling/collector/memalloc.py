@@ -112,14 +112,18 @@ class MemoryCollector(collector.PeriodicCollector):
             return tuple()
 
         if self._export_libdd_enabled:
+            # The heap profile can be uploaded less often than snapshots are taken: only the last one is sent
+            ddup.start_snapshot(ddup.SAMPLE_TYPE_HEAP)
             for (frames, nframes, thread_id), size in events:
                 if not self.ignore_profiler or thread_id not in thread_id_ignore_set:
-                    handle = ddup.SampleHandle()
+                    handle = ddup.SampleHandle(ddup.SAMPLE_TYPE_HEAP)
                     handle.push_heap(size)
                     handle.push_threadinfo(
                         thread_id, _threading.get_thread_native_id(thread_id), _threading.get_thread_name(thread_id)
                     )
                     try:
+                        if frames:
+                            handle.push_class_name(frames[0].class_name)
                         for frame in frames:
                             handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
                         handle.flush_sample()
@@ -166,12 +170,14 @@ class MemoryCollector(collector.PeriodicCollector):
             for (frames, nframes, thread_id), size, _domain in events:
                 if thread_id in thread_id_ignore_set:
                     continue
-                handle = ddup.SampleHandle()
+                handle = ddup.SampleHandle(ddup.SAMPLE_TYPE_ALLOCATION)
                 handle.push_alloc(int((ceil(size) * alloc_count) / count), count)  # Roundup to help float precision
                 handle.push_threadinfo(
                     thread_id, _threading.get_thread_native_id(thread_id), _threading.get_thread_name(thread_id)
                 )
                 try:
+                    if frames:
+                        handle.push_class_name(frames[0].class_name)
                     for frame in frames:
                         handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
                     handle.flush_sample()
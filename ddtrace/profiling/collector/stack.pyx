@@ -20,9 +20,17 @@ from ddtrace.profiling import collector
 from ddtrace.profiling.collector import _task
 from ddtrace.profiling.collector import _traceback
 from ddtrace.profiling.collector import stack_event
+from ddtrace.profiling.event import DDFrame
 from ddtrace.settings.profiling import config
 
 
+try:
+    from ddtrace.profiling.collector import _nogil_sampler
+except ImportError:
+    # The GIL-free sampler is not built on Windows
+    _nogil_sampler = None
+
+
 LOG = logging.getLogger(__name__)
 
 
@@ -37,6 +45,9 @@ FEATURES = {
 # the now-experimental interface.
 cdef bint use_libdd = False
 
+# Stack samples carry both CPU and wall time, so they must be collected into the same profile
+_WALL_SAMPLE_TYPES = ddup.SAMPLE_TYPE_CPU | ddup.SAMPLE_TYPE_WALL
+
 cdef void set_use_libdd(bint flag):
     global use_libdd
     use_libdd = flag
@@ -288,7 +299,9 @@ cdef collect_threads(thread_id_ignore_list, thread_time, thread_span_links) with
     )
 
 
-cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_time, thread_span_links, collect_endpoint):
+cdef stack_collect(
+    ignore_profiler, thread_time, max_nframes, max_tasks, interval, wall_time, thread_span_links, collect_endpoint
+):
     # Do not use `threading.enumerate` to not mess with locking (gevent!)
     thread_id_ignore_list = {
         thread_id
@@ -312,7 +325,10 @@ cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_tim
             # Effectively we would be discarding a negligible number of samples.
             continue
 
-        tasks = _task.list_tasks(thread_id)
+        tasks, ntasks = _task.sample_tasks(thread_id, max_tasks)
+
+        # When only a subset of the tasks is sampled, each of them stands for the ones that were not
+        task_wall_time = wall_time * ntasks // len(tasks) if tasks else wall_time
 
         # Inject wall time for all running tasks
         for task_id, task_name, task_pyframes in tasks:
@@ -321,20 +337,21 @@ cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_tim
             if task_pyframes is None:
                 continue
 
-            frames, nframes = _traceback.pyframe_to_frames(task_pyframes, max_nframes)
-
-            if nframes:
-                if use_libdd:
-                    handle = ddup.SampleHandle()
-                    handle.push_walltime(wall_time, 1)
+            if use_libdd:
+                # Frames are walked natively and pushed straight into the sample; only the leaf frame goes
+                # through the Python-level class name extraction.
+                handle = ddup.SampleHandle(_WALL_SAMPLE_TYPES)
+                if handle.push_pyframes(task_pyframes, max_nframes) > 0:
+                    handle.push_walltime(task_wall_time, 1)
                     handle.push_threadinfo(thread_id, thread_native_id, thread_name)
                     handle.push_task_id(task_id)
                     handle.push_task_name(task_name)
-                    handle.push_class_name(frames[0].class_name)
-                    for frame in frames:
-                        handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
+                    handle.push_class_name(_traceback._extract_class_name(task_pyframes))
                     handle.flush_sample()
-                else:
+            else:
+                frames, nframes = _traceback.pyframe_to_frames(task_pyframes, max_nframes)
+
+                if nframes:
                     stack_events.append(
                         stack_event.StackSampleEvent(
                             thread_id=thread_id,
@@ -343,25 +360,24 @@ cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_tim
                             task_id=task_id,
                             task_name=task_name,
                             nframes=nframes, frames=frames,
-                            wall_time_ns=wall_time,
+                            wall_time_ns=task_wall_time,
                             sampling_period=int(interval * 1e9),
                         )
                     )
 
-        frames, nframes = _traceback.pyframe_to_frames(thread_pyframes, max_nframes)
-
-        if nframes:
-            if use_libdd:
-                handle = ddup.SampleHandle()
+        if use_libdd:
+            handle = ddup.SampleHandle(_WALL_SAMPLE_TYPES)
+            if handle.push_pyframes(thread_pyframes, max_nframes) > 0:
                 handle.push_cputime( cpu_time, 1)
                 handle.push_walltime( wall_time, 1)
                 handle.push_threadinfo(thread_id, thread_native_id, thread_name)
-                handle.push_class_name(frames[0].class_name)
-                for frame in frames:
-                    handle.push_frame(frame.function_name, frame.file_name, 0, frame.lineno)
+                handle.push_class_name(_traceback._extract_class_name(thread_pyframes))
                 handle.push_span(span, collect_endpoint)
                 handle.flush_sample()
-            else:
+        else:
+            frames, nframes = _traceback.pyframe_to_frames(thread_pyframes, max_nframes)
+
+            if nframes:
                 event = stack_event.StackSampleEvent(
                     thread_id=thread_id,
                     thread_native_id=thread_native_id,
@@ -384,7 +400,7 @@ cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_tim
 
             if nframes:
                 if use_libdd:
-                    handle = ddup.SampleHandle()
+                    handle = ddup.SampleHandle(ddup.SAMPLE_TYPE_EXCEPTION)
                     handle.push_threadinfo(thread_id, thread_native_id, thread_name)
                     handle.push_exceptioninfo(exc_type, 1)
                     handle.push_class_name(frames[0].class_name)
@@ -410,6 +426,72 @@ cdef stack_collect(ignore_profiler, thread_time, max_nframes, interval, wall_tim
     return stack_events, exc_events
 
 
+cdef nogil_collect(ignore_profiler, dict last_cpu_times, interval, thread_span_links, collect_endpoint):
+    # The samples have been taken by the native sampling thread without the GIL; we only resolve thread names and
+    # spans here, so they reflect the state at collection time rather than at sampling time.
+    thread_id_ignore_list = {
+        thread_id
+        for thread_id, thread in ddtrace_threading._active.items()
+        if getattr(thread, "_ddtrace_profiling_ignore", False)
+    } if ignore_profiler else set()
+
+    samples = _nogil_sampler.collect()
+
+    if thread_span_links:
+        # Threads which were not sampled in this period are still alive and keep their links: these are only set
+        # when a span is activated.
+        thread_span_links.clear_threads(set(ddtrace_threading._active) | set(sample[0] for sample in samples))
+
+    stack_events = []
+    sampling_period = int(interval * 1e9)
+
+    for thread_id, thread_native_id, wall_time, abs_cpu_time, frames, sampled_at_ns in samples:
+        if thread_id in thread_id_ignore_list:
+            continue
+
+        thread_name = _threading.get_thread_name(thread_id)
+        if thread_name is None:
+            continue
+
+        if abs_cpu_time < 0:
+            cpu_time = 0
+        else:
+            cpu_time = max(0, abs_cpu_time - last_cpu_times.get(thread_native_id, abs_cpu_time))
+            last_cpu_times[thread_native_id] = abs_cpu_time
+
+        span = thread_span_links.get_active_span_from_thread_id(thread_id) if thread_span_links else None
+
+        if use_libdd:
+            handle = ddup.SampleHandle(_WALL_SAMPLE_TYPES)
+            # The sample was taken before this collection, which would otherwise be the time of the sample
+            handle.push_monotonic_ns(sampled_at_ns)
+            handle.push_cputime(cpu_time, 1)
+            handle.push_walltime(wall_time, 1)
+            handle.push_threadinfo(thread_id, thread_native_id, thread_name)
+            handle.push_class_name(frames[0][3])
+            for file_name, lineno, function_name, _ in frames:
+                handle.push_frame(function_name, file_name, 0, lineno)
+            handle.push_span(span, collect_endpoint)
+            handle.flush_sample()
+        else:
+            event = stack_event.StackSampleEvent(
+                thread_id=thread_id,
+                thread_native_id=thread_native_id,
+                thread_name=thread_name,
+                task_id=None,
+                task_name=None,
+                nframes=len(frames),
+                frames=[DDFrame(*frame) for frame in frames],
+                wall_time_ns=wall_time,
+                cpu_time_ns=cpu_time,
+                sampling_period=sampling_period,
+            )
+            event.set_trace_info(span, collect_endpoint)
+            stack_events.append(event)
+
+    return stack_events, []
+
+
 if typing.TYPE_CHECKING:
     _thread_span_links_base = _threading._ThreadLink[ddspan.Span]
 else:
@@ -464,6 +546,7 @@ class StackCollector(collector.PeriodicCollector):
 
     max_time_usage_pct = attr.ib(type=float, default=config.max_time_usage_pct)
     nframes = attr.ib(type=int, default=config.max_frames)
+    max_tasks = attr.ib(type=int, default=config.stack.max_tasks)
     ignore_profiler = attr.ib(type=bool, default=config.ignore_profiler)
     endpoint_collection_enabled = attr.ib(default=None)
     tracer = attr.ib(default=None)
@@ -471,6 +554,8 @@ class StackCollector(collector.PeriodicCollector):
     _last_wall_time = attr.ib(init=False, repr=False, eq=False, type=int)
     _thread_span_links = attr.ib(default=None, init=False, repr=False, eq=False)
     _stack_collector_v2_enabled = attr.ib(type=bool, default=config.stack.v2.enabled)
+    _gil_free_enabled = attr.ib(type=bool, default=config.stack.gil_free)
+    _nogil_cpu_times = attr.ib(factory=dict, init=False, repr=False, eq=False)
 
     @max_time_usage_pct.validator
     def _check_max_time_usage(self, attribute, value):
@@ -493,7 +578,14 @@ class StackCollector(collector.PeriodicCollector):
         if self._stack_collector_v2_enabled:
             LOG.debug("Starting the stack v2 sampler")
             stack_v2.start()
-
+        elif self._gil_free_enabled:
+            if _nogil_sampler is not None and _nogil_sampler.is_supported:
+                LOG.debug("Starting the GIL-free stack sampler")
+                self._nogil_cpu_times = {}
+                _nogil_sampler.start(self.interval, self.nframes)
+            else:
+                LOG.debug("GIL-free stack sampling is not supported on this platform, falling back to the default")
+                self._gil_free_enabled = False
 
     def _start_service(self):
         # type: (...) -> None
@@ -514,6 +606,8 @@ class StackCollector(collector.PeriodicCollector):
         # Also tell the native thread running the v2 sampler to stop, if needed
         if self._stack_collector_v2_enabled:
             stack_v2.stop()
+        elif self._gil_free_enabled:
+            _nogil_sampler.stop()
 
     def _compute_new_interval(self, used_wall_time_ns):
         interval = (used_wall_time_ns / (self.max_time_usage_pct / 100.0)) - used_wall_time_ns
@@ -528,20 +622,33 @@ class StackCollector(collector.PeriodicCollector):
 
         # If the stack v2 collector is enabled, then do not collect the stack samples here.
         if not self._stack_collector_v2_enabled:
-            all_events = stack_collect(
-                self.ignore_profiler,
-                self._thread_time,
-                self.nframes,
-                self.interval,
-                wall_time,
-                self._thread_span_links,
-                self.endpoint_collection_enabled,
-            )
+            if self._gil_free_enabled:
+                # Stacks have already been sampled by the native thread, only drain them.
+                all_events = nogil_collect(
+                    self.ignore_profiler,
+                    self._nogil_cpu_times,
+                    self.interval,
+                    self._thread_span_links,
+                    self.endpoint_collection_enabled,
+                )
+            else:
+                all_events = stack_collect(
+                    self.ignore_profiler,
+                    self._thread_time,
+                    self.nframes,
+                    self.max_tasks,
+                    self.interval,
+                    wall_time,
+                    self._thread_span_links,
+                    self.endpoint_collection_enabled,
+                )
 
         used_wall_time_ns = compat.monotonic_ns() - now
         self.interval = self._compute_new_interval(used_wall_time_ns)
 
         if self._stack_collector_v2_enabled:
             stack_v2.set_interval(self.interval)
+        elif self._gil_free_enabled:
+            _nogil_sampler.set_interval(self.interval)
 
         return all_events
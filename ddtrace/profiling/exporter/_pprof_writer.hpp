@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef DD_PPROF_WRITER_GZIP
+#include <zlib.h>
+#endif
+
+// Protobuf wire format encoding for the pprof schema, without depending on the protobuf runtime or libdatadog.
+//
+// Nested messages are encoded in a ProtobufBuffer, since their length must be known before they can be written.
+// The top-level fields of the Profile message are then appended to a PprofStream as they are produced, which can
+// gzip-compress them on the fly: the uncompressed profile never needs to be held in memory as a whole.
+
+namespace ddtrace {
+
+enum WireType : uint8_t
+{
+    WIRE_TYPE_VARINT = 0,
+    WIRE_TYPE_LEN = 2,
+};
+
+class ProtobufBuffer
+{
+  public:
+    void varint(uint64_t value)
+    {
+        char bytes[10];
+        size_t len = 0;
+        while (value >= 0x80) {
+            bytes[len++] = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        bytes[len++] = static_cast<char>(value);
+        buf_.append(bytes, len);
+    }
+
+    void tag(uint32_t field, WireType wire_type) { varint((static_cast<uint64_t>(field) << 3) | wire_type); }
+
+    // proto3 does not serialize fields holding their default value
+    void uint64(uint32_t field, uint64_t value)
+    {
+        if (value != 0) {
+            tag(field, WIRE_TYPE_VARINT);
+            varint(value);
+        }
+    }
+
+    void int64(uint32_t field, int64_t value) { uint64(field, static_cast<uint64_t>(value)); }
+
+    void string(uint32_t field, const char* data, size_t size)
+    {
+        tag(field, WIRE_TYPE_LEN);
+        varint(size);
+        buf_.append(data, size);
+    }
+
+    void message(uint32_t field, const ProtobufBuffer& msg) { string(field, msg.data(), msg.size()); }
+
+    void clear() { buf_.clear(); }
+
+    const char* data() const { return buf_.data(); }
+    size_t size() const { return buf_.size(); }
+
+  private:
+    std::string buf_;
+};
+
+// Minimum room left in the output buffer for each call to zlib
+constexpr size_t chunk_size = 16384;
+
+class PprofStream
+{
+  public:
+    PprofStream() = default;
+    PprofStream(const PprofStream&) = delete;
+    PprofStream& operator=(const PprofStream&) = delete;
+
+    ~PprofStream()
+    {
+#ifdef DD_PPROF_WRITER_GZIP
+        if (gzip_) {
+            deflateEnd(&zstream_);
+        }
+#endif
+    }
+
+    // Compress the output with gzip. Must be called before anything is written; returns false if compression is not
+    // available, in which case the output is left uncompressed.
+    bool enable_gzip(int level)
+    {
+#ifdef DD_PPROF_WRITER_GZIP
+        if (gzip_) {
+            return true;
+        }
+        // 16 + MAX_WBITS: write a gzip header and trailer rather than a zlib one
+        if (deflateInit2(&zstream_, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        gzip_ = true;
+        return true;
+#else
+        (void)level;
+        return false;
+#endif
+    }
+
+    bool write(const char* data, size_t size)
+    {
+        if (!gzip_) {
+            out_.append(data, size);
+            size_ = out_.size();
+            return true;
+        }
+        return deflate_chunk(data, size, false);
+    }
+
+    bool write(const ProtobufBuffer& buf) { return write(buf.data(), buf.size()); }
+
+    bool string(uint32_t field, const char* data, size_t size)
+    {
+        header_.clear();
+        header_.tag(field, WIRE_TYPE_LEN);
+        header_.varint(size);
+        return write(header_) && write(data, size);
+    }
+
+    bool message(uint32_t field, const ProtobufBuffer& msg) { return string(field, msg.data(), msg.size()); }
+
+    // Flush the compressed stream, if any. Nothing can be written afterwards.
+    bool finish()
+    {
+        if (!gzip_) {
+            return true;
+        }
+        return deflate_chunk(nullptr, 0, true);
+    }
+
+    const char* data() const { return out_.data(); }
+    size_t size() const { return size_; }
+    bool gzip() const { return gzip_; }
+
+  private:
+    bool deflate_chunk(const char* data, size_t size, bool finish)
+    {
+#ifdef DD_PPROF_WRITER_GZIP
+        // zlib takes 32-bit lengths
+        while (size > UINT32_MAX) {
+            if (!deflate_chunk(data, UINT32_MAX, false)) {
+                return false;
+            }
+            data += UINT32_MAX;
+            size -= UINT32_MAX;
+        }
+
+        zstream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data)); // NOLINT
+        zstream_.avail_in = static_cast<uInt>(size);
+        const int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+        for (;;) {
+            if (out_.size() - size_ < chunk_size) {
+                out_.resize(out_.size() < chunk_size ? chunk_size : out_.size() * 2);
+            }
+            zstream_.next_out = reinterpret_cast<Bytef*>(&out_[size_]); // NOLINT
+            const size_t avail_out = out_.size() - size_;
+            zstream_.avail_out = static_cast<uInt>(avail_out > UINT32_MAX ? UINT32_MAX : avail_out);
+
+            const int ret = deflate(&zstream_, flush);
+            size_ = reinterpret_cast<char*>(zstream_.next_out) - &out_[0]; // NOLINT
+            if (ret == Z_STREAM_END) {
+                return true;
+            }
+            if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                return false;
+            }
+            // Without Z_FINISH, zlib may keep input in its window: it is done once it has consumed everything while
+            // leaving room in the output buffer.
+            if (!finish && zstream_.avail_in == 0 && zstream_.avail_out != 0) {
+                return true;
+            }
+        }
+#else
+        (void)data;
+        (void)size;
+        (void)finish;
+        return false;
+#endif
+    }
+
+    std::string out_;
+    // Number of bytes of out_ actually used: when compressing, out_ is grown ahead of what zlib writes
+    size_t size_ = 0;
+    bool gzip_ = false;
+    ProtobufBuffer header_;
+#ifdef DD_PPROF_WRITER_GZIP
+    z_stream zstream_{};
+#endif
+};
+
+} // namespace ddtrace
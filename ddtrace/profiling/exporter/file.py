@@ -1,4 +1,3 @@
-import gzip
 import os
 import typing  # noqa:F401
 
@@ -16,6 +15,8 @@ class PprofFileExporter(pprof.PprofExporter):
     prefix = attr.ib(default="profile", type=str)
     _increment = attr.ib(default=1, init=False, repr=False, type=int)
 
+    _compress = True
+
     def export(
         self,
         events,  # type: recorder.EventsType
@@ -33,7 +34,7 @@ class PprofFileExporter(pprof.PprofExporter):
         :param end_time_ns: The end time of recording.
         """
         profile, libs = super(PprofFileExporter, self).export(events, start_time_ns, end_time_ns)
-        with gzip.open(self.prefix + (".%d.%d" % (os.getpid(), self._increment)), "wb") as f:
-            f.write(profile.SerializeToString())
+        with open(self.prefix + (".%d.%d" % (os.getpid(), self._increment)), "wb") as f:
+            f.write(profile.SerializeToGzip())
         self._increment += 1
         return profile, libs
@@ -61,6 +61,8 @@ class PprofHTTPExporter(pprof.PprofExporter):
 
     endpoint_call_counter_span_processor = attr.ib(default=None, type=EndpointCallCounterProcessor)
 
+    _compress = True
+
     def _update_git_metadata_tags(self, tags):
         """
         Update profiler tags with git metadata
@@ -177,16 +179,13 @@ class PprofHTTPExporter(pprof.PprofExporter):
         container.update_headers_with_container_info(headers, self._container_info)
 
         profile, libs = super(PprofHTTPExporter, self).export(events, start_time_ns, end_time_ns)
-        pprof = io.BytesIO()
-        with gzip.GzipFile(fileobj=pprof, mode="wb") as gz:
-            gz.write(profile.SerializeToString())
 
         data = [
             {
                 "name": b"auto",
                 "filename": b"auto.pprof",
                 "content-type": b"application/octet-stream",
-                "data": pprof.getvalue(),
+                "data": profile.SerializeToGzip(),
             }
         ]
 
@@ -209,7 +208,7 @@ class PprofHTTPExporter(pprof.PprofExporter):
                 }
             )
 
-        service = self.service or os.path.basename(profile.string_table[profile.mapping[0].filename])
+        service = self.service or os.path.basename(profile.program_name)
         event = {
             "version": "4",
             "family": "python",
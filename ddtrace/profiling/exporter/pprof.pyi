@@ -30,102 +30,33 @@ class pprof_ProfileType:
     id: int
     string_table: typing.Dict[int, str]
     mapping: typing.List[pprof_Mapping]
+    program_name: str
     def SerializeToString(self) -> bytes: ...
+    def SerializeToGzip(self) -> bytes: ...
 
 class pprof_FunctionType:
     id: int
 
 HashableStackTraceType: Any
 
-class _PprofConverter:
-    def convert_stack_event(
-        self,
-        thread_id: str,
-        thread_native_id: str,
-        thread_name: str,
-        task_id: str,
-        task_name: str,
-        local_root_span_id: str,
-        span_id: str,
-        trace_resource: str,
-        trace_type: str,
-        frames: HashableStackTraceType,  # noqa
-        nframes: int,
-        samples: typing.List[stack_event.StackSampleEvent],
-    ) -> None: ...
-    def convert_memalloc_event(
-        self,
-        thread_id: str,
-        thread_native_id: str,
-        thread_name: str,
-        frames: HashableStackTraceType,  # noqa
-        nframes: int,
-        events: typing.List[memalloc.MemoryAllocSampleEvent],
-    ) -> None: ...
-    def convert_memalloc_heap_event(self, event: memalloc.MemoryHeapSampleEvent) -> None: ...
-    def convert_lock_acquire_event(
-        self,
-        lock_name: str,
-        thread_id: str,
-        thread_name: str,
-        task_id: str,
-        task_name: str,
-        local_root_span_id: str,
-        span_id: str,
-        trace_resource: str,
-        trace_type: str,
-        frames: HashableStackTraceType,  # noqa
-        nframes: int,
-        events: typing.List[_lock.LockAcquireEvent],
-        sampling_ratio: float,
-    ) -> None: ...
-    def convert_lock_release_event(
-        self,
-        lock_name: str,
-        thread_id: str,
-        thread_name: str,
-        task_id: str,
-        task_name: str,
-        local_root_span_id: str,
-        span_id: str,
-        trace_resource: str,
-        trace_type: str,
-        frames: HashableStackTraceType,  # noqa
-        nframes: int,
-        events: typing.List[_lock.LockReleaseEvent],
-        sampling_ratio: float,
-    ) -> None: ...
-    def convert_stack_exception_event(
-        self,
-        thread_id: str,
-        thread_native_id: str,
-        thread_name: str,
-        local_root_span_id: str,
-        span_id: str,
-        trace_resource: str,
-        trace_type: str,
-        frames: HashableStackTraceType,  # noqa
-        nframes: int,
-        exc_type_name: str,
-        events: typing.List[stack_event.StackExceptionSampleEvent],
-    ) -> None: ...
-    def __init__(
-        self,
-        functions: Any,
-        locations: Any,
-        string_table: Any,
-        last_location_id: Any,
-        last_func_id: Any,
-        location_values: Any,
-    ) -> None: ...
-    def __lt__(self, other: Any) -> Any: ...
-    def __le__(self, other: Any) -> Any: ...
-    def __gt__(self, other: Any) -> Any: ...
-    def __ge__(self, other: Any) -> Any: ...
+SAMPLE_TYPES: typing.Tuple[typing.Tuple[str, str], ...]
+
+class _EncodedProfile:
+    program_name: str
+    def __init__(self, data: bytes, gzipped: bool = ..., program_name: str = ...) -> None: ...
+    def SerializeToString(self) -> bytes: ...
+    def SerializeToGzip(self) -> bytes: ...
+    def __getattr__(self, name: str) -> Any: ...
 
-StackEventGroupKey: Any
-LockEventGroupKey: Any
-StackExceptionEventGroupKey: Any
+class _PprofBuilder:
+    def add_stack_event(self, event: stack_event.StackSampleEvent) -> None: ...
+    def add_stack_exception_event(self, event: stack_event.StackExceptionSampleEvent) -> None: ...
+    def add_lock_event(self, event: _lock.LockEventBase, acquire: bool, sampling_ratio: float) -> None: ...
+    def add_memalloc_event(self, event: memalloc.MemoryAllocSampleEvent) -> None: ...
+    def add_memalloc_heap_event(self, event: memalloc.MemoryHeapSampleEvent) -> None: ...
+    def build(
+        self, start_time_ns: int, duration_ns: int, program_name: str, compress: bool = ...
+    ) -> typing.Tuple[_EncodedProfile, typing.Set[str]]: ...
 
 class PprofExporter(exporter.Exporter):
     def export(
@@ -1,16 +1,16 @@
-import collections
-import itertools
+from libc.stdint cimport int64_t
+from libc.stdint cimport uint64_t
+
+import gzip
 import operator
 import platform
 import sysconfig
 import typing
 
 import attr
-import six
 
 from ddtrace import ext
 from ddtrace.internal import packages
-from ddtrace.internal._encoding import ListStringTable as _StringTable
 from ddtrace.internal.compat import ensure_text
 from ddtrace.internal.datadog.profiling.ddup.utils import sanitize_string
 from ddtrace.internal.logger import get_logger
@@ -115,8 +115,6 @@ else:
 
 
 _ITEMGETTER_ZERO = operator.itemgetter(0)
-_ITEMGETTER_ONE = operator.itemgetter(1)
-_ATTRGETTER_ID = operator.attrgetter("id")
 
 
 cdef str _none_to_str(object value):
@@ -155,298 +153,438 @@ class pprof_ProfileType(object):
     id: int
     string_table: typing.Dict[int, str]
     mapping: typing.List[pprof_Mapping]
+    program_name: str
 
     def SerializeToString(self) -> bytes:  # type: ignore[empty-body]
         ...
 
+    def SerializeToGzip(self) -> bytes:  # type: ignore[empty-body]
+        ...
+
 
 class pprof_FunctionType(object):
     # pprof_pb2.Function
     id: int
 
 
-_Label_T = typing.Tuple[str, str]
-_Label_List_T = typing.Tuple[_Label_T, ...]
-_Location_Key_T = typing.Tuple[typing.Tuple[int, ...], _Label_List_T]
-
-
 HashableStackTraceType = typing.Tuple[event.DDFrame, ...]
 
 
-@attr.s
-class _PprofConverter(object):
-    """Convert stacks generated by a Profiler to pprof format."""
+SAMPLE_TYPES = (
+    ("cpu-samples", "count"),
+    ("cpu-time", "nanoseconds"),
+    ("wall-time", "nanoseconds"),
+    ("exception-samples", "count"),
+    ("lock-acquire", "count"),
+    ("lock-acquire-wait", "nanoseconds"),
+    ("lock-release", "count"),
+    ("lock-release-hold", "nanoseconds"),
+    ("alloc-samples", "count"),
+    ("alloc-space", "bytes"),
+    ("heap-space", "bytes"),
+)
 
-    # Those attributes will be serialize in a `pprof_pb2.Profile`
-    _functions = attr.ib(
-        init=False, factory=dict, type=typing.Dict[typing.Tuple[str, typing.Optional[str]], pprof_FunctionType]
-    )
-    _locations = attr.ib(init=False, factory=dict, type=typing.Dict[typing.Tuple[str, int, str], pprof_LocationType])
-    _string_table = attr.ib(init=False, factory=_StringTable)
-
-    _last_location_id = attr.ib(init=False, factory=lambda: itertools.count(1))
-    _last_func_id = attr.ib(init=False, factory=lambda: itertools.count(1))
-
-    # A dict where key is a (Location, [Labels]) and value is a a dict.
-    # This dict has sample-type (e.g. "cpu-time") as key and the numeric value.
-    _location_values = attr.ib(
-        factory=lambda: collections.defaultdict(lambda: collections.defaultdict(lambda: 0)),
-        init=False,
-        repr=False,
-        type=typing.DefaultDict[_Location_Key_T, typing.DefaultDict[str, int]],
-    )
-
-    def _to_Function(
-        self,
-        filename,  # type: str
-        funcname,  # type: str
-    ):
-        # type: (...) -> pprof_FunctionType
-        # filename/funcname are "guaranteed" to be str, but on 3.11 and later
-        # they may (erroneously?) be bytes.  Try to fix this.
-        filename = sanitize_string(filename)
-        funcname = sanitize_string(funcname)
-        try:
-            return self._functions[(filename, funcname)]
-        except KeyError:
-            func = pprof_pb2.Function(
-                id=next(self._last_func_id),
-                name=self._str(funcname),
-                filename=self._str(filename),
-            )
-            self._functions[(filename, funcname)] = func
-            return func
-
-    def _to_Location(
-        self,
-        filename,  # type: str
-        lineno,  # type: int
-        funcname,  # type: str
-    ):
-        # type: (...) -> pprof_LocationType
-        # filename/funcname are "guaranteed" to be str, but on 3.11 and later
-        # they may (erroneously?) be bytes.  Try to fix this.
-        filename = sanitize_string(filename)
-        funcname = sanitize_string(funcname)
-        try:
-            return self._locations[(filename, lineno, funcname)]
-        except KeyError:
-            location = pprof_pb2.Location(
-                id=next(self._last_location_id),
-                line=[
-                    pprof_pb2.Line(
-                        function_id=self._to_Function(filename, funcname).id,
-                        line=lineno,
-                    ),
-                ],
-            )
-            self._locations[(filename, lineno, funcname)] = location
-            return location
-
-    def _str(self, string: typing.Optional[str]) -> int:
-        """Convert a string to an id from the string table."""
-        return self._string_table.index(str(string))
-
-    def _to_locations(
-        self,
-        frames,  # type: typing.Sequence[event.DDFrame]
-        nframes,  # type: int
-    ):
-        # type: (...) -> typing.Tuple[int, ...]
-        locations = [
-            self._to_Location(filename, lineno, funcname).id for filename, lineno, funcname, class_name in frames
-        ]
+# Indexes in SAMPLE_TYPES
+cdef enum:
+    _CPU_SAMPLES = 0
+    _CPU_TIME = 1
+    _WALL_TIME = 2
+    _EXCEPTION_SAMPLES = 3
+    _LOCK_ACQUIRE = 4
+    _LOCK_ACQUIRE_WAIT = 5
+    _LOCK_RELEASE = 6
+    _LOCK_RELEASE_HOLD = 7
+    _ALLOC_SAMPLES = 8
+    _ALLOC_SPACE = 9
+    _HEAP_SPACE = 10
+    _NB_SAMPLE_TYPES = 11
+
+
+cdef enum:
+    # Maximum number of stacks cached in an export period; past it, the locations of new stacks are not cached
+    _MAX_STACKS = 65536
+
+
+cdef extern from "_pprof_writer.hpp" namespace "ddtrace":
+    cdef cppclass ProtobufBuffer:
+        void varint(uint64_t value) except +
+        void uint64(int field, uint64_t value) except +
+        void int64(int field, int64_t value) except +
+        void string(int field, const char* data, size_t size) except +
+        void message(int field, const ProtobufBuffer& msg) except +
+        void clear()
+
+    cdef cppclass PprofStream:
+        bint enable_gzip(int level)
+        bint write(const ProtobufBuffer& buf) except +
+        bint string(int field, const char* data, size_t size) except +
+        bint message(int field, const ProtobufBuffer& msg) except +
+        bint finish() except +
+        const char* data()
+        size_t size()
+        bint gzip()
+
+
+cdef str _get_event_trace_resource(object event):
+    trace_resource = ""
+    # Do not export trace_resource for non Web spans for privacy concerns.
+    if event.trace_resource_container and event.trace_type == ext.SpanTypes.WEB:
+        (trace_resource,) = event.trace_resource_container
+    return ensure_text(trace_resource, errors="backslashreplace")
+
+
+cdef Py_ssize_t _string_id(dict strings, list string_table, object value):
+    """Return the index of a string in the string table of a profile, adding it if needed."""
+    index = strings.get(value)
+    if index is None:
+        if type(value) is not str:
+            return _string_id(strings, string_table, str(value))
+        index = strings[value] = len(string_table)
+        string_table.append(value)
+    return index
+
+
+cdef inline void _write_string(PprofStream& stream, int field, str value) except *:
+    cdef bytes data = value.encode("utf-8", "backslashreplace")
+    if not stream.string(field, data, len(data)):
+        raise RuntimeError("Failed to write profile")
+
+
+cdef inline void _write_message(PprofStream& stream, int field, const ProtobufBuffer& msg) except *:
+    if not stream.message(field, msg):
+        raise RuntimeError("Failed to write profile")
+
+
+class _EncodedProfile(object):
+    """A profile serialized in pprof format, possibly gzip-compressed.
+
+    The profile is only decoded when one of its fields is accessed, which is meant for inspection and tests.
+    """
+
+    __slots__ = ("_data", "_gzipped", "_decoded", "program_name")
+
+    def __init__(self, data: bytes, gzipped: bool = False, program_name: str = "") -> None:
+        self._data = data
+        self._gzipped = gzipped
+        self._decoded = None
+        # Name of the main binary; also in the mapping, but without having to decode the profile
+        self.program_name = program_name
+
+    def SerializeToString(self) -> bytes:
+        if self._gzipped:
+            return gzip.decompress(self._data)
+        return self._data
+
+    def SerializeToGzip(self) -> bytes:
+        if self._gzipped:
+            return self._data
+        return gzip.compress(self._data)
+
+    def __getattr__(self, name: str) -> typing.Any:
+        if name.startswith("_"):
+            raise AttributeError(name)
+        if self._decoded is None:
+            self._decoded = pprof_pb2.Profile.FromString(self.SerializeToString())
+        return getattr(self._decoded, name)
+
+
+cdef class _PprofBuilder(object):
+    """Aggregate profiling events and serialize them to pprof.
+
+    Functions, locations and stacks are interned for an export period, and the tables are reset with the samples
+    after each export, so that their size stays bounded in applications that keep generating new code. Events are
+    aggregated one at a time into samples, keyed by their locations and labels.
+    """
+
+    # Interned for the current period
+    cdef dict _function_ids  # (filename, funcname) -> function index
+    cdef list _function_names
+    cdef list _function_filenames
+    cdef dict _location_ids  # (filename, lineno, funcname) -> location index
+    cdef list _location_functions
+    cdef list _location_lines
+    cdef dict _stacks  # (frames, nframes) -> tuple of location indexes
+
+    # Samples of the current period
+    cdef dict _samples  # (locations, labels) -> values
+    cdef int64_t _sum_period
+    cdef int64_t _nb_period
+
+    def __cinit__(self):
+        self._reset_tables()
+        self._samples = {}
+        self._sum_period = 0
+        self._nb_period = 0
+
+    cdef void _reset_tables(self):
+        self._function_ids = {}
+        self._function_names = []
+        self._function_filenames = []
+        self._location_ids = {}
+        self._location_functions = []
+        self._location_lines = []
+        self._stacks = {}
+
+    cdef Py_ssize_t _function(self, str filename, str funcname):
+        key = (filename, funcname)
+        function_id = self._function_ids.get(key)
+        if function_id is None:
+            function_id = len(self._function_names)
+            self._function_names.append(funcname)
+            self._function_filenames.append(filename)
+            self._function_ids[key] = function_id
+        return function_id
+
+    cdef Py_ssize_t _location(self, filename, lineno, funcname):
+        key = (filename, lineno, funcname)
+        location_id = self._location_ids.get(key)
+        if location_id is None:
+            # filename/funcname are "guaranteed" to be str, but on 3.11 and later
+            # they may (erroneously?) be bytes.  Try to fix this.
+            location_id = len(self._location_functions)
+            self._location_functions.append(self._function(sanitize_string(filename), sanitize_string(funcname)))
+            self._location_lines.append(lineno)
+            self._location_ids[key] = location_id
+        return location_id
+
+    cdef tuple _locations(self, frames, Py_ssize_t nframes):
+        cdef tuple key = (tuple(frames), nframes)
+        cdef list locations
+
+        stack = self._stacks.get(key)
+        if stack is not None:
+            return stack
+
+        locations = [self._location(filename, lineno, funcname) for filename, lineno, funcname, class_name in frames]
 
         omitted = nframes - len(frames)
-        if omitted:
-            locations.append(
-                self._to_Location("", 0, "<%d frame%s omitted>" % (omitted, ("s" if omitted > 1 else ""))).id
-            )
-
-        return tuple(locations)
-
-    def convert_stack_event(
-        self,
-        thread_id,  # type: str
-        thread_native_id,  # type: str
-        thread_name,  # type: str
-        task_id,  # type: str
-        task_name,  # type: str
-        local_root_span_id,  # type: str
-        span_id,  # type: str
-        trace_resource,  # type: str
-        trace_type,  # type: str
-        frames,  # type: HashableStackTraceType
-        nframes,  # type: int
-        samples,  # type: typing.List[stack_event.StackSampleEvent]
-    ):
-        # type: (...) -> None
-        location_key = (
-            self._to_locations(frames, nframes),
+        if omitted > 0:
+            locations.append(self._location("", 0, "<%d frame%s omitted>" % (omitted, ("s" if omitted > 1 else ""))))
+
+        stack = tuple(locations)
+        if len(self._stacks) < _MAX_STACKS:
+            self._stacks[key] = stack
+        return stack
+
+    cdef list _values(self, tuple locations, tuple labels):
+        key = (locations, labels)
+        values = self._samples.get(key)
+        if values is None:
+            values = [0] * _NB_SAMPLE_TYPES
+            self._samples[key] = values
+        return values
+
+    def add_stack_event(self, event) -> None:
+        frames = event.frames
+        cdef list values = self._values(
+            self._locations(frames, event.nframes),
             (
-                ("thread id", thread_id),
-                ("thread native id", thread_native_id),
-                ("thread name", thread_name),
-                ("task id", task_id),
-                ("task name", task_name),
-                ("local root span id", local_root_span_id),
-                ("span id", span_id),
-                ("trace endpoint", trace_resource),
-                ("trace type", trace_type),
-                ("class name", frames[0][3]),
-            ),
-        )
-
-        self._location_values[location_key]["cpu-samples"] = len(samples)
-        self._location_values[location_key]["cpu-time"] = sum(s.cpu_time_ns for s in samples)
-        self._location_values[location_key]["wall-time"] = sum(s.wall_time_ns for s in samples)
-
-    def convert_memalloc_event(
-        self,
-        thread_id,  # type: str
-        thread_native_id,  # type: str
-        thread_name,  # type: str
-        frames,  # type: HashableStackTraceType
-        nframes,  # type: int
-        events,  # type: typing.List[memalloc.MemoryAllocSampleEvent]
-    ):
-        # type: (...) -> None
-        location_key = (
-            self._to_locations(frames, nframes),
-            (
-                ("thread id", thread_id),
-                ("thread native id", thread_native_id),
-                ("thread name", thread_name),
+                ("thread id", _none_to_str(event.thread_id)),
+                ("thread native id", _none_to_str(event.thread_native_id)),
+                ("thread name", _get_thread_name(event.thread_id, event.thread_name)),
+                ("task id", _none_to_str(event.task_id)),
+                ("task name", _none_to_str(event.task_name)),
+                ("local root span id", _none_to_str(event.local_root_span_id)),
+                ("span id", _none_to_str(event.span_id)),
+                ("trace endpoint", _get_event_trace_resource(event)),
+                ("trace type", _none_to_str(event.trace_type)),
+                ("class name", frames[0][3] if frames else ""),
             ),
         )
-
-        self._location_values[location_key]["alloc-samples"] = round(
-            sum(event.nevents * (event.capture_pct / 100.0) for event in events)
-        )
-        self._location_values[location_key]["alloc-space"] = round(
-            sum(event.size / event.capture_pct * 100.0 for event in events)
-        )
-
-    def convert_memalloc_heap_event(self, event: memalloc.MemoryHeapSampleEvent) -> None:
-        location_key = (
-            self._to_locations(tuple(event.frames), event.nframes),
+        values[_CPU_SAMPLES] += 1
+        values[_CPU_TIME] += event.cpu_time_ns
+        values[_WALL_TIME] += event.wall_time_ns
+        self._sum_period += event.sampling_period
+        self._nb_period += 1
+
+    def add_stack_exception_event(self, event) -> None:
+        frames = event.frames
+        exc_type = event.exc_type
+        cdef list values = self._values(
+            self._locations(frames, event.nframes),
             (
                 ("thread id", _none_to_str(event.thread_id)),
                 ("thread native id", _none_to_str(event.thread_native_id)),
                 ("thread name", _get_thread_name(event.thread_id, event.thread_name)),
+                ("local root span id", _none_to_str(event.local_root_span_id)),
+                ("span id", _none_to_str(event.span_id)),
+                ("trace endpoint", _get_event_trace_resource(event)),
+                ("trace type", _none_to_str(event.trace_type)),
+                ("exception type", exc_type.__module__ + "." + exc_type.__name__),
+                ("class name", frames[0][3] if frames else ""),
             ),
         )
+        values[_EXCEPTION_SAMPLES] += 1
 
-        self._location_values[location_key]["heap-space"] += event.size
-
-    def convert_lock_acquire_event(
-        self,
-        lock_name,  # type: str
-        thread_id,  # type: str
-        thread_name,  # type: str
-        task_id,  # type: str
-        task_name,  # type: str
-        local_root_span_id,  # type: str
-        span_id,  # type: str
-        trace_resource,  # type: str
-        trace_type,  # type: str
-        frames,  # type: HashableStackTraceType
-        nframes,  # type: int
-        events,  # type: typing.List[_lock.LockAcquireEvent]
-        sampling_ratio,  # type: float
-    ):
-        # type: (...) -> None
-        location_key = (
-            self._to_locations(frames, nframes),
+    def add_lock_event(self, event, bint acquire, double sampling_ratio) -> None:
+        frames = event.frames
+        cdef list values = self._values(
+            self._locations(frames, event.nframes),
             (
-                ("thread id", thread_id),
-                ("thread name", thread_name),
-                ("task id", task_id),
-                ("task name", task_name),
-                ("local root span id", local_root_span_id),
-                ("span id", span_id),
-                ("trace endpoint", trace_resource),
-                ("trace type", trace_type),
-                ("lock name", lock_name),
-                ("class name", frames[0][3]),
+                ("thread id", _none_to_str(event.thread_id)),
+                ("thread name", _get_thread_name(event.thread_id, event.thread_name)),
+                ("task id", _none_to_str(event.task_id)),
+                ("task name", _none_to_str(event.task_name)),
+                ("local root span id", _none_to_str(event.local_root_span_id)),
+                ("span id", _none_to_str(event.span_id)),
+                ("trace endpoint", _get_event_trace_resource(event)),
+                ("trace type", _none_to_str(event.trace_type)),
+                ("lock name", _none_to_str(event.lock_name)),
+                ("class name", frames[0][3] if frames else ""),
             ),
         )
-
-        self._location_values[location_key]["lock-acquire"] = len(events)
-        self._location_values[location_key]["lock-acquire-wait"] = int(
-            sum(e.wait_time_ns for e in events) / sampling_ratio
+        if acquire:
+            values[_LOCK_ACQUIRE] += 1
+            values[_LOCK_ACQUIRE_WAIT] += event.wait_time_ns / sampling_ratio
+        else:
+            values[_LOCK_RELEASE] += 1
+            values[_LOCK_RELEASE_HOLD] += event.locked_for_ns / sampling_ratio
+
+    cdef tuple _memory_labels(self, event):
+        return (
+            ("thread id", _none_to_str(event.thread_id)),
+            ("thread native id", _none_to_str(event.thread_native_id)),
+            ("thread name", _get_thread_name(event.thread_id, event.thread_name)),
         )
 
-    def convert_lock_release_event(
-        self,
-        lock_name,  # type: str
-        thread_id,  # type: str
-        thread_name,  # type: str
-        task_id,  # type: str
-        task_name,  # type: str
-        local_root_span_id,  # type: str
-        span_id,  # type: str
-        trace_resource,  # type: str
-        trace_type,  # type: str
-        frames,  # type: HashableStackTraceType
-        nframes,  # type: int
-        events,  # type: typing.List[_lock.LockReleaseEvent]
-        sampling_ratio,  # type: float
-    ):
-        # type: (...) -> None
-        location_key = (
-            self._to_locations(frames, nframes),
-            (
-                ("thread id", thread_id),
-                ("thread name", thread_name),
-                ("task id", task_id),
-                ("task name", task_name),
-                ("local root span id", local_root_span_id),
-                ("span id", span_id),
-                ("trace endpoint", trace_resource),
-                ("trace type", trace_type),
-                ("lock name", lock_name),
-                ("class name", frames[0][3]),
-            ),
-        )
+    def add_memalloc_event(self, event) -> None:
+        cdef list values = self._values(self._locations(event.frames, event.nframes), self._memory_labels(event))
+        values[_ALLOC_SAMPLES] += event.nevents * (event.capture_pct / 100.0)
+        values[_ALLOC_SPACE] += event.size / event.capture_pct * 100.0
 
-        self._location_values[location_key]["lock-release"] = len(events)
-        self._location_values[location_key]["lock-release-hold"] = int(
-            sum(e.locked_for_ns for e in events) / sampling_ratio
-        )
+    def add_memalloc_heap_event(self, event) -> None:
+        cdef list values = self._values(self._locations(event.frames, event.nframes), self._memory_labels(event))
+        values[_HEAP_SPACE] += event.size
 
-    def convert_stack_exception_event(
-        self,
-        thread_id: str,
-        thread_native_id: str,
-        thread_name: str,
-        local_root_span_id: str,
-        span_id: str,
-        trace_resource: str,
-        trace_type: str,
-        frames: HashableStackTraceType,
-        nframes: int,
-        exc_type_name: str,
-        events: typing.List[stack_event.StackExceptionSampleEvent],
-    ) -> None:
-        location_key = (
-            self._to_locations(frames, nframes),
-            (
-                ("thread id", thread_id),
-                ("thread native id", thread_native_id),
-                ("thread name", thread_name),
-                ("local root span id", local_root_span_id),
-                ("span id", span_id),
-                ("trace endpoint", trace_resource),
-                ("trace type", trace_type),
-                ("exception type", exc_type_name),
-                ("class name", frames[0][3]),
-            ),
-        )
+    def build(
+        self, int64_t start_time_ns, int64_t duration_ns, str program_name, bint compress=False
+    ) -> typing.Tuple[_EncodedProfile, typing.Set[str]]:
+        """Serialize the samples aggregated since the last call.
+
+        :param compress: Whether to gzip-compress the profile while it is serialized.
+        :return: The serialized profile and the set of file names it references.
+        """
+        cdef dict strings = {"": 0}
+        cdef list string_table = [""]
+        cdef list function_pids = [0] * len(self._function_names)
+        cdef list location_pids = [0] * len(self._location_functions)
+        cdef list period_functions = []
+        cdef list period_locations = []
+        cdef PprofStream stream
+        cdef ProtobufBuffer msg
+        cdef ProtobufBuffer sub
+        cdef Py_ssize_t i
+
+        if compress:
+            # Same level as libdatadog; falls back to compressing in Python if zlib is not available
+            stream.enable_gzip(6)
+
+        # Sample types
+        for type_, unit in SAMPLE_TYPES:
+            msg.clear()
+            msg.int64(1, _string_id(strings, string_table, type_))
+            msg.int64(2, _string_id(strings, string_table, unit))
+            _write_message(stream, 1, msg)
+
+        # Samples: this also determines which locations and functions this period references
+        for (locations, labels), values in self._samples.items():
+            msg.clear()
+
+            sub.clear()
+            for location in locations:
+                if not location_pids[location]:
+                    period_locations.append(location)
+                    location_pids[location] = len(period_locations)
+                sub.varint(location_pids[location])
+            msg.message(1, sub)
+
+            sub.clear()
+            for i in range(_NB_SAMPLE_TYPES):
+                value = values[i]
+                if i in (_ALLOC_SAMPLES, _ALLOC_SPACE):
+                    value = round(value)
+                sub.varint(<uint64_t><int64_t>int(value))
+            msg.message(2, sub)
+
+            for key, value in labels:
+                sub.clear()
+                sub.int64(1, _string_id(strings, string_table, key))
+                sub.int64(2, _string_id(strings, string_table, value))
+                msg.message(3, sub)
+
+            _write_message(stream, 2, msg)
+
+        # Mapping
+        msg.clear()
+        msg.uint64(1, 1)
+        msg.int64(5, _string_id(strings, string_table, program_name))
+        _write_message(stream, 3, msg)
+
+        # Locations
+        for location in period_locations:
+            function = self._location_functions[location]
+            if not function_pids[function]:
+                period_functions.append(function)
+                function_pids[function] = len(period_functions)
+
+            msg.clear()
+            msg.uint64(1, location_pids[location])
+            sub.clear()
+            sub.uint64(1, function_pids[function])
+            sub.int64(2, self._location_lines[location])
+            msg.message(4, sub)
+            _write_message(stream, 4, msg)
+
+        # Functions
+        filenames = set()
+        for function in period_functions:
+            filename = self._function_filenames[function]
+            filenames.add(filename)
+            msg.clear()
+            msg.uint64(1, function_pids[function])
+            msg.int64(2, _string_id(strings, string_table, self._function_names[function]))
+            msg.int64(4, _string_id(strings, string_table, filename))
+            _write_message(stream, 5, msg)
+
+        # Period type must be interned before the string table is written
+        period_type_id = _string_id(strings, string_table, "time")
+        period_unit_id = _string_id(strings, string_table, "nanoseconds")
+
+        for value in string_table:
+            _write_string(stream, 6, value)
+
+        msg.clear()
+        msg.int64(9, start_time_ns)
+        msg.int64(10, duration_ns)
+        sub.clear()
+        sub.int64(1, period_type_id)
+        sub.int64(2, period_unit_id)
+        msg.message(11, sub)
+        if self._nb_period:
+            msg.int64(12, self._sum_period // self._nb_period)
+        if not stream.write(msg) or not stream.finish():
+            raise RuntimeError("Failed to write profile")
+
+        self._samples = {}
+        self._sum_period = 0
+        self._nb_period = 0
+        self._reset_tables()
+
+        return _EncodedProfile(stream.data()[:stream.size()], stream.gzip(), program_name), filenames
+
+
+@attr.s
+class PprofExporter(exporter.Exporter):
+    """Export recorder events to pprof format."""
+
+    enable_code_provenance = attr.ib(default=True, type=bool)
+    _builder = attr.ib(init=False, factory=_PprofBuilder, repr=False, eq=False)
 
-        self._location_values[location_key]["exception-samples"] = len(events)
+    # Whether the exported profile is gzip-compressed as it is serialized
+    _compress = False
 
-    def _build_libraries(self) -> typing.List[Package]:
+    @staticmethod
+    def _build_libraries(filenames: typing.Iterable[str]) -> typing.List[Package]:
         return [
             Package(
                 {
@@ -461,191 +599,20 @@ class _PprofConverter(object):
                     _
                     for _ in (
                         (packages.filename_to_package(filename), filename)
-                        for filename, lineno, funcname in self._locations
+                        for filename in filenames
                     )
                     if _[0] is not None
                 }, _ITEMGETTER_ZERO
             )
         ] + STDLIB
 
-    def _build_profile(
-        self,
-        start_time_ns: int,
-        duration_ns: int,
-        period: typing.Optional[int],
-        sample_types: typing.Tuple[typing.Tuple[str, str], ...],
-        program_name: str,
-    ) -> pprof_ProfileType:
-        pprof_sample_type = [
-            pprof_pb2.ValueType(type=self._str(type_), unit=self._str(unit)) for type_, unit in sample_types
-        ]
-
-        sample = [
-            pprof_pb2.Sample(
-                location_id=locations,
-                value=[values.get(sample_type_name, 0) for sample_type_name, unit in sample_types],
-                label=[pprof_pb2.Label(key=self._str(key), str=self._str(s)) for key, s in labels],
-            )
-            for (locations, labels), values in six.iteritems(self._location_values)
-        ]
-
-        period_type = pprof_pb2.ValueType(type=self._str("time"), unit=self._str("nanoseconds"))
-
-        # WARNING: no code should use _str() here as once the _string_table is serialized below,
-        # it won't be updated if you call _str later in the code here
-        return pprof_pb2.Profile(
-            sample_type=pprof_sample_type,
-            sample=sample,
-            mapping=[
-                pprof_pb2.Mapping(
-                    id=1,
-                    filename=self._str(program_name),
-                ),
-            ],
-            location=self._locations.values(),
-            function=self._functions.values(),
-            string_table=self._string_table,
-            time_nanos=start_time_ns,
-            duration_nanos=duration_ns,
-            period=period,
-            period_type=period_type,
-        )
-
-
-# Use this format because CPython does not support the class style declaration
-StackEventGroupKey = typing.NamedTuple(
-    "StackEventGroupKey",
-    [
-        ("thread_id", str),
-        ("thread_native_id", str),
-        ("thread_name", str),
-        ("task_id", str),
-        ("task_name", str),
-        ("local_root_span_id", str),
-        ("span_id", str),
-        ("trace_resource", str),
-        ("trace_type", str),
-        ("frames", HashableStackTraceType),
-        ("nframes", int),
-    ],
-)
-
-
-LockEventGroupKey = typing.NamedTuple(
-    "LockEventGroupKey",
-    [
-        ("lock_name", str),
-        ("thread_id", str),
-        ("thread_name", str),
-        ("task_id", str),
-        ("task_name", str),
-        ("local_root_span_id", str),
-        ("span_id", str),
-        ("trace_resource", str),
-        ("trace_type", str),
-        ("frames", HashableStackTraceType),
-        ("nframes", int),
-    ],
-)
-
-
-StackExceptionEventGroupKey = typing.NamedTuple(
-    "StackExceptionEventGroupKey",
-    [
-        ("thread_id", str),
-        ("thread_native_id", str),
-        ("thread_name", str),
-        ("local_root_span_id", str),
-        ("span_id", str),
-        ("trace_resource", str),
-        ("trace_type", str),
-        ("frames", HashableStackTraceType),
-        ("nframes", int),
-        ("exc_type_name", str),
-    ],
-)
-
-
-@attr.s
-class PprofExporter(exporter.Exporter):
-    """Export recorder events to pprof format."""
-
-    enable_code_provenance = attr.ib(default=True, type=bool)
-
-    def _stack_event_group_key(self, event: event.StackBasedEvent) -> StackEventGroupKey:
-        return StackEventGroupKey(
-            _none_to_str(event.thread_id),
-            _none_to_str(event.thread_native_id),
-            _get_thread_name(event.thread_id, event.thread_name),
-            _none_to_str(event.task_id),
-            _none_to_str(event.task_name),
-            _none_to_str(event.local_root_span_id),
-            _none_to_str(event.span_id),
-            self._get_event_trace_resource(event),
-            _none_to_str(event.trace_type),
-            # TODO: store this as a tuple directly?
-            tuple(event.frames),
-            event.nframes,
-        )
-
-    def _group_stack_events(
-        self, events: typing.Iterable[event.StackBasedEvent]
-    ) -> typing.Iterator[typing.Tuple[StackEventGroupKey, typing.Iterator[event.StackBasedEvent]]]:
-        return groupby(events, self._stack_event_group_key)
-
-    def _lock_event_group_key(
-        self,
-        event: _lock.LockEventBase,
-    ) -> LockEventGroupKey:
-        return LockEventGroupKey(
-            _none_to_str(event.lock_name),
-            _none_to_str(event.thread_id),
-            _get_thread_name(event.thread_id, event.thread_name),
-            _none_to_str(event.task_id),
-            _none_to_str(event.task_name),
-            _none_to_str(event.local_root_span_id),
-            _none_to_str(event.span_id),
-            self._get_event_trace_resource(event),
-            _none_to_str(event.trace_type),
-            tuple(event.frames),
-            event.nframes,
-        )
-
-    def _group_lock_events(
-        self, events: typing.Iterable[_lock.LockEventBase]
-    ) -> typing.Iterator[typing.Tuple[LockEventGroupKey, typing.Iterator[_lock.LockEventBase]]]:
-        return groupby(events, self._lock_event_group_key)
-
-    def _stack_exception_group_key(self, event: stack_event.StackExceptionSampleEvent) -> StackExceptionEventGroupKey:
-        exc_type = event.exc_type
-        exc_type_name = exc_type.__module__ + "." + exc_type.__name__
-
-        return StackExceptionEventGroupKey(
-            _none_to_str(event.thread_id),
-            _none_to_str(event.thread_native_id),
-            _get_thread_name(event.thread_id, event.thread_name),
-            _none_to_str(event.local_root_span_id),
-            _none_to_str(event.span_id),
-            self._get_event_trace_resource(event),
-            _none_to_str(event.trace_type),
-            tuple(event.frames),
-            event.nframes,
-            exc_type_name,
-        )
-
-    def _group_stack_exception_events(
-        self, events: typing.Iterable[stack_event.StackExceptionSampleEvent]
-    ) -> typing.Iterator[
-        typing.Tuple[StackExceptionEventGroupKey, typing.Iterator[stack_event.StackExceptionSampleEvent]]
-    ]:
-        return groupby(events, self._stack_exception_group_key)
-
-    def _get_event_trace_resource(self, event: event.StackBasedEvent) -> str:
-        trace_resource = ""
-        # Do not export trace_resource for non Web spans for privacy concerns.
-        if event.trace_resource_container and event.trace_type == ext.SpanTypes.WEB:
-            (trace_resource,) = event.trace_resource_container
-        return ensure_text(trace_resource, errors="backslashreplace")
+    @staticmethod
+    def _add_events(events: typing.Iterable[event.Event], add: typing.Callable[..., None], *args: typing.Any) -> None:
+        for e in events:
+            try:
+                add(e, *args)
+            except Exception:
+                log.warning("Failed to export event %r", e, exc_info=True)
 
     def export(
         self, events: recorder.EventsType, start_time_ns: int, end_time_ns: int
@@ -655,189 +622,35 @@ class PprofExporter(exporter.Exporter):
         :param events: The event dictionary from a `ddtrace.profiling.recorder.Recorder`.
         :param start_time_ns: The start time of recording.
         :param end_time_ns: The end time of recording.
-        :return: A protobuf Profile object.
+        :return: The profile, serialized in pprof format.
         """
         program_name = config.get_application_name() or "<unknown program>"
+        builder = self._builder
 
-        sum_period = 0
-        nb_event = 0
-
-        converter = _PprofConverter()
-
-        # Handle StackSampleEvent
-        stack_events = []
-        for event in events.get(stack_event.StackSampleEvent, []):  # type: ignore[call-overload]
-            stack_events.append(event)
-            sum_period += event.sampling_period
-            nb_event += 1
-
-        for (
-            (
-                thread_id,
-                thread_native_id,
-                thread_name,
-                task_id,
-                task_name,
-                local_root_span_id,
-                span_id,
-                trace_resource,
-                trace_type,
-                frames,
-                nframes,
-            ),
-            grouped_stack_events,
-        ) in self._group_stack_events(stack_events):
-            converter.convert_stack_event(
-                thread_id,
-                thread_native_id,
-                thread_name,
-                task_id,
-                task_name,
-                local_root_span_id,
-                span_id,
-                trace_resource,
-                trace_type,
-                frames,
-                nframes,
-                list(typing.cast(typing.Iterator[stack_event.StackSampleEvent], grouped_stack_events)),
-            )
+        self._add_events(events.get(stack_event.StackSampleEvent, []), builder.add_stack_event)
 
         # Handle Lock events
-        for event_class, convert_fn in (
-            (_lock.LockAcquireEvent, converter.convert_lock_acquire_event),
-            (_lock.LockReleaseEvent, converter.convert_lock_release_event),
-            (threading.ThreadingLockAcquireEvent, converter.convert_lock_acquire_event),
-            (threading.ThreadingLockReleaseEvent, converter.convert_lock_release_event),
+        for event_class, acquire in (
+            (_lock.LockAcquireEvent, True),
+            (_lock.LockReleaseEvent, False),
+            (threading.ThreadingLockAcquireEvent, True),
+            (threading.ThreadingLockReleaseEvent, False),
         ):
             lock_events = events.get(event_class, [])  # type: ignore[call-overload]
-            sampling_sum_pct = sum(event.sampling_pct for event in lock_events)
-
             if lock_events:
-                sampling_ratio_avg = sampling_sum_pct / (len(lock_events) * 100.0)
-
-                for (
-                    lock_name,
-                    thread_id,
-                    thread_name,
-                    task_id,
-                    task_name,
-                    local_root_span_id,
-                    span_id,
-                    trace_resource,
-                    trace_type,
-                    frames,
-                    nframes,
-                ), l_events in self._group_lock_events(lock_events):
-                    convert_fn(  # type: ignore[operator]
-                        lock_name,
-                        thread_id,
-                        thread_name,
-                        task_id,
-                        task_name,
-                        local_root_span_id,
-                        span_id,
-                        trace_resource,
-                        trace_type,
-                        frames,
-                        nframes,
-                        list(l_events),
-                        sampling_ratio_avg,
-                    )
+                sampling_ratio_avg = sum(e.sampling_pct for e in lock_events) / (len(lock_events) * 100.0)
+                self._add_events(lock_events, builder.add_lock_event, acquire, sampling_ratio_avg)
 
-        for (
-            (
-                thread_id,
-                thread_native_id,
-                thread_name,
-                local_root_span_id,
-                span_id,
-                trace_resource,
-                trace_type,
-                frames,
-                nframes,
-                exc_type_name,
-            ),
-            se_events,
-        ) in self._group_stack_exception_events(
-            events.get(stack_event.StackExceptionSampleEvent, [])  # type: ignore[call-overload]
-        ):
-            converter.convert_stack_exception_event(
-                thread_id,
-                thread_native_id,
-                thread_name,
-                local_root_span_id,
-                span_id,
-                trace_resource,
-                trace_type,
-                frames,
-                nframes,
-                exc_type_name,
-                list(typing.cast(typing.Iterator[stack_event.StackExceptionSampleEvent], se_events)),
-            )
+        self._add_events(events.get(stack_event.StackExceptionSampleEvent, []), builder.add_stack_exception_event)
 
         if memalloc._memalloc:
-            for (
-                (
-                    thread_id,
-                    thread_native_id,
-                    thread_name,
-                    task_id,
-                    task_name,
-                    local_root_span_id,
-                    span_id,
-                    trace_resource,
-                    trace_type,
-                    frames,
-                    nframes,
-                ),
-                memalloc_events,
-            ) in self._group_stack_events(
-                events.get(memalloc.MemoryAllocSampleEvent, [])  # type: ignore[call-overload]
-            ):
-                converter.convert_memalloc_event(
-                    thread_id,
-                    thread_native_id,
-                    thread_name,
-                    frames,
-                    nframes,
-                    list(typing.cast(typing.Iterator[memalloc.MemoryAllocSampleEvent], memalloc_events)),
-                )
-
-            for event in events.get(memalloc.MemoryHeapSampleEvent, []):  # type: ignore[call-overload]
-                converter.convert_memalloc_heap_event(event)
-
-        # Compute some metadata
-        period = None  # type: typing.Optional[int]
-        if nb_event:
-            period = int(sum_period / nb_event)
-
-        duration_ns = end_time_ns - start_time_ns
-
-        sample_types = (
-            ("cpu-samples", "count"),
-            ("cpu-time", "nanoseconds"),
-            ("wall-time", "nanoseconds"),
-            ("exception-samples", "count"),
-            ("lock-acquire", "count"),
-            ("lock-acquire-wait", "nanoseconds"),
-            ("lock-release", "count"),
-            ("lock-release-hold", "nanoseconds"),
-            ("alloc-samples", "count"),
-            ("alloc-space", "bytes"),
-            ("heap-space", "bytes"),
-        )
+            self._add_events(events.get(memalloc.MemoryAllocSampleEvent, []), builder.add_memalloc_event)
+            self._add_events(events.get(memalloc.MemoryHeapSampleEvent, []), builder.add_memalloc_heap_event)
 
-        profile = converter._build_profile(
-            start_time_ns=start_time_ns,
-            duration_ns=duration_ns,
-            period=period,
-            sample_types=sample_types,
-            program_name=program_name,
-        )
+        profile, filenames = builder.build(start_time_ns, end_time_ns - start_time_ns, program_name, self._compress)
 
-        # Build profile first to get location filled out
         if self.enable_code_provenance:
-            libs = converter._build_libraries()
+            libs = self._build_libraries(filenames)
         else:
             libs = []
 
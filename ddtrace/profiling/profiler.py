@@ -132,6 +132,9 @@ class _ProfilerInstance(service.Service):
 
     ENDPOINT_TEMPLATE = "https://intake.profile.{}"
 
+    # Seconds to wait for the last spooled profiles to be written when stopping
+    _SPOOL_FLUSH_TIMEOUT = 5.0
+
     def _build_default_exporters(self):
         # type: (...) -> List[exporter.Exporter]
         if not self._export_libdd_enabled:
@@ -210,6 +213,9 @@ class _ProfilerInstance(service.Service):
         # * If initialization fails and libdd is required, disable everything and return (error)
         if self._export_libdd_enabled:
             try:
+                if config.heap.upload_interval > 0:
+                    # Heap profiles are snapshots, which don't need to be sent as often as the other profiles
+                    ddup.add_profile("heap", ddup.SAMPLE_TYPE_HEAP, upload_period=config.heap.upload_interval)
                 ddup.init(
                     env=self.env,
                     service=self.service,
@@ -217,6 +223,10 @@ class _ProfilerInstance(service.Service):
                     tags=self.tags,  # type: ignore
                     max_nframes=config.max_frames,
                     url=endpoint,
+                    timeline_enabled=config.timeline_enabled,
+                    memory_budget=config.memory_budget,
+                    spool_dir=config.spool_dir,
+                    spool_max_bytes=config.spool_max_size,
                 )
                 return []
             except Exception as e:
@@ -394,6 +404,9 @@ class _ProfilerInstance(service.Service):
             if flush:
                 # Do not stop the collectors before flushing, they might be needed (snapshot)
                 self._scheduler.flush()
+                if self._export_libdd_enabled and config.spool_dir:
+                    # Spooled profiles are written in the background; don't lose the last one at exit
+                    ddup.flush_spool(self._SPOOL_FLUSH_TIMEOUT)
 
         for col in reversed(self._collectors):
             try:
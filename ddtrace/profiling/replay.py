@@ -0,0 +1,54 @@
+"""Upload the profiles spooled to disk with ``DD_PROFILING_SPOOL_DIR``.
+
+Usage: ``python -m ddtrace.profiling.replay [directory]``
+
+Profiles are uploaded to the agent configured for the current process, and tagged with its service, environment,
+version and tags, as these are not stored along with the spooled profiles. Each profile is removed once it is sent;
+if an upload fails, the remaining profiles are kept for a later attempt.
+"""
+import os
+import sys
+import typing  # noqa:F401
+
+from ddtrace.internal import agent
+from ddtrace.internal.datadog.profiling import ddup
+from ddtrace.settings.profiling import config
+
+
+def replay(directory):
+    # type: (str) -> int
+    """Upload the profiles spooled in ``directory``, and return the number of profiles sent, or -1 on error."""
+    ddup.init(
+        service=os.environ.get("DD_SERVICE"),
+        env=os.environ.get("DD_ENV"),
+        version=os.environ.get("DD_VERSION"),
+        tags=config.tags,  # type: ignore
+        max_nframes=config.max_frames,
+        url=agent.get_trace_url(),
+    )
+    return ddup.replay_spool(directory)
+
+
+def main(argv=None):
+    # type: (typing.Optional[typing.List[str]]) -> int
+    args = sys.argv[1:] if argv is None else argv
+    directory = args[0] if args else config.spool_dir
+    if not directory:
+        print("usage: python -m ddtrace.profiling.replay [directory]", file=sys.stderr)
+        return 2
+
+    if not ddup.is_available:
+        print("The native profile exporter is not available on this platform", file=sys.stderr)
+        return 1
+
+    sent = replay(directory)
+    if sent < 0:
+        print("Could not create the profile uploader", file=sys.stderr)
+        return 1
+
+    print("Uploaded %d profile(s) from %s" % (sent, directory))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
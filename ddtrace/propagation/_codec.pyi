@@ -0,0 +1,20 @@
+import typing
+
+def hex_to_id(value: str) -> int: ...
+def decimal_to_id(value: str) -> int: ...
+def parse_traceparent(tp: str) -> typing.Tuple[int, int, typing.Literal[0, 1]]: ...
+def normalize_tracestate(ts: str) -> typing.Tuple[str, bool]: ...
+def get_tracestate_values(
+    ts: str,
+) -> typing.Tuple[typing.Optional[int], typing.Dict[str, str], typing.Optional[str], typing.Optional[str]]: ...
+def get_sampling_priority(
+    traceparent_sampled: int, tracestate_sampling_priority: typing.Optional[int], origin: typing.Optional[str] = None
+) -> int: ...
+def apply_tracestate(
+    trace_flag: int, ts: typing.Optional[str], meta: typing.Dict[str, str]
+) -> typing.Tuple[int, typing.Optional[str]]: ...
+def extract_tracecontext(
+    headers: typing.Mapping[str, str],
+) -> typing.Optional[typing.Tuple[int, int, int, typing.Optional[str], typing.Dict[str, str]]]: ...
+def tracestate_add_p(tracestate: str, span_id: int) -> str: ...
+def replace_dd_member(tracestate: str, dd_member: str) -> str: ...
@@ -0,0 +1,401 @@
+"""
+Native codec of the distributed tracing headers.
+
+Header values are parsed in a single pass over their characters, without regular expressions or intermediate lists.
+Trace and span ids are converted from their hexadecimal and decimal representations natively when they only contain
+digits, and with int() otherwise so that the syntax they accept does not change.
+"""
+cimport cython
+from cpython.unicode cimport PyUnicode_CheckExact
+from libc.stdint cimport uint64_t
+
+from ddtrace.internal.compat import ensure_text
+from ddtrace.internal.constants import LAST_DD_PARENT_ID_KEY
+from ddtrace.internal.constants import W3C_TRACEPARENT_KEY
+from ddtrace.internal.constants import W3C_TRACESTATE_KEY
+from ddtrace.internal.constants import W3C_TRACESTATE_PARENT_ID_KEY
+from ddtrace.internal.logger import get_logger
+
+
+cdef extern from "Python.h":
+    bint PyUnicode_IS_ASCII(object o)
+    Py_UCS4 PyUnicode_READ_CHAR(object o, Py_ssize_t index)
+
+
+log = get_logger(__name__)
+
+
+# Header names, and their WSGI counterparts once lower cased
+cdef str _TRACEPARENT = "traceparent"
+cdef str _WSGI_TRACEPARENT = "http_traceparent"
+cdef str _TRACESTATE = "tracestate"
+cdef str _WSGI_TRACESTATE = "http_tracestate"
+
+# Value of the last datadog parent id when the dd list member does not have one
+cdef str _NO_LAST_PARENT_ID = "0000000000000000"
+
+
+cdef enum:
+    # version "-" trace-id "-" parent-id "-" trace-flags
+    TRACEPARENT_LENGTH = 55
+
+
+cdef inline int _lower_hex_digit(Py_UCS4 c):
+    cdef unsigned int u = c
+    if 0x30 <= u <= 0x39:  # 0-9
+        return u - 0x30
+    if 0x61 <= u <= 0x66:  # a-f
+        return u - 0x61 + 10
+    return -1
+
+
+cdef inline int _hex_digit(Py_UCS4 c):
+    cdef unsigned int u = c
+    if 0x41 <= u <= 0x46:  # A-F
+        return u - 0x41 + 10
+    return _lower_hex_digit(c)
+
+
+# Parse the n <= 32 hexadecimal digits of s at start into the high and low 64 bits of their value. Returns False if
+# one of them is not a hexadecimal digit.
+cdef bint _parse_hex(str s, Py_ssize_t start, Py_ssize_t n, bint lower_only, uint64_t* hi, uint64_t* lo):
+    cdef Py_ssize_t i
+    cdef int d
+    hi[0] = 0
+    lo[0] = 0
+    for i in range(start, start + n):
+        d = _lower_hex_digit(PyUnicode_READ_CHAR(s, i)) if lower_only else _hex_digit(PyUnicode_READ_CHAR(s, i))
+        if d < 0:
+            return False
+        hi[0] = (hi[0] << 4) | (lo[0] >> 60)
+        lo[0] = (lo[0] << 4) | <uint64_t>d
+    return True
+
+
+cdef inline object _to_int(uint64_t hi, uint64_t lo):
+    if hi == 0:
+        return lo
+    return (<object>hi << 64) | lo
+
+
+cdef inline bint _is_ascii_space(Py_UCS4 c):
+    # The characters str.strip() removes from ASCII strings
+    cdef unsigned int u = c
+    return u == 0x20 or 0x09 <= u <= 0x0D or 0x1C <= u <= 0x1F
+
+
+# End of the tracestate list member starting at start
+@cython.boundscheck(False)
+@cython.wraparound(False)
+cdef inline Py_ssize_t _member_end(str ts, Py_ssize_t start, Py_ssize_t n):
+    while start < n and ts[start] != u",":
+        start += 1
+    return start
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+cdef inline bint _is_dd_member(str ts, Py_ssize_t start, Py_ssize_t end):
+    # Optional whitespace is allowed before a list member
+    while start < end and (ts[start] == u" " or ts[start] == u"\t"):
+        start += 1
+    return end - start >= 3 and ts[start] == u"d" and ts[start + 1] == u"d" and ts[start + 2] == u"="
+
+
+def hex_to_id(value):
+    # type: (str) -> int
+    """Convert a hexadecimal trace or span id into an int."""
+    cdef uint64_t hi, lo
+    cdef Py_ssize_t n
+    if PyUnicode_CheckExact(value):
+        n = len(<str>value)
+        if 0 < n <= 32 and _parse_hex(value, 0, n, False, &hi, &lo):
+            return _to_int(hi, lo)
+    return int(value, 16)
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def decimal_to_id(value):
+    # type: (str) -> int
+    """Convert a decimal trace or span id into an int."""
+    cdef uint64_t result = 0
+    cdef Py_ssize_t i, n
+    cdef unsigned int u
+    if PyUnicode_CheckExact(value):
+        n = len(<str>value)
+        # Up to 19 digits always fit in 64 bits
+        if 0 < n <= 19:
+            for i in range(n):
+                u = (<str>value)[i]
+                if u < 0x30 or u > 0x39:
+                    break
+                result = result * 10 + (u - 0x30)
+            else:
+                return result
+    return int(value)
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def parse_traceparent(tp):
+    # type: (str) -> typing.Tuple[int, int, typing.Literal[0, 1]]
+    """If the traceparent value is invalid raise a ValueError. Otherwise we extract the trace-id, span-id, and sampling
+    priority from the traceparent header.
+
+    The format of a traceparent is ``version "-" trace-id "-" parent-id "-" trace-flags``, made of 2, 32, 16 and 2
+    lower case hexadecimal characters. Versions other than ``00`` may be followed by additional values.
+    """
+    cdef str s = tp.strip()
+    cdef Py_ssize_t n = len(s)
+    cdef uint64_t version, flags, trace_id_hi, trace_id_lo, span_id, unused
+    cdef bint has_future_values
+
+    if (
+        n < TRACEPARENT_LENGTH
+        or s[2] != u"-"
+        or s[35] != u"-"
+        or s[52] != u"-"
+        or not _parse_hex(s, 0, 2, True, &unused, &version)
+        or not _parse_hex(s, 3, 32, True, &trace_id_hi, &trace_id_lo)
+        or not _parse_hex(s, 36, 16, True, &unused, &span_id)
+        or not _parse_hex(s, 53, 2, True, &unused, &flags)
+    ):
+        raise ValueError("Invalid traceparent version: %s" % tp)
+
+    # Future proofing: the traceparent spec is additive, future versions may contain more than 4 values
+    has_future_values = n > TRACEPARENT_LENGTH
+    if has_future_values and (n == TRACEPARENT_LENGTH + 1 or s[TRACEPARENT_LENGTH] != u"-" or u"\n" in s):
+        raise ValueError("Invalid traceparent version: %s" % tp)
+
+    if version == 0xFF:
+        # https://www.w3.org/TR/trace-context/#version
+        raise ValueError("ff is an invalid traceparent version: %s" % tp)
+    elif version != 0:
+        # currently 00 is the only version format, but if future versions come up we may need to add changes
+        log.warning("unsupported traceparent version:%r, still attempting to parse", s[:2])
+    elif has_future_values:
+        raise ValueError("Traceparents with the version `00` should contain 4 values delimited by a dash: %s" % tp)
+
+    # All 0s are invalid values
+    if trace_id_hi == 0 and trace_id_lo == 0:
+        raise ValueError("0 value for trace_id is invalid")
+    if span_id == 0:
+        raise ValueError("0 value for span_id is invalid")
+
+    # there's currently only one trace flag, which denotes sampling priority was set to keep "01" or drop "00".
+    # trace flags is a bit field: https://www.w3.org/TR/trace-context/#trace-flags
+    return _to_int(trace_id_hi, trace_id_lo), span_id, 1 if flags & 0x1 else 0
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def normalize_tracestate(str ts):
+    # type: (str) -> typing.Tuple[str, bool]
+    """Return the tracestate without the whitespace around its list members, and whether it is valid, i.e. only made of
+    ASCII characters in the range of 0x20 to 0x7E.
+    """
+    cdef Py_ssize_t n = len(ts)
+    cdef Py_ssize_t i
+    cdef unsigned int u
+
+    if not PyUnicode_IS_ASCII(ts):
+        # Non-ASCII whitespace is stripped as well, but any other non-ASCII character makes the tracestate invalid
+        ts = ",".join([member.strip() for member in ts.split(",")])
+        if not PyUnicode_IS_ASCII(ts):
+            return ts, False
+        n = len(ts)
+    else:
+        for i in range(n):
+            if _is_ascii_space(ts[i]) and (i == 0 or i == n - 1 or ts[i - 1] == u"," or ts[i + 1] == u","):
+                ts = ",".join([member.strip() for member in ts.split(",")])
+                n = len(ts)
+                break
+
+    for i in range(n):
+        u = ts[i]
+        if u < 0x20 or u > 0x7E:
+            return ts, False
+    return ts, True
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+cdef dict _parse_dd_member(str ts, Py_ssize_t start, Py_ssize_t end):
+    # Items are separated by ";", and split on their first ":" since values can contain one
+    cdef dict dd = {}
+    cdef Py_ssize_t item = start
+    cdef Py_ssize_t colon = -1
+    cdef Py_ssize_t i
+    for i in range(start, end + 1):
+        if i == end or ts[i] == u";":
+            if colon < 0:
+                raise ValueError("invalid dd list member item: %r" % ts[item:i])
+            dd[ts[item:colon]] = ts[colon + 1 : i]
+            item = i + 1
+            colon = -1
+        elif colon < 0 and ts[i] == u":":
+            colon = i
+    return dd
+
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def get_tracestate_values(str ts):
+    # type: (str) -> typing.Tuple[typing.Optional[int], typing.Dict[str, str], typing.Optional[str], typing.Optional[str]]
+    """Return the sampling priority, propagated tags, origin and last datadog parent id of the dd list member of a
+    tracestate.
+
+    For example ``dd=s:2;o:rum;t.dm:-4;t.usr.id:baz64,congo=t61rcWkgMzE`` gives
+    ``2, {"_dd.p.dm": "-4", "_dd.p.usr.id": "baz64"}, "rum", "0000000000000000"``.
+    """
+    cdef Py_ssize_t n = len(ts)
+    cdef Py_ssize_t start = 0
+    cdef Py_ssize_t end
+    cdef dict dd = None
+
+    while start <= n:
+        end = _member_end(ts, start, n)
+        if end - start >= 3 and ts[start] == u"d" and ts[start + 1] == u"d" and ts[start + 2] == u"=":
+            dd = _parse_dd_member(ts, start + 3, end)
+        start = end + 1
+
+    if not dd:
+        return None, {}, None, None
+
+    sampling_priority = dd.get("s")
+    if sampling_priority is not None:
+        sampling_priority = int(sampling_priority)
+
+    origin = dd.get("o")
+    if origin:
+        # we encode "=" as "~" in tracestate so need to decode here
+        origin = origin.replace("~", "=")
+
+    # Get last datadog parent id, this field is used to reconnect traces with missing spans
+    last_parent_id = dd.get("p", _NO_LAST_PARENT_ID)
+
+    # need to convert from t. to _dd.p.
+    tags = {"_dd.p." + k[2:]: v.replace("~", "=") for k, v in dd.items() if k.startswith("t.")}
+
+    return sampling_priority, tags, origin, last_parent_id
+
+
+def get_sampling_priority(int traceparent_sampled, tracestate_sampling_priority, origin=None):
+    # type: (int, typing.Optional[int], typing.Optional[str]) -> int
+    """
+    When the traceparent sampled flag is set, the Datadog sampling priority is either
+    1 or a positive value of sampling priority if propagated in tracestate.
+
+    When the traceparent sampled flag is not set, the Datadog sampling priority is either
+    0 or a negative value of sampling priority if propagated in tracestate.
+
+    When origin is "rum" and there is no sampling priority propagated in tracestate, the above rules do not apply.
+    """
+    cdef bint from_rum_wo_priority = not tracestate_sampling_priority and origin == "rum"
+
+    if from_rum_wo_priority:
+        return tracestate_sampling_priority
+    if traceparent_sampled == 0 and (not tracestate_sampling_priority or tracestate_sampling_priority >= 0):
+        return 0
+    if traceparent_sampled == 1 and (not tracestate_sampling_priority or tracestate_sampling_priority < 0):
+        return 1
+    # The two other options:
+    # traceparent_sampled == 1 and tracestate_sampling_priority > 0
+    # traceparent_sampled == 0 and tracestate_sampling_priority <= 0
+    return tracestate_sampling_priority
+
+
+def apply_tracestate(int trace_flag, ts, dict meta):
+    # type: (int, typing.Optional[str], typing.Dict[str, str]) -> typing.Tuple[int, typing.Optional[str]]
+    """Add the tracestate and its propagated tags to meta, and return the sampling priority and origin of the context."""
+    origin = None
+    sampling_priority = trace_flag
+    if not ts:
+        return sampling_priority, origin
+
+    # whitespace is allowed, but whitespace to start or end values should be trimmed
+    # e.g. "foo=1 \t , \t bar=2, \t baz=3" -> "foo=1,bar=2,baz=3"
+    ts, valid = normalize_tracestate(ts)
+    if not valid:
+        log.debug("received invalid tracestate header: %r", ts)
+        return sampling_priority, origin
+
+    # store tracestate so we keep other vendor data for injection, even if dd ends up being invalid
+    meta[W3C_TRACESTATE_KEY] = ts
+    try:
+        sampling_priority_ts, tags, origin, last_parent_id = get_tracestate_values(ts)
+    except (TypeError, ValueError):
+        log.debug("received invalid dd header value in tracestate: %r ", ts)
+        return sampling_priority, None
+
+    meta.update(tags)
+    if last_parent_id:
+        meta[LAST_DD_PARENT_ID_KEY] = last_parent_id
+    return get_sampling_priority(trace_flag, sampling_priority_ts, origin), origin
+
+
+cdef inline object _header_value(object headers, str name, str wsgi_name):
+    if name in headers:
+        return ensure_text(headers[name], errors="backslashreplace")
+    if wsgi_name in headers:
+        return ensure_text(headers[wsgi_name], errors="backslashreplace")
+    return None
+
+
+def extract_tracecontext(headers):
+    # type: (typing.Mapping[str, str]) -> typing.Optional[typing.Tuple[int, int, int, typing.Optional[str], typing.Dict[str, str]]]
+    """Return the trace id, span id, sampling priority, origin and meta of the W3C Trace Context propagated in lower
+    cased headers, or None if there is no valid traceparent.
+    """
+    tp = _header_value(headers, _TRACEPARENT, _WSGI_TRACEPARENT)
+    if tp is None:
+        log.debug("no traceparent header")
+        return None
+    try:
+        trace_id, span_id, trace_flag = parse_traceparent(tp)
+    except (ValueError, AssertionError):
+        log.exception("received invalid w3c traceparent: %s ", tp)
+        return None
+
+    meta = {W3C_TRACEPARENT_KEY: tp}
+    ts = _header_value(headers, _TRACESTATE, _WSGI_TRACESTATE)
+    sampling_priority, origin = apply_tracestate(trace_flag, ts, meta)
+    return trace_id, span_id, sampling_priority, origin, meta
+
+
+def tracestate_add_p(str tracestate, uint64_t span_id):
+    # type: (str, int) -> str
+    """Add the last datadog parent id to the dd list member of a tracestate, which is created if needed.
+
+    This tag is used to reconnect a trace with non-datadog spans.
+    """
+    cdef Py_ssize_t n = len(tracestate)
+    cdef Py_ssize_t start = 0
+    cdef Py_ssize_t end
+    cdef str p = "%s:%016x" % (W3C_TRACESTATE_PARENT_ID_KEY, span_id)
+
+    while start < n:
+        end = _member_end(tracestate, start, n)
+        if _is_dd_member(tracestate, start, end):
+            start = tracestate.index("dd=", start) + 3
+            return tracestate[:start] + p + ";" + tracestate[start:]
+        start = end + 1
+    if tracestate:
+        return "dd=" + p + "," + tracestate
+    return "dd=" + p
+
+
+def replace_dd_member(str tracestate, str dd_member):
+    # type: (str, str) -> str
+    """Return the tracestate with its dd list members replaced by the given one, which comes first."""
+    cdef Py_ssize_t n = len(tracestate)
+    cdef Py_ssize_t start = 0
+    cdef Py_ssize_t end
+    members = ["dd=" + dd_member]
+    while start < n:
+        end = _member_end(tracestate, start, n)
+        if not _is_dd_member(tracestate, start, end):
+            members.append(tracestate[start:end])
+        start = end + 1
+    return ",".join(members)
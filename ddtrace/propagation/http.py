@@ -1,4 +1,3 @@
-import re
 import sys
 from typing import Any  # noqa:F401
 from typing import Dict  # noqa:F401
@@ -44,13 +43,19 @@ from ..internal.constants import MAX_UINT_64BITS as _MAX_UINT_64BITS
 from ..internal.constants import PROPAGATION_STYLE_B3_MULTI
 from ..internal.constants import PROPAGATION_STYLE_B3_SINGLE
 from ..internal.constants import PROPAGATION_STYLE_DATADOG
-from ..internal.constants import W3C_TRACEPARENT_KEY
 from ..internal.constants import W3C_TRACESTATE_KEY
 from ..internal.logger import get_logger
 from ..internal.sampling import SAMPLING_DECISION_TRACE_TAG_KEY
 from ..internal.sampling import SamplingMechanism
 from ..internal.sampling import validate_sampling_decision
 from ..internal.utils.http import w3c_tracestate_add_p
+from ._codec import apply_tracestate
+from ._codec import decimal_to_id
+from ._codec import extract_tracecontext
+from ._codec import get_sampling_priority
+from ._codec import get_tracestate_values
+from ._codec import hex_to_id
+from ._codec import parse_traceparent
 from ._utils import get_wsgi_header
 
 
@@ -95,23 +100,6 @@ _POSSIBLE_HTTP_HEADER_TRACEPARENT = _possible_header(_HTTP_HEADER_TRACEPARENT)
 _POSSIBLE_HTTP_HEADER_TRACESTATE = _possible_header(_HTTP_HEADER_TRACESTATE)
 
 
-# https://www.w3.org/TR/trace-context/#traceparent-header-field-values
-# Future proofing: The traceparent spec is additive, future traceparent versions may contain more than 4 values
-# The regex below matches the version, trace id, span id, sample flag, and end-string/future values (if version>00)
-_TRACEPARENT_HEX_REGEX = re.compile(
-    r"""
-     ^                  # Start of string
-     ([a-f0-9]{2})-     # 2 character hex version
-     ([a-f0-9]{32})-    # 32 character hex trace id
-     ([a-f0-9]{16})-    # 16 character hex span id
-     ([a-f0-9]{2})      # 2 character hex sample flag
-     (-.+)?             # optional, start of any additional values
-     $                  # end of string
-     """,
-    re.VERBOSE,
-)
-
-
 def _extract_header_value(possible_header_names, headers, default=None):
     # type: (FrozenSet[str], Dict[str, str], Optional[str]) -> Optional[str]
     for header in possible_header_names:
@@ -128,10 +116,8 @@ def _attach_baggage_to_context(headers: Dict[str, str], context: Context):
                 context._set_baggage_item(key[len(_HTTP_BAGGAGE_PREFIX) :], value)
 
 
-def _hex_id_to_dd_id(hex_id):
-    # type: (str) -> int
-    """Helper to convert hex ids into Datadog compatible ints."""
-    return int(hex_id, 16)
+# Helper to convert hex ids into Datadog compatible ints
+_hex_id_to_dd_id = hex_to_id
 
 
 _b3_id_to_dd_id = _hex_id_to_dd_id
@@ -210,7 +196,7 @@ class _DatadogMultiHeader:
     @staticmethod
     def _put_together_trace_id(trace_id_hob_hex: str, low_64_bits: int) -> int:
         # combine highest and lowest order hex values to create a 128 bit trace_id
-        return int(trace_id_hob_hex + "{:016x}".format(low_64_bits), 16)
+        return (_hex_id_to_dd_id(trace_id_hob_hex) << 64) | low_64_bits
 
     @staticmethod
     def _higher_order_is_valid(upper_64_bits: str) -> bool:
@@ -286,7 +272,7 @@ class _DatadogMultiHeader:
         if trace_id_str is None:
             return None
         try:
-            trace_id = int(trace_id_str)
+            trace_id = decimal_to_id(trace_id_str)
         except ValueError:
             trace_id = 0
 
@@ -345,7 +331,7 @@ class _DatadogMultiHeader:
             return Context(
                 # DEV: Do not allow `0` for trace id or span id, use None instead
                 trace_id=trace_id or None,
-                span_id=int(parent_span_id) or None,  # type: ignore[arg-type]
+                span_id=decimal_to_id(parent_span_id) or None,  # type: ignore[arg-type]
                 sampling_priority=sampling_priority,  # type: ignore[arg-type]
                 dd_origin=origin,
                 # DEV: This cast is needed because of the type requirements of
@@ -647,56 +633,9 @@ class _TraceContext:
         ``_dd.p.`` prefix = ``t.``
     """
 
-    @staticmethod
-    def decode_tag_val(tag_val):
-        # type str -> str
-        return tag_val.replace("~", "=")
-
-    @staticmethod
-    def _get_traceparent_values(tp):
-        # type: (str) -> Tuple[int, int, Literal[0,1]]
-        """If there is no traceparent, or if the traceparent value is invalid raise a ValueError.
-        Otherwise we extract the trace-id, span-id, and sampling priority from the
-        traceparent header.
-        """
-        valid_tp_values = _TRACEPARENT_HEX_REGEX.match(tp.strip())
-        if valid_tp_values is None:
-            raise ValueError("Invalid traceparent version: %s" % tp)
-
-        (
-            version,
-            trace_id_hex,
-            span_id_hex,
-            trace_flags_hex,
-            future_vals,
-        ) = valid_tp_values.groups()  # type: Tuple[str, str, str, str, Optional[str]]
-
-        if version == "ff":
-            # https://www.w3.org/TR/trace-context/#version
-            raise ValueError("ff is an invalid traceparent version: %s" % tp)
-        elif version != "00":
-            # currently 00 is the only version format, but if future versions come up we may need to add changes
-            log.warning("unsupported traceparent version:%r, still attempting to parse", version)
-        elif version == "00" and future_vals is not None:
-            raise ValueError("Traceparents with the version `00` should contain 4 values delimited by a dash: %s" % tp)
-
-        trace_id = _hex_id_to_dd_id(trace_id_hex)
-        span_id = _hex_id_to_dd_id(span_id_hex)
-
-        # All 0s are invalid values
-        if trace_id == 0:
-            raise ValueError("0 value for trace_id is invalid")
-        if span_id == 0:
-            raise ValueError("0 value for span_id is invalid")
-
-        trace_flags = _hex_id_to_dd_id(trace_flags_hex)
-        # there's currently only one trace flag, which denotes sampling priority
-        # was set to keep "01" or drop "00"
-        # trace flags is a bit field: https://www.w3.org/TR/trace-context/#trace-flags
-        # if statement is required to cast traceflags to a Literal
-        sampling_priority = 1 if trace_flags & 0x1 else 0  # type: Literal[0, 1]
-
-        return trace_id, span_id, sampling_priority
+    # The traceparent, tracestate and sampling priority are decoded natively, see ddtrace.propagation._codec
+    _get_traceparent_values = staticmethod(parse_traceparent)
+    _get_sampling_priority = staticmethod(get_sampling_priority)
 
     @staticmethod
     def _get_tracestate_values(ts_l):
@@ -704,129 +643,30 @@ class _TraceContext:
 
         # tracestate list parsing example: ["dd=s:2;o:rum;t.dm:-4;t.usr.id:baz64","congo=t61rcWkgMzE"]
         # -> 2, {"_dd.p.dm":"-4","_dd.p.usr.id":"baz64"}, "rum"
-
-        dd = None
-        for list_mem in ts_l:
-            if list_mem.startswith("dd="):
-                # cut out dd= before turning into dict
-                list_mem = list_mem[3:]
-                # since tags can have a value with a :, we need to only split on the first instance of :
-                dd = dict(item.split(":", 1) for item in list_mem.split(";"))
-
-        # parse out values
-        if dd:
-            sampling_priority_ts = dd.get("s")
-            if sampling_priority_ts is not None:
-                sampling_priority_ts_int = int(sampling_priority_ts)
-            else:
-                sampling_priority_ts_int = None
-
-            origin = dd.get("o")
-            if origin:
-                # we encode "=" as "~" in tracestate so need to decode here
-                origin = _TraceContext.decode_tag_val(origin)
-
-            # Get last datadog parent id, this field is used to reconnect traces with missing spans
-            lpid = dd.get("p", "0000000000000000")
-
-            # need to convert from t. to _dd.p.
-            other_propagated_tags = {
-                "_dd.p.%s" % k[2:]: _TraceContext.decode_tag_val(v) for (k, v) in dd.items() if k.startswith("t.")
-            }
-
-            return sampling_priority_ts_int, other_propagated_tags, origin, lpid
-        else:
-            return None, {}, None, None
-
-    @staticmethod
-    def _get_sampling_priority(
-        traceparent_sampled: int, tracestate_sampling_priority: Optional[int], origin: Optional[str] = None
-    ):
-        """
-        When the traceparent sampled flag is set, the Datadog sampling priority is either
-        1 or a positive value of sampling priority if propagated in tracestate.
-
-        When the traceparent sampled flag is not set, the Datadog sampling priority is either
-        0 or a negative value of sampling priority if propagated in tracestate.
-
-        When origin is "rum" and there is no sampling priority propagated in tracestate, the above rules do not apply.
-        """
-        from_rum_wo_priority = not tracestate_sampling_priority and origin == "rum"
-
-        if (
-            not from_rum_wo_priority
-            and traceparent_sampled == 0
-            and (not tracestate_sampling_priority or tracestate_sampling_priority >= 0)
-        ):
-            sampling_priority = 0
-        elif (
-            not from_rum_wo_priority
-            and traceparent_sampled == 1
-            and (not tracestate_sampling_priority or tracestate_sampling_priority < 0)
-        ):
-            sampling_priority = 1
-        else:
-            # The two other options provided for clarity:
-            # elif traceparent_sampled == 1 and tracestate_sampling_priority > 0:
-            # elif traceparent_sampled == 0 and tracestate_sampling_priority <= 0:
-            sampling_priority = tracestate_sampling_priority  # type: ignore
-
-        return sampling_priority
+        return get_tracestate_values(",".join(ts_l))
 
     @staticmethod
     def _extract(headers):
         # type: (Dict[str, str]) -> Optional[Context]
-
-        try:
-            tp = _extract_header_value(_POSSIBLE_HTTP_HEADER_TRACEPARENT, headers)
-            if tp is None:
-                log.debug("no traceparent header")
-                return None
-            trace_id, span_id, trace_flag = _TraceContext._get_traceparent_values(tp)
-        except (ValueError, AssertionError):
-            log.exception("received invalid w3c traceparent: %s ", tp)
+        values = extract_tracecontext(headers)
+        if values is None:
             return None
 
-        meta = {W3C_TRACEPARENT_KEY: tp}  # type: _MetaDictType
-
-        ts = _extract_header_value(_POSSIBLE_HTTP_HEADER_TRACESTATE, headers)
-        return _TraceContext._get_context(trace_id, span_id, trace_flag, ts, meta)
+        trace_id, span_id, sampling_priority, origin, meta = values
+        return Context(
+            trace_id=trace_id,
+            span_id=span_id,
+            sampling_priority=sampling_priority,
+            dd_origin=origin,
+            meta=meta,
+        )
 
     @staticmethod
     def _get_context(trace_id, span_id, trace_flag, ts, meta=None):
         # type: (int, int, Literal[0,1], Optional[str], Optional[_MetaDictType]) -> Context
         if meta is None:
             meta = {}
-        origin = None
-        sampling_priority = trace_flag  # type: int
-        if ts:
-            # whitespace is allowed, but whitespace to start or end values should be trimmed
-            # e.g. "foo=1 \t , \t bar=2, \t baz=3" -> "foo=1,bar=2,baz=3"
-            ts_l = [member.strip() for member in ts.split(",")]
-            ts = ",".join(ts_l)
-            # the value MUST contain only ASCII characters in the
-            # range of 0x20 to 0x7E
-            if re.search(r"[^\x20-\x7E]+", ts):
-                log.debug("received invalid tracestate header: %r", ts)
-            else:
-                # store tracestate so we keep other vendor data for injection, even if dd ends up being invalid
-                meta[W3C_TRACESTATE_KEY] = ts
-                try:
-                    tracestate_values = _TraceContext._get_tracestate_values(ts_l)
-                except (TypeError, ValueError):
-                    log.debug("received invalid dd header value in tracestate: %r ", ts)
-                    tracestate_values = None
-
-                if tracestate_values:
-                    sampling_priority_ts, other_propagated_tags, origin, lpid = tracestate_values
-                    meta.update(other_propagated_tags.items())
-                    if lpid:
-                        meta[LAST_DD_PARENT_ID_KEY] = lpid
-
-                    sampling_priority = _TraceContext._get_sampling_priority(trace_flag, sampling_priority_ts, origin)
-                else:
-                    log.debug("no dd list member in tracestate from incoming request: %r", ts)
-
+        sampling_priority, origin = apply_tracestate(trace_flag, ts, meta)
         return Context(
             trace_id=trace_id,
             span_id=span_id,
@@ -848,7 +688,7 @@ class _TraceContext:
                 )
             elif LAST_DD_PARENT_ID_KEY in span_context._meta:
                 # Datadog Span is not active, propagate the last datadog span_id
-                span_id = int(span_context._meta[LAST_DD_PARENT_ID_KEY], 16)
+                span_id = _hex_id_to_dd_id(span_context._meta[LAST_DD_PARENT_ID_KEY])
                 headers[_HTTP_HEADER_TRACESTATE] = w3c_tracestate_add_p(span_context._tracestate, span_id)
             else:
                 headers[_HTTP_HEADER_TRACESTATE] = span_context._tracestate
@@ -11,13 +11,13 @@ from typing import Optional  # noqa:F401
 from typing import Tuple  # noqa:F401
 
 from .constants import ENV_KEY
+from .internal._glob_matching import SamplingRuleMatcher
 from .internal.constants import _PRIORITY_CATEGORY
 from .internal.constants import DEFAULT_SAMPLING_RATE_LIMIT
 from .internal.constants import MAX_UINT_64BITS as _MAX_UINT_64BITS
 from .internal.logger import get_logger
 from .internal.rate_limiter import RateLimiter
 from .internal.sampling import _apply_rate_limit
-from .internal.sampling import _get_highest_precedence_rule_matching
 from .internal.sampling import _set_sampling_tags
 from .sampling_rule import SamplingRule
 from .settings import _config as ddconfig
@@ -204,7 +204,7 @@ class DatadogSampler(RateByServiceSampler):
     per second.
     """
 
-    __slots__ = ("limiter", "rules")
+    __slots__ = ("limiter", "rules", "_rules_matcher")
 
     NO_RATE_LIMIT = -1
     # deprecate and remove the DEFAULT_RATE_LIMIT field from DatadogSampler
@@ -255,6 +255,9 @@ class DatadogSampler(RateByServiceSampler):
         if default_sample_rate is not None:
             self.rules.append(SamplingRule(sample_rate=default_sample_rate))
 
+        # All the rules are compiled together, so that a span is matched against them in one pass
+        self._rules_matcher = SamplingRuleMatcher(self.rules)
+
         # Configure rate limiter
         self.limiter = RateLimiter(rate_limit)
 
@@ -295,7 +298,7 @@ class DatadogSampler(RateByServiceSampler):
     def sample(self, span):
         span.context._update_tags(span)
 
-        matched_rule = _get_highest_precedence_rule_matching(span, self.rules)
+        matched_rule = self._get_highest_precedence_rule_matching(span)
 
         sampler = self._default_sampler  # type: BaseSampler
         sample_rate = self.sample_rate
@@ -317,6 +320,14 @@ class DatadogSampler(RateByServiceSampler):
 
         return cleared_rate_limit and sampled
 
+    def _get_highest_precedence_rule_matching(self, span):
+        # type: (Span) -> Optional[SamplingRule]
+        # The rules may have been changed since they were compiled
+        if not self._rules_matcher.compiled_for(self.rules):
+            self._rules_matcher = SamplingRuleMatcher(self.rules)
+        index = self._rules_matcher.first_match(span)
+        return self.rules[index] if index >= 0 else None
+
     def _choose_priority_category_with_rule(self, rule, sampler):
         # type: (Optional[SamplingRule], BaseSampler) -> str
         if rule:
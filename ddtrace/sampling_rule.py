@@ -1,18 +1,16 @@
 from typing import TYPE_CHECKING  # noqa:F401
 
+from ddtrace.internal._glob_matching import SamplingRuleMatcher
 from ddtrace.internal.compat import pattern_type
 from ddtrace.internal.constants import MAX_UINT_64BITS as _MAX_UINT_64BITS
 from ddtrace.internal.glob_matching import GlobMatcher
 from ddtrace.internal.logger import get_logger
-from ddtrace.internal.utils.cache import cachedmethod
 from ddtrace.internal.utils.deprecations import DDTraceDeprecationWarning
 from ddtrace.vendor.debtcollector import deprecate
 
 
 if TYPE_CHECKING:  # pragma: no cover
     from typing import Any  # noqa:F401
-    from typing import Optional  # noqa:F401
-    from typing import Tuple  # noqa:F401
 
     from ddtrace._trace.span import Span  # noqa:F401
 
@@ -83,6 +81,7 @@ class SamplingRule(object):
         self.service = self.choose_matcher(service)
         self.name = self.choose_matcher(name)
         self.resource = self.choose_matcher(resource)
+        self._matcher = SamplingRuleMatcher([self])
 
     @property
     def sample_rate(self):
@@ -126,17 +125,6 @@ class SamplingRule(object):
         # Exact match on the values
         return prop == pattern
 
-    @cachedmethod()
-    def _matches(self, key):
-        # type: (Tuple[Optional[str], str, Optional[str]]) -> bool
-        # self._matches exists to maintain legacy pattern values such as regex and functions
-        service, name, resource = key
-        for prop, pattern in [(service, self.service), (name, self.name), (resource, self.resource)]:
-            if not self._pattern_matches(prop, pattern):
-                return False
-        else:
-            return True
-
     def matches(self, span):
         # type: (Span) -> bool
         """
@@ -147,8 +135,7 @@ class SamplingRule(object):
         :returns: Whether this span matches or not
         :rtype: :obj:`bool`
         """
-        tags_match = self.tags_match(span)
-        return tags_match and self._matches((span.service, span.name, span.resource))
+        return self._matcher.first_match(span) == 0
 
     def tags_match(self, span):
         # type: (Span) -> bool
@@ -160,35 +147,7 @@ class SamplingRule(object):
     def check_tags(self, meta, metrics):
         if meta is None and metrics is None:
             return False
-
-        tag_match = False
-        for tag_key in self._tag_value_matchers.keys():
-            value = meta.get(tag_key)
-            tag_match = self._tag_value_matchers[tag_key].match(str(value))
-            # If the value doesn't match in meta, check the metrics
-            if tag_match is False:
-                value = metrics.get(tag_key)
-                # Floats: Matching floating point values with a non-zero decimal part is not supported.
-                # For floating point values with a non-zero decimal part, any all * pattern always returns true.
-                # Other patterns always return false.
-                if isinstance(value, float):
-                    if not value.is_integer():
-                        if self._tag_value_matchers[tag_key].pattern == "*":
-                            tag_match = True
-                        else:
-                            return False
-                        continue
-                    else:
-                        value = int(value)
-
-                tag_match = self._tag_value_matchers[tag_key].match(str(value))
-            else:
-                continue
-            # if we don't match with all specified tags for a rule, it's not a match
-            if tag_match is False:
-                return False
-
-        return tag_match
+        return self._matcher.check_tags(0, meta, metrics)
 
     def sample(self, span):
         """
@@ -170,6 +170,43 @@ class ProfilingConfig(En):
         help="The timeout in seconds before dropping events if the HTTP API does not reply",
     )
 
+    timeline_enabled = En.v(
+        bool,
+        "timeline_enabled",
+        default=False,
+        help_type="Boolean",
+        help="Whether to keep the time at which samples are taken, to display them on a timeline."
+        " Only supported by the libdatadog exporter.",
+    )
+
+    memory_budget = En.v(
+        int,
+        "memory_budget",
+        default=0,
+        help_type="Integer",
+        help="Approximate number of bytes a profile may use before samples are degraded: low-value labels are dropped"
+        " or replaced by a placeholder and stacks are shortened until the next upload. 0 disables the budget. Only"
+        " supported by the libdatadog exporter.",
+    )
+
+    spool_dir = En.v(
+        str,
+        "spool_dir",
+        default="",
+        help_type="String",
+        help="Directory to write profiles to instead of uploading them, for when no agent can be reached. Spooled"
+        " profiles can be uploaded later with ``python -m ddtrace.profiling.replay <directory>``. Only supported by the"
+        " libdatadog exporter.",
+    )
+
+    spool_max_size = En.v(
+        int,
+        "spool_max_size",
+        default=256 * 1024 * 1024,
+        help_type="Integer",
+        help="Maximum size in bytes of the spooled profiles; past this size, the oldest profiles are removed.",
+    )
+
     tags = En.v(
         dict,
         "tags",
@@ -203,6 +240,24 @@ class ProfilingConfig(En):
 
             enabled = En.d(bool, lambda c: _check_for_stack_v2_available() and c._enabled)
 
+        max_tasks = En.v(
+            int,
+            "max_tasks",
+            default=0,
+            help_type="Integer",
+            help="The maximum number of asyncio tasks or gevent greenlets sampled per thread at each collection."
+            " When there are more, they are sampled in turn and their wall time is scaled accordingly. 0 means no limit.",
+        )
+
+        gil_free = En.v(
+            bool,
+            "gil_free",
+            default=False,
+            help_type="Boolean",
+            help="Whether to sample thread stacks from a native thread without holding the GIL."
+            " Only supported on Linux with CPython 3.11 and 3.12; ignored when the v2 stack profiler is enabled.",
+        )
+
     class Lock(En):
         __item__ = __prefix__ = "lock"
 
@@ -253,6 +308,16 @@ class ProfilingConfig(En):
         )
         sample_size = En.d(int, _derive_default_heap_sample_size)
 
+        upload_interval = En.v(
+            float,
+            "upload_interval",
+            default=0.0,
+            help_type="Float",
+            help="Interval in seconds between uploads of heap profiles, which are then sent separately from the other"
+            " profile types. Heap profiles are uploaded at most as often as the other profiles. 0 sends them together."
+            " Only supported by the libdatadog exporter.",
+        )
+
     class Export(En):
         __item__ = __prefix__ = "export"
 
@@ -392,9 +392,16 @@ if CURRENT_OS == "Windows":
     encoding_libraries = ["ws2_32"]
     extra_compile_args = []
     debug_compile_args = []
+    # zlib headers are not available; the pprof exporter compresses profiles in Python instead
+    pprof_libraries = []
+    pprof_macros = []
+    cpp17_compile_args = ["/std:c++17"]
 else:
     linux = CURRENT_OS == "Linux"
     encoding_libraries = []
+    pprof_libraries = ["z"]
+    pprof_macros = [("DD_PPROF_WRITER_GZIP", "1")]
+    cpp17_compile_args = ["-std=c++17"]
     extra_compile_args = ["-DPy_BUILD_CORE"]
     if DEBUG_COMPILE:
         if linux:
@@ -425,6 +432,16 @@ if not IS_PYSTON:
         ),
     ]
     if platform.system() not in ("Windows", ""):
+        ext_modules.append(
+            Extension(
+                "ddtrace.profiling.collector._nogil_sampler",
+                sources=[
+                    "ddtrace/profiling/collector/_nogil_sampler.c",
+                ],
+                # Needed to access the interpreter frames; the module disables itself on unsupported versions
+                extra_compile_args=debug_compile_args + ["-DPy_BUILD_CORE"],
+            )
+        )
         ext_modules.append(
             Extension(
                 "ddtrace.appsec._iast._stacktrace",
@@ -432,7 +449,7 @@ if not IS_PYSTON:
                 sources=[
                     "ddtrace/appsec/_iast/_stacktrace.c",
                 ],
-                extra_compile_args=debug_compile_args,
+                extra_compile_args=debug_compile_args + ["-DPy_BUILD_CORE"],
             )
         )
 
@@ -498,6 +515,26 @@ setup(
                 sources=["ddtrace/internal/_tagset.pyx"],
                 language="c",
             ),
+            Cython.Distutils.Extension(
+                "ddtrace._trace._span",
+                sources=["ddtrace/_trace/_span.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace._trace.processor._trace_buffer",
+                sources=["ddtrace/_trace/processor/_trace_buffer.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.appsec._ddwaf._object_arena",
+                sources=["ddtrace/appsec/_ddwaf/_object_arena.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.appsec._ddwaf._binding",
+                sources=["ddtrace/appsec/_ddwaf/_binding.pyx"],
+                language="c",
+            ),
             Extension(
                 "ddtrace.internal._encoding",
                 ["ddtrace/internal/_encoding.pyx"],
@@ -505,6 +542,41 @@ setup(
                 libraries=encoding_libraries,
                 define_macros=encoding_macros,
             ),
+            Cython.Distutils.Extension(
+                "ddtrace.internal._glob_matching",
+                sources=["ddtrace/internal/_glob_matching.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.propagation._codec",
+                sources=["ddtrace/propagation/_codec.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.internal.datastreams._pathway",
+                sources=["ddtrace/internal/datastreams/_pathway.pyx"],
+                language="c",
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.internal._ddsketch",
+                sources=["ddtrace/internal/_ddsketch.pyx"],
+                language="c++",
+                extra_compile_args=cpp17_compile_args,
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.internal.processor._stats",
+                sources=["ddtrace/internal/processor/_stats.pyx"],
+                include_dirs=["ddtrace/internal"],
+                language="c++",
+                extra_compile_args=cpp17_compile_args,
+            ),
+            Cython.Distutils.Extension(
+                "ddtrace.internal.datastreams._aggregator",
+                sources=["ddtrace/internal/datastreams/_aggregator.pyx"],
+                include_dirs=["ddtrace/internal"],
+                language="c++",
+                extra_compile_args=cpp17_compile_args,
+            ),
             Cython.Distutils.Extension(
                 "ddtrace.profiling.collector.stack",
                 sources=["ddtrace/profiling/collector/stack.pyx"],
@@ -529,7 +601,9 @@ setup(
             Cython.Distutils.Extension(
                 "ddtrace.profiling.exporter.pprof",
                 sources=["ddtrace/profiling/exporter/pprof.pyx"],
-                language="c",
+                language="c++",
+                libraries=pprof_libraries,
+                define_macros=pprof_macros,
             ),
             Cython.Distutils.Extension(
                 "ddtrace.profiling._build",
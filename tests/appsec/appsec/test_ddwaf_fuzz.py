@@ -1,9 +1,11 @@
+import ctypes
 import sys
 
 from hypothesis import given
 from hypothesis import strategies as st
 import pytest
 
+from ddtrace.appsec._ddwaf._object_arena import ObjectArena
 from ddtrace.appsec._ddwaf.ddwaf_types import _observator
 from ddtrace.appsec._ddwaf.ddwaf_types import ddwaf_object
 
@@ -80,6 +82,55 @@ def test_limits(obj, res, trunc):
     assert obs.truncation == trunc
 
 
+def test_object_arena():
+    arena = ObjectArena()
+    body = {"items": [{"id": i, "name": "x" * 1000} for i in range(100)], "big": "y" * (1 << 20)}
+    headers_address, headers_truncation = arena.build({"host": "localhost", "x": ["é", b"\xff"]}, 256, 20, 4096)
+    body_address, body_truncation = arena.build(body, 256, 20, 4096)
+    assert arena.allocated > 100 * 1000
+
+    # trees built in the same arena stay valid until it is freed
+    assert ddwaf_object.from_address(headers_address).struct == {"host": "localhost", "x": ["é", ""]}
+    assert headers_truncation == 0
+    assert ddwaf_object.from_address(body_address).struct == dict(body, big="y" * 4095)
+    assert body_truncation == 1
+
+    arena.free()
+    assert arena.allocated == 0
+
+
+def _first_value_items(address):
+    # The nodes of the cached values are shared between the trees
+    return ctypes.addressof(ddwaf_object.from_address(address).value.array[0].value.array.contents)
+
+
+def test_object_arena_cached_values():
+    arena = ObjectArena()
+    headers = {"header-%d" % i: "value" for i in range(100)}
+    arena.build({"headers": headers}, 256, 20, 4096)
+    allocated = arena.allocated
+
+    # values already converted are reused, under any key, as long as the limits are the same
+    address, truncation = arena.build({"headers": headers, "other": headers}, 256, 20, 4096)
+    assert arena.allocated == allocated
+    assert ddwaf_object.from_address(address).struct == {"headers": headers, "other": headers}
+    assert truncation == 0
+    address, truncation = arena.build({"headers": headers}, 1, 20, 4096)
+    assert ddwaf_object.from_address(address).struct == {"headers": {"header-0": "value"}}
+    assert truncation == 2
+
+
+    # values built without the cache are converted again, and are not cached for the next builds
+    headers["header-0"] = "changed"
+    address, _ = arena.build({"headers": headers}, 256, 20, 4096, cache_values=False)
+    assert ddwaf_object.from_address(address).struct == {"headers": headers}
+    other = {"header": "value"}
+    address, _ = arena.build({"other": other}, 256, 20, 4096, cache_values=False)
+    cached_address, _ = arena.build({"other": other}, 256, 20, 4096)
+    assert _first_value_items(cached_address) != _first_value_items(address)
+    address, _ = arena.build({"other": other}, 256, 20, 4096)
+    assert _first_value_items(cached_address) == _first_value_items(address)
+
 if __name__ == "__main__":
     import atheris
 
@@ -543,6 +543,62 @@ def test_ddwaf_run_timeout():
         assert res.timeout is True
 
 
+def test_ddwaf_run_same_addresses():
+    with open(rules.RULES_GOOD_PATH) as rule_set:
+        rules_json = json.loads(rule_set.read())
+        _ddwaf = DDWaf(rules_json, b"", b"")
+        headers = {"user-agent": "werkzeug/2.1.2", "host": "localhost"}
+        cookies = {"attack": "1' or '1' = '1'"}
+        ctx = _ddwaf._at_request_start()
+        res = _ddwaf.run(ctx, {"server.request.headers.no_cookies": headers}, timeout_ms=DEFAULT.WAF_TIMEOUT)
+        assert res.data == []
+        allocated = ctx.arena.allocated
+
+        # only the new addresses are pushed, the headers already sent are neither converted nor pushed again
+        data = {"server.request.headers.no_cookies": headers, "server.request.cookies": cookies}
+        res = _ddwaf.run(ctx, data, timeout_ms=DEFAULT.WAF_TIMEOUT)
+        assert res.data[0]["rule"]["id"] == "crs-942-100"
+        assert ctx.arena.allocated == allocated
+
+
+def test_ddwaf_run_ephemeral_released():
+    with open(rules.RULES_GOOD_PATH) as rule_set:
+        rules_json = json.loads(rule_set.read())
+        _ddwaf = DDWaf(rules_json, b"", b"")
+        headers = {"user-agent": "werkzeug/2.1.2", "host": "localhost"}
+        ctx = _ddwaf._at_request_start()
+        _ddwaf.run(ctx, {"server.request.headers.no_cookies": headers}, timeout_ms=DEFAULT.WAF_TIMEOUT)
+        allocated = ctx.arena.allocated
+
+        # the ephemeral data is released after each run instead of staying in the arena until the request ends
+        cookies = {"cookie-%d" % i: "x" * 4000 for i in range(100)}
+        cookies["attack"] = "1' or '1' = '1'"
+        for _ in range(3):
+            res = _ddwaf.run(
+                ctx, {}, ephemeral_data={"server.request.cookies": cookies}, timeout_ms=DEFAULT.WAF_TIMEOUT
+            )
+            assert res.data[0]["rule"]["id"] == "crs-942-100"
+        assert ctx.arena.allocated == allocated
+
+
+def test_ddwaf_run_request_end():
+    with open(rules.RULES_GOOD_PATH) as rule_set:
+        rules_json = json.loads(rule_set.read())
+        _ddwaf = DDWaf(rules_json, b"", b"")
+        data = {"server.request.cookies": {"attack": "1' or '1' = '1'"}}
+        ctx = _ddwaf._at_request_start()
+        res = _ddwaf.run(ctx, {}, ephemeral_data=data, timeout_ms=DEFAULT.WAF_TIMEOUT)
+        assert res.data[0]["rule"]["id"] == "crs-942-100"
+        assert ctx.arena.allocated > 0
+
+        # the context is destroyed and the data sent to it released, later runs are dry runs
+        _ddwaf._at_request_end(ctx)
+        assert not ctx
+        assert ctx.arena.allocated == 0
+        res = _ddwaf.run(ctx, data, timeout_ms=DEFAULT.WAF_TIMEOUT)
+        assert res.data == []
+
+
 def test_ddwaf_info():
     with open(rules.RULES_GOOD_PATH) as rule_set:
         rules_json = json.loads(rule_set.read())
@@ -618,15 +674,24 @@ def test_ddwaf_info_with_json_decode_errors(tracer_appsec, caplog):
     assert "Error parsing data ASM In-App WAF metrics report" in caplog.text
 
 
+def _failing_context_run(error):
+    # The methods of the native context cannot be patched, the contexts are created from a subclass instead
+    from ddtrace.appsec._ddwaf._binding import Context
+
+    class FailingContext(Context):
+        def run(self, data, ephemeral_data, timeout):
+            raise error
+
+    return mock.patch("ddtrace.appsec._ddwaf.ddwaf_types.ddwaf_context_capsule", FailingContext)
+
+
 def test_ddwaf_run_contained_typeerror(tracer_appsec, caplog):
     tracer = tracer_appsec
 
     config = rules.Config()
     config.http_tag_query_string = True
 
-    with caplog.at_level(logging.DEBUG), mock.patch(
-        "ddtrace.appsec._ddwaf.ddwaf_run", side_effect=TypeError("expected c_long instead of int")
-    ):
+    with caplog.at_level(logging.DEBUG), _failing_context_run(TypeError("expected c_long instead of int")):
         with _asm_request_context.asm_request_context_manager(), tracer.trace("test", span_type=SpanTypes.WEB) as span:
             set_http_meta(
                 span,
@@ -662,9 +727,7 @@ def test_ddwaf_run_contained_oserror(tracer_appsec, caplog):
     config = rules.Config()
     config.http_tag_query_string = True
 
-    with caplog.at_level(logging.DEBUG), mock.patch(
-        "ddtrace.appsec._ddwaf.ddwaf_run", side_effect=OSError("ddwaf run failed")
-    ):
+    with caplog.at_level(logging.DEBUG), _failing_context_run(OSError("ddwaf run failed")):
         with _asm_request_context.asm_request_context_manager(), tracer.trace("test", span_type=SpanTypes.WEB) as span:
             set_http_meta(
                 span,
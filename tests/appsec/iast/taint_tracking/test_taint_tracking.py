@@ -13,6 +13,8 @@ with override_env({"DD_IAST_ENABLED": "True"}):
     from ddtrace.appsec._iast._taint_tracking import Source
     from ddtrace.appsec._iast._taint_tracking import TaintRange
     from ddtrace.appsec._iast._taint_tracking import destroy_context
+    from ddtrace.appsec._iast._taint_tracking import get_tainted_arguments
+    from ddtrace.appsec._iast._taint_tracking import get_tainted_ranges
     from ddtrace.appsec._iast._taint_tracking import num_objects_tainted
     from ddtrace.appsec._iast._taint_tracking import set_ranges
     from ddtrace.appsec._iast._taint_tracking import taint_pyobject
@@ -40,6 +42,22 @@ def test_taint_ranges_as_evidence_info_all_tainted():
     assert sources == [input_info]
 
 
+def test_get_tainted_arguments():
+    tainted_text = taint_pyobject(
+        "tainted", source_name="request_body", source_value="tainted", source_origin=OriginType.PARAMETER
+    )
+    tainted_bytes = taint_pyobject(
+        b"tainted", source_name="request_body", source_value="tainted", source_origin=OriginType.PARAMETER
+    )
+    arguments = ["ls", tainted_text, "", 1, None, tainted_bytes]
+    assert get_tainted_arguments(arguments) == [
+        (1, get_tainted_ranges(tainted_text)),
+        (5, get_tainted_ranges(tainted_bytes)),
+    ]
+    assert get_tainted_arguments(tuple(arguments)) == get_tainted_arguments(arguments)
+    assert get_tainted_arguments(["ls", "-l"]) == []
+
+
 @pytest.mark.skip_iast_check_logs
 def test_taint_object_with_no_context_should_be_noop():
     destroy_context()
@@ -134,6 +134,14 @@ def test_stacktrace_memory_check_direct_call():
         assert line_number > 0
 
 
+def test_stacktrace_same_as_python():
+    assert get_info_frame(CWD) == get_info_frame_py(CWD)
+
+    # the frames already seen are filtered again when the working directory changes
+    assert get_info_frame("/nonexistent") == ("", -1)
+    assert get_info_frame(CWD) == get_info_frame_py(CWD)
+
+
 @flaky(1735812000)
 @pytest.mark.limit_leaks("460 KB", filter_fn=IASTFilter())
 def test_stacktrace_memory_check_no_native():
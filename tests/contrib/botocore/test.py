@@ -1234,7 +1234,7 @@ class BotocoreTest(TracerTestCase):
                         3337976778666780987,
                         0,
                     )
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 1
             )
             assert (
@@ -1244,7 +1244,7 @@ class BotocoreTest(TracerTestCase):
                         3337976778666780987,
                         0,
                     )
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 1
             )
             assert (
@@ -1260,13 +1260,13 @@ class BotocoreTest(TracerTestCase):
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 13854213076663332654, 3337976778666780987)
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 1
             )
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 13854213076663332654, 3337976778666780987)
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 1
             )
             assert (
@@ -1314,20 +1314,20 @@ class BotocoreTest(TracerTestCase):
             first = list(buckets.values())[0].pathway_stats
 
             assert (
-                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency._count >= 1
+                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency.count >= 1
             )
-            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency._count >= 1
+            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency.count >= 1
             assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].payload_size.count == 1
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 15625264005677082004, 15309751356108160802)
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 1
             )
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 15625264005677082004, 15309751356108160802)
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 1
             )
             assert (
@@ -1380,20 +1380,20 @@ class BotocoreTest(TracerTestCase):
             first = list(buckets.values())[0].pathway_stats
 
             assert (
-                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency._count >= 3
+                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency.count >= 3
             )
-            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency._count >= 3
+            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency.count >= 3
             assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].payload_size.count == 3
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 15625264005677082004, 15309751356108160802)
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 3
             )
             assert (
                 first[
                     ("direction:in,topic:Test,type:sqs", 15625264005677082004, 15309751356108160802)
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 3
             )
             assert (
@@ -1456,12 +1456,12 @@ class BotocoreTest(TracerTestCase):
             first = list(buckets.values())[0].pathway_stats
 
             assert (
-                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency._count >= 1
+                first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].full_pathway_latency.count >= 1
             )
-            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency._count >= 1
+            assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].edge_latency.count >= 1
             assert first[("direction:out,topic:Test,type:sqs", 15309751356108160802, 0)].payload_size.count == 1
-            assert first[("direction:in,topic:Test,type:sqs", 3569019635468821892, 0)].full_pathway_latency._count >= 1
-            assert first[("direction:in,topic:Test,type:sqs", 3569019635468821892, 0)].edge_latency._count >= 1
+            assert first[("direction:in,topic:Test,type:sqs", 3569019635468821892, 0)].full_pathway_latency.count >= 1
+            assert first[("direction:in,topic:Test,type:sqs", 3569019635468821892, 0)].edge_latency.count >= 1
             assert first[("direction:in,topic:Test,type:sqs", 3569019635468821892, 0)].payload_size.count == 1
 
     @mock_lambda
@@ -2974,7 +2974,7 @@ class BotocoreTest(TracerTestCase):
                         7250761453654470644,
                         17012262583645342129,
                     )
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 2
             )
             assert (
@@ -2984,7 +2984,7 @@ class BotocoreTest(TracerTestCase):
                         7250761453654470644,
                         17012262583645342129,
                     )
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 2
             )
             assert (
@@ -3004,7 +3004,7 @@ class BotocoreTest(TracerTestCase):
                         17012262583645342129,
                         0,
                     )
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 2
             )
             assert (
@@ -3014,7 +3014,7 @@ class BotocoreTest(TracerTestCase):
                         17012262583645342129,
                         0,
                     )
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 2
             )
             assert (
@@ -3067,7 +3067,7 @@ class BotocoreTest(TracerTestCase):
                         7186383338881463054,
                         14715769790627487616,
                     )
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 1
             )
             assert (
@@ -3077,7 +3077,7 @@ class BotocoreTest(TracerTestCase):
                         7186383338881463054,
                         14715769790627487616,
                     )
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 1
             )
             assert (
@@ -3097,7 +3097,7 @@ class BotocoreTest(TracerTestCase):
                         14715769790627487616,
                         0,
                     )
-                ].full_pathway_latency._count
+                ].full_pathway_latency.count
                 >= 1
             )
             assert (
@@ -3107,7 +3107,7 @@ class BotocoreTest(TracerTestCase):
                         14715769790627487616,
                         0,
                     )
-                ].edge_latency._count
+                ].edge_latency.count
                 >= 1
             )
             assert (
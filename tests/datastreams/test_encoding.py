@@ -1,5 +1,13 @@
+import struct
+
+import pytest
+
+from ddtrace.internal.datastreams._pathway import compute_pathway_hash
+from ddtrace.internal.datastreams.encoding import decode_pathway
 from ddtrace.internal.datastreams.encoding import decode_var_int_64
+from ddtrace.internal.datastreams.encoding import encode_pathway
 from ddtrace.internal.datastreams.encoding import encode_var_int_64
+from ddtrace.internal.datastreams.fnv import fnv1_64
 from ddtrace.internal.datastreams.processor import DataStreamsProcessor
 
 
@@ -30,3 +38,35 @@ def test_pathway_encoding():
     decoded = processor.decode_pathway(data)
     decoded.set_checkpoint(["direction:in", "type:kafka", "topic:topic1"])
     assert abs(decoded.pathway_start_sec - expected_pathway_start) <= 1e-3
+
+
+@pytest.mark.parametrize(
+    "data,expected",
+    [(b"", 0xCBF29CE484222325), (b"a", 0xAF63BD4C8601B7BE), (b"foobar", 0x340D8765A4DDA9C2)],
+)
+def test_fnv1_64(data, expected):
+    assert fnv1_64(data) == expected
+
+
+def test_compute_pathway_hash():
+    tags = ["direction:out", "topic:topic1", "type:kafka"]
+    parent_hash = 0xDEADBEEF
+    node_hash = fnv1_64(("service" + "env" + "".join(tags)).encode("utf-8"))
+    expected = fnv1_64(struct.pack("<Q", node_hash) + struct.pack("<Q", parent_hash))
+    assert compute_pathway_hash("service", "env", tags, parent_hash) == expected
+
+
+@pytest.mark.parametrize("pathway_start_ms,current_edge_start_ms", [(0, 0), (1679672748000, 1679672749123), (-5, 7)])
+def test_pathway_encode_decode(pathway_start_ms, current_edge_start_ms):
+    hash_value = 0xFEDCBA9876543210
+    data = encode_pathway(hash_value, pathway_start_ms, current_edge_start_ms)
+    assert data == (
+        struct.pack("<Q", hash_value) + encode_var_int_64(pathway_start_ms) + encode_var_int_64(current_edge_start_ms)
+    )
+    assert decode_pathway(data) == (hash_value, pathway_start_ms, current_edge_start_ms)
+
+
+@pytest.mark.parametrize("data", [b"", b"\x01" * 7, b"\x01" * 8, b"\x01" * 8 + b"\x80"])
+def test_pathway_decode_truncated(data):
+    with pytest.raises(EOFError):
+        decode_pathway(data)
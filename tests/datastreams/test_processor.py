@@ -1,4 +1,5 @@
 import os
+import threading
 import time
 
 import mock
@@ -61,6 +62,60 @@ def test_kafka_offset_monitoring():
     assert processor._buckets[bucket_time_ns].latest_commit_offsets[ConsumerPartitionKey("group1", "topic1", 1)] == 14
 
 
+def test_data_streams_processor_concurrent_checkpoints():
+    dsm_processor = DataStreamsProcessor("http://localhost:8126")
+    dsm_processor.stop()
+    now = mocked_time
+
+    def produce(n):
+        for i in range(1000):
+            dsm_processor.on_checkpoint_creation(1, 2, ["direction:out", "topic:topicA", "type:kafka"], now, 1, n)
+            dsm_processor.track_kafka_produce("topicA", 0, i, now)
+
+    threads = [threading.Thread(target=produce, args=(n,)) for n in range(1, 9)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    assert len(dsm_processor._buckets) == 1
+    bucket = list(dsm_processor._buckets.values())[0]
+    stats = bucket.pathway_stats[(",".join(["direction:out", "topic:topicA", "type:kafka"]), 1, 2)]
+    assert stats.full_pathway_latency.count == 8000
+    assert stats.full_pathway_latency.sum == 1000 * sum(range(1, 9))
+    assert bucket.latest_produce_offsets[PartitionKey("topicA", 0)] == 999
+
+
+def test_data_streams_processor_serialize_buckets():
+    dsm_processor = DataStreamsProcessor("http://localhost:8126")
+    dsm_processor.stop()
+    now = mocked_time
+    now_ns = int(now * 1e9)
+    bucket_time_ns = int(now_ns - (now_ns % 1e10))
+    dsm_processor.on_checkpoint_creation(1, 2, ["direction:out", "topic:topicA", "type:kafka"], now, 1, 2)
+    dsm_processor.track_kafka_commit("group1", "topic1", 1, 14, now)
+    dsm_processor.track_kafka_produce("topic1", 1, 34, now)
+
+    buckets = dsm_processor._serialize_buckets()
+    assert len(buckets) == 1
+    assert buckets[0]["Start"] == bucket_time_ns
+    assert buckets[0]["Duration"] == dsm_processor._bucket_size_ns
+    (stats,) = buckets[0]["Stats"]
+    assert stats["EdgeTags"] == ["direction:out", "topic:topicA", "type:kafka"]
+    assert stats["Hash"] == 1
+    assert stats["ParentHash"] == 2
+    assert isinstance(stats["PathwayLatency"], bytes)
+    assert isinstance(stats["EdgeLatency"], bytes)
+    assert buckets[0]["Backlogs"] == [
+        {"Tags": ["type:kafka_commit", "consumer_group:group1", "topic:topic1", "partition:1"], "Value": 14},
+        {"Tags": ["type:kafka_produce", "topic:topic1", "partition:1"], "Value": 34},
+    ]
+
+    # Serialized buckets are cleared
+    assert len(dsm_processor._buckets) == 0
+    assert dsm_processor._serialize_buckets() == []
+
+
 def test_processor_atexit(ddtrace_run_python_code_in_subprocess):
     code = """
 import pytest
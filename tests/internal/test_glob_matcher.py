@@ -29,8 +29,31 @@ from ddtrace.internal.glob_matching import GlobMatcher
         ("test/na{2}/string", "test/na{2}/string", True),
         ("*a*a*a*a*a*a", "aaaaaaaaaaaaaaaaaaaaaaaaaax", False),
         ("*a*a*a*a*a*a", "aaaaaaaarrrrrrraaaraaarararaarararaarararaaa", True),
+        ("", "", True),
+        ("", "a", False),
+        ("**", "", True),
+        ("a**b", "ab", True),
+        ("a*?b", "ab", False),
+        ("a*?b", "axb", True),
+        ("*ing", "ing", True),
+        ("test*ing", "testing", True),
+        ("test*sting", "testing", False),  # Anchored segments must not overlap
+        ("ÉTÉ*", "été indien", True),  # Non-ASCII subjects are lowered too
+        ("?", "é", True),
     ],
 )
 def test_matching(pattern, string, result):
     glob_matcher = GlobMatcher(pattern)
     assert result == glob_matcher.match(string)
+
+
+@pytest.mark.parametrize(
+    "pattern,subject,result",
+    [
+        ("None", None, True),
+        ("1?", 12, True),
+        ("1*", 2, False),
+    ],
+)
+def test_matching_non_string(pattern, subject, result):
+    assert result == GlobMatcher(pattern).match(subject)
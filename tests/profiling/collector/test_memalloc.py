@@ -95,6 +95,25 @@ def test_iter_events():
     assert object_count >= 1000
 
 
+class _Allocator(object):
+    def allocate(self):
+        return [object() for _ in range(1000)]
+
+
+@pytest.mark.skipif(sys.version_info < (3, 11), reason="Class names are only resolved from code objects on 3.11+")
+def test_iter_events_class_name():
+    _memalloc.start(32, 10000, 512 * 1024)
+    _Allocator().allocate()
+    events, count, alloc_count = _memalloc.iter_events()
+    _memalloc.stop()
+
+    class_names = {
+        frame.class_name for (stack, nframe, thread_id), size, domain in events for frame in stack
+        if frame.function_name == "allocate"
+    }
+    assert class_names == {"_Allocator"}
+
+
 def test_iter_events_dropped():
     max_nframe = 32
     _memalloc.start(max_nframe, 100, 512 * 1024)
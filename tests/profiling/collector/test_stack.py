@@ -22,6 +22,11 @@ from tests.utils import flaky
 from . import test_collector
 
 
+try:
+    from ddtrace.profiling.collector import _nogil_sampler
+except ImportError:
+    _nogil_sampler = None
+
 # FIXME: remove version limitation when gevent segfaults are fixed on Python 3.12
 TESTING_GEVENT = os.getenv("DD_PROFILE_TEST_GEVENT", False) and sys.version_info < (3, 12)
 
@@ -96,6 +101,68 @@ def test_collect_once():
         pytest.fail("Unable to find MainThread")
 
 
+@pytest.mark.skipif(
+    _nogil_sampler is None or not _nogil_sampler.is_supported, reason="GIL-free sampling not supported"
+)
+def test_collect_gil_free():
+    r = recorder.Recorder()
+    s = stack.StackCollector(r, _gil_free_enabled=True)
+    s._init()
+    try:
+        t = threading.Thread(target=func1, name="gil-free-sleeper")
+        t.start()
+        time.sleep(0.5)
+        stack_events, exc_events = s.collect()
+        t.join()
+    finally:
+        _nogil_sampler.stop()
+
+    assert exc_events == []
+    for e in stack_events:
+        if e.thread_name == "gil-free-sleeper":
+            assert e.thread_native_id > 0
+            assert e.wall_time_ns > 0
+            assert [f.function_name for f in e.frames[:5]] == ["func5", "func4", "func3", "func2", "func1"]
+            break
+    else:
+        pytest.fail("Unable to find the sleeping thread")
+
+    assert _nogil_sampler.stats()["samples"] > 0
+
+
+@pytest.mark.skipif(
+    _nogil_sampler is None or not _nogil_sampler.is_supported, reason="GIL-free sampling not supported"
+)
+def test_collect_gil_free_freed_code():
+    # The frames of code objects freed before the samples are collected are still reported
+    stop = threading.Event()
+    code = compile("def spin(stop):\n    while not stop.is_set():\n        pass\n", "spin.py", "exec")
+    namespace = {}
+    exec(code, namespace)
+    t = threading.Thread(target=namespace["spin"], args=(stop,))
+    started_at_ns = time.monotonic_ns()
+    _nogil_sampler.start(0.001, 64)
+    try:
+        t.start()
+        time.sleep(0.1)
+        stop.set()
+        t.join()
+        del t, code, namespace
+        gc.collect()
+        samples = _nogil_sampler.collect()
+        collected_at_ns = time.monotonic_ns()
+    finally:
+        _nogil_sampler.stop()
+
+    # The samples carry the time they were taken at rather than the time they were collected
+    assert samples
+    assert all(started_at_ns <= sample[5] <= collected_at_ns for sample in samples)
+
+    frames = [frame for sample in samples for frame in sample[4] if frame[2] == "spin"]
+    assert frames
+    assert all(frame[0] == "spin.py" and frame[1] in (2, 3) and frame[3] == "" for frame in frames)
+
+
 def _find_sleep_event(events, class_name):
     class_method_found = False
     class_classmethod_found = False
@@ -137,6 +204,35 @@ def test_collect_once_with_class():
         assert SomeClass.sleep_class()
 
 
+def test_collect_once_with_inherited_method():
+    # From Python 3.11, the class name is taken from the qualified name of the code object: it is the class which
+    # defines the method rather than the class of the instance.
+    class_name = "BaseClass" if sys.version_info >= (3, 11) else "SubClass"
+
+    class BaseClass(object):
+        @classmethod
+        def sleep_class(cls):
+            # type: (...) -> bool
+            return cls().sleep_instance()
+
+        def sleep_instance(self):
+            # type: (...) -> bool
+            for _ in range(5):
+                if _find_sleep_event(r.events[stack_event.StackSampleEvent], class_name):
+                    return True
+                time.sleep(1)
+            return False
+
+    class SubClass(BaseClass):
+        pass
+
+    r = recorder.Recorder()
+    s = stack.StackCollector(r)
+
+    with s:
+        assert SubClass.sleep_class()
+
+
 @pytest.mark.skipif(sys.platform == "win32", reason="FIXME: this test is flaky on Windows")
 def test_collect_once_with_class_not_right_type():
     # type: (...) -> None
@@ -23,6 +23,96 @@ def test_list_tasks_nogevent():
     assert _task.list_tasks(compat.main_thread.ident) == []
 
 
+@pytest.mark.subprocess
+def test_sample_tasks_asyncio():
+    import asyncio
+    import threading
+
+    from ddtrace.profiling.collector import _task
+
+    async def sleeper():
+        await asyncio.sleep(10)
+
+    async def main():
+        tasks = [asyncio.create_task(sleeper()) for _ in range(10)]
+        await asyncio.sleep(0)
+
+        thread_id = threading.main_thread().ident
+        all_tasks = _task.list_tasks(thread_id)
+        assert sorted(task_id for task_id, _, _ in all_tasks) == sorted(id(t) for t in asyncio.all_tasks())
+
+        seen = set()
+        for _ in range(4):
+            sampled, ntasks = _task.sample_tasks(thread_id, 3)
+            assert ntasks == 11
+            assert len(sampled) == 3
+            for task_id, task_name, task_frame in sampled:
+                assert task_frame.f_code.co_name in ("main", "sleeper")
+                seen.add(task_id)
+        # Successive calls cycle through the tasks
+        assert len(seen) == 11
+
+        for t in tasks:
+            t.cancel()
+
+    asyncio.run(main())
+
+
+@pytest.mark.subprocess
+def test_sample_tasks_asyncio_per_loop():
+    import asyncio
+    import threading
+
+    from ddtrace.profiling.collector import _task
+
+    # A second loop with its own tasks runs in another thread
+    other_loop = asyncio.new_event_loop()
+    other_tasks_ready = threading.Event()
+
+    async def sleeper():
+        await asyncio.sleep(10)
+
+    async def other_main():
+        for _ in range(4):
+            other_loop.create_task(sleeper())
+        await asyncio.sleep(0)
+        other_tasks_ready.set()
+        await asyncio.sleep(10)
+
+    def run_other_loop():
+        try:
+            other_loop.run_until_complete(other_main())
+        except RuntimeError:
+            # The loop is stopped before the main task completes
+            pass
+
+    other_thread = threading.Thread(target=run_other_loop)
+    other_thread.start()
+    other_tasks_ready.wait()
+
+    async def main():
+        tasks = [asyncio.create_task(sleeper()) for _ in range(10)]
+        await asyncio.sleep(0)
+
+        thread_id = threading.main_thread().ident
+        seen = set()
+        for _ in range(4):
+            sampled, ntasks = _task.sample_tasks(thread_id, 3)
+            assert ntasks == 11
+            seen.update(task_id for task_id, _, _ in sampled)
+            # Sampling the tasks of the other thread does not move the rotation of this one
+            _, other_ntasks = _task.sample_tasks(other_thread.ident, 2)
+            assert other_ntasks == 5
+        assert len(seen) == 11
+
+        for t in tasks:
+            t.cancel()
+
+    asyncio.run(main())
+    other_loop.call_soon_threadsafe(other_loop.stop)
+    other_thread.join()
+
+
 @pytest.mark.skipif(not TESTING_GEVENT, reason="only works with gevent")
 @pytest.mark.subprocess(ddtrace_run=True)
 def test_list_tasks_gevent():
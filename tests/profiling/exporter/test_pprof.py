@@ -1,3 +1,4 @@
+import gzip
 import os
 import platform
 
@@ -658,26 +659,89 @@ TEST_EVENTS = {
 }
 
 
-def test_string_table():
-    t = pprof._StringTable()
-    assert len(t) == 1
-    id1 = t.index("foobar")
-    assert len(t) == 2
-    assert id1 == t.index("foobar")
-    assert len(t) == 2
-    id2 = t.index("foobaz")
-    assert len(t) == 3
-    assert id2 == t.index("foobaz")
-    assert len(t) == 3
-    assert id1 != id2
+def _stack_sample_event(frames, **kwargs):
+    return stack_event.StackSampleEvent(
+        timestamp=1,
+        thread_id=67892304,
+        thread_native_id=123987,
+        thread_name="MainThread",
+        frames=frames,
+        nframes=len(frames),
+        wall_time_ns=1324,
+        cpu_time_ns=1321,
+        sampling_period=1000000,
+        **kwargs
+    )
+
+
+def test_builder_aggregates_samples():
+    b = pprof._PprofBuilder()
+    frames = [("foobar.py", 23, "func1", ""), ("foobar.py", 44, "func2", "")]
+    b.add_stack_event(_stack_sample_event(frames))
+    b.add_stack_event(_stack_sample_event(frames))
+    b.add_stack_event(_stack_sample_event(frames, span_id=1))
+
+    profile, filenames = b.build(1, 6, "bonjour")
+
+    assert filenames == {"foobar.py"}
+    assert len(profile.sample) == 2
+    assert len(profile.location) == 2
+    assert len(profile.function) == 2
+    assert profile.string_table[0] == ""
+    assert len(profile.string_table) == len(set(profile.string_table))
+    assert sorted(tuple(s.value[:3]) for s in profile.sample) == [(1, 1321, 1324), (2, 2642, 2648)]
+    assert profile.period == 1000000
+
+
+def test_builder_incremental():
+    b = pprof._PprofBuilder()
+    b.add_stack_event(_stack_sample_event([("foobar.py", 23, "func1", "")]))
+    b.add_stack_event(_stack_sample_event([("foobaz.py", 44, "func2", "")]))
+    first, _ = b.build(1, 6, "bonjour")
+    assert len(first.sample) == 2
+    assert "func1" in first.string_table
+
+    # Only the entries referenced by the samples of the period are exported
+    b.add_stack_event(_stack_sample_event([("foobaz.py", 44, "func2", "")]))
+    second, filenames = b.build(7, 6, "bonjour")
+    assert filenames == {"foobaz.py"}
+    assert len(second.sample) == 1
+    assert len(second.location) == 1
+    assert [second.string_table[f.name] for f in second.function] == ["func2"]
+    assert "func1" not in second.string_table
+    assert second.time_nanos == 7
+
+    # Nothing is left over from the previous period
+    empty, _ = b.build(13, 6, "bonjour")
+    assert len(empty.sample) == 0
+    assert len(empty.location) == 0
+
+
+def test_builder_gzip():
+    b = pprof._PprofBuilder()
+    events = [_stack_sample_event([("foobar.py", i, "func%d" % i, "")]) for i in range(100)]
+    for e in events:
+        b.add_stack_event(e)
+    raw, _ = b.build(1, 6, "bonjour")
+    for e in events:
+        b.add_stack_event(e)
+    compressed, _ = b.build(1, 6, "bonjour", True)
+
+    data = compressed.SerializeToGzip()
+    assert data.startswith(b"\x1f\x8b\x08\x00")
+    assert gzip.decompress(data) == compressed.SerializeToString() == raw.SerializeToString()
+    assert compressed.program_name == "bonjour"
+    assert len(compressed.sample) == 100
 
 
 def test_to_str_none():
-    c = pprof._PprofConverter()
-    id1 = c._str(None)
-    id2 = c._str("None")
-    id_o = c._str("foobar")
-    assert id1 == id2 != id_o
+    b = pprof._PprofBuilder()
+    b.add_stack_event(_stack_sample_event([("foobar.py", 23, "func1", "")], task_id=None))
+    profile, _ = b.build(1, 6, "bonjour")
+    (sample,) = profile.sample
+    labels = {profile.string_table[label.key]: profile.string_table[label.str] for label in sample.label}
+    assert labels["task id"] == ""
+    assert "None" not in profile.string_table
 
 
 @mock.patch("ddtrace.internal.utils.config.get_application_name")
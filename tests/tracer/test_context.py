@@ -330,6 +330,18 @@ def test_traceparent(context, expected_traceparent):
             # = is encoded as ~
             "dd=s:1;o:_r_um~",
         ),
+        (
+            Context(
+                trace_id=11803532876627986230,
+                span_id=67667974448284343,
+                sampling_priority=1,
+                meta={
+                    "tracestate": "congo=t61rcWkgMzE,dd=s:1;o:rum,odd=ok",
+                },
+                dd_origin="rum",
+            ),
+            "dd=s:1;o:rum,congo=t61rcWkgMzE,odd=ok",
+        ),
     ],
     ids=[
         "basic_ts_with_extra_listmember",
@@ -341,6 +353,7 @@ def test_traceparent(context, expected_traceparent):
         "equals_and_comma_chars_replaced",
         "key_outside_range_replaced_w_underscore",
         "test_origin_specific_replacement",
+        "dd_list_member_not_first",
     ],
 )
 def test_tracestate(context, expected_tracestate):
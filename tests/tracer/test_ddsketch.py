@@ -0,0 +1,80 @@
+import random
+
+from ddsketch import LogCollapsingLowestDenseDDSketch
+from ddsketch.pb.proto import DDSketchProto
+import pytest
+
+from ddtrace.internal._ddsketch import DDSketch
+
+
+def _reference_sketch():
+    return LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)
+
+
+def _random_values(rng, n):
+    # Values spanning many orders of magnitude, of both signs, force bins to be collapsed at both ends
+    return [rng.choice([1, -1]) * 10 ** rng.uniform(-9, 15) for _ in range(n)] + [0.0, 1e-320, 42]
+
+
+def test_ddsketch_empty():
+    sketch = DDSketch()
+    assert sketch.count == 0
+    assert sketch.sum == 0
+    assert sketch.to_proto() == DDSketchProto.to_proto(_reference_sketch()).SerializeToString()
+
+
+def test_ddsketch_add():
+    sketch = DDSketch()
+    sketch.add(0)
+    sketch.add(2.5)
+    sketch.add(10, weight=2.0)
+    assert sketch.count == 4
+    assert sketch.sum == 22.5
+    assert sketch.zero_count == 1
+
+    with pytest.raises(ValueError):
+        sketch.add(1, weight=0)
+
+
+@pytest.mark.parametrize("seed", range(10))
+def test_ddsketch_proto_matches_ddsketch(seed):
+    rng = random.Random(seed)
+    sketch = DDSketch()
+    reference = _reference_sketch()
+    for value in _random_values(rng, rng.randint(1, 3000)):
+        sketch.add(value)
+        reference.add(value)
+
+    assert sketch.count == reference.count
+    assert sketch.to_proto() == DDSketchProto.to_proto(reference).SerializeToString()
+
+
+@pytest.mark.parametrize("seed", range(10))
+def test_ddsketch_merge_matches_ddsketch(seed):
+    rng = random.Random(seed)
+    sketches = [DDSketch() for _ in range(2)]
+    references = [_reference_sketch() for _ in range(2)]
+    for sketch, reference in zip(sketches, references):
+        for value in _random_values(rng, rng.randint(0, 1000)):
+            sketch.add(value)
+            reference.add(value)
+
+    sketches[0].merge(sketches[1])
+    references[0].merge(references[1])
+
+    assert sketches[0].count == references[0].count
+    assert sketches[0].to_proto() == DDSketchProto.to_proto(references[0]).SerializeToString()
+
+
+@pytest.mark.parametrize("seed", range(5))
+def test_ddsketch_quantiles_match_ddsketch(seed):
+    rng = random.Random(seed)
+    sketch = DDSketch()
+    reference = _reference_sketch()
+    for value in _random_values(rng, rng.randint(1, 1000)):
+        sketch.add(value)
+        reference.add(value)
+
+    for quantile in (0, 0.1, 0.5, 0.9, 0.99, 1):
+        assert sketch.get_quantile_value(quantile) == reference.get_quantile_value(quantile)
+    assert DDSketch().get_quantile_value(0.5) is None
@@ -290,3 +290,9 @@ class GlobalConfigTestCase(TestCase):
         ), override_env(dict(DD_TRACE_PROPAGATION_STYLE="b3 single header")):
             style = _parse_propagation_styles("DD_TRACE_PROPAGATION_STYLE", default="datadog")
             assert style == ["b3"]
+
+    def test_span_aggregator_rlock_deprecation(self):
+        with pytest.warns(DeprecationWarning, match="DD_TRACE_SPAN_AGGREGATOR_RLOCK is deprecated"), override_env(
+            dict(DD_TRACE_SPAN_AGGREGATOR_RLOCK="true")
+        ):
+            Config()
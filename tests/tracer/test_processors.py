@@ -244,6 +244,40 @@ def test_aggregator_partial_flush_2_spans():
     assert parent.get_metric("_dd.py.partial_flush") is None
 
 
+def test_aggregator_span_not_started():
+    writer = DummyWriter()
+    aggr = SpanAggregator(partial_flush_enabled=True, partial_flush_min_spans=0, trace_processors=[], writer=writer)
+
+    # A span that was not started with the aggregator is not flushed nor kept around when it finishes
+    span = Span("span", on_finish=[aggr.on_span_finish])
+    span.finish()
+    assert writer.pop() == []
+    assert len(aggr._traces) == 0
+
+
+def test_aggregator_processors_finish_spans():
+    writer = DummyWriter()
+
+    class Proc(TraceProcessor):
+        def process_trace(self, trace):
+            # Trace processors are not run while the aggregator updates its state, so they can finish other spans
+            if other.duration_ns is None:
+                other.finish()
+            return trace
+
+    aggr = SpanAggregator(
+        partial_flush_enabled=False, partial_flush_min_spans=0, trace_processors=[Proc()], writer=writer
+    )
+
+    span = Span("span", on_finish=[aggr.on_span_finish])
+    aggr.on_span_start(span)
+    other = Span("other", on_finish=[aggr.on_span_finish])
+    aggr.on_span_start(other)
+    span.finish()
+    assert writer.pop() == [other, span]
+    assert len(aggr._traces) == 0
+
+
 def test_trace_top_level_span_processor_partial_flushing():
     """Parent span and child span have the same service name"""
     tracer = Tracer()
@@ -16,6 +16,9 @@ from ddtrace.internal.constants import LAST_DD_PARENT_ID_KEY
 from ddtrace.internal.constants import PROPAGATION_STYLE_B3_MULTI
 from ddtrace.internal.constants import PROPAGATION_STYLE_B3_SINGLE
 from ddtrace.internal.constants import PROPAGATION_STYLE_DATADOG
+from ddtrace.propagation._codec import decimal_to_id
+from ddtrace.propagation._codec import hex_to_id
+from ddtrace.propagation._codec import tracestate_add_p
 from ddtrace.propagation._utils import get_wsgi_header
 from ddtrace.propagation.http import _HTTP_BAGGAGE_PREFIX
 from ddtrace.propagation.http import _HTTP_HEADER_B3_FLAGS
@@ -825,6 +828,48 @@ def test_extract_traceparent(caplog, headers, expected_tuple, expected_logging,
                 assert expected_log in caplog.text
 
 
+@pytest.mark.parametrize(
+    "value", ["0", "1", "5678", "18446744073709551615", "18446744073709551616", "-1", " 12 ", "1_0", "", "id", "٣"]
+)
+def test_decimal_to_id(value):
+    try:
+        expected = int(value)
+    except ValueError:
+        with pytest.raises(ValueError):
+            decimal_to_id(value)
+    else:
+        assert decimal_to_id(value) == expected
+
+
+@pytest.mark.parametrize(
+    "value",
+    ["0", "ff", "FF", "64fe8b2a57d3eff7", "80f198ee56343ba864fe8b2a57d3eff7", "180f198ee56343ba864fe8b2a57d3eff7", "0x1f"]
+    + ["-1", "", "g", "e457b5a2e4d86bd1-1"],
+)
+def test_hex_to_id(value):
+    try:
+        expected = int(value, 16)
+    except ValueError:
+        with pytest.raises(ValueError):
+            hex_to_id(value)
+    else:
+        assert hex_to_id(value) == expected
+
+
+@pytest.mark.parametrize(
+    "ts,expected",
+    [
+        ("", "dd=p:00f067aa0ba902b7"),
+        ("congo=t61rcWkgMzE", "dd=p:00f067aa0ba902b7,congo=t61rcWkgMzE"),
+        ("dd=s:2;o:rum,congo=t61rcWkgMzE", "dd=p:00f067aa0ba902b7;s:2;o:rum,congo=t61rcWkgMzE"),
+        # Only the dd list member is updated
+        ("congo=dd=1,odd=2,dd=s:2", "congo=dd=1,odd=2,dd=p:00f067aa0ba902b7;s:2"),
+    ],
+)
+def test_tracestate_add_p(ts, expected):
+    assert tracestate_add_p(ts, 67667974448284343) == expected
+
+
 @pytest.mark.parametrize(
     "ts_string,expected_tuple,expected_logging,expected_exception",
     [
@@ -1,3 +1,4 @@
+from array import array
 from itertools import chain
 import multiprocessing as mp
 
@@ -190,6 +191,34 @@ def test_threadsafe():
     assert len(ids) > 0
 
 
+def test_thread_states():
+    # Each thread derives its own state, so that threads never share one
+    states = []
+
+    def target():
+        _rand.rand64bits()
+        states.append(_rand._getstate())
+
+    ts = [threading.Thread(target=target) for _ in range(5)]
+    for t in ts:
+        t.start()
+    for t in ts:
+        t.join()
+
+    assert len(set(states)) == len(ts)
+
+
+def test_fill_rand64bits():
+    ids = array("Q", bytes(8 * 2**16))
+    _rand.fill_rand64bits(ids)
+    assert len(set(ids)) == len(ids)
+
+    # Batches and single numbers come from the same stream
+    assert _rand.rand64bits() not in set(ids)
+
+    _rand.fill_rand64bits(array("Q"))
+
+
 def test_tracer_usage_fork():
     q = MPQueue()
     pid = os.fork()
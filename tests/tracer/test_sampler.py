@@ -629,6 +629,27 @@ def test_sampling_rule_matches_exception():
         )
 
 
+def test_datadog_sampler_highest_precedence_rule_matching():
+    rules = [
+        SamplingRule(sample_rate=0.1, service="my-*", name="test.span"),
+        SamplingRule(sample_rate=0.2, service="my-*", tags={"env": "prod"}),
+        SamplingRule(sample_rate=0.3, service=re.compile(r"^other-")),
+        SamplingRule(sample_rate=0.4),
+    ]
+    sampler = DatadogSampler(rules=rules)
+
+    assert sampler._get_highest_precedence_rule_matching(create_span(service="MY-service", name="test.span")) is rules[0]
+    span = create_span(service="my-service", name="other.span")
+    span.set_tag("env", "prod")
+    assert sampler._get_highest_precedence_rule_matching(span) is rules[1]
+    assert sampler._get_highest_precedence_rule_matching(create_span(service="other-service")) is rules[2]
+    assert sampler._get_highest_precedence_rule_matching(create_span(service="my-service")) is rules[3]
+
+    # Rules changed after the sampler was created are matched too
+    sampler.rules.pop()
+    assert sampler._get_highest_precedence_rule_matching(create_span(service="my-service")) is None
+
+
 @pytest.mark.subprocess(
     parametrize={"DD_TRACE_128_BIT_TRACEID_GENERATION_ENABLED": ["true", "false"]},
 )
@@ -663,6 +663,60 @@ def test_span_preconditions(arg):
         Span("test", **{arg: "foo"})
 
 
+def test_span_data_fields():
+    span = Span("test", trace_id=(1 << 100) + 42, span_id=2**64 - 1)
+    assert span.trace_id == (1 << 100) + 42
+    assert span._trace_id_64bits == 42
+    assert span.span_id == 2**64 - 1
+    assert span.parent_id is None
+    assert span.duration_ns is None
+
+    span.parent_id = 0
+    assert span.parent_id == 0
+    span.parent_id = None
+    assert span.parent_id is None
+
+    span.trace_id = 7
+    assert span._trace_id_64bits == 7
+
+    span.finish()
+    assert span.duration_ns is not None
+    span.duration_ns = None
+    assert not span.finished
+
+
+@pytest.mark.parametrize(
+    "field,value",
+    [
+        ("span_id", -1),
+        ("span_id", 2**64),
+        ("parent_id", 2**64 + 1),
+        ("start_ns", 1.5e18),
+        ("start_ns", 2**63),
+        ("duration_ns", 0.5),
+        ("error", 2**31),
+        ("error", "1"),
+    ],
+)
+def test_span_data_fields_not_native(field, value):
+    # Values which do not fit the native fields are kept as they are
+    span = Span("test")
+    setattr(span, field, value)
+    assert getattr(span, field) == value
+    setattr(span, field, 1)
+    assert getattr(span, field) == 1
+
+
+def test_span_data_fields_unset():
+    class UninitializedSpan(Span):
+        def __init__(self):
+            pass
+
+    # Like with the slots of the Python span, reading a field which was never set raises
+    with pytest.raises(AttributeError):
+        UninitializedSpan().span_id
+
+
 def test_span_pprint():
     root = Span("test.span", service="s", resource="r", span_type=SpanTypes.WEB)
     root.set_tag("t", "v")
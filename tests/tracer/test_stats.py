@@ -0,0 +1,124 @@
+import random
+import threading
+
+from ddsketch import LogCollapsingLowestDenseDDSketch
+from ddsketch.pb.proto import DDSketchProto
+import msgpack
+
+from ddtrace.internal.processor._stats import SpanStatsAggregator
+
+
+def _sketch_bytes(values):
+    sketch = LogCollapsingLowestDenseDDSketch(0.00775, bin_limit=2048)
+    for value in values:
+        sketch.add(value)
+    return DDSketchProto.to_proto(sketch).SerializeToString()
+
+
+def test_span_stats_aggregator_empty():
+    assert SpanStatsAggregator().flush("", "", "", 10) is None
+
+
+def test_span_stats_aggregator_payload():
+    aggregator = SpanStatsAggregator()
+    aggregator.add(10, "web.request", "svc", "GET /", "web", 200, False, 5, True, False)
+    aggregator.add(10, b"web.request", "svc", "GET /", "web", 200, False, 7, False, True)
+    aggregator.add(10, "db.query", "", "SELECT", "", 0, True, 3, False, False)
+    aggregator.add(20, "web.request", "svc", "GET /", "web", 500, False, 11, True, True)
+
+    payload = aggregator.flush("host", "prod", "", 10)
+    assert msgpack.unpackb(payload) == {
+        "Stats": [
+            {
+                "Start": 10,
+                "Duration": 10,
+                "Stats": [
+                    {
+                        "Name": "web.request",
+                        "Resource": "GET /",
+                        "Synthetics": False,
+                        "HTTPStatusCode": 200,
+                        "Hits": 2,
+                        "TopLevelHits": 1,
+                        "Duration": 12,
+                        "Errors": 1,
+                        "OkSummary": _sketch_bytes([5]),
+                        "ErrorSummary": _sketch_bytes([7]),
+                        "Service": "svc",
+                        "Type": "web",
+                    },
+                    {
+                        "Name": "db.query",
+                        "Resource": "SELECT",
+                        "Synthetics": True,
+                        "HTTPStatusCode": 0,
+                        "Hits": 1,
+                        "TopLevelHits": 0,
+                        "Duration": 3,
+                        "Errors": 0,
+                        "OkSummary": _sketch_bytes([3]),
+                        "ErrorSummary": _sketch_bytes([]),
+                    },
+                ],
+            },
+            {
+                "Start": 20,
+                "Duration": 10,
+                "Stats": [
+                    {
+                        "Name": "web.request",
+                        "Resource": "GET /",
+                        "Synthetics": False,
+                        "HTTPStatusCode": 500,
+                        "Hits": 1,
+                        "TopLevelHits": 1,
+                        "Duration": 11,
+                        "Errors": 1,
+                        "OkSummary": _sketch_bytes([]),
+                        "ErrorSummary": _sketch_bytes([11]),
+                        "Service": "svc",
+                        "Type": "web",
+                    },
+                ],
+            },
+        ],
+        "Hostname": "host",
+        "Env": "prod",
+    }
+
+    # Flushing clears the aggregated stats
+    assert aggregator.flush("host", "prod", "", 10) is None
+
+
+def test_span_stats_aggregator_sketch_matches_ddsketch():
+    rng = random.Random(0)
+    # Durations spanning many orders of magnitude force the lowest bins to be collapsed
+    durations = [int(10 ** rng.uniform(0, 18)) for _ in range(2000)] + [0, -1, -(10**9)]
+
+    aggregator = SpanStatsAggregator()
+    for duration in durations:
+        aggregator.add(0, "op", "svc", "res", "", 0, False, duration, True, False)
+
+    (stats,) = msgpack.unpackb(aggregator.flush("", "", "", 10))["Stats"][0]["Stats"]
+    assert stats["OkSummary"] == _sketch_bytes(durations)
+
+
+def test_span_stats_aggregator_threads():
+    aggregator = SpanStatsAggregator()
+    nthreads, nspans = 8, 1000
+
+    def finish_spans():
+        for i in range(nspans):
+            aggregator.add(i % 2, "op%d" % (i % 3), "svc", "res", "", 200, False, i + 1, True, i % 10 == 0)
+
+    threads = [threading.Thread(target=finish_spans) for _ in range(nthreads)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    buckets = msgpack.unpackb(aggregator.flush("", "", "", 10))["Stats"]
+    assert sorted(bucket["Start"] for bucket in buckets) == [0, 1]
+    assert all(len(bucket["Stats"]) == 3 for bucket in buckets)
+    assert sum(stats["Hits"] for bucket in buckets for stats in bucket["Stats"]) == nthreads * nspans
+    assert sum(stats["Errors"] for bucket in buckets for stats in bucket["Stats"]) == nthreads * nspans // 10
@@ -77,6 +77,11 @@ def test_decode_tagset_string(header, expected):
         # Non-space whitespace characters are not allowed in key or value
         "key=value\r\n",
         "key\t=value\r\n",
+        # Only ASCII characters are allowed
+        ensure_text("key=välue"),
+        ensure_text("kéy=value"),
+        "key=value,,",
+        "key=value, ",
     ],
 )
 def test_decode_tagset_string_malformed(header):
@@ -166,6 +171,19 @@ def test_encode_tagset_values_max_size():
     assert ex.current_results == "a=1,b=2"
 
 
+def test_tagset_large_values():
+    """Test that tagsets larger than the default max size are encoded and decoded"""
+    values = {"_dd.p.key{}".format(i): "value {}".format(i) * 20 for i in range(20)}
+    header = encode_tagset_values(values, max_size=8192)
+    assert len(header) > 512
+    assert values == decode_tagset_string(header, max_size=8192)
+
+    with pytest.raises(TagsetMaxSizeEncodeError) as ex_info:
+        encode_tagset_values(values, max_size=1024)
+    assert header.startswith(ex_info.value.current_results)
+    assert len(ex_info.value.current_results) <= 1024
+
+
 def test_encode_tagset_values_invalid_type():
     """
     encode_tagset_values accepts `values` as an `object` instead of `dict`